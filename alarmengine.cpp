@@ -0,0 +1,304 @@
+#include "alarmengine.h"
+#include "profiler.h"
+
+#include <QFile>
+#include <QRegularExpression>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+bool parseMetric(const QString &name, Metric &metric) {
+    if (name == "temperature")
+        metric = Metric::Temperature;
+    else if (name == "humidity")
+        metric = Metric::Humidity;
+    else if (name == "pressure")
+        metric = Metric::Pressure;
+    else
+        return false;
+    return true;
+}
+
+} // namespace
+
+/**
+ * @brief Конструктор; правил нет, тревоги не поднимаются.
+ */
+AlarmEngine::AlarmEngine(QObject *parent)
+    : QObject(parent)
+{
+    pendingEvents.reserve(QueueCapacity);
+    deliveredEvents.reserve(QueueCapacity);
+    notifyTimer.setSingleShot(true);
+    notifyTimer.setInterval(NotifyIntervalMs);
+    connect(&notifyTimer, &QTimer::timeout, this, &AlarmEngine::flush);
+}
+
+void AlarmEngine::setRules(const QVector<AlarmRule> &rules) {
+    ruleList = rules;
+    compile();
+    resetChannels();
+}
+
+bool AlarmEngine::loadRules(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "Не удалось открыть файл правил тревог" << path;
+        return false;
+    }
+    QVector<AlarmRule> rules;
+    QString error;
+    if (!parseRules(QString::fromUtf8(file.readAll()), rules, &error)) {
+        qWarning().noquote() << QString("%1: %2").arg(path, error);
+        return false;
+    }
+    setRules(rules);
+    return true;
+}
+
+bool AlarmEngine::parseRules(const QString &text, QVector<AlarmRule> &rules, QString *error) {
+    const QRegularExpression separator("\\s+");
+    const QStringList lines = text.split('\n');
+    for (int lineNumber = 0; lineNumber < lines.size(); ++lineNumber) {
+        const QString line = lines[lineNumber].trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        const QStringList fields = line.split(separator);
+        AlarmRule rule;
+        bool ok = fields.size() >= 4 && parseMetric(fields[1], rule.metric);
+        if (ok && fields[0] != "*") {
+            rule.roomId = fields[0].toInt(&ok);
+            ok = ok && rule.roomId >= 0;
+        }
+        int holdField = 0;
+        if (ok && fields[2] == "range" && fields.size() >= 5) {
+            bool lowOk = false;
+            bool highOk = false;
+            rule.kind = AlarmRule::Range;
+            rule.low = fields[3].toDouble(&lowOk);
+            rule.high = fields[4].toDouble(&highOk);
+            ok = lowOk && highOk && rule.low <= rule.high;
+            holdField = 5;
+        } else if (ok && fields[2] == "rate") {
+            rule.kind = AlarmRule::RateOfChange;
+            rule.maxRatePerMinute = std::abs(fields[3].toDouble(&ok));
+            holdField = 4;
+        } else {
+            ok = false;
+        }
+        if (ok && fields.size() > holdField) {
+            const double holdSeconds = fields[holdField].toDouble(&ok);
+            ok = ok && holdSeconds >= 0.0 && fields.size() == holdField + 1;
+            rule.holdMs = qint64(holdSeconds * 1000.0);
+        }
+        if (!ok) {
+            if (error)
+                *error = QString("строка %1: неверное правило \"%2\"").arg(lineNumber + 1).arg(line);
+            return false;
+        }
+        rules.append(rule);
+    }
+    return true;
+}
+
+/**
+ * @brief Меняет число комнат; таблицы порогов пересобираются, состояние прежних комнат сохраняется.
+ */
+void AlarmEngine::resize(int roomCount) {
+    roomCount = std::max(roomCount, 0);
+    if (roomCount == rooms)
+        return;
+    for (int metric = 0; metric < MetricCount; ++metric) {
+        for (int roomId = roomCount; roomId < rooms; ++roomId) {
+            const Channel &channel = channels[metric][size_t(roomId)];
+            activeAlarms -= int(channel.active[AlarmRule::Range]) + int(channel.active[AlarmRule::RateOfChange]);
+        }
+        Channel empty = {};
+        std::fill(std::begin(empty.pendingSinceMs), std::end(empty.pendingSinceMs), NotPending);
+        channels[metric].resize(size_t(roomCount), empty);
+    }
+    rooms = roomCount;
+    compile();
+}
+
+/**
+ * @brief Сводит правила в таблицы порогов.
+ *
+ * Сначала во все комнаты записываются общие правила, затем поверх -
+ * правила отдельных комнат; среди правил одного уровня действует последнее.
+ * Правила комнат за пределами roomCount() не действуют до resize().
+ */
+void AlarmEngine::compile() {
+    const double infinity = std::numeric_limits<double>::infinity();
+    const Threshold none = {-infinity, infinity, infinity, 0, 0, -1, -1};
+    Threshold global[MetricCount] = {none, none, none};
+
+    auto apply = [](Threshold &threshold, const AlarmRule &rule, qint32 index) {
+        if (rule.kind == AlarmRule::Range) {
+            threshold.low = rule.low;
+            threshold.high = rule.high;
+            threshold.rangeHoldMs = rule.holdMs;
+            threshold.rangeRule = index;
+        } else {
+            threshold.maxRatePerMs = rule.maxRatePerMinute / 60000.0;
+            threshold.rateHoldMs = rule.holdMs;
+            threshold.rateRule = index;
+        }
+    };
+
+    for (int i = 0; i < ruleList.size(); ++i) {
+        const AlarmRule &rule = ruleList[i];
+        if (rule.roomId == AlarmRule::AllRooms)
+            apply(global[int(rule.metric)], rule, i);
+    }
+    for (int metric = 0; metric < MetricCount; ++metric)
+        thresholds[metric].assign(size_t(rooms), global[metric]);
+    for (int i = 0; i < ruleList.size(); ++i) {
+        const AlarmRule &rule = ruleList[i];
+        if (rule.roomId >= 0 && rule.roomId < rooms)
+            apply(thresholds[int(rule.metric)][size_t(rule.roomId)], rule, i);
+    }
+}
+
+void AlarmEngine::resetChannels() {
+    for (int metric = 0; metric < MetricCount; ++metric) {
+        for (Channel &channel : channels[metric]) {
+            channel = Channel();
+            std::fill(std::begin(channel.pendingSinceMs), std::end(channel.pendingSinceMs), NotPending);
+        }
+    }
+    activeAlarms = 0;
+    ///< События ссылаются на номера прежних правил
+    pendingEvents.clear();
+    deliveredEvents.clear();
+    notifyTimer.stop();
+}
+
+/**
+ * @brief Проверяет пачку измерений (вызывается рядом с RoomStateStore::applySamples()).
+ */
+void AlarmEngine::evaluateSamples(const SensorSample *samples, int count) {
+    CLIMATE_PROFILE_SCOPE(AlarmCheck);
+    for (int i = 0; i < count; ++i) {
+        const SensorSample &sample = samples[i];
+        if (sample.roomId < 0 || sample.roomId >= rooms)
+            continue;
+        check(sample.roomId, int(Metric::Temperature), sample.timestampMs, sample.temperature);
+        check(sample.roomId, int(Metric::Humidity), sample.timestampMs, sample.humidity);
+        check(sample.roomId, int(Metric::Pressure), sample.timestampMs, sample.pressure);
+    }
+}
+
+void AlarmEngine::evaluate(int roomId, qint64 timestampMs, double temperature, double humidity, double pressure) {
+    const SensorSample sample = {timestampMs, roomId, 0, temperature, humidity, pressure};
+    evaluateSamples(&sample, 1);
+}
+
+bool AlarmEngine::isActive(int roomId, Metric metric, AlarmRule::Kind kind) const {
+    return roomId >= 0 && roomId < rooms && channels[int(metric)][size_t(roomId)].active[kind];
+}
+
+bool AlarmEngine::isRoomActive(int roomId) const {
+    if (roomId < 0 || roomId >= rooms)
+        return false;
+    for (int metric = 0; metric < MetricCount; ++metric) {
+        const Channel &channel = channels[metric][size_t(roomId)];
+        for (int kind = 0; kind < AlarmRule::KindCount; ++kind) {
+            if (channel.active[kind])
+                return true;
+        }
+    }
+    return false;
+}
+
+void AlarmEngine::check(int roomId, int metric, qint64 timestampMs, double value) {
+    const Threshold &threshold = thresholds[metric][size_t(roomId)];
+    Channel &channel = channels[metric][size_t(roomId)];
+
+    if (threshold.rangeRule >= 0) {
+        const bool violated = value < threshold.low || value > threshold.high;
+        update(roomId, metric, AlarmRule::Range, threshold.rangeRule, threshold.rangeHoldMs,
+               violated, timestampMs, value, channel);
+    }
+
+    ///< Скорость считается только по измерениям, идущим вперёд по времени
+    if (channel.hasLast && timestampMs <= channel.lastMs)
+        return;
+    if (threshold.rateRule >= 0 && channel.hasLast) {
+        const double ratePerMs = std::abs(value - channel.lastValue) / double(timestampMs - channel.lastMs);
+        update(roomId, metric, AlarmRule::RateOfChange, threshold.rateRule, threshold.rateHoldMs,
+               ratePerMs > threshold.maxRatePerMs, timestampMs, ratePerMs * 60000.0, channel);
+    }
+    channel.lastValue = value;
+    channel.lastMs = timestampMs;
+    channel.hasLast = true;
+}
+
+/**
+ * @brief Применяет задержку holdMs к одному условию и ставит событие при смене состояния.
+ */
+void AlarmEngine::update(int roomId, int metric, AlarmRule::Kind kind, qint32 rule, qint64 holdMs,
+                         bool violated, qint64 timestampMs, double value, Channel &channel) {
+    qint64 &pendingSinceMs = channel.pendingSinceMs[kind];
+    if (violated == channel.active[kind]) {
+        pendingSinceMs = NotPending;
+        return;
+    }
+    if (pendingSinceMs == NotPending)
+        pendingSinceMs = timestampMs;
+    if (timestampMs - pendingSinceMs < holdMs)
+        return;
+
+    pendingSinceMs = NotPending;
+    channel.active[kind] = violated;
+    activeAlarms += violated ? 1 : -1;
+    push({timestampMs, roomId, rule, value, Metric(metric), kind, violated});
+}
+
+void AlarmEngine::push(const AlarmEvent &event) {
+    if (pendingEvents.size() < size_t(QueueCapacity))
+        pendingEvents.push_back(event);
+    else
+        ++droppedCount;
+    if (!notifyTimer.isActive())
+        notifyTimer.start();
+}
+
+/**
+ * @brief Передаёт накопленные события интерфейсу одним сигналом.
+ *
+ * Очереди меняются местами, поэтому память не выделяется.
+ */
+void AlarmEngine::flush() {
+    notifyTimer.stop();
+    if (pendingEvents.empty())
+        return;
+    deliveredEvents.swap(pendingEvents);
+    pendingEvents.clear();
+    emit eventsReady();
+}
+
+QString AlarmEngine::metricName(Metric metric) {
+    switch (metric) {
+    case Metric::Temperature: return "Температура";
+    case Metric::Humidity:    return "Влажность";
+    case Metric::Pressure:    return "Давление";
+    }
+    return QString();
+}
+
+QString AlarmEngine::describe(const AlarmEvent &event) {
+    const QString condition = event.kind == AlarmRule::Range ? "вне диапазона" : "быстро меняется";
+    const QString value = event.kind == AlarmRule::Range
+                              ? QString::number(event.value, 'f', 1)
+                              : QString("%1 в мин").arg(event.value, 0, 'f', 2);
+    return QString("Комната %1: %2 %3 (%4) - %5")
+        .arg(event.roomId + 1)
+        .arg(metricName(event.metric).toLower())
+        .arg(condition)
+        .arg(value)
+        .arg(event.active ? "тревога" : "норма");
+}
@@ -0,0 +1,157 @@
+#ifndef ALARMENGINE_H
+#define ALARMENGINE_H
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+#include <limits>
+#include <vector>
+
+#include "sensorsample.h"
+#include "roomhistory.h"
+
+/**
+ * @brief Правило тревоги по одной величине.
+ *
+ * Значения в базовых единицах хранилища: °C, %, Па. Правило для всех
+ * комнат (roomId == AllRooms) действует там, где нет своего правила
+ * той же величины и того же вида.
+ */
+struct AlarmRule {
+    enum Kind : quint8 {
+        Range = 0,      ///< Значение вне [low, high]
+        RateOfChange,   ///< Изменение быстрее maxRatePerMinute
+        KindCount
+    };
+
+    static constexpr int AllRooms = -1;
+
+    int roomId = AllRooms;
+    Metric metric = Metric::Temperature;
+    Kind kind = Range;
+    double low = -std::numeric_limits<double>::infinity();
+    double high = std::numeric_limits<double>::infinity();
+    double maxRatePerMinute = std::numeric_limits<double>::infinity(); ///< По модулю, единиц в минуту
+    qint64 holdMs = 0;  ///< Сколько нарушение (и возврат в норму) должно длиться до смены состояния
+};
+
+/**
+ * @brief Изменение состояния тревоги.
+ */
+struct AlarmEvent {
+    qint64 timestampMs;   ///< Время измерения, на котором сменилось состояние
+    qint32 roomId;
+    qint32 ruleIndex;     ///< Номер правила в AlarmEngine::rules()
+    double value;         ///< Значение величины (для RateOfChange - скорость в минуту)
+    Metric metric;
+    AlarmRule::Kind kind;
+    bool active;          ///< true - тревога поднята, false - снята
+};
+
+Q_DECLARE_TYPEINFO(AlarmEvent, Q_PRIMITIVE_TYPE);
+
+/**
+ * @brief Проверка измерений по правилам тревог.
+ *
+ * Правила компилируются в плоские таблицы порогов, по одной на величину,
+ * индексируемые номером комнаты: в каждой ячейке уже выбрано действующее
+ * правило диапазона и правило скорости (своё правило комнаты или общее).
+ * Проверка измерения - обращение к трём ячейкам по roomId, то есть O(1)
+ * независимо от числа правил, без выделения памяти.
+ *
+ * Смена состояния тревоги учитывается с задержкой holdMs: нарушение (или
+ * возврат в норму) должно продержаться это время по меткам измерений.
+ * События копятся в очереди фиксированной ёмкости и передаются интерфейсу
+ * пачкой не чаще раза в NotifyIntervalMs сигналом eventsReady(). При
+ * переполнении очереди лишние события отбрасываются (см. droppedEvents()),
+ * состояние тревог при этом остаётся верным.
+ */
+class AlarmEngine : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int NotifyIntervalMs = 50;
+    static constexpr int QueueCapacity = 4096;
+
+    explicit AlarmEngine(QObject *parent = nullptr);
+
+    void setRules(const QVector<AlarmRule> &rules); ///< Сбрасывает состояние всех тревог и очередь событий
+    const QVector<AlarmRule> &rules() const { return ruleList; }
+    bool loadRules(const QString &path);            ///< Формат см. parseRules()
+    /**
+     * @brief Разбирает правила из текста.
+     *
+     * Строка: "<комната|*> <temperature|humidity|pressure> range <мин> <макс> [удержание, с]"
+     * или "<комната|*> <величина> rate <макс. изменение в минуту> [удержание, с]".
+     * Пустые строки и строки, начинающиеся с '#', пропускаются.
+     * @param error Описание первой ошибки, если разбор не удался.
+     */
+    static bool parseRules(const QString &text, QVector<AlarmRule> &rules, QString *error = nullptr);
+
+    void resize(int roomCount);  ///< Число комнат; новые комнаты без истории и тревог
+    int roomCount() const { return rooms; }
+
+    void evaluateSamples(const SensorSample *samples, int count);
+    void evaluate(int roomId, qint64 timestampMs, double temperature, double humidity, double pressure);
+
+    bool isActive(int roomId, Metric metric, AlarmRule::Kind kind) const;
+    bool isRoomActive(int roomId) const; ///< Поднята хотя бы одна тревога комнаты
+    int activeCount() const { return activeAlarms; }
+    quint64 droppedEvents() const { return droppedCount; }
+
+    /// События последней пачки, действительны до следующего eventsReady()
+    const std::vector<AlarmEvent> &lastEvents() const { return deliveredEvents; }
+
+    static QString metricName(Metric metric);
+    static QString describe(const AlarmEvent &event); ///< Событие одной строкой для журнала
+
+public slots:
+    void flush(); ///< Передать накопленные события сразу
+
+signals:
+    void eventsReady(); ///< См. lastEvents()
+
+private:
+    /// Действующие пороги одной величины одной комнаты
+    struct Threshold {
+        double low;
+        double high;
+        double maxRatePerMs;
+        qint64 rangeHoldMs;
+        qint64 rateHoldMs;
+        qint32 rangeRule;   ///< -1 - правила нет
+        qint32 rateRule;
+    };
+
+    /// Состояние проверки одной величины одной комнаты
+    struct Channel {
+        double lastValue;
+        qint64 lastMs;
+        qint64 pendingSinceMs[AlarmRule::KindCount];  ///< Начало нарушения (или нормы) до смены состояния
+        bool active[AlarmRule::KindCount];
+        bool hasLast;
+    };
+
+    static constexpr qint64 NotPending = std::numeric_limits<qint64>::min();
+
+    void compile();
+    void resetChannels();
+    void check(int roomId, int metric, qint64 timestampMs, double value);
+    void update(int roomId, int metric, AlarmRule::Kind kind, qint32 rule, qint64 holdMs,
+                bool violated, qint64 timestampMs, double value, Channel &channel);
+    void push(const AlarmEvent &event);
+
+    QVector<AlarmRule> ruleList;
+    int rooms = 0;
+    std::vector<Threshold> thresholds[MetricCount];  ///< По комнатам
+    std::vector<Channel> channels[MetricCount];
+    int activeAlarms = 0;
+
+    std::vector<AlarmEvent> pendingEvents;    ///< Ёмкость QueueCapacity, не растёт
+    std::vector<AlarmEvent> deliveredEvents;
+    quint64 droppedCount = 0;
+    QTimer notifyTimer;
+};
+
+#endif // ALARMENGINE_H
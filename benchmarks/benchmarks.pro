@@ -0,0 +1,14 @@
+# Замеры производительности на QtTest (QBENCHMARK).
+#
+#   engine - ядро (только QtCore): хранилище, перевод единиц, история, снимок
+#   gui    - слоты MainWindow: построение окна, смена единиц, темы, настройки
+#
+# Результаты в CSV для сравнения версий на одной машине:
+#   ./engine/enginebenchmark -o engine.csv,csv
+#   ./gui/guibenchmark -platform offscreen -o gui.csv,csv
+# Отдельный замер: ./engine/enginebenchmark applySamples:100000
+
+TEMPLATE = subdirs
+SUBDIRS = engine
+
+!headless: SUBDIRS += gui
@@ -0,0 +1,15 @@
+QT += core testlib
+QT -= gui
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = enginebenchmark
+
+include(../../engine.pri)
+include(../../sharedstate.pri)
+include(../../tools/hvacsim/hvacsim.pri)
+include(../../tools/controlclient/controlclient.pri)
+
+SOURCES += \
+        tst_enginebenchmark.cpp
@@ -0,0 +1,1171 @@
+#include <QtTest>
+#include <QDir>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alarmengine.h"
+#include "buildinghierarchy.h"
+#include "climateengine.h"
+#include "controlapiclient.h"
+#include "controlapiserver.h"
+#include "derivedmetrics.h"
+#include "historyarchive.h"
+#include "hvacdriver.h"
+#include "hvacsimulator.h"
+#include "profiler.h"
+#include "roomstate.h"
+#include "roomhistory.h"
+#include "roomstatistics.h"
+#include "samplingscheduler.h"
+#include "sensorrecording.h"
+#include "sharedstateexporter.h"
+#include "statesnapshot.h"
+#include "thermalsimulation.h"
+#include "unitconversion.h"
+
+/**
+ * @brief Замеры ядра без интерфейса.
+ *
+ * Большинство замеров параметризованы числом комнат, чтобы видеть, как
+ * стоимость операций растёт с размером здания.
+ */
+class EngineBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void setTemperature_data();
+    void setTemperature();
+    void fillTemperature_data();
+    void fillTemperature();
+    void applySamples_data();
+    void applySamples();
+    void convertPressureColumn_data();
+    void convertPressureColumn();
+    void derivedMetricsUpdate_data();
+    void derivedMetricsUpdate();
+    void simulateHour_data();
+    void simulateHour();
+    void simulateInvalidAirflow();
+    void evaluateAlarms_data();
+    void evaluateAlarms();
+    void hierarchyUpdate_data();
+    void hierarchyUpdate();
+
+    void historyAppend_data();
+    void historyAppend();
+    void historyQuery();
+    void statisticsAppend_data();
+    void statisticsAppend();
+
+    void snapshotSerialize_data();
+    void snapshotSerialize();
+    void snapshotWrite_data();
+    void snapshotWrite();
+    void snapshotLoad_data();
+    void snapshotLoad();
+    void snapshotDamaged_data();
+    void snapshotDamaged();
+
+    void recordSamples();
+    void replayRecording();
+    void replayDamagedRecording_data();
+    void replayDamagedRecording();
+    void archiveAppend();
+    void archiveScan();
+    void archiveDamagedChunk_data();
+    void archiveDamagedChunk();
+
+    void sharedStatePublish_data();
+    void sharedStatePublish();
+    void sharedStateLayout_data();
+    void sharedStateLayout();
+
+    void hvacPollCycle_data();
+    void hvacPollCycle();
+    void samplingSchedule_data();
+    void samplingSchedule();
+
+    void controlApiThroughput_data();
+    void controlApiThroughput();
+    void controlApiEngineBatch();
+
+    void profileScope();
+
+private:
+    static void addRoomCounts(int maxRooms);
+    static HistoryConfig snapshotHistoryConfig();
+    static std::vector<SensorSample> samplesForAllRooms(int rooms, qint64 timestampMs);
+    static void fillStore(RoomStateStore &store, RoomHistory &history);
+    static void advanceSample(SensorSample &sample, int round);
+    static void advanceSamples(std::vector<SensorSample> &samples, int round);
+    static void forEachRecordedEvent(int rooms, int rounds, const std::function<void(const RecordedEvent &event)> &visit);
+    static bool writeRecording(const QString &path, int rooms, int rounds);
+    static qint64 checkedEvents(const RecordingReader &reader, int rooms, int rounds);
+
+    QTemporaryDir workDir;
+};
+
+void EngineBenchmark::initTestCase() {
+    QVERIFY(workDir.isValid());
+}
+
+/// Столбец "rooms" со строками 3, 1000, 10000 и 100000, не больше maxRooms
+void EngineBenchmark::addRoomCounts(int maxRooms) {
+    QTest::addColumn<int>("rooms");
+    for (int rooms : {3, 1000, 10000, 100000}) {
+        if (rooms <= maxRooms)
+            QTest::newRow(QByteArray::number(rooms).constData()) << rooms;
+    }
+}
+
+/// История только из сырого кольца длиной в хвост снимка: память не растёт с уровнями агрегации
+HistoryConfig EngineBenchmark::snapshotHistoryConfig() {
+    HistoryConfig config;
+    config.rawCapacity = StateSnapshot::HistoryTailLength;
+    config.tiers.clear();
+    return config;
+}
+
+std::vector<SensorSample> EngineBenchmark::samplesForAllRooms(int rooms, qint64 timestampMs) {
+    std::vector<SensorSample> samples(size_t(rooms));
+    for (int roomId = 0; roomId < rooms; ++roomId) {
+        SensorSample &sample = samples[size_t(roomId)];
+        sample.timestampMs = timestampMs;
+        sample.roomId = roomId;
+        sample.reserved = 0;
+        sample.temperature = 20.0 + roomId % 7;
+        sample.humidity = 40.0 + roomId % 11;
+        sample.pressure = RoomStateStore::StandardPressure + roomId % 13;
+    }
+    return samples;
+}
+
+/// Заполняет хранилище и полный хвост истории, как после продолжительной работы
+void EngineBenchmark::fillStore(RoomStateStore &store, RoomHistory &history) {
+    history.resize(store.roomCount());
+    for (int i = 0; i < StateSnapshot::HistoryTailLength; ++i) {
+        const std::vector<SensorSample> samples = samplesForAllRooms(store.roomCount(), 1000LL * i);
+        store.applySamples(samples.data(), int(samples.size()));
+        history.appendSamples(samples.data(), int(samples.size()));
+    }
+}
+
+/// Следующий опрос через секунду: показания медленно блуждают с шагом точности датчиков
+void EngineBenchmark::advanceSample(SensorSample &sample, int round) {
+    sample.timestampMs += 1000;
+    const int step = (round * 7 + sample.roomId) % 3 - 1;
+    sample.temperature += 0.01 * step;
+    sample.humidity += 0.1 * ((round + sample.roomId) % 5 == 0 ? step : 0);
+    sample.pressure += 1.0 * ((round + sample.roomId) % 11 == 0 ? step : 0);
+}
+
+void EngineBenchmark::advanceSamples(std::vector<SensorSample> &samples, int round) {
+    for (SensorSample &sample : samples)
+        advanceSample(sample, round);
+}
+
+/**
+ * @brief События тестовой записи по порядку.
+ *
+ * rounds опросов всех комнат через секунду (см. advanceSamples()), перед
+ * каждым десятым - уставка одной комнаты. Температура одной комнаты не кратна
+ * 1/SensorRecording::ValueScale и пишется исходными double.
+ */
+void EngineBenchmark::forEachRecordedEvent(int rooms, int rounds,
+                                           const std::function<void(const RecordedEvent &event)> &visit) {
+    std::vector<SensorSample> samples = samplesForAllRooms(rooms, 0);
+    samples[size_t(1 % rooms)].temperature = 21.0 + 1.0 / 3.0;
+    RecordedEvent event = {};
+    for (int round = 0; round < rounds; ++round) {
+        advanceSamples(samples, round);
+        if (round % 10 == 0) {
+            event.type = RecordedEvent::Setpoint;
+            event.timestampMs = samples[0].timestampMs;
+            event.roomId = round / 10 % rooms;
+            event.setpoint = 18.0 + 0.1 * (round % 70);
+            visit(event);
+        }
+        event.type = RecordedEvent::Sample;
+        for (const SensorSample &sample : samples) {
+            event.timestampMs = sample.timestampMs;
+            event.sample = sample;
+            visit(event);
+        }
+    }
+}
+
+bool EngineBenchmark::writeRecording(const QString &path, int rooms, int rounds) {
+    QFile::remove(path);
+    QFile::remove(SensorRecording::indexPath(path));
+    SensorRecorder recorder;
+    if (!recorder.open(path))
+        return false;
+    forEachRecordedEvent(rooms, rounds, [&recorder](const RecordedEvent &event) {
+        if (event.type == RecordedEvent::Sample)
+            recorder.recordSamples(&event.sample, 1);
+        else
+            recorder.recordSetpoint(event.timestampMs, event.roomId, event.setpoint);
+    });
+    return true;
+}
+
+/// Сколько событий отдаёт запись; -1, если они расходятся со сценарием forEachRecordedEvent() (значения - бит в бит)
+qint64 EngineBenchmark::checkedEvents(const RecordingReader &reader, int rooms, int rounds) {
+    RecordingReader::Cursor cursor = reader.cursor();
+    RecordedEvent decoded;
+    qint64 count = 0;
+    bool ended = false;
+    bool same = true;
+    forEachRecordedEvent(rooms, rounds, [&](const RecordedEvent &expected) {
+        if (ended || !same)
+            return;
+        if (!cursor.next(decoded)) {
+            ended = true;
+            return;
+        }
+        ++count;
+        same = decoded.type == expected.type && decoded.timestampMs == expected.timestampMs;
+        if (same && expected.type == RecordedEvent::Sample)
+            same = std::memcmp(&decoded.sample, &expected.sample, sizeof(SensorSample)) == 0;
+        else if (same)
+            same = decoded.roomId == expected.roomId
+                   && TimeSeriesCodec::doubleBits(decoded.setpoint) == TimeSeriesCodec::doubleBits(expected.setpoint);
+    });
+    if (!ended && same && cursor.next(decoded))
+        same = false; // Событий больше, чем записано
+    return same ? count : -1;
+}
+
+/**
+ * @brief Установка температуры по одной комнате через RoomStateStore::setTemperature(), как при правке из ClimateEngine.
+ */
+void EngineBenchmark::setTemperature_data() {
+    addRoomCounts(100000);
+}
+
+void EngineBenchmark::setTemperature() {
+    QFETCH(int, rooms);
+    RoomStateStore store(rooms);
+    double value = 20.0;
+    QBENCHMARK {
+        for (int roomId = 0; roomId < rooms; ++roomId)
+            store.setTemperature(roomId, value);
+        value += 0.5;
+    }
+}
+
+/**
+ * @brief Одна температура для всех комнат, как из updateTemperature(value).
+ */
+void EngineBenchmark::fillTemperature_data() {
+    addRoomCounts(100000);
+}
+
+void EngineBenchmark::fillTemperature() {
+    QFETCH(int, rooms);
+    RoomStateStore store(rooms);
+    double value = 20.0;
+    QBENCHMARK {
+        store.fillTemperature(value);
+        value += 0.5;
+    }
+}
+
+/**
+ * @brief Применение пачки измерений датчиков (по одному на комнату).
+ */
+void EngineBenchmark::applySamples_data() {
+    addRoomCounts(100000);
+}
+
+void EngineBenchmark::applySamples() {
+    QFETCH(int, rooms);
+    RoomStateStore store(rooms);
+    std::vector<SensorSample> samples = samplesForAllRooms(rooms, 0);
+    QBENCHMARK {
+        for (SensorSample &sample : samples)
+            sample.temperature += 0.1;
+        store.applySamples(samples.data(), int(samples.size()));
+    }
+}
+
+/**
+ * @brief Пересчёт столбца давления в мм рт. ст., как при changePressureUnit.
+ */
+void EngineBenchmark::convertPressureColumn_data() {
+    addRoomCounts(100000);
+}
+
+void EngineBenchmark::convertPressureColumn() {
+    QFETCH(int, rooms);
+    std::vector<double> pascal(size_t(rooms), RoomStateStore::StandardPressure);
+    std::vector<double> converted(size_t(rooms));
+    QBENCHMARK {
+        ::convertPressureColumn<PressureUnit::MmHg>(pascal.data(), converted.data(), converted.size());
+    }
+}
+
+/**
+ * @brief Пакет измерений части комнат и пересчёт их точки росы, влажности, энтальпии и индекса жары.
+ *
+ * При 100 % считаются столбцы целиком, при 1 % - только изменённые комнаты через плотные буферы.
+ */
+void EngineBenchmark::derivedMetricsUpdate_data() {
+    QTest::addColumn<int>("rooms");
+    QTest::addColumn<int>("changedPercent");
+    for (int rooms : {1000, 10000, 100000}) {
+        for (int percent : {1, 100})
+            QTest::newRow(QString("%1/%2%").arg(rooms).arg(percent).toLatin1().constData()) << rooms << percent;
+    }
+}
+
+void EngineBenchmark::derivedMetricsUpdate() {
+    QFETCH(int, rooms);
+    QFETCH(int, changedPercent);
+    RoomStateStore store(rooms);
+    const std::vector<SensorSample> all = samplesForAllRooms(rooms, 0);
+    store.applySamples(all.data(), int(all.size()));
+    DerivedMetrics metrics(&store);
+    metrics.update();
+
+    std::vector<SensorSample> changed;
+    for (const SensorSample &sample : all) {
+        if (sample.roomId % (100 / changedPercent) == 0)
+            changed.push_back(sample);
+    }
+    QBENCHMARK {
+        for (SensorSample &sample : changed)
+            sample.temperature = sample.temperature > 30.0 ? 20.0 : sample.temperature + 0.1;
+        store.applySamples(changed.data(), int(changed.size()));
+        metrics.update();
+    }
+    QCOMPARE(metrics.pendingRooms(), 0);
+    QVERIFY(metrics.dewPoint(0) < store.temperature(0));
+}
+
+/**
+ * @brief Час имитации здания (720 шагов по 5 с) с публикацией итогового состояния.
+ */
+void EngineBenchmark::simulateHour_data() {
+    addRoomCounts(100000);
+}
+
+void EngineBenchmark::simulateHour() {
+    QFETCH(int, rooms);
+    RoomStateStore store(rooms);
+    const std::vector<SensorSample> samples = samplesForAllRooms(rooms, 0);
+    store.applySamples(samples.data(), int(samples.size()));
+    ThermalSimulation simulation(&store);
+    simulation.reset();
+    QBENCHMARK {
+        simulation.advance(3600.0);
+    }
+}
+
+/**
+ * @brief Направление подачи вне AirflowGain хранилище не принимает, имитация остаётся конечной.
+ */
+void EngineBenchmark::simulateInvalidAirflow() {
+    RoomStateStore store(1000);
+    const std::vector<SensorSample> samples = samplesForAllRooms(1000, 0);
+    store.applySamples(samples.data(), int(samples.size()));
+    store.setAirflow(1, AirflowDirection::RightLeft);
+    store.setAirflow(1, AirflowDirection(200));
+    QCOMPARE(store.airflow(1), AirflowDirection::RightLeft);
+    store.setRoom(2, 23.0, 45.0, RoomStateStore::StandardPressure, AirflowDirection(4));
+    QCOMPARE(store.temperature(2), 23.0);
+    QCOMPARE(store.airflow(2), AirflowDirection::None);
+
+    ThermalSimulation simulation(&store);
+    simulation.reset();
+    simulation.advance(3600.0);
+    for (int roomId = 0; roomId < store.roomCount(); ++roomId) {
+        QVERIFY(std::isfinite(store.temperature(roomId)));
+        QVERIFY(std::isfinite(store.pressure(roomId)));
+    }
+    QVERIFY(store.pressure(1) > store.pressure(0));
+}
+
+/**
+ * @brief Проверка измерений всех комнат при двух правилах на комнату (диапазон и скорость температуры).
+ */
+void EngineBenchmark::evaluateAlarms_data() {
+    addRoomCounts(100000);
+}
+
+void EngineBenchmark::evaluateAlarms() {
+    QFETCH(int, rooms);
+    QVector<AlarmRule> rules;
+    rules.reserve(rooms * 2);
+    for (int roomId = 0; roomId < rooms; ++roomId) {
+        AlarmRule range;
+        range.roomId = roomId;
+        range.low = 18.0;
+        range.high = 26.0;
+        range.holdMs = 5000;
+        rules.append(range);
+        AlarmRule rate;
+        rate.roomId = roomId;
+        rate.kind = AlarmRule::RateOfChange;
+        rate.maxRatePerMinute = 2.0;
+        rules.append(rate);
+    }
+    AlarmEngine alarms;
+    alarms.resize(rooms);
+    alarms.setRules(rules);
+    std::vector<SensorSample> samples = samplesForAllRooms(rooms, 0);
+    QBENCHMARK {
+        for (SensorSample &sample : samples)
+            sample.timestampMs += 1000;
+        alarms.evaluateSamples(samples.data(), int(samples.size()));
+    }
+}
+
+/**
+ * @brief Изменение одной комнаты и сводка по всему зданию и по этажу (O(log n) каждое).
+ */
+void EngineBenchmark::hierarchyUpdate_data() {
+    addRoomCounts(100000);
+}
+
+void EngineBenchmark::hierarchyUpdate() {
+    QFETCH(int, rooms);
+    RoomStateStore store(rooms);
+    BuildingHierarchy building(&store);
+    int roomId = 0;
+    double temperature = 20.0;
+    QBENCHMARK {
+        roomId = (roomId + 7919) % rooms;
+        temperature = temperature > 25.0 ? 20.0 : temperature + 0.1;
+        store.setTemperature(roomId, temperature);
+        const BuildingHierarchy::Aggregate total =
+            building.aggregate(BuildingHierarchy::BuildingLevel, 0, Metric::Temperature);
+        const BuildingHierarchy::Aggregate floor =
+            building.aggregate(BuildingHierarchy::FloorLevel, building.nodeCount(BuildingHierarchy::FloorLevel) - 1,
+                               Metric::Temperature);
+        QVERIFY(total.count == rooms && floor.max >= floor.min);
+    }
+}
+
+/**
+ * @brief Запись в историю с полным набором уровней агрегации.
+ */
+void EngineBenchmark::historyAppend_data() {
+    addRoomCounts(1000);
+}
+
+void EngineBenchmark::historyAppend() {
+    QFETCH(int, rooms);
+    RoomHistory history;
+    history.resize(rooms);
+    std::vector<SensorSample> samples = samplesForAllRooms(rooms, 0);
+    QBENCHMARK {
+        for (SensorSample &sample : samples)
+            sample.timestampMs += 1000;
+        history.appendSamples(samples.data(), int(samples.size()));
+    }
+}
+
+/**
+ * @brief Запрос суточного тренда на 500 точек после суток измерений раз в секунду.
+ */
+void EngineBenchmark::historyQuery() {
+    RoomHistory history;
+    history.resize(1);
+    const qint64 day = 24 * 3600 * 1000LL;
+    for (qint64 timestampMs = 0; timestampMs < day; timestampMs += 1000)
+        history.append(0, timestampMs, 20.0 + (timestampMs / 60000) % 5, 45.0, RoomStateStore::StandardPressure);
+
+    QBENCHMARK {
+        const QVector<HistoryPoint> points = history.query(0, Metric::Temperature, 0, day, 500);
+        QVERIFY(!points.isEmpty());
+    }
+}
+
+/**
+ * @brief Опрос всех комнат, учтённый в скользящей статистике и прогнозе.
+ */
+void EngineBenchmark::statisticsAppend_data() {
+    addRoomCounts(100000);
+}
+
+void EngineBenchmark::statisticsAppend() {
+    QFETCH(int, rooms);
+    RoomStatistics statistics;
+    statistics.resize(rooms);
+    std::vector<SensorSample> samples = samplesForAllRooms(rooms, 0);
+    int round = 0;
+    QBENCHMARK {
+        advanceSamples(samples, round++);
+        statistics.appendSamples(samples.data(), int(samples.size()));
+    }
+    QCOMPARE(statistics.sampleCount(0), quint64(round));
+}
+
+/**
+ * @brief Сборка снимка в памяти (часть saveSettings, выполняемая в потоке интерфейса).
+ */
+void EngineBenchmark::snapshotSerialize_data() {
+    addRoomCounts(100000);
+}
+
+void EngineBenchmark::snapshotSerialize() {
+    QFETCH(int, rooms);
+    RoomStateStore store(rooms);
+    RoomHistory history(snapshotHistoryConfig());
+    fillStore(store, history);
+    QBENCHMARK {
+        const QByteArray data = StateSnapshot::serialize(store, history, SnapshotSettings());
+        QVERIFY(!data.isEmpty());
+    }
+}
+
+/**
+ * @brief Атомарная запись готового снимка на диск.
+ */
+void EngineBenchmark::snapshotWrite_data() {
+    addRoomCounts(100000);
+}
+
+void EngineBenchmark::snapshotWrite() {
+    QFETCH(int, rooms);
+    RoomStateStore store(rooms);
+    RoomHistory history(snapshotHistoryConfig());
+    fillStore(store, history);
+    const QByteArray data = StateSnapshot::serialize(store, history, SnapshotSettings());
+    const QString path = workDir.filePath("write.snapshot");
+    QBENCHMARK {
+        QVERIFY(StateSnapshot::writeFile(path, data));
+    }
+}
+
+/**
+ * @brief Загрузка снимка при запуске (loadSettings): отображение файла и восстановление хвоста истории.
+ */
+void EngineBenchmark::snapshotLoad_data() {
+    addRoomCounts(100000);
+}
+
+void EngineBenchmark::snapshotLoad() {
+    QFETCH(int, rooms);
+    const QString path = workDir.filePath("load.snapshot");
+    {
+        RoomStateStore store(rooms);
+        RoomHistory history(snapshotHistoryConfig());
+        fillStore(store, history);
+        QVERIFY(StateSnapshot::writeFile(path, StateSnapshot::serialize(store, history, SnapshotSettings())));
+    }
+
+    RoomStateStore store;
+    RoomHistory history(snapshotHistoryConfig());
+    SnapshotSettings settings;
+    QBENCHMARK {
+        QVERIFY(StateSnapshot::load(path, store, history, settings));
+    }
+    QCOMPARE(store.roomCount(), rooms);
+}
+
+void EngineBenchmark::snapshotDamaged_data() {
+    QTest::addColumn<QString>("damage");
+    for (const char *damage : {"truncated", "short-header", "oversized-rooms", "oversized-tail", "column-past-end"})
+        QTest::newRow(damage) << QString(damage);
+}
+
+/**
+ * @brief Обрезанный снимок и снимок с размерами больше файла отклоняются, хранилище не меняется.
+ */
+void EngineBenchmark::snapshotDamaged() {
+    QFETCH(QString, damage);
+    // Смещения полей SnapshotHeader, см. statesnapshot.cpp
+    constexpr int RoomCountOffset = 32;
+    constexpr int HistoryTailOffset = 48;
+    constexpr int TemperatureOffset = 56;
+
+    RoomStateStore source(100);
+    RoomHistory sourceHistory(snapshotHistoryConfig());
+    fillStore(source, sourceHistory);
+    QByteArray data = StateSnapshot::serialize(source, sourceHistory, SnapshotSettings());
+    const auto patch = [&data](int offset, auto value) {
+        std::memcpy(data.data() + offset, &value, sizeof(value));
+    };
+    if (damage == "truncated")
+        data.truncate(data.size() / 2);
+    else if (damage == "short-header")
+        data.truncate(RoomCountOffset);
+    else if (damage == "oversized-rooms")
+        patch(RoomCountOffset, qint32(std::numeric_limits<qint32>::max()));
+    else if (damage == "oversized-tail")
+        patch(HistoryTailOffset, qint32(StateSnapshot::HistoryTailLength + 1));
+    else
+        patch(TemperatureOffset, quint64(data.size()));
+    const QString path = workDir.filePath(damage + ".snapshot");
+    QVERIFY(StateSnapshot::writeFile(path, data));
+
+    RoomStateStore store(10);
+    store.fillTemperature(5.0);
+    RoomHistory history(snapshotHistoryConfig());
+    SnapshotSettings settings;
+    QVERIFY(!StateSnapshot::load(path, store, history, settings));
+    QCOMPARE(store.roomCount(), 10);
+    QCOMPARE(store.temperature(9), 5.0);
+}
+
+/**
+ * @brief Запись 100 000 измерений (1000 комнат по 100 раз) в файл записи.
+ */
+void EngineBenchmark::recordSamples() {
+    const QString path = workDir.filePath("record.rec");
+    std::vector<SensorSample> samples = samplesForAllRooms(1000, 0);
+    QBENCHMARK {
+        QFile::remove(path);
+        SensorRecorder recorder;
+        QVERIFY(recorder.open(path));
+        for (int round = 0; round < 100; ++round) {
+            for (SensorSample &sample : samples)
+                sample.timestampMs += 1000;
+            recorder.recordSamples(samples.data(), int(samples.size()));
+        }
+        recorder.close();
+    }
+}
+
+/**
+ * @brief Декодирование 1 000 000 записанных измерений и 100 уставок из отображённого файла.
+ *
+ * Перед замером проверяет, что декодированные события совпадают с записанными.
+ */
+void EngineBenchmark::replayRecording() {
+    const QString path = workDir.filePath("replay.rec");
+    QVERIFY(writeRecording(path, 1000, 1000));
+
+    RecordingReader reader;
+    QVERIFY(reader.open(path));
+    QCOMPARE(checkedEvents(reader, 1000, 1000), qint64(1000 * 1000 + 100));
+    QBENCHMARK {
+        RecordingReader::Cursor cursor = reader.cursor();
+        RecordedEvent event;
+        int count = 0;
+        while (cursor.next(event))
+            ++count;
+        QCOMPARE(count, 1000 * 1000 + 100);
+    }
+}
+
+void EngineBenchmark::replayDamagedRecording_data() {
+    QTest::addColumn<QString>("damage");
+    for (const char *damage : {"corrupt-block", "oversized-room", "truncated-tail", "unindexed-tail"})
+        QTest::newRow(damage) << QString(damage);
+}
+
+/**
+ * @brief Повреждённая запись: события до повреждения читаются без изменений.
+ *
+ * Блок с неверной контрольной суммой и блок с номером комнаты не меньше
+ * SensorRecording::MaxRooms останавливают чтение, недописанный последний
+ * блок отбрасывается, а блоки, которых нет в индексе, находятся по заголовкам.
+ */
+void EngineBenchmark::replayDamagedRecording() {
+    QFETCH(QString, damage);
+    constexpr int Rooms = 100;
+    constexpr int Rounds = 500;
+    // Раскладка файла и индекса, см. static_assert в sensorrecording.cpp
+    constexpr qint64 FileHeaderBytes = 24;
+    constexpr qint64 BlockHeaderBytes = 32;
+    constexpr qint64 IndexHeaderBytes = 16;
+    constexpr qint64 IndexEntryBytes = 32;
+    constexpr quint32 BlockMagic = 0x4b4c4231u;
+
+    const QString path = workDir.filePath(damage + ".rec");
+    QVERIFY(writeRecording(path, Rooms, Rounds));
+
+    // Сколько событий в блоках до каждого блока целой записи
+    std::vector<qint64> eventsBefore;
+    int blocks = 0;
+    {
+        RecordingReader reader;
+        QVERIFY(reader.open(path));
+        blocks = reader.blockCount();
+        QVERIFY(blocks >= 3);
+        eventsBefore.assign(size_t(blocks) + 1, 0);
+        RecordingReader::Cursor cursor = reader.cursor();
+        RecordedEvent event;
+        while (cursor.next(event))
+            ++eventsBefore[size_t(cursor.block()) + 1];
+        for (size_t block = 1; block < eventsBefore.size(); ++block)
+            eventsBefore[block] += eventsBefore[block - 1];
+        QCOMPARE(checkedEvents(reader, Rooms, Rounds), eventsBefore.back());
+    }
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    const QByteArray data = file.readAll();
+    std::vector<qint64> blockOffsets;
+    for (qint64 offset = FileHeaderBytes; offset + BlockHeaderBytes <= data.size();) {
+        quint32 payloadBytes;
+        std::memcpy(&payloadBytes, data.constData() + offset + sizeof(quint32), sizeof(payloadBytes));
+        blockOffsets.push_back(offset);
+        offset += BlockHeaderBytes + payloadBytes;
+    }
+    QCOMPARE(int(blockOffsets.size()), blocks);
+
+    qint64 expectedEvents = eventsBefore.back();
+    int expectedBlocks = blocks;
+    if (damage == "corrupt-block") {
+        // Один байт данных второго блока: контрольная сумма не сходится
+        const qint64 offset = blockOffsets[1] + BlockHeaderBytes + 10;
+        QVERIFY(file.seek(offset));
+        QVERIFY(file.putChar(char(data[int(offset)] ^ 0x55)));
+        expectedEvents = eventsBefore[1];
+    } else if (damage == "oversized-room") {
+        // Дописанный блок с верной контрольной суммой и измерением комнаты MaxRooms
+        QByteArray payload;
+        payload.append(char(RecordedEvent::Sample));
+        payload.append(char(0));                     // Разность времени
+        quint64 room = quint64(SensorRecording::MaxRooms);
+        for (; room >= 0x80; room >>= 7)
+            payload.append(char(room | 0x80));
+        payload.append(char(room));
+        payload.append(QByteArray(3, char(0)));      // Величины без изменений
+        quint32 checksum = 2166136261u;              // FNV-1a
+        for (char byte : payload) {
+            checksum ^= uchar(byte);
+            checksum *= 16777619u;
+        }
+        const quint32 header[4] = {BlockMagic, quint32(payload.size()), 1, checksum};
+        const qint64 timestampMs = 1000LL * Rounds;
+        QVERIFY(file.seek(file.size()));
+        file.write(reinterpret_cast<const char *>(header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(&timestampMs), sizeof(timestampMs));
+        file.write(reinterpret_cast<const char *>(&timestampMs), sizeof(timestampMs));
+        file.write(payload);
+        expectedBlocks = blocks + 1;
+    } else if (damage == "truncated-tail") {
+        // Аварийное завершение посреди записи последнего блока
+        const qint64 lastData = blockOffsets.back() + BlockHeaderBytes;
+        QVERIFY(file.resize(lastData + (data.size() - lastData) / 2));
+        expectedEvents = eventsBefore[size_t(blocks - 1)];
+        expectedBlocks = blocks - 1;
+    } else {
+        // Аварийное завершение до записи индекса: в индексе только первый блок
+        QFile index(SensorRecording::indexPath(path));
+        QVERIFY(index.open(QIODevice::ReadWrite));
+        QVERIFY(index.resize(IndexHeaderBytes + IndexEntryBytes));
+    }
+    file.close();
+
+    RecordingReader reader;
+    QVERIFY(reader.open(path));
+    QCOMPARE(reader.blockCount(), expectedBlocks);
+    QCOMPARE(checkedEvents(reader, Rooms, Rounds), expectedEvents);
+}
+
+/**
+ * @brief Сжатие 100 000 измерений (1000 комнат по 100 раз) в блок архива в памяти.
+ */
+void EngineBenchmark::archiveAppend() {
+    HistoryArchiver archiver;
+    QVERIFY(archiver.open(workDir.filePath("archive-append")));
+    archiver.resize(1000);
+    std::vector<SensorSample> samples = samplesForAllRooms(1000, 0);
+    int round = 0;
+    QBENCHMARK {
+        for (int i = 0; i < 100; ++i) {
+            advanceSamples(samples, round++);
+            archiver.appendSamples(samples.data(), int(samples.size()));
+        }
+    }
+}
+
+/**
+ * @brief Распаковка 1 000 000 измерений архива (1000 комнат за 1000 секунд).
+ *
+ * Перед замером проверяет, что архив отдаёт записанные точки бит в бит
+ * и занимает много меньше самих измерений.
+ */
+void EngineBenchmark::archiveScan() {
+    const QString directory = workDir.filePath("archive-scan");
+    std::vector<SensorSample> initial = samplesForAllRooms(1000, 0);
+    initial[1].temperature = 21.0 + 1.0 / 3.0; // Не кратно 0.01 °C: ряд хранится исходными double
+    {
+        HistoryArchiver archiver;
+        QVERIFY(archiver.open(directory));
+        archiver.resize(1000);
+        std::vector<SensorSample> samples = initial;
+        for (int round = 0; round < 1000; ++round) {
+            advanceSamples(samples, round);
+            archiver.appendSamples(samples.data(), int(samples.size()));
+        }
+    }
+
+    HistoryArchive archive;
+    QVERIFY(archive.open(directory));
+    QCOMPARE(archive.pointCount(), quint64(1000 * 1000));
+
+    // Точки комнаты идут в порядке записи: тот же генератор восстанавливает ожидаемую
+    std::vector<SensorSample> expected = initial;
+    std::vector<int> rounds(initial.size(), 0);
+    SensorSample decoded = initial[0];
+    SensorSample written = initial[0];
+    bool mismatch = false;
+    QVERIFY(archive.scan(ArchiveQuery(), [&](const ArchiveBatch &batch) {
+        SensorSample &sample = expected[size_t(batch.roomId)];
+        for (int i = 0; i < batch.count && !mismatch; ++i) {
+            advanceSample(sample, rounds[size_t(batch.roomId)]++);
+            const SensorSample point = {batch.timestamps[i], batch.roomId, 0,
+                                        batch.values[0][i], batch.values[1][i], batch.values[2][i]};
+            if (std::memcmp(&point, &sample, sizeof(point)) != 0) {
+                decoded = point;
+                written = sample;
+                mismatch = true;
+            }
+        }
+    }));
+    QCOMPARE(decoded.roomId, written.roomId);
+    QCOMPARE(decoded.timestampMs, written.timestampMs);
+    // Значения бит в бит: QCOMPARE сравнивает double приблизительно
+    QCOMPARE(TimeSeriesCodec::doubleBits(decoded.temperature), TimeSeriesCodec::doubleBits(written.temperature));
+    QCOMPARE(TimeSeriesCodec::doubleBits(decoded.humidity), TimeSeriesCodec::doubleBits(written.humidity));
+    QCOMPARE(TimeSeriesCodec::doubleBits(decoded.pressure), TimeSeriesCodec::doubleBits(written.pressure));
+    QVERIFY(std::all_of(rounds.begin(), rounds.end(), [](int count) { return count == 1000; }));
+
+    // Gorilla на медленно меняющихся показаниях - около 1.3 байта на точку против 40 байт SensorSample
+    const quint64 rawBytes = archive.pointCount() * sizeof(SensorSample);
+    QVERIFY2(archive.fileBytes() * 10 < rawBytes,
+             qPrintable(QString("архив %1 байт, измерения %2 байт").arg(archive.fileBytes()).arg(rawBytes)));
+
+    QBENCHMARK {
+        quint64 count = 0;
+        QVERIFY(archive.scan(ArchiveQuery(), [&](const ArchiveBatch &batch) { count += quint64(batch.count); }));
+        QCOMPARE(count, quint64(1000 * 1000));
+    }
+}
+
+void EngineBenchmark::archiveDamagedChunk_data() {
+    QTest::addColumn<bool>("truncated");
+    QTest::newRow("truncated") << true;
+    QTest::newRow("corrupt") << false;
+}
+
+/**
+ * @brief Усечённый и повреждённый блок архива: scan() возвращает false и не отдаёт ни одной точки блока.
+ */
+void EngineBenchmark::archiveDamagedChunk() {
+    QFETCH(bool, truncated);
+    const QString directory = workDir.filePath(truncated ? "archive-truncated" : "archive-corrupt");
+    {
+        HistoryArchiver archiver;
+        QVERIFY(archiver.open(directory));
+        archiver.resize(10);
+        std::vector<SensorSample> samples = samplesForAllRooms(10, 0);
+        for (int round = 0; round < 100; ++round) {
+            advanceSamples(samples, round);
+            archiver.appendSamples(samples.data(), int(samples.size()));
+        }
+    }
+
+    const QStringList names = QDir(directory).entryList({QString("*") + HistoryArchiveFormat::Suffix}, QDir::Files);
+    QCOMPARE(names.size(), 1);
+    QFile file(QDir(directory).filePath(names.first()));
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    ArchiveChunkHeader header;
+    QCOMPARE(file.read(reinterpret_cast<char *>(&header), sizeof(header)), qint64(sizeof(header)));
+    const qint64 dataOffset = qint64(sizeof(header) + header.seriesCount * sizeof(ArchiveSeriesEntry));
+    QCOMPARE(file.size(), dataOffset + qint64(header.dataBytes));
+    if (truncated) {
+        // Оборванная запись: заголовок и ряды целы, потоков половина
+        QVERIFY(file.resize(dataOffset + qint64(header.dataBytes / 2)));
+    } else {
+        // Потоки из одних единиц: каждое время читается как полная 64-битная разность, и поток кончается раньше точек
+        const QByteArray ones(int(header.dataBytes), char(0xFF));
+        QVERIFY(file.seek(dataOffset));
+        QCOMPARE(file.write(ones), qint64(ones.size()));
+    }
+    file.close();
+
+    HistoryArchive archive;
+    QVERIFY(archive.open(directory));
+    QCOMPARE(archive.chunkCount(), 1);
+    quint64 delivered = 0;
+    QVERIFY(!archive.scan(ArchiveQuery(), [&](const ArchiveBatch &batch) { delivered += quint64(batch.count); }));
+    QCOMPARE(delivered, quint64(0));
+}
+
+/**
+ * @brief Публикация всех комнат в разделяемую память и чтение снимка другим читателем.
+ */
+void EngineBenchmark::sharedStatePublish_data() {
+    addRoomCounts(100000);
+}
+
+void EngineBenchmark::sharedStatePublish() {
+    QFETCH(int, rooms);
+    RoomStateStore store(rooms);
+    SharedStateExporter exporter(&store);
+    const QString name = QString("/climate-bench-%1").arg(QCoreApplication::applicationPid());
+    QVERIFY(exporter.open(name));
+    double temperature = 20.0;
+    QBENCHMARK {
+        temperature = temperature > 25.0 ? 20.0 : temperature + 0.1;
+        store.fillTemperature(temperature);
+        exporter.publish();
+    }
+
+    SharedStateReader reader;
+    QVERIFY2(reader.open(name.toStdString()), reader.errorString().c_str());
+    std::vector<SharedRoomRecord> snapshot;
+    QVERIFY(reader.snapshot(snapshot));
+    QCOMPARE(int(snapshot.size()), rooms);
+    QCOMPARE(snapshot.back().temperature, temperature);
+}
+
+void EngineBenchmark::sharedStateLayout_data() {
+    QTest::addColumn<QString>("damage");
+    for (const char *damage : {"rooms-offset", "blocks-offset", "capacity"})
+        QTest::newRow(damage) << QString(damage);
+}
+
+/**
+ * @brief Сегмент, чьи смещения или ёмкость выходят за отображение, читатель не открывает.
+ */
+void EngineBenchmark::sharedStateLayout() {
+    QFETCH(QString, damage);
+    RoomStateStore store(1000);
+    SharedStateExporter exporter(&store);
+    const QString name = QString("/climate-layout-%1").arg(QCoreApplication::applicationPid());
+    QVERIFY(exporter.open(name));
+
+    SharedStateReader reader;
+    QVERIFY2(reader.open(name.toStdString()), reader.errorString().c_str());
+    reader.close();
+
+    const int fd = shm_open(name.toLocal8Bit().constData(), O_RDWR, 0);
+    QVERIFY(fd >= 0);
+    struct stat info;
+    QVERIFY(fstat(fd, &info) == 0);
+    const std::size_t bytes = std::size_t(info.st_size);
+    void *mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    QVERIFY(mapping != MAP_FAILED);
+    SharedStateHeader *header = static_cast<SharedStateHeader *>(mapping);
+    QCOMPARE(SharedState::segmentBytes(header->roomCapacity), bytes);
+    if (damage == "rooms-offset") {
+        header->roomsOffset += std::uint64_t(header->roomCapacity) * sizeof(SharedRoomRecord);
+    } else if (damage == "blocks-offset") {
+        header->blocksOffset = bytes;
+    } else {
+        // Согласованная раскладка на вдвое больше комнат, чем помещается в сегмент
+        header->roomCapacity *= 2;
+        header->blockCount = (header->roomCapacity + SharedState::BlockRooms - 1) / SharedState::BlockRooms;
+        header->roomsOffset = header->blocksOffset + std::uint64_t(header->blockCount) * sizeof(SharedBlockSequence);
+    }
+    munmap(mapping, bytes);
+
+    QVERIFY(!reader.open(name.toStdString()));
+    QVERIFY(!reader.errorString().empty());
+    QCOMPARE(reader.roomCount(), std::uint32_t(0));
+}
+
+void EngineBenchmark::hvacPollCycle_data() {
+    QTest::addColumn<int>("rooms");
+    QTest::newRow("1000") << 1000;
+    QTest::newRow("5000") << 5000;
+}
+
+/**
+ * @brief Полный цикл опроса установок через имитатор шлюза на локальном порту.
+ *
+ * Имитатор работает в своём потоке; цикл - от первого запроса до последнего
+ * разобранного измерения, как в потоке приёма SensorIngestion.
+ */
+void EngineBenchmark::hvacPollCycle() {
+    QFETCH(int, rooms);
+    HvacSimulator simulator(rooms);
+    const int port = simulator.listen(0);
+    QVERIFY2(port > 0, simulator.errorString().c_str());
+    std::atomic<bool> stop{false};
+    std::thread gateway([&]() { simulator.run(stop); });
+
+    // Постоянная частота: каждый цикл читает все установки
+    HvacDeviceSource source("127.0.0.1", quint16(port), rooms, HvacDeviceSource::DefaultConnections, 0, 1);
+    QVERIFY(source.open());
+    std::vector<SensorSample> samples(1024);
+    int received = 0;
+    QBENCHMARK {
+        received = 0;
+        while (received < rooms)
+            received += source.read(samples.data(), int(samples.size()));
+    }
+    source.close();
+    stop = true;
+    gateway.join();
+
+    QCOMPARE(received, rooms);
+    QCOMPARE(source.failedRequests(), quint64(0));
+}
+
+/**
+ * @brief Такт расписания опроса: выбор установок, которым пора, и их перепланирование по измерениям.
+ *
+ * Показания блуждают с шагом точности датчиков, каждая сотая комната - скачками;
+ * после замера проверяется, что спокойные комнаты опрашиваются реже.
+ */
+void EngineBenchmark::samplingSchedule_data() {
+    addRoomCounts(100000);
+}
+
+void EngineBenchmark::samplingSchedule() {
+    QFETCH(int, rooms);
+    SamplingScheduler scheduler(rooms);
+    std::vector<SensorSample> samples = samplesForAllRooms(rooms, 0);
+    std::vector<int> due;
+    int round = 0;
+    QBENCHMARK {
+        advanceSamples(samples, round);
+        scheduler.advance(due);
+        for (int roomId : due) {
+            const SensorSample &sample = samples[size_t(roomId)];
+            const double jump = roomId % 100 == 0 && round % 2 ? 1.0 : 0.0;
+            scheduler.complete(roomId, sample.temperature + jump, sample.humidity, sample.temperature);
+        }
+        ++round;
+    }
+    if (round > 8 && rooms >= 100)
+        QVERIFY(scheduler.polledRooms() < scheduler.fixedRatePolls());
+}
+
+void EngineBenchmark::controlApiThroughput_data() {
+    QTest::addColumn<int>("batch");
+    QTest::newRow("1") << 1;
+    QTest::newRow("64") << 64;
+    QTest::newRow("512") << 512;
+}
+
+/**
+ * @brief 100000 уставок через API управления на Unix-сокете пакетами по batch.
+ *
+ * Клиент держит в пути 16 запросов; drain() вызывается прямо из цикла замера
+ * вместо очереди событий, поэтому в замер входят сокет, разбор кадров, оба
+ * буфера и setSetpoint() с сигналом roomChanged.
+ */
+void EngineBenchmark::controlApiThroughput() {
+    QFETCH(int, batch);
+    constexpr int Rooms = 5000;
+    constexpr int Setpoints = 100000;
+    constexpr size_t Pipeline = 16;
+    RoomStateStore store(Rooms);
+    ControlApiServer server(&store);
+    const QString address = "unix:" + workDir.filePath("control.sock");
+    QVERIFY(server.start(address));
+    ControlApiClient client;
+    QVERIFY2(client.connect(address.toStdString()), client.errorString().c_str());
+
+    std::vector<std::int32_t> roomIds(size_t(batch), 0);
+    std::vector<double> setpoints(size_t(batch), 22.0);
+    int nextRoom = 0;
+    int applied = 0;
+    quint8 status = ControlApi::Ok;
+    const auto handler = [&](const ControlApiClient::Response &response) {
+        applied += int(response.count);
+        status |= response.status;
+    };
+    QBENCHMARK {
+        applied = 0;
+        int queued = 0;
+        while (applied < Setpoints) {
+            while (queued < Setpoints && client.pendingRequests() < Pipeline) {
+                const int count = std::min(batch, Setpoints - queued);
+                for (int i = 0; i < count; ++i) {
+                    roomIds[size_t(i)] = nextRoom;
+                    nextRoom = (nextRoom + 1) % Rooms;
+                }
+                client.setSetpoints(roomIds.data(), setpoints.data(), size_t(count));
+                queued += count;
+            }
+            QVERIFY2(client.process(0, handler) >= 0, client.errorString().c_str());
+            server.drain();
+        }
+    }
+    server.stop();
+
+    QCOMPARE(status, quint8(ControlApi::Ok));
+    QCOMPARE(applied, Setpoints);
+    QCOMPARE(store.setpoint(Rooms - 1), 22.0);
+}
+
+/**
+ * @brief Полный пакет из ControlApi::MaxItems уставок через ClimateEngine.
+ *
+ * В отличие от controlApiThroughput, уставки проходят через все подписки
+ * ядра на roomChanged (запись, передача на установки); после замера
+ * проверяется, что правки уставок не добавили точек в историю комнат.
+ */
+void EngineBenchmark::controlApiEngineBatch() {
+    constexpr int Rooms = int(ControlApi::MaxItems);
+    ClimateEngine engine(workDir.filePath("api.snapshot"));
+    engine.setRoomCount(Rooms);
+    const QString address = "unix:" + workDir.filePath("engine-control.sock");
+    QVERIFY(engine.startControlApi(address));
+    ControlApiClient client;
+    QVERIFY2(client.connect(address.toStdString()), client.errorString().c_str());
+
+    std::vector<std::int32_t> roomIds(size_t(Rooms), 0);
+    for (int roomId = 0; roomId < Rooms; ++roomId)
+        roomIds[size_t(roomId)] = roomId;
+    std::vector<double> setpoints(size_t(Rooms), 0.0);
+    for (int roomId = 0; roomId < Rooms; ++roomId)
+        QCOMPARE(engine.history()->latestTimestamp(roomId), qint64(-1));
+
+    int applied = 0;
+    quint8 status = ControlApi::Ok;
+    const auto handler = [&](const ControlApiClient::Response &response) {
+        applied = int(response.count);
+        status |= response.status;
+    };
+    int round = 0;
+    QBENCHMARK {
+        // Уставка меняется каждый раз, иначе setSetpoint() ничего не делает
+        std::fill(setpoints.begin(), setpoints.end(), 22.0 + 0.5 * (round++ % 2));
+        applied = 0;
+        client.setSetpoints(roomIds.data(), setpoints.data(), roomIds.size());
+        while (client.pendingRequests() > 0) {
+            QVERIFY2(client.process(0, handler) >= 0, client.errorString().c_str());
+            engine.controlApi()->drain();
+        }
+    }
+    engine.stop();
+
+    QCOMPARE(status, quint8(ControlApi::Ok));
+    QCOMPARE(applied, Rooms);
+    for (int roomId = 0; roomId < Rooms; ++roomId)
+        QCOMPARE(engine.history()->latestTimestamp(roomId), qint64(-1));
+}
+
+/**
+ * @brief Стоимость одного замера CLIMATE_PROFILE_SCOPE (два чтения часов и запись в гистограмму).
+ */
+void EngineBenchmark::profileScope() {
+    Profiler::reset();
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i) {
+            CLIMATE_PROFILE_SCOPE(UiFrame);
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(EngineBenchmark)
+
+#include "tst_enginebenchmark.moc"
@@ -0,0 +1,12 @@
+QT += core gui widgets testlib
+
+CONFIG += c++17 testcase
+CONFIG -= app_bundle
+
+TARGET = guibenchmark
+
+include(../../engine.pri)
+include(../../gui.pri)
+
+SOURCES += \
+        tst_guibenchmark.cpp
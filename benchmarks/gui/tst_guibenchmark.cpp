@@ -0,0 +1,225 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QApplication>
+
+#include "header.h"
+
+/**
+ * @brief Замеры слотов главного окна.
+ *
+ * Окно создаётся во временном каталоге, чтобы не трогать state.snapshot
+ * и settings.xml рабочего каталога. Без дисплея запускать с -platform offscreen.
+ */
+class GuiBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+
+    void setupUI();
+    void updateTemperature_data();
+    void updateTemperature();
+    void updateTemperatureAllRooms_data();
+    void updateTemperatureAllRooms();
+    void changePressureUnit_data();
+    void changePressureUnit();
+    void editRoomRoundTrip();
+    void saveSettings_data();
+    void saveSettings();
+    void loadSettings_data();
+    void loadSettings();
+    void toggleDarkTheme();
+    void floorPlanColors_data();
+    void floorPlanColors();
+
+private:
+    static void addRoomCounts();
+
+    QTemporaryDir workDir;
+    QString previousDir;
+};
+
+void GuiBenchmark::initTestCase() {
+    QVERIFY(workDir.isValid());
+    previousDir = QDir::currentPath();
+    QVERIFY(QDir::setCurrent(workDir.path()));
+}
+
+void GuiBenchmark::cleanupTestCase() {
+    QDir::setCurrent(previousDir);
+}
+
+/// Каждый замер начинается с трёх комнат по умолчанию, без снимка предыдущего окна
+void GuiBenchmark::init() {
+    QFile::remove("state.snapshot");
+    QFile::remove("settings.xml");
+}
+
+void GuiBenchmark::addRoomCounts() {
+    QTest::addColumn<int>("rooms");
+    QTest::newRow("3") << 3;
+    QTest::newRow("1000") << 1000;
+    QTest::newRow("10000") << 10000;
+}
+
+/**
+ * @brief Построение окна целиком (конструктор с setupUI) и его закрытие.
+ */
+void GuiBenchmark::setupUI() {
+    QBENCHMARK {
+        MainWindow window;
+    }
+}
+
+/**
+ * @brief Изменение температуры одной комнаты со спинбокса.
+ */
+void GuiBenchmark::updateTemperature_data() {
+    addRoomCounts();
+}
+
+void GuiBenchmark::updateTemperature() {
+    QFETCH(int, rooms);
+    MainWindow window;
+    window.setRoomCount(rooms);
+    int value = 0;
+    QBENCHMARK {
+        window.updateTemperature(value++ % 100, 1);
+    }
+}
+
+/**
+ * @brief Одна температура для всех комнат.
+ */
+void GuiBenchmark::updateTemperatureAllRooms_data() {
+    addRoomCounts();
+}
+
+void GuiBenchmark::updateTemperatureAllRooms() {
+    QFETCH(int, rooms);
+    MainWindow window;
+    window.setRoomCount(rooms);
+    int value = 0;
+    QBENCHMARK {
+        window.updateTemperature(value++ % 100);
+    }
+}
+
+/**
+ * @brief Переключение единицы давления Па <-> мм рт. ст.
+ */
+void GuiBenchmark::changePressureUnit_data() {
+    addRoomCounts();
+}
+
+void GuiBenchmark::changePressureUnit() {
+    QFETCH(int, rooms);
+    MainWindow window;
+    window.setRoomCount(rooms);
+    int index = 0;
+    QBENCHMARK {
+        index ^= 1;
+        window.changePressureUnit(index);
+    }
+}
+
+/**
+ * @brief Путь значений editRoom без модального exec(): хранилище -> диалог -> хранилище.
+ */
+void GuiBenchmark::editRoomRoundTrip() {
+    MainWindow window;
+    RoomStateStore *store = window.roomStore;
+    QBENCHMARK {
+        RoomEditDialog dialog(1, store->temperature(0), store->humidity(0), store->pressure(0),
+                              airflowDirectionName(store->airflow(0)), &window);
+        store->setRoom(0, dialog.getTemperature() + 0.5, dialog.getHumidity(), dialog.getPressure(),
+                       airflowDirectionFromName(dialog.getAirflowDirection()));
+    }
+}
+
+/**
+ * @brief Сохранение состояния: двоичный снимок и settings.xml.
+ */
+void GuiBenchmark::saveSettings_data() {
+    addRoomCounts();
+}
+
+void GuiBenchmark::saveSettings() {
+    QFETCH(int, rooms);
+    MainWindow window;
+    window.setRoomCount(rooms);
+    QBENCHMARK {
+        QVERIFY(window.engine->saveSnapshot());
+        window.saveSettings();
+    }
+}
+
+/**
+ * @brief Загрузка состояния из снимка с обновлением окна.
+ */
+void GuiBenchmark::loadSettings_data() {
+    addRoomCounts();
+}
+
+void GuiBenchmark::loadSettings() {
+    QFETCH(int, rooms);
+    MainWindow window;
+    window.setRoomCount(rooms);
+    QVERIFY(window.engine->saveSnapshot());
+    QBENCHMARK {
+        window.loadSettings();
+    }
+    QCOMPARE(window.roomStore->roomCount(), rooms);
+}
+
+/**
+ * @brief Задержка смены темы видимого окна вместе с обработкой событий перерисовки.
+ */
+void GuiBenchmark::toggleDarkTheme() {
+    MainWindow window;
+    window.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&window));
+    bool dark = false;
+    QBENCHMARK {
+        dark = !dark;
+        window.toggleDarkTheme(dark);
+        QCoreApplication::processEvents();
+    }
+    window.toggleDarkTheme(false);
+}
+
+/**
+ * @brief Перекраска всех комнат видимого плана этажей вместе с перерисовкой.
+ *
+ * Смена шкалы меняет цвет каждой комнаты, то есть это худший случай
+ * обновления: все элементы сбрасывают кэш изображения.
+ */
+void GuiBenchmark::floorPlanColors_data() {
+    QTest::addColumn<int>("rooms");
+    QTest::newRow("1000") << 1000;
+    QTest::newRow("20000") << 20000;
+}
+
+void GuiBenchmark::floorPlanColors() {
+    QFETCH(int, rooms);
+    MainWindow window;
+    window.setRoomCount(rooms);
+    window.roomStore->fillTemperature(20.0); ///< Внутри обеих шкал замера, иначе цвет не меняется
+    window.floorPlanCheck->setChecked(true);
+    window.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&window));
+    QCOMPARE(window.floorPlan->roomCount(), rooms);
+    bool shifted = false;
+    QBENCHMARK {
+        shifted = !shifted;
+        window.floorPlan->setValueRange(Metric::Temperature, shifted ? 10.0 : 15.0, shifted ? 25.0 : 30.0);
+        QCoreApplication::processEvents();
+    }
+    QCOMPARE(window.floorPlan->changedColors(), rooms);
+}
+
+QTEST_MAIN(GuiBenchmark)
+
+#include "tst_guibenchmark.moc"
@@ -0,0 +1,211 @@
+#include "buildinghierarchy.h"
+
+#include <algorithm>
+
+namespace {
+
+int ceilDiv(int value, int divisor) {
+    return (value + divisor - 1) / divisor;
+}
+
+} // namespace
+
+/**
+ * @brief Конструктор иерархии.
+ * @param store Хранилище, за которым следит иерархия.
+ */
+BuildingHierarchy::BuildingHierarchy(RoomStateStore *store, QObject *parent)
+    : QObject(parent), store(store)
+{
+    connect(store, &RoomStateStore::roomChanged, this, &BuildingHierarchy::roomChanged);
+    connect(store, &RoomStateStore::allRoomsChanged, this, &BuildingHierarchy::allRoomsChanged);
+    connect(store, &RoomStateStore::samplesApplied, this, &BuildingHierarchy::samplesApplied);
+    connect(store, &RoomStateStore::roomsReset, this, &BuildingHierarchy::roomsReset);
+    roomsReset();
+}
+
+void BuildingHierarchy::setLayout(int roomsPerZone, int zonesPerFloor) {
+    zoneRooms = std::max(roomsPerZone, 1);
+    floorZones = std::max(zonesPerFloor, 1);
+    emit layoutChanged();
+}
+
+int BuildingHierarchy::nodeCount(Level level) const {
+    switch (level) {
+    case BuildingLevel: return 1;
+    case FloorLevel:    return ceilDiv(rooms, zoneRooms * floorZones);
+    case ZoneLevel:     return ceilDiv(rooms, zoneRooms);
+    case RoomLevel:     return rooms;
+    case LevelCount:    break;
+    }
+    return 0;
+}
+
+int BuildingHierarchy::childCount(Level level, int node) const {
+    switch (level) {
+    case BuildingLevel: return nodeCount(FloorLevel);
+    case FloorLevel:    return std::min(floorZones, nodeCount(ZoneLevel) - node * floorZones);
+    case ZoneLevel:     return roomEnd(level, node) - firstRoom(level, node);
+    default:            return 0;
+    }
+}
+
+int BuildingHierarchy::firstChild(Level level, int node) const {
+    switch (level) {
+    case FloorLevel: return node * floorZones;
+    case ZoneLevel:  return node * zoneRooms;
+    default:         return 0;
+    }
+}
+
+int BuildingHierarchy::parentNode(Level level, int node) const {
+    switch (level) {
+    case ZoneLevel: return node / floorZones;
+    case RoomLevel: return node / zoneRooms;
+    default:        return 0;
+    }
+}
+
+int BuildingHierarchy::firstRoom(Level level, int node) const {
+    switch (level) {
+    case FloorLevel: return std::min(node * zoneRooms * floorZones, rooms);
+    case ZoneLevel:  return std::min(node * zoneRooms, rooms);
+    case RoomLevel:  return node;
+    default:         return 0;
+    }
+}
+
+int BuildingHierarchy::roomEnd(Level level, int node) const {
+    switch (level) {
+    case FloorLevel: return std::min((node + 1) * zoneRooms * floorZones, rooms);
+    case ZoneLevel:  return std::min((node + 1) * zoneRooms, rooms);
+    case RoomLevel:  return std::min(node + 1, rooms);
+    default:         return rooms;
+    }
+}
+
+QString BuildingHierarchy::nodeName(Level level, int node) {
+    switch (level) {
+    case BuildingLevel: return "Здание";
+    case FloorLevel:    return QString("Этаж %1").arg(node + 1);
+    case ZoneLevel:     return QString("Зона %1").arg(node + 1);
+    case RoomLevel:     return QString("Комната %1").arg(node + 1);
+    case LevelCount:    break;
+    }
+    return QString();
+}
+
+BuildingHierarchy::Aggregate BuildingHierarchy::aggregate(Level level, int node, Metric metric) const {
+    return rangeAggregate(firstRoom(level, node), roomEnd(level, node), metric);
+}
+
+/**
+ * @brief Сводка по диапазону комнат: подъём по дереву с обоих концов, O(log n).
+ */
+BuildingHierarchy::Aggregate BuildingHierarchy::rangeAggregate(int firstRoomId, int roomEndId, Metric metric) const {
+    Aggregate result;
+    firstRoomId = std::max(firstRoomId, 0);
+    roomEndId = std::min(roomEndId, rooms);
+    if (firstRoomId >= roomEndId)
+        return result;
+    result.count = roomEndId - firstRoomId;
+
+    const Tree &tree = trees[int(metric)];
+    auto take = [&](int vertex) {
+        result.sum += tree.sum[size_t(vertex)];
+        result.min = std::min(result.min, tree.min[size_t(vertex)]);
+        result.max = std::max(result.max, tree.max[size_t(vertex)]);
+    };
+    for (int left = firstRoomId + leafBase, right = roomEndId + leafBase; left < right; left >>= 1, right >>= 1) {
+        if (left & 1)
+            take(left++);
+        if (right & 1)
+            take(--right);
+    }
+    return result;
+}
+
+/**
+ * @brief Переносит значения комнаты в листья и пересчитывает путь до корня, O(log n).
+ */
+void BuildingHierarchy::updateRoom(int roomId) {
+    if (roomId < 0 || roomId >= rooms)
+        return;
+    for (int metric = 0; metric < MetricCount; ++metric) {
+        Tree &tree = trees[metric];
+        int vertex = leafBase + roomId;
+        const double value = column(metric)[roomId];
+        tree.sum[size_t(vertex)] = tree.min[size_t(vertex)] = tree.max[size_t(vertex)] = value;
+        for (vertex >>= 1; vertex > 0; vertex >>= 1) {
+            const size_t left = size_t(vertex) * 2;
+            tree.sum[size_t(vertex)] = tree.sum[left] + tree.sum[left + 1];
+            tree.min[size_t(vertex)] = std::min(tree.min[left], tree.min[left + 1]);
+            tree.max[size_t(vertex)] = std::max(tree.max[left], tree.max[left + 1]);
+        }
+    }
+}
+
+/**
+ * @brief Строит деревья по всем комнатам снизу вверх, O(n).
+ */
+void BuildingHierarchy::rebuild() {
+    for (int metric = 0; metric < MetricCount; ++metric) {
+        Tree &tree = trees[metric];
+        const double *values = column(metric);
+        std::copy(values, values + rooms, tree.sum.begin() + leafBase);
+        std::copy(values, values + rooms, tree.min.begin() + leafBase);
+        std::copy(values, values + rooms, tree.max.begin() + leafBase);
+        for (int vertex = leafBase - 1; vertex > 0; --vertex) {
+            const size_t left = size_t(vertex) * 2;
+            tree.sum[size_t(vertex)] = tree.sum[left] + tree.sum[left + 1];
+            tree.min[size_t(vertex)] = std::min(tree.min[left], tree.min[left + 1]);
+            tree.max[size_t(vertex)] = std::max(tree.max[left], tree.max[left + 1]);
+        }
+    }
+}
+
+void BuildingHierarchy::roomChanged(int roomId, int fields) {
+    if (fields & RoomStateStore::MeasurementFields)
+        updateRoom(roomId);
+}
+
+void BuildingHierarchy::allRoomsChanged(int fields) {
+    if (fields & RoomStateStore::MeasurementFields)
+        rebuild();
+}
+
+void BuildingHierarchy::samplesApplied() {
+    const std::vector<RoomStateStore::RoomChange> &changes = store->lastAppliedChanges();
+    if (changes.size() > size_t(rooms / RebuildFraction)) {
+        rebuild();
+        return;
+    }
+    for (const RoomStateStore::RoomChange &change : changes)
+        roomChanged(change.roomId, change.fields);
+}
+
+/**
+ * @brief Пересоздаёт деревья под новое число комнат; пустые листья не влияют на min/max.
+ */
+void BuildingHierarchy::roomsReset() {
+    rooms = store->roomCount();
+    leafBase = 1;
+    while (leafBase < rooms)
+        leafBase *= 2;
+    for (Tree &tree : trees) {
+        tree.sum.assign(size_t(leafBase) * 2, 0.0);
+        tree.min.assign(size_t(leafBase) * 2, std::numeric_limits<double>::infinity());
+        tree.max.assign(size_t(leafBase) * 2, -std::numeric_limits<double>::infinity());
+    }
+    rebuild();
+    emit layoutChanged();
+}
+
+const double *BuildingHierarchy::column(int metric) const {
+    switch (Metric(metric)) {
+    case Metric::Temperature: return store->temperatures();
+    case Metric::Humidity:    return store->humidities();
+    case Metric::Pressure:    return store->pressures();
+    }
+    return store->temperatures();
+}
@@ -0,0 +1,106 @@
+#ifndef BUILDINGHIERARCHY_H
+#define BUILDINGHIERARCHY_H
+
+#include <QObject>
+#include <QString>
+#include <limits>
+#include <vector>
+
+#include "roomstate.h"
+#include "roomhistory.h"
+
+/**
+ * @brief Иерархия здания (здание - этаж - зона - комната) со сводными значениями узлов.
+ *
+ * Комнаты нумеруются подряд по зонам и этажам, поэтому каждый узел
+ * охватывает непрерывный диапазон комнат [firstRoom, roomEnd). Для каждой
+ * величины по комнатам строится дерево отрезков с суммой, минимумом
+ * и максимумом: изменение комнаты пересчитывает только путь от листа до
+ * корня, а сводка любого узла собирается из O(log n) вершин дерева.
+ * Значения вершин каждый раз пересчитываются из детей, а не накапливаются
+ * приращениями, поэтому ошибка округления суммы не растёт со временем.
+ *
+ * Иерархия следит за RoomStateStore сама: пакет измерений обновляет
+ * изменённые комнаты по одной или, если их больше RebuildFraction от
+ * всех, перестраивает дерево целиком за O(n).
+ */
+class BuildingHierarchy : public QObject {
+    Q_OBJECT
+
+public:
+    enum Level {
+        BuildingLevel = 0,
+        FloorLevel,
+        ZoneLevel,
+        RoomLevel,
+        LevelCount
+    };
+
+    /// Сводка величины по диапазону комнат
+    struct Aggregate {
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+        double sum = 0.0;
+        int count = 0;
+
+        double average() const { return count ? sum / double(count) : 0.0; }
+    };
+
+    static constexpr int RebuildFraction = 8; ///< Пакет больше roomCount / RebuildFraction - полная перестройка
+
+    explicit BuildingHierarchy(RoomStateStore *store, QObject *parent = nullptr);
+
+    /**
+     * @brief Задаёт планировку: этажи из zonesPerFloor зон по roomsPerZone комнат.
+     *
+     * Совпадает с ThermalSimulation::setBuildingLayout() (зона - ряд комнат);
+     * последние зона и этаж могут быть неполными.
+     */
+    void setLayout(int roomsPerZone, int zonesPerFloor);
+    int roomsPerZone() const { return zoneRooms; }
+    int zonesPerFloor() const { return floorZones; }
+
+    int roomCount() const { return rooms; }
+    int nodeCount(Level level) const;
+    int childCount(Level level, int node) const;
+    int firstChild(Level level, int node) const;  ///< Номер первого ребёнка на уровне level + 1
+    int parentNode(Level level, int node) const;  ///< Номер родителя на уровне level - 1
+    int firstRoom(Level level, int node) const;
+    int roomEnd(Level level, int node) const;     ///< Комната после последней комнаты узла
+    static QString nodeName(Level level, int node);
+
+    Aggregate aggregate(Level level, int node, Metric metric) const;
+    Aggregate rangeAggregate(int firstRoomId, int roomEndId, Metric metric) const; ///< [firstRoomId, roomEndId)
+
+public slots:
+    void updateRoom(int roomId);
+    void rebuild();
+
+signals:
+    void layoutChanged(); ///< Изменились планировка или число комнат
+
+private slots:
+    void roomChanged(int roomId, int fields);
+    void allRoomsChanged(int fields);
+    void samplesApplied();
+    void roomsReset();
+
+private:
+    /// Дерево отрезков одной величины: вершина i - дети 2i и 2i + 1, листья с leafBase
+    struct Tree {
+        std::vector<double> sum;
+        std::vector<double> min;
+        std::vector<double> max;
+    };
+
+    const double *column(int metric) const;
+
+    RoomStateStore *store;
+    int rooms = 0;
+    int zoneRooms = 10;
+    int floorZones = 2;
+    int leafBase = 1;              ///< Степень двойки, не меньше числа комнат
+    Tree trees[MetricCount];
+};
+
+#endif // BUILDINGHIERARCHY_H
@@ -0,0 +1,198 @@
+#include "buildingtreemodel.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr quintptr LevelCount = BuildingHierarchy::LevelCount;
+
+quintptr encode(BuildingHierarchy::Level level, int node) {
+    return quintptr(node) * LevelCount + quintptr(level);
+}
+
+} // namespace
+
+/**
+ * @brief Конструктор модели здания.
+ * @param hierarchy Иерархия, из сводок которой берутся значения.
+ */
+BuildingTreeModel::BuildingTreeModel(BuildingHierarchy *hierarchy, QObject *parent)
+    : QAbstractItemModel(parent), hierarchy(hierarchy)
+{
+    connect(hierarchy, &BuildingHierarchy::layoutChanged, this, &BuildingTreeModel::hierarchyChanged);
+}
+
+BuildingHierarchy::Level BuildingTreeModel::level(const QModelIndex &index) const {
+    return BuildingHierarchy::Level(index.internalId() % LevelCount);
+}
+
+int BuildingTreeModel::node(const QModelIndex &index) const {
+    return int(index.internalId() / LevelCount);
+}
+
+int BuildingTreeModel::firstRoom(const QModelIndex &index) const {
+    if (!index.isValid() || hierarchy->roomCount() == 0)
+        return -1;
+    return std::min(hierarchy->firstRoom(level(index), node(index)), hierarchy->roomCount() - 1);
+}
+
+/**
+ * @brief Индекс узла; строка - положение среди детей родителя.
+ */
+QModelIndex BuildingTreeModel::nodeIndex(BuildingHierarchy::Level nodeLevel, int nodeNumber, int column) const {
+    if (nodeLevel == BuildingHierarchy::BuildingLevel)
+        return createIndex(0, column, encode(nodeLevel, 0));
+    const BuildingHierarchy::Level parentLevel = BuildingHierarchy::Level(nodeLevel - 1);
+    const int parentNumber = hierarchy->parentNode(nodeLevel, nodeNumber);
+    const int row = nodeNumber - hierarchy->firstChild(parentLevel, parentNumber);
+    return createIndex(row, column, encode(nodeLevel, nodeNumber));
+}
+
+QModelIndex BuildingTreeModel::index(int row, int column, const QModelIndex &parent) const {
+    if (row < 0 || column < 0 || column >= ColumnCount || row >= rowCount(parent))
+        return QModelIndex();
+    if (!parent.isValid())
+        return createIndex(row, column, encode(BuildingHierarchy::BuildingLevel, 0));
+    const BuildingHierarchy::Level parentLevel = level(parent);
+    return createIndex(row, column, encode(BuildingHierarchy::Level(parentLevel + 1),
+                                           hierarchy->firstChild(parentLevel, node(parent)) + row));
+}
+
+QModelIndex BuildingTreeModel::parent(const QModelIndex &child) const {
+    if (!child.isValid() || level(child) == BuildingHierarchy::BuildingLevel)
+        return QModelIndex();
+    const BuildingHierarchy::Level childLevel = level(child);
+    return nodeIndex(BuildingHierarchy::Level(childLevel - 1), hierarchy->parentNode(childLevel, node(child)), 0);
+}
+
+int BuildingTreeModel::rowCount(const QModelIndex &parent) const {
+    if (!parent.isValid())
+        return 1;
+    if (parent.column() != 0)
+        return 0;
+    return hierarchy->childCount(level(parent), node(parent));
+}
+
+int BuildingTreeModel::columnCount(const QModelIndex &parent) const {
+    Q_UNUSED(parent);
+    return ColumnCount;
+}
+
+QString BuildingTreeModel::formatValue(double value, Metric metric) const {
+    switch (metric) {
+    case Metric::Temperature:
+        return QString("%1 %2").arg(convertTemperature(value, temperatureDisplayUnit), 0, 'f', 1)
+                               .arg(QString::fromUtf8(temperatureUnitSymbol(temperatureDisplayUnit)));
+    case Metric::Humidity:
+        return QString("%1%").arg(value, 0, 'f', 1);
+    case Metric::Pressure:
+        return QString("%1 %2").arg(convertPressure(value, pressureDisplayUnit), 0, 'f', 1)
+                               .arg(QString::fromUtf8(pressureUnitSymbol(pressureDisplayUnit)));
+    }
+    return QString();
+}
+
+QVariant BuildingTreeModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || (role != Qt::DisplayRole && role != Qt::ToolTipRole))
+        return QVariant();
+
+    const BuildingHierarchy::Level nodeLevel = level(index);
+    const int nodeNumber = node(index);
+    if (index.column() == NameColumn)
+        return BuildingHierarchy::nodeName(nodeLevel, nodeNumber);
+
+    const Metric metric = Metric(index.column() - TemperatureColumn);
+    const BuildingHierarchy::Aggregate aggregate = hierarchy->aggregate(nodeLevel, nodeNumber, metric);
+    if (aggregate.count == 0)
+        return QVariant();
+    if (nodeLevel == BuildingHierarchy::RoomLevel)
+        return formatValue(aggregate.average(), metric);
+    if (role == Qt::ToolTipRole)
+        return QString("Комнат: %1").arg(aggregate.count);
+    return QString("%1 (%2 .. %3)")
+        .arg(formatValue(aggregate.average(), metric))
+        .arg(formatValue(aggregate.min, metric))
+        .arg(formatValue(aggregate.max, metric));
+}
+
+QVariant BuildingTreeModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+        return QAbstractItemModel::headerData(section, orientation, role);
+
+    switch (section) {
+    case NameColumn:        return QString("Узел");
+    case TemperatureColumn: return QString("Температура");
+    case HumidityColumn:    return QString("Влажность");
+    case PressureColumn:    return QString("Давление");
+    }
+    return QVariant();
+}
+
+void BuildingTreeModel::setTemperatureUnit(TemperatureUnit unit) {
+    if (temperatureDisplayUnit == unit)
+        return;
+    temperatureDisplayUnit = unit;
+    refreshAll();
+}
+
+void BuildingTreeModel::setPressureUnit(PressureUnit unit) {
+    if (pressureDisplayUnit == unit)
+        return;
+    pressureDisplayUnit = unit;
+    refreshAll();
+}
+
+/**
+ * @brief Отмечает изменёнными комнаты диапазона и всех их предков.
+ */
+void BuildingTreeModel::roomRangeChanged(int firstRoomId, int lastRoomId, int fields) {
+    const int dataFields = RoomStateStore::TemperatureField | RoomStateStore::HumidityField
+                           | RoomStateStore::PressureField;
+    if (!(fields & dataFields) || firstRoomId > lastRoomId || lastRoomId >= hierarchy->roomCount())
+        return;
+
+    const int firstZone = hierarchy->parentNode(BuildingHierarchy::RoomLevel, firstRoomId);
+    const int lastZone = hierarchy->parentNode(BuildingHierarchy::RoomLevel, lastRoomId);
+    if (lastZone - firstZone >= MaxRangeSignals) {
+        refreshAll();
+        return;
+    }
+
+    const int last = PressureColumn;
+    for (int zone = firstZone; zone <= lastZone; ++zone) {
+        const int first = std::max(firstRoomId, hierarchy->firstRoom(BuildingHierarchy::ZoneLevel, zone));
+        const int end = std::min(lastRoomId + 1, hierarchy->roomEnd(BuildingHierarchy::ZoneLevel, zone));
+        emit dataChanged(nodeIndex(BuildingHierarchy::RoomLevel, first, TemperatureColumn),
+                         nodeIndex(BuildingHierarchy::RoomLevel, end - 1, last));
+    }
+
+    ///< Предки: зоны по этажам, этажи и здание
+    const int firstFloor = hierarchy->parentNode(BuildingHierarchy::ZoneLevel, firstZone);
+    const int lastFloor = hierarchy->parentNode(BuildingHierarchy::ZoneLevel, lastZone);
+    for (int floor = firstFloor; floor <= lastFloor; ++floor) {
+        const int floorFirstZone = hierarchy->firstChild(BuildingHierarchy::FloorLevel, floor);
+        const int first = std::max(firstZone, floorFirstZone);
+        const int end = std::min(lastZone + 1, floorFirstZone + hierarchy->childCount(BuildingHierarchy::FloorLevel, floor));
+        emit dataChanged(nodeIndex(BuildingHierarchy::ZoneLevel, first, TemperatureColumn),
+                         nodeIndex(BuildingHierarchy::ZoneLevel, end - 1, last));
+    }
+    emit dataChanged(nodeIndex(BuildingHierarchy::FloorLevel, firstFloor, TemperatureColumn),
+                     nodeIndex(BuildingHierarchy::FloorLevel, lastFloor, last));
+    emit dataChanged(nodeIndex(BuildingHierarchy::BuildingLevel, 0, TemperatureColumn),
+                     nodeIndex(BuildingHierarchy::BuildingLevel, 0, last));
+}
+
+/**
+ * @brief Сообщает об изменении всех значений без изменения структуры.
+ *
+ * Раскрытые узлы и выделение сохраняются, перерисовываются только видимые строки.
+ */
+void BuildingTreeModel::refreshAll() {
+    emit layoutAboutToBeChanged();
+    emit layoutChanged();
+}
+
+void BuildingTreeModel::hierarchyChanged() {
+    beginResetModel();
+    endResetModel();
+}
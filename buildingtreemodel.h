@@ -0,0 +1,69 @@
+#ifndef BUILDINGTREEMODEL_H
+#define BUILDINGTREEMODEL_H
+
+#include <QAbstractItemModel>
+
+#include "buildinghierarchy.h"
+#include "unitconversion.h"
+
+/**
+ * @brief Древовидная модель здания поверх BuildingHierarchy.
+ *
+ * Узлы не хранятся: индекс несёт уровень и номер узла в internalId, а
+ * значения ячеек берутся из сводок иерархии при запросе представлением,
+ * поэтому раскрытие этажа или зоны ничего не выделяет и не пересчитывает.
+ * У узлов выше комнаты показывается среднее и разброс min..max.
+ *
+ * Об изменениях модель узнаёт через roomRangeChanged() (обычно от
+ * UiUpdateScheduler): изменённые комнаты и их предки отмечаются сигналами
+ * dataChanged. Если диапазон затрагивает больше MaxRangeSignals зон,
+ * вместо тысяч сигналов представлению сообщается об обновлении раскладки
+ * без изменения структуры, и оно перерисовывает только видимые строки.
+ */
+class BuildingTreeModel : public QAbstractItemModel {
+    Q_OBJECT
+
+public:
+    enum Column {
+        NameColumn = 0,
+        TemperatureColumn,
+        HumidityColumn,
+        PressureColumn,
+        ColumnCount
+    };
+
+    static constexpr int MaxRangeSignals = 64;
+
+    explicit BuildingTreeModel(BuildingHierarchy *hierarchy, QObject *parent = nullptr);
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    BuildingHierarchy::Level level(const QModelIndex &index) const;
+    int node(const QModelIndex &index) const;
+    int firstRoom(const QModelIndex &index) const; ///< Первая комната узла, -1 для неверного индекса
+
+    void setTemperatureUnit(TemperatureUnit unit);
+    void setPressureUnit(PressureUnit unit);
+
+public slots:
+    void roomRangeChanged(int firstRoomId, int lastRoomId, int fields);
+
+private slots:
+    void hierarchyChanged();
+
+private:
+    QModelIndex nodeIndex(BuildingHierarchy::Level level, int node, int column) const;
+    QString formatValue(double value, Metric metric) const;
+    void refreshAll();
+
+    BuildingHierarchy *hierarchy;
+    TemperatureUnit temperatureDisplayUnit = TemperatureUnit::Celsius;
+    PressureUnit pressureDisplayUnit = PressureUnit::Pascal;
+};
+
+#endif // BUILDINGTREEMODEL_H
@@ -0,0 +1,281 @@
+#include "climateengine.h"
+
+#include <QDateTime>
+
+/**
+ * @brief Конструктор ядра.
+ * @param snapshotPath Файл снимка состояния.
+ */
+ClimateEngine::ClimateEngine(const QString &snapshotPath, QObject *parent)
+    : QObject(parent)
+{
+    uptime.start();
+
+    roomStore = new RoomStateStore(DefaultRoomCount, this);
+    derivedMetrics = new DerivedMetrics(roomStore, this);
+    sensorIngestion = new SensorIngestion(roomStore, this);
+    connect(sensorIngestion, &SensorIngestion::sourceFinished, this, &ClimateEngine::sensorSourceFinished);
+    controlEngine = new ControlEngine(roomStore, this);
+    thermalSimulation = new ThermalSimulation(roomStore, this);
+    ///< Зоны и этажи иерархии совпадают с рядами и этажами имитации
+    buildingHierarchy = new BuildingHierarchy(roomStore, this);
+    buildingHierarchy->setLayout(thermalSimulation->roomsPerRow(), thermalSimulation->rowsPerFloor());
+    alarmEngine = new AlarmEngine(this);
+    alarmEngine->resize(roomStore->roomCount());
+    roomStatistics.resize(roomStore->roomCount());
+    sensorRecorder = new SensorRecorder(this);
+    recordingPlayer = new RecordingPlayer(roomStore, this);
+    connect(recordingPlayer, &RecordingPlayer::finished, this, &ClimateEngine::replayFinished);
+    connect(recordingPlayer, &RecordingPlayer::systemStateChanged, this, &ClimateEngine::systemStateReplayed);
+    sharedStateExporter = new SharedStateExporter(roomStore, this);
+    historyArchiver = new HistoryArchiver(this);
+    historyArchiver->resize(roomStore->roomCount());
+    controlApiServer = new ControlApiServer(roomStore, this);
+    eventLoopMonitor = new EventLoopMonitor(this);
+    eventLoopMonitor->start();
+
+    ///< Датчики, имитация и воспроизведение отдают пачки измерений в один distributeSamples()
+    connect(sensorIngestion, &SensorIngestion::samplesApplied, this, &ClimateEngine::distributeSamples);
+    connect(thermalSimulation, &ThermalSimulation::samplesApplied, this, &ClimateEngine::distributeSamples);
+    connect(recordingPlayer, &RecordingPlayer::samplesApplied, this, &ClimateEngine::distributeSamples);
+
+    ///< История повторяет набор комнат хранилища и записывает ручные изменения
+    roomHistory.resize(roomStore->roomCount());
+    connect(roomStore, &RoomStateStore::roomsReset, this, [this]() {
+        roomHistory.resize(roomStore->roomCount());
+        alarmEngine->resize(roomStore->roomCount());
+        roomStatistics.resize(roomStore->roomCount());
+        historyArchiver->resize(roomStore->roomCount());
+    });
+    ///< Правка уставки или направления воздуха не измерение: иначе в историю и тревоги попала бы точка с текущим временем
+    connect(roomStore, &RoomStateStore::roomChanged, this, [this](int roomId, int fields) {
+        if (fields & RoomStateStore::MeasurementFields)
+            recordRoomHistory(roomId);
+    });
+    connect(roomStore, &RoomStateStore::allRoomsChanged, this, [this](int fields) {
+        if (!(fields & RoomStateStore::MeasurementFields))
+            return;  // fillSetpoint(): ни истории, ни статистики
+        for (int roomId = 0; roomId < roomStore->roomCount(); ++roomId)
+            recordRoomHistory(roomId);
+    });
+    ///< Уставки попадают в запись вместе с измерениями
+    connect(roomStore, &RoomStateStore::roomChanged, this, [this](int roomId, int fields) {
+        if (fields & RoomStateStore::SetpointField)
+            sensorRecorder->recordSetpoint(sourceTimestampMs(), roomId, roomStore->setpoint(roomId));
+    });
+    connect(roomStore, &RoomStateStore::allRoomsChanged, this, [this](int fields) {
+        if (!(fields & RoomStateStore::SetpointField) || !sensorRecorder->isOpen())
+            return;
+        const qint64 timestampMs = sourceTimestampMs();
+        for (int roomId = 0; roomId < roomStore->roomCount(); ++roomId)
+            sensorRecorder->recordSetpoint(timestampMs, roomId, roomStore->setpoint(roomId));
+    });
+    ///< Уставки и направление воздуха уходят на установки, если источник ими управляет (см. HvacDeviceSource)
+    connect(roomStore, &RoomStateStore::roomChanged, this, [this](int roomId, int fields) {
+        if (fields & RoomStateStore::SetpointField)
+            sensorIngestion->writeSetpoint(roomId, roomStore->setpoint(roomId));
+        if (fields & RoomStateStore::AirflowField)
+            sensorIngestion->writeAirflow(roomId, roomStore->airflow(roomId));
+    });
+    ///< Комнаты с тревогой источник опрашивает чаще (см. SamplingScheduler)
+    connect(alarmEngine, &AlarmEngine::eventsReady, this, [this]() {
+        if (!sensorIngestion->isRunning())
+            return;
+        for (const AlarmEvent &event : alarmEngine->lastEvents())
+            sensorIngestion->setRoomAlarmed(event.roomId, alarmEngine->isRoomActive(event.roomId));
+    });
+    connect(roomStore, &RoomStateStore::allRoomsChanged, this, [this](int fields) {
+        if (!(fields & (RoomStateStore::SetpointField | RoomStateStore::AirflowField)) || !sensorIngestion->isRunning())
+            return;
+        for (int roomId = 0; roomId < roomStore->roomCount(); ++roomId) {
+            if (fields & RoomStateStore::SetpointField)
+                sensorIngestion->writeSetpoint(roomId, roomStore->setpoint(roomId));
+            if (fields & RoomStateStore::AirflowField)
+                sensorIngestion->writeAirflow(roomId, roomStore->airflow(roomId));
+        }
+    });
+
+    snapshotWriter = new SnapshotWriter(snapshotPath, roomStore, &roomHistory,
+                                        [this]() {
+                                            return settingsProvider ? settingsProvider() : engineSettings;
+                                        }, this);
+}
+
+ClimateEngine::~ClimateEngine() {
+    stop();
+}
+
+void ClimateEngine::setRoomCount(int roomCount) {
+    roomStore->resize(roomCount);
+}
+
+/**
+ * @brief Запускает приём измерений датчиков.
+ * @param sourceSpec Описание источника: "sim[:темп]", "hvac:<узел>[:<порт>]" или путь к файлу, каналу или сокету.
+ */
+bool ClimateEngine::startSensorIngestion(const QString &sourceSpec) {
+    return sensorIngestion->start(SensorSource::create(sourceSpec, roomStore->roomCount()));
+}
+
+/**
+ * @brief Запускает имитацию здания, которая публикует состояние комнат вместо датчиков.
+ * @param speed Секунд имитации в секунду работы.
+ */
+void ClimateEngine::startSimulation(double speed) {
+    thermalSimulation->start(speed);
+}
+
+void ClimateEngine::setSystemEnabled(bool enabled) {
+    engineSettings.systemState = enabled;
+    controlEngine->setEnabled(enabled);
+    sensorRecorder->recordSystemState(sourceTimestampMs(), enabled);
+}
+
+bool ClimateEngine::startRecording(const QString &path) {
+    if (!sensorRecorder->open(path))
+        return false;
+    sensorRecorder->recordSystemState(sourceTimestampMs(), engineSettings.systemState);
+    return true;
+}
+
+bool ClimateEngine::startStateExport(const QString &name) {
+    return sharedStateExporter->open(name);
+}
+
+bool ClimateEngine::startArchive(const QString &directory) {
+    return historyArchiver->open(directory);
+}
+
+bool ClimateEngine::startControlApi(const QString &address) {
+    return controlApiServer->start(address);
+}
+
+bool ClimateEngine::startReplay(const QString &path, double speed, qint64 fromMs) {
+    if (!recordingPlayer->open(path))
+        return false;
+    if (fromMs > 0)
+        recordingPlayer->seek(recordingPlayer->recording().firstTimestampMs() + fromMs);
+    recordingPlayer->start(speed);
+    return true;
+}
+
+bool ClimateEngine::loadSnapshot() {
+    return StateSnapshot::load(snapshotWriter->path(), *roomStore, roomHistory, engineSettings);
+}
+
+bool ClimateEngine::saveSnapshot() {
+    return snapshotWriter->saveNow();
+}
+
+void ClimateEngine::startAutosave(int intervalMs) {
+    snapshotWriter->start(intervalMs);
+}
+
+/**
+ * @brief Останавливает поток приёма до разрушения хранилища и сохраняет снимок.
+ */
+void ClimateEngine::stop() {
+    if (stopped)
+        return;
+    stopped = true;
+    controlEngine->setEnabled(false);
+    controlApiServer->stop();
+    thermalSimulation->stop();
+    sensorIngestion->stop();
+    recordingPlayer->stop();
+    sensorRecorder->close();
+    sharedStateExporter->close();
+    historyArchiver->close();
+    snapshotWriter->saveNow();
+}
+
+/**
+ * @brief Время для событий, которые не несут своего: ручных правок, уставок, включения установки.
+ *
+ * При воспроизведении - позиция записи, при имитации - время имитации,
+ * иначе - текущее. С настенным временем правка посреди воспроизведения
+ * попала бы в историю, статистику и тревоги не на своё место.
+ */
+qint64 ClimateEngine::sourceTimestampMs() const {
+    if (recordingPlayer->isPlaying())
+        return recordingPlayer->position();
+    if (thermalSimulation->isRunning())
+        return thermalSimulation->timestampMs();
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+void ClimateEngine::recordRoomHistory(int roomId) {
+    SensorSample sample;
+    sample.timestampMs = sourceTimestampMs();
+    sample.roomId = roomId;
+    sample.reserved = 0;
+    sample.temperature = roomStore->temperature(roomId);
+    sample.humidity = roomStore->humidity(roomId);
+    sample.pressure = roomStore->pressure(roomId);
+    distributeSamples(&sample, 1);
+}
+
+/**
+ * @brief Передаёт пачку измерений, уже применённую к хранилищу, во все приёмники.
+ *
+ * Единственный путь измерений в историю, тревоги, статистику, запись и архив:
+ * так пачки датчиков, имитации, воспроизведения и ручные правки попадают
+ * в одни и те же приёмники.
+ */
+void ClimateEngine::distributeSamples(const SensorSample *samples, int count) {
+    roomHistory.appendSamples(samples, count);
+    alarmEngine->evaluateSamples(samples, count);
+    roomStatistics.appendSamples(samples, count);
+    sensorRecorder->recordSamples(samples, count);
+    historyArchiver->appendSamples(samples, count);
+}
+
+ClimateEngine::Metrics ClimateEngine::metrics() const {
+    Metrics result;
+    result.rooms = roomStore->roomCount();
+    result.uptimeMs = uptime.elapsed();
+    result.samplesApplied = sensorIngestion->samplesApplied();
+    result.producerStalls = sensorIngestion->producerStalls();
+    result.historyBytes = roomHistory.bytesPerRoom() * size_t(roomHistory.roomCount());
+    result.control = controlEngine->stats();
+    result.simulatedSeconds = thermalSimulation->simulatedSeconds();
+    result.activeAlarms = alarmEngine->activeCount();
+    result.polling = sensorIngestion->pollingStats();
+    result.apiFrames = controlApiServer->framesReceived();
+    result.apiCommands = controlApiServer->commandsApplied();
+    result.temperature = buildingHierarchy->aggregate(BuildingHierarchy::BuildingLevel, 0, Metric::Temperature);
+    return result;
+}
+
+QString ClimateEngine::metricsSummary() const {
+    const Metrics m = metrics();
+    QString summary = QString("комнат: %1, время работы: %2 с, измерений: %3, ожиданий буфера: %4, история: %5 КБ, "
+                   "шагов регулятора: %6 (пропущено %7, с перегрузкой %8), расчёт: средн. %9 мкс, макс. %10 мкс, "
+                   "имитация: %11 ч, тревог: %12, температура: %13 °C (%14 .. %15)")
+        .arg(m.rooms)
+        .arg(m.uptimeMs / 1000)
+        .arg(m.samplesApplied)
+        .arg(m.producerStalls)
+        .arg(quint64(m.historyBytes / 1024))
+        .arg(m.control.ticks)
+        .arg(m.control.missedTicks)
+        .arg(m.control.overruns)
+        .arg(m.control.averageComputeNs() / 1000.0, 0, 'f', 1)
+        .arg(double(m.control.maxComputeNs) / 1000.0, 0, 'f', 1)
+        .arg(m.simulatedSeconds / 3600.0, 0, 'f', 2)
+        .arg(m.activeAlarms)
+        .arg(m.temperature.average(), 0, 'f', 1)
+        .arg(m.temperature.min, 0, 'f', 1)
+        .arg(m.temperature.max, 0, 'f', 1);
+    if (m.polling.fixedRateRooms > 0) {
+        summary += QString(", опрос: запросов %1 из %2, установок %3 из %4 (экономия %5 %)")
+            .arg(m.polling.requests)
+            .arg(m.polling.fixedRateRequests)
+            .arg(m.polling.rooms)
+            .arg(m.polling.fixedRateRooms)
+            .arg(m.polling.savedFraction() * 100.0, 0, 'f', 1);
+    }
+    if (m.apiFrames > 0)
+        summary += QString(", API управления: запросов %1, элементов %2").arg(m.apiFrames).arg(m.apiCommands);
+    return summary;
+}
@@ -0,0 +1,140 @@
+#ifndef CLIMATEENGINE_H
+#define CLIMATEENGINE_H
+
+#include <QObject>
+#include <QString>
+#include <QElapsedTimer>
+
+#include "roomstate.h"
+#include "roomhistory.h"
+#include "sensoringestion.h"
+#include "statesnapshot.h"
+#include "controlengine.h"
+#include "thermalsimulation.h"
+#include "profiler.h"
+#include "alarmengine.h"
+#include "sensorrecording.h"
+#include "buildinghierarchy.h"
+#include "sharedstateexporter.h"
+#include "historyarchive.h"
+#include "derivedmetrics.h"
+#include "roomstatistics.h"
+#include "controlapiserver.h"
+
+/**
+ * @brief Ядро климат-контроля без зависимости от QtGui.
+ *
+ * Владеет хранилищем комнат и всеми подсистемами, которые с ним работают:
+ * производными величинами (точка росы и др.), иерархией здания, историей,
+ * скользящей статистикой с прогнозом, приёмом измерений, регулятором
+ * температуры, имитацией здания, правилами тревог, записью и
+ * воспроизведением потока измерений, долговременным архивом, публикацией
+ * состояния в разделяемую память, локальным API управления и сохранением
+ * снимка состояния.
+ *
+ * Работает одинаково под QApplication и под QCoreApplication: окно
+ * MainWindow только отображает состояние ядра и передаёт ему команды
+ * пользователя, а в режиме --headless ядро запускается без интерфейса.
+ */
+class ClimateEngine : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultRoomCount = 3;
+
+    /// Счётчики работы ядра
+    struct Metrics {
+        int rooms = 0;
+        qint64 uptimeMs = 0;
+        quint64 samplesApplied = 0;   ///< Измерений датчиков применено к хранилищу
+        quint64 producerStalls = 0;   ///< Ожиданий потока приёма на заполненном буфере
+        size_t historyBytes = 0;      ///< Память истории всех комнат
+        ControlEngine::TickStats control; ///< Шаги регулятора
+        double simulatedSeconds = 0.0; ///< Время, прошедшее в имитации здания
+        int activeAlarms = 0;          ///< Поднятых тревог сейчас
+        SensorSource::PollingStats polling; ///< Опрос источника против постоянной частоты
+        quint64 apiFrames = 0;         ///< Запросов API управления принято
+        quint64 apiCommands = 0;       ///< Элементов пакетов API управления выполнено
+        BuildingHierarchy::Aggregate temperature; ///< По всему зданию
+    };
+
+    explicit ClimateEngine(const QString &snapshotPath = "state.snapshot", QObject *parent = nullptr);
+    ~ClimateEngine();
+
+    RoomStateStore *store() const { return roomStore; }
+    BuildingHierarchy *building() const { return buildingHierarchy; }
+    RoomHistory *history() { return &roomHistory; }
+    const RoomHistory *history() const { return &roomHistory; }
+    const RoomStatistics *statistics() const { return &roomStatistics; }
+    SensorIngestion *ingestion() const { return sensorIngestion; }
+    ControlEngine *control() const { return controlEngine; }
+    ThermalSimulation *simulation() const { return thermalSimulation; }
+    AlarmEngine *alarms() const { return alarmEngine; }
+    SensorRecorder *recorder() const { return sensorRecorder; }
+    RecordingPlayer *player() const { return recordingPlayer; }
+    SharedStateExporter *stateExporter() const { return sharedStateExporter; }
+    HistoryArchiver *archiver() const { return historyArchiver; }
+    ControlApiServer *controlApi() const { return controlApiServer; }
+    DerivedMetrics *derived() const { return derivedMetrics; }
+
+    void setRoomCount(int roomCount);
+    bool startSensorIngestion(const QString &sourceSpec);
+    void startSimulation(double speed = ThermalSimulation::DefaultSpeed); ///< Вместо датчиков, см. ThermalSimulation
+    void setSystemEnabled(bool enabled); ///< Включение климатической установки (регулятора)
+    bool startRecording(const QString &path); ///< Запись измерений, уставок и включения установки, см. SensorRecorder
+    bool startStateExport(const QString &name = SharedState::DefaultName); ///< Состояние комнат для других процессов, см. SharedStateExporter
+    bool startArchive(const QString &directory); ///< Измерения в сжатый архив, см. HistoryArchiver
+    bool startControlApi(const QString &address); ///< Пакетные уставки и чтение комнат по сокету, см. ControlApiServer
+    /**
+     * @brief Воспроизводит запись вместо датчиков.
+     * @param speed Секунд записи в секунду, 0 - без ограничения скорости.
+     * @param fromMs Смещение от начала записи, мс.
+     */
+    bool startReplay(const QString &path, double speed = 1.0, qint64 fromMs = 0);
+
+    SnapshotSettings settings() const { return engineSettings; }
+    void setSettings(const SnapshotSettings &settings) { engineSettings = settings; } ///< Сохраняются со снимком
+    /// Источник актуальных настроек интерфейса; без него сохраняются заданные через setSettings()
+    void setSettingsProvider(SnapshotWriter::SettingsProvider provider) { settingsProvider = std::move(provider); }
+    bool loadSnapshot();            ///< Восстановить комнаты, историю и настройки
+    bool saveSnapshot();            ///< Синхронное сохранение
+    void startAutosave(int intervalMs = SnapshotWriter::DefaultIntervalMs);
+    void stop();                    ///< Остановить приём и имитацию и сохранить итоговый снимок (повторный вызов ничего не делает)
+
+    Metrics metrics() const;
+    QString metricsSummary() const; ///< Счётчики одной строкой для журнала
+    qint64 sourceTimestampMs() const; ///< Время текущего источника: позиция записи, время имитации или часы
+
+public slots:
+    void recordRoomHistory(int roomId); ///< Текущие значения комнаты как измерение, см. distributeSamples()
+    void distributeSamples(const SensorSample *samples, int count); ///< Пачка измерений в историю, тревоги, статистику, запись и архив
+
+signals:
+    void sensorSourceFinished();
+    void replayFinished();
+    void systemStateReplayed(bool enabled); ///< Включение установки из записи, см. RecordingPlayer
+
+private:
+    RoomStateStore *roomStore;
+    BuildingHierarchy *buildingHierarchy;
+    RoomHistory roomHistory;
+    RoomStatistics roomStatistics;
+    SensorIngestion *sensorIngestion;
+    ControlEngine *controlEngine;
+    ThermalSimulation *thermalSimulation;
+    AlarmEngine *alarmEngine;
+    SensorRecorder *sensorRecorder;
+    RecordingPlayer *recordingPlayer;
+    SharedStateExporter *sharedStateExporter;
+    HistoryArchiver *historyArchiver;
+    ControlApiServer *controlApiServer;
+    DerivedMetrics *derivedMetrics;
+    EventLoopMonitor *eventLoopMonitor;   ///< Задержки цикла событий потока ядра
+    SnapshotWriter *snapshotWriter;
+    SnapshotSettings engineSettings;
+    SnapshotWriter::SettingsProvider settingsProvider;
+    QElapsedTimer uptime;
+    bool stopped = false;
+};
+
+#endif // CLIMATEENGINE_H
@@ -0,0 +1,168 @@
+#ifndef CONTROLAPIPROTOCOL_H
+#define CONTROLAPIPROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief Двоичный протокол локального API управления (см. ControlApiServer).
+ *
+ * Кадр - длина остатка кадра (uint32), затем заголовок и элементы пакета:
+ *
+ *     uint32 длина | uint8 код | uint8 состояние | uint16 0 | uint32 номер запроса | uint32 элементов | элементы
+ *
+ * Все числа - little-endian, дробные - IEEE 754 double. Запрос SetSetpoints
+ * несёт пары (int32 комната, double уставка, °C), ReadRooms - номера комнат
+ * (int32). Ответ - кадр с кодом запроса и флагом ResponseFlag, тем же
+ * номером запроса и состоянием: на SetSetpoints - число принятых уставок без
+ * элементов, на ReadRooms - по записи RoomState на каждую запрошенную комнату
+ * в том же порядке. Запросы можно отправлять подряд, не дожидаясь ответов;
+ * ответы приходят в порядке запросов.
+ *
+ * Размер элемента определяется кодом, поэтому кадр разбирается прямо в
+ * приёмном буфере: поля читаются по смещениям, без промежуточных структур.
+ * Заголовок не зависит от Qt и используется и сервером, и эталонным клиентом
+ * (tools/controlclient).
+ */
+namespace ControlApi {
+constexpr std::uint16_t DefaultPort = 7590;
+constexpr const char *DefaultAddress = "unix:/tmp/climate-control.sock";
+constexpr int LengthBytes = 4;
+constexpr int HeaderBytes = LengthBytes + 12;  ///< Длина, код, состояние, резерв, номер запроса, число элементов
+constexpr std::uint32_t MaxItems = 4096;       ///< Элементов в одном кадре
+constexpr int SetpointItemBytes = 12;          ///< int32 комната, double уставка
+constexpr int RoomIdItemBytes = 4;
+constexpr int RoomStateBytes = 48;             ///< Запись ответа ReadRooms
+
+enum Opcode : std::uint8_t {
+    SetSetpoints = 0x01,
+    ReadRooms = 0x02,
+    ResponseFlag = 0x80
+};
+
+enum Status : std::uint8_t {
+    Ok = 0,
+    InvalidRoom = 1,      ///< Часть комнат пакета не существует (или уставка не число)
+    UnknownOpcode = 2,
+    BadLength = 3         ///< Длина кадра не совпадает с числом элементов
+};
+
+/// Заголовок кадра, прочитанный из буфера
+struct FrameHeader {
+    std::uint32_t length;   ///< Байт после поля длины
+    std::uint8_t opcode;
+    std::uint8_t status;
+    std::uint32_t requestId;
+    std::uint32_t count;
+};
+
+/// Состояние комнаты в ответе ReadRooms
+struct RoomState {
+    std::int32_t roomId;
+    bool valid;             ///< false - комнаты нет, значения нулевые
+    std::uint8_t airflow;   ///< AirflowDirection
+    double temperature;     ///< °C
+    double humidity;        ///< %
+    double pressure;        ///< Па
+    double setpoint;        ///< °C
+    double output;          ///< -1..1
+};
+
+inline std::uint32_t getU32(const std::uint8_t *data) {
+    return std::uint32_t(data[0]) | std::uint32_t(data[1]) << 8 | std::uint32_t(data[2]) << 16
+           | std::uint32_t(data[3]) << 24;
+}
+
+inline void putU32(std::uint8_t *data, std::uint32_t value) {
+    data[0] = std::uint8_t(value);
+    data[1] = std::uint8_t(value >> 8);
+    data[2] = std::uint8_t(value >> 16);
+    data[3] = std::uint8_t(value >> 24);
+}
+
+inline double getF64(const std::uint8_t *data) {
+    const std::uint64_t bits = std::uint64_t(getU32(data)) | std::uint64_t(getU32(data + 4)) << 32;
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline void putF64(std::uint8_t *data, double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putU32(data, std::uint32_t(bits));
+    putU32(data + 4, std::uint32_t(bits >> 32));
+}
+
+/// Размер элемента запроса с этим кодом или 0 для неизвестного кода
+inline std::size_t requestItemBytes(std::uint8_t opcode) {
+    return opcode == SetSetpoints ? SetpointItemBytes : opcode == ReadRooms ? RoomIdItemBytes : 0;
+}
+
+/// Размер элемента ответа на запрос с этим кодом
+inline std::size_t responseItemBytes(std::uint8_t opcode) {
+    return (opcode & ~ResponseFlag) == ReadRooms ? RoomStateBytes : 0;
+}
+
+/**
+ * @brief Полная длина кадра в начале буфера.
+ * @return 0, если длина или кадр ещё не пришли целиком; -1, если длина недопустима.
+ */
+inline long frameBytes(const std::uint8_t *data, std::size_t available, std::size_t maxItemBytes) {
+    if (available < std::size_t(LengthBytes))
+        return 0;
+    const std::uint32_t length = getU32(data);
+    if (length < std::uint32_t(HeaderBytes - LengthBytes)
+        || length > std::uint32_t(HeaderBytes - LengthBytes) + MaxItems * maxItemBytes)
+        return -1;
+    const std::size_t total = std::size_t(LengthBytes) + length;
+    return available < total ? 0 : long(total);
+}
+
+inline FrameHeader decodeHeader(const std::uint8_t *frame) {
+    return {getU32(frame), frame[4], frame[5], getU32(frame + 8), getU32(frame + 12)};
+}
+
+/// Записывает заголовок кадра с itemBytes байт элементов после него
+inline void encodeHeader(std::uint8_t *frame, std::uint8_t opcode, std::uint8_t status, std::uint32_t requestId,
+                         std::uint32_t count, std::size_t itemBytes) {
+    putU32(frame, std::uint32_t(HeaderBytes - LengthBytes + itemBytes));
+    frame[4] = opcode;
+    frame[5] = status;
+    frame[6] = 0;
+    frame[7] = 0;
+    putU32(frame + 8, requestId);
+    putU32(frame + 12, count);
+}
+
+inline void encodeSetpoint(std::uint8_t *item, std::int32_t roomId, double celsius) {
+    putU32(item, std::uint32_t(roomId));
+    putF64(item + 4, celsius);
+}
+
+inline void decodeSetpoint(const std::uint8_t *item, std::int32_t &roomId, double &celsius) {
+    roomId = std::int32_t(getU32(item));
+    celsius = getF64(item + 4);
+}
+
+inline void encodeRoomState(std::uint8_t *item, const RoomState &state) {
+    putU32(item, std::uint32_t(state.roomId));
+    item[4] = state.valid ? 1 : 0;
+    item[5] = state.airflow;
+    item[6] = 0;
+    item[7] = 0;
+    putF64(item + 8, state.temperature);
+    putF64(item + 16, state.humidity);
+    putF64(item + 24, state.pressure);
+    putF64(item + 32, state.setpoint);
+    putF64(item + 40, state.output);
+}
+
+inline RoomState decodeRoomState(const std::uint8_t *item) {
+    return {std::int32_t(getU32(item)), item[4] != 0, item[5], getF64(item + 8), getF64(item + 16),
+            getF64(item + 24), getF64(item + 32), getF64(item + 40)};
+}
+}
+
+#endif // CONTROLAPIPROTOCOL_H
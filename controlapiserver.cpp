@@ -0,0 +1,563 @@
+#include "controlapiserver.h"
+#include "profiler.h"
+
+#include <QDebug>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t ReceiveChunk = 64 * 1024;
+constexpr size_t InputLimit = 4 << 20;   ///< Байт неразобранных запросов, после которых соединение не читается
+constexpr size_t OutputLimit = 4 << 20;  ///< Байт неотправленных ответов, то же
+constexpr size_t StagingSize = 256;      ///< Элементов, передаваемых в буфер одним push()
+constexpr int PollTimeoutMs = 100;
+
+/**
+ * @brief Открывает неблокирующий слушающий сокет.
+ * @param resolved Адрес в виде "unix:<путь>" или "tcp:<узел>:<порт>" с фактическим портом.
+ * @param unixPath Путь Unix-сокета или пустая строка.
+ * @return Дескриптор или -1 (причина - в журнале).
+ */
+int openListener(const QString &address, QString &resolved, QString &unixPath) {
+    if (address.startsWith(QLatin1String("unix:"))) {
+        const QByteArray path = address.mid(5).toLocal8Bit();
+        sockaddr_un target;
+        std::memset(&target, 0, sizeof(target));
+        target.sun_family = AF_UNIX;
+        if (path.isEmpty() || size_t(path.size()) >= sizeof(target.sun_path)) {
+            qWarning() << "Недопустимый путь сокета API управления:" << address;
+            return -1;
+        }
+        std::memcpy(target.sun_path, path.constData(), size_t(path.size()));
+
+        // Сокет, оставшийся от прошлого запуска, мешает bind(); прочие файлы не трогаем
+        struct stat info;
+        if (::stat(path.constData(), &info) == 0 && S_ISSOCK(info.st_mode))
+            ::unlink(path.constData());
+
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0 || ::bind(fd, reinterpret_cast<const sockaddr *>(&target), sizeof(target)) != 0
+            || ::listen(fd, SOMAXCONN) != 0) {
+            qWarning() << "Не удалось открыть сокет API управления" << address << ":" << std::strerror(errno);
+            if (fd >= 0)
+                ::close(fd);
+            return -1;
+        }
+        resolved = address;
+        unixPath = QString::fromLocal8Bit(path);
+        return fd;
+    }
+
+    if (!address.startsWith(QLatin1String("tcp:"))) {
+        qWarning() << "Адрес API управления должен начинаться с unix: или tcp:" << address;
+        return -1;
+    }
+    // "tcp:7590", "tcp:127.0.0.1:7590", "tcp:[::1]:7590"
+    QString host = QStringLiteral("127.0.0.1");
+    QString port = address.mid(4);
+    const int colon = port.lastIndexOf(':');
+    if (colon >= 0) {
+        host = port.left(colon);
+        port = port.mid(colon + 1);
+        if (host.startsWith('[') && host.endsWith(']'))
+            host = host.mid(1, host.size() - 2);
+    }
+    bool portOk = false;
+    const uint portNumber = port.toUInt(&portOk);
+    if (!portOk || portNumber > 0xffff) {
+        qWarning() << "Недопустимый порт API управления:" << address;
+        return -1;
+    }
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV;
+    addrinfo *result = nullptr;
+    const int error = ::getaddrinfo(host.toLocal8Bit().constData(), QByteArray::number(portNumber).constData(),
+                                    &hints, &result);
+    if (error != 0 || !result) {
+        qWarning() << "Не удалось найти адрес API управления" << host << ":" << gai_strerror(error);
+        return -1;
+    }
+    const int fd = ::socket(result->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    const int reuse = 1;
+    if (fd >= 0)
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    const bool ok = fd >= 0 && ::bind(fd, result->ai_addr, result->ai_addrlen) == 0 && ::listen(fd, SOMAXCONN) == 0;
+    ::freeaddrinfo(result);
+    if (!ok) {
+        qWarning() << "Не удалось открыть порт API управления" << address << ":" << std::strerror(errno);
+        if (fd >= 0)
+            ::close(fd);
+        return -1;
+    }
+
+    sockaddr_storage bound;
+    socklen_t boundSize = sizeof(bound);
+    ::getsockname(fd, reinterpret_cast<sockaddr *>(&bound), &boundSize);
+    const quint16 boundPort = bound.ss_family == AF_INET6
+            ? ntohs(reinterpret_cast<const sockaddr_in6 *>(&bound)->sin6_port)
+            : ntohs(reinterpret_cast<const sockaddr_in *>(&bound)->sin_port);
+    resolved = QString("tcp:%1:%2").arg(host.contains(':') ? '[' + host + ']' : host).arg(boundPort);
+    unixPath.clear();
+    return fd;
+}
+
+} // namespace
+
+/**
+ * @brief Поток ввода-вывода сервера: соединения, разбор запросов и сборка ответов.
+ *
+ * Единственный писатель буфера команд и единственный читатель буфера ответов.
+ */
+class ControlApiServer::IoThread : public QThread {
+public:
+    IoThread(ControlApiServer &server, int listener, int wakeFd)
+        : server(server), listener(listener), wakeFd(wakeFd), connections(MaxClients)
+    {
+    }
+
+    ~IoThread() override {
+        for (Connection &connection : connections)
+            drop(connection);
+        ::close(listener);
+    }
+
+    void requestStop() {
+        stopRequested.store(true, std::memory_order_relaxed);
+        wake();
+    }
+
+    /// Будит poll(); вызывается из любого потока
+    void wake() {
+        const quint64 one = 1;
+        const ssize_t written = ::write(wakeFd, &one, sizeof(one));
+        Q_UNUSED(written);  // переполнение счётчика eventfd означает, что поток и так разбужен
+    }
+
+protected:
+    void run() override {
+        std::vector<pollfd> waiters;
+        std::vector<int> polled;   ///< Номер соединения для waiters[2 + i]
+        while (!stopRequested.load(std::memory_order_relaxed)) {
+            waiters.clear();
+            polled.clear();
+            waiters.push_back({wakeFd, POLLIN, 0});
+            waiters.push_back({listener, POLLIN, 0});
+            for (int index = 0; index < MaxClients; ++index) {
+                const Connection &connection = connections[size_t(index)];
+                if (connection.fd < 0)
+                    continue;
+                short events = 0;
+                if (connection.input.size() < InputLimit && connection.output.size() < OutputLimit)
+                    events |= POLLIN;
+                if (connection.outputOffset < connection.completeBytes)
+                    events |= POLLOUT;
+                waiters.push_back({connection.fd, events, 0});
+                polled.push_back(index);
+            }
+
+            if (::poll(waiters.data(), nfds_t(waiters.size()), PollTimeoutMs) < 0 && errno != EINTR) {
+                qWarning() << "Сбой poll() в API управления:" << std::strerror(errno);
+                break;
+            }
+            if (waiters[0].revents & POLLIN) {
+                quint64 counter;
+                const ssize_t bytes = ::read(wakeFd, &counter, sizeof(counter));
+                Q_UNUSED(bytes);
+            }
+
+            server.replies.consume(server.replies.capacity(), [this](const Reply *items, size_t count) {
+                deliver(items, count);
+            });
+            if (waiters[1].revents & POLLIN)
+                acceptClients();
+
+            for (size_t i = 0; i < polled.size(); ++i) {
+                Connection &connection = connections[size_t(polled[i])];
+                if ((waiters[i + 2].revents & (POLLIN | POLLHUP | POLLERR)) && !receive(connection))
+                    drop(connection);
+            }
+            // Разбор идёт и без новых данных: кадры могли ждать места в буфере команд
+            for (int index = 0; index < MaxClients; ++index) {
+                Connection &connection = connections[size_t(index)];
+                if (connection.fd >= 0 && !connection.input.empty() && !parse(connection, index))
+                    drop(connection);
+            }
+            flushStaging();
+            if (pushed) {
+                pushed = false;
+                server.scheduleDrain();
+            }
+
+            for (Connection &connection : connections) {
+                if (connection.fd >= 0 && !flush(connection))
+                    drop(connection);
+            }
+        }
+    }
+
+private:
+    struct Connection {
+        int fd = -1;
+        quint32 generation = 0;
+        std::vector<quint8> input;      ///< Принятые байты, неполный кадр остаётся в начале
+        std::vector<quint8> output;     ///< Ответы; последний может собираться
+        size_t outputOffset = 0;        ///< Отправлено
+        size_t completeBytes = 0;       ///< Собранные целиком ответы, можно отправлять
+        size_t responseOffset = 0;      ///< Заголовок собираемого ответа
+        quint32 responseCount = 0;
+        quint8 responseStatus = ControlApi::Ok;
+    };
+
+    quint32 connectionId(int index) const {
+        return quint32(index) | connections[size_t(index)].generation << 8;
+    }
+
+    void acceptClients() {
+        for (;;) {
+            const int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+                return;
+            auto slot = std::find_if(connections.begin(), connections.end(),
+                                     [](const Connection &connection) { return connection.fd < 0; });
+            if (slot == connections.end()) {
+                qWarning() << "API управления: больше" << MaxClients << "соединений, новое закрыто";
+                ::close(fd);
+                continue;
+            }
+            slot->fd = fd;
+            ++slot->generation;
+        }
+    }
+
+    void drop(Connection &connection) {
+        if (connection.fd < 0)
+            return;
+        ::close(connection.fd);
+        connection.fd = -1;
+        connection.input.clear();
+        connection.output.clear();
+        connection.outputOffset = 0;
+        connection.completeBytes = 0;
+    }
+
+    /**
+     * @brief Дочитывает всё, что есть в сокете.
+     * @return false при закрытии соединения клиентом или ошибке.
+     */
+    bool receive(Connection &connection) {
+        for (;;) {
+            const size_t used = connection.input.size();
+            connection.input.resize(used + ReceiveChunk);
+            const ssize_t received = ::recv(connection.fd, connection.input.data() + used, ReceiveChunk, 0);
+            connection.input.resize(used + size_t(std::max<ssize_t>(received, 0)));
+            if (received > 0) {
+                if (size_t(received) < ReceiveChunk || connection.input.size() >= InputLimit)
+                    return true;
+            } else if (received < 0 && errno == EINTR) {
+                continue;
+            } else {
+                return received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+            }
+        }
+    }
+
+    /**
+     * @brief Передаёт в ядро целые кадры из начала приёмного буфера, пока в буфере команд есть место.
+     * @return false, если длина кадра недопустима и соединение надо закрыть.
+     */
+    bool parse(Connection &connection, int index) {
+        const quint8 *data = connection.input.data();
+        const size_t size = connection.input.size();
+        size_t offset = 0;
+        while (offset < size) {
+            const long bytes = ControlApi::frameBytes(data + offset, size - offset, ControlApi::SetpointItemBytes);
+            if (bytes < 0) {
+                qWarning() << "API управления: недопустимая длина кадра, соединение закрыто";
+                return false;
+            }
+            if (bytes == 0)
+                break;
+
+            const quint8 *frame = data + offset;
+            const ControlApi::FrameHeader header = ControlApi::decodeHeader(frame);
+            const size_t itemBytes = ControlApi::requestItemBytes(header.opcode);
+            quint8 status = ControlApi::Ok;
+            if (itemBytes == 0)
+                status = ControlApi::UnknownOpcode;
+            else if (header.count > ControlApi::MaxItems
+                     || header.length != quint32(ControlApi::HeaderBytes - ControlApi::LengthBytes) + header.count * itemBytes)
+                status = ControlApi::BadLength;
+            const size_t items = status == ControlApi::Ok ? header.count : 0;
+            if (server.commands.capacity() - server.commands.size() < staged + std::max<size_t>(items, 1))
+                break;  // ждём, пока ядро разберёт очередь
+
+            Command command;
+            command.connection = connectionId(index);
+            command.requestId = header.requestId;
+            command.opcode = header.opcode;
+            command.status = status;
+            if (items == 0) {
+                command.roomId = -1;
+                command.flags = FirstItem | LastItem | NoItem;
+                command.value = 0.0;
+                stage(command);
+            }
+            const quint8 *item = frame + ControlApi::HeaderBytes;
+            for (size_t i = 0; i < items; ++i, item += itemBytes) {
+                command.flags = quint8((i == 0 ? FirstItem : 0) | (i + 1 == items ? LastItem : 0));
+                if (header.opcode == ControlApi::SetSetpoints) {
+                    ControlApi::decodeSetpoint(item, command.roomId, command.value);
+                } else {
+                    command.roomId = qint32(ControlApi::getU32(item));
+                    command.value = 0.0;
+                }
+                stage(command);
+            }
+            offset += size_t(bytes);
+            server.frameCount.store(server.frameCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        connection.input.erase(connection.input.begin(), connection.input.begin() + long(offset));
+        return true;
+    }
+
+    void stage(const Command &command) {
+        staging[staged++] = command;
+        if (staged == StagingSize)
+            flushStaging();
+    }
+
+    /// Место в буфере проверено до разбора кадра, поэтому push() принимает всё
+    void flushStaging() {
+        if (staged == 0)
+            return;
+        server.commands.push(staging, staged);
+        staged = 0;
+        pushed = true;
+    }
+
+    /**
+     * @brief Собирает кадры ответов из элементов, выполненных ядром.
+     */
+    void deliver(const Reply *items, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            const Reply &reply = items[i];
+            const int index = int(reply.connection & 0xff);
+            if (index >= MaxClients)
+                continue;
+            Connection &connection = connections[size_t(index)];
+            if (connection.fd < 0 || connectionId(index) != reply.connection)
+                continue;  // соединение закрыто, пока ядро выполняло пакет
+
+            if (reply.flags & FirstItem) {
+                connection.responseOffset = connection.output.size();
+                connection.output.resize(connection.responseOffset + ControlApi::HeaderBytes);
+                connection.responseCount = 0;
+                connection.responseStatus = ControlApi::Ok;
+            }
+            if (reply.status != ControlApi::Ok && connection.responseStatus == ControlApi::Ok)
+                connection.responseStatus = reply.status;
+            if (!(reply.flags & NoItem)) {
+                if (reply.opcode == ControlApi::ReadRooms) {
+                    const size_t used = connection.output.size();
+                    connection.output.resize(used + ControlApi::RoomStateBytes);
+                    ControlApi::encodeRoomState(connection.output.data() + used, reply.state);
+                    ++connection.responseCount;
+                } else if (reply.status == ControlApi::Ok) {
+                    ++connection.responseCount;  // принятые уставки
+                }
+            }
+            if (reply.flags & LastItem) {
+                const size_t itemBytes = connection.output.size() - connection.responseOffset - ControlApi::HeaderBytes;
+                ControlApi::encodeHeader(connection.output.data() + connection.responseOffset,
+                                         quint8(reply.opcode | ControlApi::ResponseFlag), connection.responseStatus,
+                                         reply.requestId, connection.responseCount, itemBytes);
+                connection.completeBytes = connection.output.size();
+            }
+        }
+    }
+
+    /**
+     * @brief Отправляет собранные ответы, пока сокет принимает данные.
+     * @return false при ошибке соединения.
+     */
+    bool flush(Connection &connection) {
+        while (connection.outputOffset < connection.completeBytes) {
+            const ssize_t sent = ::send(connection.fd, connection.output.data() + connection.outputOffset,
+                                        connection.completeBytes - connection.outputOffset, MSG_NOSIGNAL);
+            if (sent > 0) {
+                connection.outputOffset += size_t(sent);
+            } else if (sent < 0 && errno == EINTR) {
+                continue;
+            } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else {
+                return false;
+            }
+        }
+        // Отправленное убираем из начала буфера; собираемый ответ сдвигается вместе с ним
+        if (connection.outputOffset > 0 && connection.outputOffset == connection.completeBytes) {
+            connection.output.erase(connection.output.begin(), connection.output.begin() + long(connection.outputOffset));
+            connection.responseOffset -= std::min(connection.responseOffset, connection.outputOffset);
+            connection.completeBytes = 0;
+            connection.outputOffset = 0;
+        }
+        return true;
+    }
+
+    ControlApiServer &server;
+    int listener;
+    int wakeFd;
+    std::vector<Connection> connections;    ///< MaxClients мест
+    Command staging[StagingSize];
+    size_t staged = 0;
+    bool pushed = false;    ///< Ядру переданы новые элементы
+    std::atomic<bool> stopRequested{false};
+};
+
+ControlApiServer::ControlApiServer(RoomStateStore *store, QObject *parent)
+    : QObject(parent), store(store), commands(QueueCapacity), replies(QueueCapacity)
+{
+}
+
+/// Поток обращается к буферам сервера: останавливаем его, пока они живы
+ControlApiServer::~ControlApiServer() {
+    stop();
+}
+
+bool ControlApiServer::start(const QString &address) {
+    stop();
+    QString resolved;
+    QString path;
+    const int listener = openListener(address, resolved, path);
+    if (listener < 0)
+        return false;
+    const int wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0) {
+        qWarning() << "Не удалось создать eventfd для API управления:" << std::strerror(errno);
+        ::close(listener);
+        return false;
+    }
+    this->wakeFd = wakeFd;
+    listenAddress = resolved;
+    socketPath = path;
+    io = new IoThread(*this, listener, wakeFd);
+    io->start();
+    return true;
+}
+
+/**
+ * @brief Останавливает поток ввода-вывода и закрывает соединения; невыполненные элементы отбрасываются.
+ */
+void ControlApiServer::stop() {
+    if (!io)
+        return;
+    io->requestStop();
+    io->wait();
+    delete io;
+    io = nullptr;
+    ::close(wakeFd);
+    wakeFd = -1;
+    if (!socketPath.isEmpty())
+        ::unlink(socketPath.toLocal8Bit().constData());
+    socketPath.clear();
+    listenAddress.clear();
+    commands.consume(commands.capacity(), [](const Command *, size_t) {});
+    replies.consume(replies.capacity(), [](const Reply *, size_t) {});
+}
+
+bool ControlApiServer::isRunning() const {
+    return io && io->isRunning();
+}
+
+void ControlApiServer::scheduleDrain() {
+    if (!drainScheduled.exchange(true, std::memory_order_acq_rel))
+        QMetaObject::invokeMethod(this, "drain", Qt::QueuedConnection);
+}
+
+/**
+ * @brief Выполняет элементы пакетов в потоке ядра и отдаёт ответы потоку ввода-вывода.
+ *
+ * Берётся не больше элементов, чем помещается ответов: остальные ждут
+ * следующего вызова, который назначается, пока поток ввода-вывода
+ * освобождает буфер ответов.
+ */
+int ControlApiServer::drain() {
+    drainScheduled.store(false, std::memory_order_release);
+    const size_t space = replies.capacity() - replies.size();
+    if (space == 0) {
+        if (io && !drainScheduled.exchange(true, std::memory_order_acq_rel))
+            QTimer::singleShot(1, this, &ControlApiServer::drain);
+        return 0;
+    }
+    CLIMATE_PROFILE_SCOPE(ControlApiDrain);
+
+    Reply staging[StagingSize];
+    size_t staged = 0;
+    const size_t count = commands.consume(space, [&](const Command *items, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            const Command &command = items[i];
+            Reply &reply = staging[staged++];
+            reply.connection = command.connection;
+            reply.requestId = command.requestId;
+            reply.opcode = command.opcode;
+            reply.flags = command.flags;
+            reply.status = command.status;
+            reply.state = ControlApi::RoomState();
+            reply.state.roomId = command.roomId;
+
+            if (!(command.flags & NoItem)) {
+                const bool valid = store->isValidRoom(command.roomId);
+                if (command.opcode == ControlApi::SetSetpoints) {
+                    if (valid && std::isfinite(command.value))
+                        store->setSetpoint(command.roomId, command.value);
+                    else
+                        reply.status = ControlApi::InvalidRoom;
+                } else if (valid) {
+                    const int roomId = command.roomId;
+                    reply.state.valid = true;
+                    reply.state.airflow = quint8(store->airflow(roomId));
+                    reply.state.temperature = store->temperature(roomId);
+                    reply.state.humidity = store->humidity(roomId);
+                    reply.state.pressure = store->pressure(roomId);
+                    reply.state.setpoint = store->setpoint(roomId);
+                    reply.state.output = store->output(roomId);
+                } else {
+                    reply.status = ControlApi::InvalidRoom;
+                }
+            }
+            if (staged == StagingSize) {
+                replies.push(staging, staged);
+                staged = 0;
+            }
+        }
+    });
+    if (staged > 0)
+        replies.push(staging, staged);
+    appliedCount += count;
+    if (count > 0 && io)
+        io->wake();
+    if (count == space && io && !drainScheduled.exchange(true, std::memory_order_acq_rel))
+        QTimer::singleShot(1, this, &ControlApiServer::drain);  // буфер ответов заполнен: повторим, когда освободится
+    return int(count);
+}
@@ -0,0 +1,102 @@
+#ifndef CONTROLAPISERVER_H
+#define CONTROLAPISERVER_H
+
+#include <QObject>
+#include <QString>
+#include <atomic>
+
+#include "controlapiprotocol.h"
+#include "roomstate.h"
+#include "spscringbuffer.h"
+
+/**
+ * @brief Локальный сервер API управления: пакетная запись уставок и чтение состояния комнат.
+ *
+ * Слушает Unix-сокет или TCP-порт (по умолчанию только 127.0.0.1) и говорит
+ * на протоколе controlapiprotocol.h. Сокеты обслуживает собственный поток
+ * ввода-вывода: один poll() по всем соединениям, приём, разбор кадров прямо
+ * в приёмном буфере и отправка ответов. RoomStateStore живёт в потоке ядра,
+ * поэтому элементы пакетов передаются туда через SpscRingBuffer, а drain()
+ * в потоке ядра применяет уставки через RoomStateStore::setSetpoint() (как
+ * правка из интерфейса: с записью и передачей на установки; в историю,
+ * статистику и тревоги уставка не попадает - это не измерение) и читает
+ * состояние комнат.
+ *
+ * На каждый элемент запроса drain() отдаёт ровно один элемент ответа через
+ * встречный буфер, и поток ввода-вывода собирает из них кадры ответов в
+ * порядке запросов, поэтому клиент может держать много запросов без
+ * ожидания. Кадр передаётся в ядро только целиком, когда в буфере есть место
+ * на все его элементы; иначе сервер перестаёт читать соединение, пока ядро
+ * не разберёт очередь. Поток ввода-вывода будит ядро вызовом drain() через
+ * очередь событий, ядро будит поток ввода-вывода через eventfd.
+ */
+class ControlApiServer : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr size_t QueueCapacity = 1 << 16;  ///< Элементов в каждом направлении, не меньше MaxItems
+    static constexpr int MaxClients = 64;
+
+    explicit ControlApiServer(RoomStateStore *store, QObject *parent = nullptr);
+    ~ControlApiServer();
+
+    /**
+     * @brief Открывает сокет и запускает поток ввода-вывода.
+     * @param address "unix:<путь>" или "tcp:[<узел>:]<порт>"; узел по умолчанию - 127.0.0.1.
+     */
+    bool start(const QString &address = QString::fromLatin1(ControlApi::DefaultAddress));
+    void stop();
+    bool isRunning() const;
+    QString address() const { return listenAddress; }  ///< С выбранным системой портом для "tcp:0"
+
+    quint64 commandsApplied() const { return appliedCount; } ///< Выполнено элементов пакетов
+    quint64 framesReceived() const { return frameCount.load(std::memory_order_relaxed); }
+
+public slots:
+    int drain(); ///< Выполнить накопленные элементы пакетов, возвращает их число
+
+private:
+    class IoThread;
+
+    /// Элемент пакета: поток ввода-вывода -> ядро
+    struct Command {
+        quint32 connection;     ///< Номер соединения с поколением
+        quint32 requestId;
+        qint32 roomId;
+        quint8 opcode;
+        quint8 flags;           ///< ItemFlag
+        quint8 status;          ///< Не Ok - ошибка кадра, элемент только передаёт её в ответ
+        double value;
+    };
+
+    /// Элемент ответа: ядро -> поток ввода-вывода
+    struct Reply {
+        quint32 connection;
+        quint32 requestId;
+        quint8 opcode;
+        quint8 flags;
+        quint8 status;
+        ControlApi::RoomState state;
+    };
+
+    enum ItemFlag : quint8 {
+        FirstItem = 0x1,
+        LastItem = 0x2,
+        NoItem = 0x4            ///< Пустой пакет или ошибка кадра: элемент без комнаты
+    };
+
+    void scheduleDrain();   ///< Вызывается из потока ввода-вывода
+
+    RoomStateStore *store;
+    SpscRingBuffer<Command> commands;
+    SpscRingBuffer<Reply> replies;
+    IoThread *io = nullptr;
+    int wakeFd = -1;        ///< eventfd потока ввода-вывода
+    QString listenAddress;
+    QString socketPath;     ///< Unix-сокет, удаляется при stop()
+    std::atomic<bool> drainScheduled{false};
+    std::atomic<quint64> frameCount{0};     ///< Пишет только поток ввода-вывода
+    quint64 appliedCount = 0;
+};
+
+#endif // CONTROLAPISERVER_H
@@ -0,0 +1,183 @@
+#include "controlengine.h"
+#include "parallelfor.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Конструктор регулятора.
+ * @param store Хранилище, из которого берутся температура и уставка и в которое пишется мощность.
+ */
+ControlEngine::ControlEngine(RoomStateStore *store, QObject *parent)
+    : QObject(parent), store(store)
+{
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
+    connect(&timer, &QTimer::timeout, this, &ControlEngine::onTimer);
+    connect(store, &RoomStateStore::roomsReset, this, &ControlEngine::roomsReset);
+    roomsReset();
+}
+
+void ControlEngine::setEnabled(bool enable) {
+    if (enabled == enable)
+        return;
+    enabled = enable;
+    resetControllers();
+
+    if (enabled) {
+        clock.start();
+        nextDeadlineNs = 0;
+        onTimer();
+    } else {
+        timer.stop();
+        store->applyOutputs(outputBuffer.data(), int(outputBuffer.size()));
+    }
+}
+
+void ControlEngine::setTickInterval(int milliseconds) {
+    tickMs = std::max(milliseconds, 1);
+    if (enabled) {
+        nextDeadlineNs = clock.nsecsElapsed();
+        scheduleNext();
+    }
+}
+
+void ControlEngine::setMode(int roomId, Mode mode) {
+    if (roomId < 0 || roomId >= int(modes.size()))
+        return;
+    modes[size_t(roomId)] = mode;
+    integrals[size_t(roomId)] = 0.0;
+    hysteresisState[size_t(roomId)] = 0;
+}
+
+void ControlEngine::setAllModes(Mode mode) {
+    std::fill(modes.begin(), modes.end(), mode);
+    resetControllers();
+}
+
+/**
+ * @brief Подгоняет состояние регуляторов под новое число комнат.
+ */
+void ControlEngine::roomsReset() {
+    const size_t count = size_t(store->roomCount());
+    modes.resize(count, Mode::Pid);
+    integrals.resize(count);
+    previousTemperatures.resize(count);
+    hysteresisState.resize(count);
+    outputBuffer.resize(count);
+    resetControllers();
+}
+
+void ControlEngine::resetControllers() {
+    std::fill(integrals.begin(), integrals.end(), 0.0);
+    std::fill(hysteresisState.begin(), hysteresisState.end(), qint8(0));
+    std::fill(outputBuffer.begin(), outputBuffer.end(), 0.0);
+    std::copy(store->temperatures(), store->temperatures() + previousTemperatures.size(),
+              previousTemperatures.begin());
+}
+
+/**
+ * @brief Срабатывание таймера: шаг по сетке сроков и планирование следующего.
+ */
+void ControlEngine::onTimer() {
+    if (!enabled)
+        return;
+
+    const qint64 periodNs = qint64(tickMs) * 1000000;
+    const qint64 jitterNs = std::max<qint64>(clock.nsecsElapsed() - nextDeadlineNs, 0);
+    if (jitterNs >= periodNs) {
+        const qint64 missed = jitterNs / periodNs;
+        tickStats.missedTicks += quint64(missed);
+        nextDeadlineNs += missed * periodNs;
+    }
+    tickStats.lastJitterNs = jitterNs % periodNs;
+    tickStats.maxJitterNs = std::max(tickStats.maxJitterNs, tickStats.lastJitterNs);
+
+    tick();
+
+    if (tickStats.lastTickNs > periodNs)
+        ++tickStats.overruns;
+    nextDeadlineNs += periodNs;
+    scheduleNext();
+}
+
+void ControlEngine::scheduleNext() {
+    const qint64 remainingNs = nextDeadlineNs - clock.nsecsElapsed();
+    timer.start(int(std::max<qint64>((remainingNs + 999999) / 1000000, 0)));
+}
+
+/**
+ * @brief Рассчитывает мощность всех комнат и применяет её к хранилищу.
+ */
+void ControlEngine::tick() {
+    CLIMATE_PROFILE_SCOPE(ControlTick);
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    const int rooms = std::min(store->roomCount(), int(outputBuffer.size()));
+    const double *temperatures = store->temperatures();
+    const double *setpoints = store->setpoints();
+    const double dt = double(tickMs) / 1000.0;
+    parallelFor(rooms, BatchSize, [&](int first, int last) {
+        compute(first, last, temperatures, setpoints, dt);
+    });
+    const qint64 computeNs = elapsed.nsecsElapsed();
+
+    store->applyOutputs(outputBuffer.data(), rooms);
+
+    ++tickStats.ticks;
+    tickStats.lastComputeNs = computeNs;
+    tickStats.maxComputeNs = std::max(tickStats.maxComputeNs, computeNs);
+    tickStats.totalComputeNs += computeNs;
+    tickStats.lastTickNs = elapsed.nsecsElapsed();
+    tickStats.maxTickNs = std::max(tickStats.maxTickNs, tickStats.lastTickNs);
+}
+
+/**
+ * @brief Шаг регуляторов комнат [first, last).
+ *
+ * Пишет только в элементы своего диапазона, поэтому пачки
+ * обрабатываются параллельно без синхронизации.
+ */
+void ControlEngine::compute(int first, int last, const double *temperatures, const double *setpoints,
+                            double dt) {
+    const PidGains gains = pidGains;
+    const double band = hysteresisBand;
+
+    for (int roomId = first; roomId < last; ++roomId) {
+        const size_t i = size_t(roomId);
+        const double temperature = temperatures[i];
+        const double error = setpoints[i] - temperature;
+        double output;
+
+        if (modes[i] == Mode::Hysteresis) {
+            qint8 &state = hysteresisState[i];
+            if (error > band)
+                state = 1;
+            else if (error < -band)
+                state = -1;
+            else if ((state > 0 && error <= 0.0) || (state < 0 && error >= 0.0))
+                state = 0;
+            output = state;
+        } else {
+            double integral = std::clamp(integrals[i] + error * dt, -gains.integralLimit, gains.integralLimit);
+            const double derivative = -(temperature - previousTemperatures[i]) / dt;
+            output = gains.kp * error + gains.ki * integral + gains.kd * derivative;
+            // Интеграл не растёт, пока выход упирается в ограничение в ту же сторону
+            if (output > 1.0) {
+                output = 1.0;
+                if (error > 0.0)
+                    integral = integrals[i];
+            } else if (output < -1.0) {
+                output = -1.0;
+                if (error < 0.0)
+                    integral = integrals[i];
+            }
+            integrals[i] = integral;
+        }
+
+        previousTemperatures[i] = temperature;
+        outputBuffer[i] = std::isfinite(output) ? output : 0.0;
+    }
+}
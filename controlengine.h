@@ -0,0 +1,112 @@
+#ifndef CONTROLENGINE_H
+#define CONTROLENGINE_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <vector>
+
+#include "roomstate.h"
+
+/**
+ * @brief Регулятор температуры всех комнат с фиксированным шагом.
+ *
+ * На каждом шаге по температуре и уставке комнаты из RoomStateStore
+ * рассчитывается мощность установки от -1 (охлаждение) до 1 (нагрев):
+ * ПИД-регулятором или двухпозиционным регулятором с гистерезисом,
+ * режим задаётся для каждой комнаты. Комнаты обрабатываются параллельно
+ * пачками по BatchSize (см. parallelFor()), результат применяется
+ * к хранилищу одним вызовом applyOutputs().
+ *
+ * Шаги идут по сетке абсолютных сроков (период * номер шага), а не
+ * "период после окончания предыдущего", поэтому задержки таймера
+ * не накапливаются. Регулятор всегда считает с номинальным шагом dt;
+ * шаги, пропущенные из-за перегрузки, не догоняются, а учитываются
+ * в статистике.
+ */
+class ControlEngine : public QObject {
+    Q_OBJECT
+
+public:
+    enum class Mode : quint8 {
+        Pid,
+        Hysteresis
+    };
+
+    struct PidGains {
+        double kp = 0.4;              ///< На градус ошибки
+        double ki = 0.01;             ///< На градус-секунду
+        double kd = 0.0;              ///< На градус в секунду (по измерению, без рывка при смене уставки)
+        double integralLimit = 50.0;  ///< Ограничение интеграла, градус-секунды
+    };
+
+    /// Статистика шагов; время в наносекундах
+    struct TickStats {
+        quint64 ticks = 0;
+        quint64 missedTicks = 0;   ///< Шаги, пропущенные из-за опоздания
+        quint64 overruns = 0;      ///< Шаги, не уложившиеся в период
+        qint64 lastComputeNs = 0;  ///< Расчёт регуляторов
+        qint64 maxComputeNs = 0;
+        qint64 totalComputeNs = 0;
+        qint64 lastTickNs = 0;     ///< Расчёт и применение к хранилищу
+        qint64 maxTickNs = 0;
+        qint64 lastJitterNs = 0;   ///< Опоздание начала шага относительно срока
+        qint64 maxJitterNs = 0;
+
+        double averageComputeNs() const { return ticks ? double(totalComputeNs) / double(ticks) : 0.0; }
+    };
+
+    static constexpr int DefaultTickIntervalMs = 100; ///< 10 Гц
+    static constexpr int BatchSize = 2048;            ///< Комнат в одной пачке параллельного прохода
+
+    explicit ControlEngine(RoomStateStore *store, QObject *parent = nullptr);
+
+    void setEnabled(bool enabled); ///< Выключение обнуляет мощность и состояние регуляторов
+    bool isEnabled() const { return enabled; }
+
+    void setTickInterval(int milliseconds);
+    int tickInterval() const { return tickMs; }
+
+    void setMode(int roomId, Mode mode);
+    void setAllModes(Mode mode);
+    Mode mode(int roomId) const { return modes[size_t(roomId)]; }
+    void setGains(const PidGains &gains) { pidGains = gains; }
+    PidGains gains() const { return pidGains; }
+    void setHysteresisBand(double celsius) { hysteresisBand = celsius; } ///< Допуск вокруг уставки
+
+    const TickStats &stats() const { return tickStats; }
+    void resetStats() { tickStats = TickStats(); }
+
+public slots:
+    void tick(); ///< Один шаг регулирования с номинальным dt
+
+private slots:
+    void onTimer();
+    void roomsReset();
+
+private:
+    void compute(int first, int last, const double *temperatures, const double *setpoints, double dt);
+    void resetControllers();
+    void scheduleNext();
+
+    RoomStateStore *store;
+    QTimer timer;
+    QElapsedTimer clock;
+    qint64 nextDeadlineNs = 0;
+    int tickMs = DefaultTickIntervalMs;
+    bool enabled = false;
+
+    PidGains pidGains;
+    double hysteresisBand = 0.5;
+
+    ///< Состояние регуляторов по комнатам
+    std::vector<Mode> modes;
+    std::vector<double> integrals;
+    std::vector<double> previousTemperatures;
+    std::vector<qint8> hysteresisState;  ///< -1 охлаждение, 0 выключено, 1 нагрев
+    std::vector<double> outputBuffer;    ///< Рассчитанная мощность до применения к хранилищу
+
+    TickStats tickStats;
+};
+
+#endif // CONTROLENGINE_H
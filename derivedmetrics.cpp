@@ -0,0 +1,116 @@
+#include "derivedmetrics.h"
+#include "profiler.h"
+
+/**
+ * @brief Конструктор.
+ * @param store Хранилище, по столбцам которого считаются величины.
+ */
+DerivedMetrics::DerivedMetrics(RoomStateStore *store, QObject *parent)
+    : QObject(parent), store(store)
+{
+    updateTimer.setSingleShot(true);
+    updateTimer.setInterval(UpdateIntervalMs);
+    connect(&updateTimer, &QTimer::timeout, this, &DerivedMetrics::update);
+
+    connect(store, &RoomStateStore::roomChanged, this, &DerivedMetrics::markDirty);
+    connect(store, &RoomStateStore::allRoomsChanged, this, &DerivedMetrics::markAllDirty);
+    connect(store, &RoomStateStore::samplesApplied, this, &DerivedMetrics::markAppliedSamples);
+    connect(store, &RoomStateStore::roomsReset, this, [this]() {
+        resizeColumns();
+        scheduleUpdate();
+    });
+
+    resizeColumns();
+    update();
+}
+
+/**
+ * @brief Подгоняет столбцы под число комнат хранилища; все комнаты считаются изменёнными.
+ */
+void DerivedMetrics::resizeColumns() {
+    const size_t count = size_t(store->roomCount());
+    dewPointColumn.resize(count);
+    absoluteHumidityColumn.resize(count);
+    enthalpyColumn.resize(count);
+    heatIndexColumn.resize(count);
+    dirtyFlags.assign(count, 0);
+    dirtyRooms.clear();
+    allDirty = true;
+}
+
+void DerivedMetrics::scheduleUpdate() {
+    if (!updateTimer.isActive())
+        updateTimer.start();
+}
+
+void DerivedMetrics::markDirty(int roomId, int fields) {
+    if (!(fields & InputFields) || allDirty || roomId < 0 || size_t(roomId) >= dirtyFlags.size()
+        || dirtyFlags[size_t(roomId)])
+        return;
+    dirtyFlags[size_t(roomId)] = 1;
+    dirtyRooms.push_back(roomId);
+    scheduleUpdate();
+}
+
+void DerivedMetrics::markAllDirty(int fields) {
+    if (!(fields & InputFields))
+        return;
+    allDirty = true;
+    scheduleUpdate();
+}
+
+void DerivedMetrics::markAppliedSamples() {
+    for (const RoomStateStore::RoomChange &change : store->lastAppliedChanges())
+        markDirty(change.roomId, change.fields);
+}
+
+/**
+ * @brief Пересчитывает изменённые комнаты одним пакетом.
+ */
+void DerivedMetrics::update() {
+    updateTimer.stop();
+    // Слот roomsReset мог ещё не дойти до нас, если update() вызван из другого его получателя
+    if (roomCount() != store->roomCount())
+        resizeColumns();
+    if (!allDirty && dirtyRooms.empty())
+        return;
+    CLIMATE_PROFILE_SCOPE(DerivedMetricsUpdate);
+
+    const size_t rooms = size_t(store->roomCount());
+    if (allDirty || dirtyRooms.size() * 2 > rooms) {
+        computePsychrometrics(store->temperatures(), store->humidities(), store->pressures(), rooms,
+                              {dewPointColumn.data(), absoluteHumidityColumn.data(), enthalpyColumn.data(),
+                               heatIndexColumn.data()});
+        computedCount += rooms;
+    } else {
+        const size_t count = dirtyRooms.size();
+        for (std::vector<double> &buffer : gathered)
+            buffer.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            const int roomId = dirtyRooms[i];
+            gathered[0][i] = store->temperature(roomId);
+            gathered[1][i] = store->humidity(roomId);
+            gathered[2][i] = store->pressure(roomId);
+        }
+        computePsychrometrics(gathered[0].data(), gathered[1].data(), gathered[2].data(), count,
+                              {gathered[3].data(), gathered[4].data(), gathered[5].data(), gathered[6].data()});
+        for (size_t i = 0; i < count; ++i) {
+            const size_t roomId = size_t(dirtyRooms[i]);
+            dewPointColumn[roomId] = gathered[3][i];
+            absoluteHumidityColumn[roomId] = gathered[4][i];
+            enthalpyColumn[roomId] = gathered[5][i];
+            heatIndexColumn[roomId] = gathered[6][i];
+        }
+        computedCount += count;
+    }
+
+    if (allDirty) {
+        dirtyFlags.assign(rooms, 0);
+    } else {
+        for (int roomId : dirtyRooms)
+            dirtyFlags[size_t(roomId)] = 0;
+    }
+    dirtyRooms.clear();
+    allDirty = false;
+    emit updated();
+}
@@ -0,0 +1,87 @@
+#ifndef DERIVEDMETRICS_H
+#define DERIVEDMETRICS_H
+
+#include <QObject>
+#include <QTimer>
+#include <vector>
+
+#include "psychrometrics.h"
+#include "roomstate.h"
+
+/**
+ * @brief Точка росы, абсолютная влажность, энтальпия и индекс жары всех комнат.
+ *
+ * Держит по столбцу на величину рядом со столбцами RoomStateStore. Изменения
+ * температуры, влажности и давления отмечают комнаты как изменённые, а
+ * пересчёт идёт пакетом раз в UpdateIntervalMs (или сразу по update()) через
+ * векторный computePsychrometrics(). Если изменено больше половины комнат,
+ * считаются столбцы целиком прямо из хранилища; иначе значения изменённых
+ * комнат собираются в плотные буферы, считаются и раскладываются обратно.
+ *
+ * Читатели, которым нужны свежие значения в данный момент (модель таблицы
+ * перед отрисовкой), вызывают update() сами: без изменённых комнат он
+ * ничего не делает.
+ */
+class DerivedMetrics : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int UpdateIntervalMs = 50;
+    static constexpr int InputFields = RoomStateStore::TemperatureField | RoomStateStore::HumidityField
+                                       | RoomStateStore::PressureField;
+    static constexpr double CondensationMargin = 2.0; ///< °C: температура ближе к точке росы - риск конденсации
+
+    explicit DerivedMetrics(RoomStateStore *store, QObject *parent = nullptr);
+
+    int roomCount() const { return int(dewPointColumn.size()); }
+
+    double dewPoint(int roomId) const { return dewPointColumn[size_t(roomId)]; }
+    double absoluteHumidity(int roomId) const { return absoluteHumidityColumn[size_t(roomId)]; }
+    double enthalpy(int roomId) const { return enthalpyColumn[size_t(roomId)]; }
+    double heatIndex(int roomId) const { return heatIndexColumn[size_t(roomId)]; }
+    bool condensationRisk(int roomId) const {
+        return store->temperature(roomId) - dewPointColumn[size_t(roomId)] < CondensationMargin;
+    }
+
+    ///< Непрерывные столбцы, как у RoomStateStore
+    const double *dewPoints() const { return dewPointColumn.data(); }
+    const double *absoluteHumidities() const { return absoluteHumidityColumn.data(); }
+    const double *enthalpies() const { return enthalpyColumn.data(); }
+    const double *heatIndices() const { return heatIndexColumn.data(); }
+
+    int pendingRooms() const { return allDirty ? store->roomCount() : int(dirtyRooms.size()); }
+    quint64 computedRooms() const { return computedCount; } ///< Всего пересчитанных комнат
+
+public slots:
+    void update(); ///< Пересчитать изменённые комнаты сейчас
+
+signals:
+    void updated(); ///< Столбцы пересчитаны
+
+private slots:
+    void markDirty(int roomId, int fields);
+    void markAllDirty(int fields);
+    void markAppliedSamples();
+
+private:
+    void resizeColumns();
+    void scheduleUpdate();
+
+    RoomStateStore *store;
+    QTimer updateTimer;
+
+    std::vector<double> dewPointColumn;
+    std::vector<double> absoluteHumidityColumn;
+    std::vector<double> enthalpyColumn;
+    std::vector<double> heatIndexColumn;
+
+    std::vector<quint8> dirtyFlags;   ///< По комнатам
+    std::vector<int> dirtyRooms;
+    bool allDirty = true;
+
+    ///< Плотные буферы изменённых комнат: три входа и четыре выхода, переиспользуются
+    std::vector<double> gathered[7];
+    quint64 computedCount = 0;
+};
+
+#endif // DERIVEDMETRICS_H
@@ -0,0 +1,67 @@
+# Ядро климат-контроля: только QtCore, без виджетов.
+# Подключается основным приложением и может подключаться другими
+# проектами (например, для замеров без QApplication).
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+# Скалярный и векторный перевод единиц должны давать одинаковый результат:
+# запрещаем компилятору сливать умножение и сложение в FMA
+gcc|clang: QMAKE_CXXFLAGS += -ffp-contract=off
+
+# qmake CONFIG+=no_profiling - замеры CLIMATE_PROFILE_SCOPE компилируются в пустые инструкции
+no_profiling: DEFINES += CLIMATE_NO_PROFILING
+
+# Разделяемая память POSIX (SharedStateExporter): shm_open в librt у старых glibc
+unix:!macx: LIBS += -lrt
+
+SOURCES += \
+        $$PWD/alarmengine.cpp \
+        $$PWD/buildinghierarchy.cpp \
+        $$PWD/climateengine.cpp \
+        $$PWD/controlapiserver.cpp \
+        $$PWD/controlengine.cpp \
+        $$PWD/derivedmetrics.cpp \
+        $$PWD/historyarchive.cpp \
+        $$PWD/hvacdriver.cpp \
+        $$PWD/profiler.cpp \
+        $$PWD/psychrometrics.cpp \
+        $$PWD/roomhistory.cpp \
+        $$PWD/roomstate.cpp \
+        $$PWD/roomstatistics.cpp \
+        $$PWD/samplingscheduler.cpp \
+        $$PWD/sensoringestion.cpp \
+        $$PWD/sensorrecording.cpp \
+        $$PWD/sharedstateexporter.cpp \
+        $$PWD/statesnapshot.cpp \
+        $$PWD/thermalsimulation.cpp \
+        $$PWD/unitconversion.cpp
+
+HEADERS += \
+    $$PWD/alarmengine.h \
+    $$PWD/buildinghierarchy.h \
+    $$PWD/climateengine.h \
+    $$PWD/controlapiprotocol.h \
+    $$PWD/controlapiserver.h \
+    $$PWD/controlengine.h \
+    $$PWD/derivedmetrics.h \
+    $$PWD/historyarchive.h \
+    $$PWD/hvacdriver.h \
+    $$PWD/hvacprotocol.h \
+    $$PWD/parallelfor.h \
+    $$PWD/profiler.h \
+    $$PWD/psychrometrics.h \
+    $$PWD/roomhistory.h \
+    $$PWD/roomstate.h \
+    $$PWD/roomstatistics.h \
+    $$PWD/samplingscheduler.h \
+    $$PWD/sensoringestion.h \
+    $$PWD/sensorrecording.h \
+    $$PWD/sensorsample.h \
+    $$PWD/sharedstate.h \
+    $$PWD/sharedstateexporter.h \
+    $$PWD/spscringbuffer.h \
+    $$PWD/statesnapshot.h \
+    $$PWD/thermalsimulation.h \
+    $$PWD/timeseriescodec.h \
+    $$PWD/unitconversion.h
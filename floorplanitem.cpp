@@ -0,0 +1,229 @@
+#include "floorplanitem.h"
+#include "profiler.h"
+
+#include <QPainter>
+#include <QPainterPath>
+#include <QGraphicsScene>
+#include <QStyleOptionGraphicsItem>
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Комната на плане: многоугольник в своих координатах и номер цвета в палитре плана.
+ *
+ * Форма у всех комнат по умолчанию одна и та же (QPolygonF разделяется
+ * неявно), положение задаётся setPos(), поэтому элемент занимает несколько
+ * десятков байт, а смена цвета не трогает ни геометрию, ни индекс сцены.
+ */
+class RoomShapeItem : public QGraphicsItem {
+public:
+    enum { Type = UserType + 1 };
+
+    RoomShapeItem(int roomId, const QColor *palette, QGraphicsItem *parent)
+        : QGraphicsItem(parent), roomId(roomId), palette(palette)
+    {
+        setCacheMode(DeviceCoordinateCache); ///< Перерисовка только при смене цвета или масштаба
+    }
+
+    int type() const override { return Type; }
+
+    void setPolygon(const QPolygonF &shape) {
+        prepareGeometryChange();
+        polygon = shape;
+        rect = shape.boundingRect();
+        rectangular = shape == QPolygonF(rect);
+    }
+
+    QRectF boundingRect() const override { return rect; }
+
+    QPainterPath shape() const override {
+        QPainterPath path;
+        path.addPolygon(polygon);
+        return path;
+    }
+
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override {
+        Q_UNUSED(option);
+        Q_UNUSED(widget);
+        if (rectangular) {
+            painter->fillRect(rect, palette[color]);
+            return;
+        }
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(palette[color]);
+        painter->drawPolygon(polygon);
+    }
+
+    const int roomId;
+    quint8 color = 0;
+
+private:
+    const QColor *palette;
+    QPolygonF polygon;
+    QRectF rect;
+    bool rectangular = true;  ///< Прямоугольник рисуется fillRect без растеризации многоугольника
+};
+
+/**
+ * @brief Конструктор плана.
+ * @param store Хранилище, из столбцов которого берутся значения комнат.
+ * @param hierarchy Планировка здания: этажи, зоны и комнаты.
+ */
+FloorPlanItem::FloorPlanItem(const RoomStateStore *store, const BuildingHierarchy *hierarchy, QGraphicsItem *parent)
+    : QGraphicsItem(parent), store(store), hierarchy(hierarchy)
+{
+    setFlag(ItemHasNoContents);
+    setValueRange(Metric::Temperature, 15.0, 30.0);
+    setValueRange(Metric::Humidity, 20.0, 80.0);
+    setValueRange(Metric::Pressure, RoomStateStore::StandardPressure - 1000.0,
+                  RoomStateStore::StandardPressure + 1000.0);
+    for (int i = 0; i < PaletteSize; ++i)
+        palette[i] = QColor::fromHsvF((1.0 - double(i) / (PaletteSize - 1)) * 240.0 / 360.0, 0.75, 0.95);
+}
+
+QRectF FloorPlanItem::boundingRect() const {
+    return bounds;
+}
+
+void FloorPlanItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) {
+    Q_UNUSED(painter);
+    Q_UNUSED(option);
+    Q_UNUSED(widget);
+}
+
+void FloorPlanItem::setMetric(Metric newMetric) {
+    if (metric == newMetric)
+        return;
+    metric = newMetric;
+    refreshColors();
+}
+
+void FloorPlanItem::setValueRange(Metric rangeMetric, double low, double high) {
+    lowValue[int(rangeMetric)] = low;
+    highValue[int(rangeMetric)] = high > low ? high : low + 1.0;
+    if (rangeMetric == metric)
+        refreshColors();
+}
+
+void FloorPlanItem::setRoomPolygon(int roomId, const QPolygonF &polygon) {
+    if (layoutDirty)
+        rebuild();
+    if (roomId < 0 || roomId >= roomCount())
+        return;
+    rooms[size_t(roomId)]->setPolygon(polygon);
+    prepareGeometryChange();
+    bounds = childrenBoundingRect();
+}
+
+/**
+ * @brief Отмечает планировку изменившейся.
+ *
+ * Скрытый план перестраивается при следующем показе, а не на каждое
+ * изменение числа комнат.
+ */
+void FloorPlanItem::invalidateLayout() {
+    layoutDirty = true;
+    if (isVisible())
+        rebuild();
+}
+
+QVariant FloorPlanItem::itemChange(GraphicsItemChange change, const QVariant &value) {
+    if (change == ItemVisibleHasChanged && value.toBool() && layoutDirty)
+        rebuild();
+    return QGraphicsItem::itemChange(change, value);
+}
+
+/**
+ * @brief Раскладывает комнаты по этажам и зонам иерархии.
+ *
+ * Существующие элементы переиспользуются, создаются и удаляются только
+ * недостающие и лишние.
+ */
+void FloorPlanItem::rebuild() {
+    layoutDirty = false;
+    const int count = hierarchy->roomCount();
+    const int zoneRooms = hierarchy->roomsPerZone();
+    const int floorZones = hierarchy->zonesPerFloor();
+    const int floors = std::max(hierarchy->nodeCount(BuildingHierarchy::FloorLevel), 1);
+    const qreal floorWidth = zoneRooms * RoomSize + FloorGap;
+    const qreal floorHeight = floorZones * RoomSize + FloorGap;
+    const int across = std::max(1, int(std::ceil(std::sqrt(floors * floorHeight / floorWidth))));
+
+    prepareGeometryChange();
+    for (size_t i = size_t(count); i < rooms.size(); ++i)
+        delete rooms[i];
+    rooms.resize(size_t(count), nullptr);
+
+    const QPolygonF cell(QRectF(RoomGap / 2, RoomGap / 2, RoomSize - RoomGap, RoomSize - RoomGap));
+    for (int roomId = 0; roomId < count; ++roomId) {
+        RoomShapeItem *&room = rooms[size_t(roomId)];
+        if (!room)
+            room = new RoomShapeItem(roomId, palette, this);
+        room->setPolygon(cell);
+
+        const int zone = hierarchy->parentNode(BuildingHierarchy::RoomLevel, roomId);
+        const int floor = hierarchy->parentNode(BuildingHierarchy::ZoneLevel, zone);
+        const int row = zone - hierarchy->firstChild(BuildingHierarchy::FloorLevel, floor);
+        const int column = roomId - hierarchy->firstRoom(BuildingHierarchy::ZoneLevel, zone);
+        room->setPos((floor % across) * floorWidth + column * RoomSize,
+                     (floor / across) * floorHeight + row * RoomSize);
+    }
+    bounds = QRectF(0, 0, std::min(floors, across) * floorWidth - FloorGap,
+                    ((floors + across - 1) / across) * floorHeight - FloorGap);
+    refreshColors();
+}
+
+quint8 FloorPlanItem::colorIndex(double value) const {
+    const double position = (value - lowValue[int(metric)]) / (highValue[int(metric)] - lowValue[int(metric)]);
+    if (!(position > 0.0))
+        return 0;
+    return quint8(std::min(position, 1.0) * (PaletteSize - 1) + 0.5);
+}
+
+/**
+ * @brief Пересчитывает номера цветов комнат [firstRoomId, lastRoomId].
+ *
+ * Обращается к одному столбцу хранилища; перерисовка запрашивается только
+ * у комнат, чей номер цвета изменился, поэтому малые колебания значений
+ * не сбрасывают кэш изображений.
+ */
+void FloorPlanItem::refreshRooms(int firstRoomId, int lastRoomId, int fields) {
+    if (!(fields & (RoomStateStore::TemperatureField << int(metric))) || layoutDirty)
+        return;
+    CLIMATE_PROFILE_SCOPE(FloorPlanColors);
+    firstRoomId = std::max(firstRoomId, 0);
+    lastRoomId = std::min(lastRoomId, std::min(roomCount(), store->roomCount()) - 1);
+
+    const double *values = metric == Metric::Temperature ? store->temperatures()
+                           : metric == Metric::Humidity  ? store->humidities()
+                                                         : store->pressures();
+    int changed = 0;
+    for (int roomId = firstRoomId; roomId <= lastRoomId; ++roomId) {
+        RoomShapeItem *room = rooms[size_t(roomId)];
+        const quint8 color = colorIndex(values[roomId]);
+        if (room->color == color)
+            continue;
+        room->color = color;
+        room->update();
+        ++changed;
+    }
+    lastChanged = changed;
+}
+
+void FloorPlanItem::refreshColors() {
+    refreshRooms(0, roomCount() - 1, RoomStateStore::TemperatureField << int(metric));
+}
+
+/**
+ * @brief Комната под точкой: поиск через индекс сцены, без перебора всех комнат.
+ */
+int FloorPlanItem::roomAt(const QPointF &scenePos) const {
+    if (!scene() || !isVisible())
+        return -1;
+    for (QGraphicsItem *item : scene()->items(scenePos, Qt::IntersectsItemShape, Qt::DescendingOrder)) {
+        if (item->type() == RoomShapeItem::Type && item->parentItem() == this)
+            return static_cast<RoomShapeItem *>(item)->roomId;
+    }
+    return -1;
+}
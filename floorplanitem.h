@@ -0,0 +1,76 @@
+#ifndef FLOORPLANITEM_H
+#define FLOORPLANITEM_H
+
+#include <QGraphicsItem>
+#include <QPolygonF>
+#include <QColor>
+#include <vector>
+
+#include "roomstate.h"
+#include "roomhistory.h"
+#include "buildinghierarchy.h"
+
+class RoomShapeItem;
+
+/**
+ * @brief План этажей для QGraphicsScene: каждая комната - многоугольник, окрашенный по величине.
+ *
+ * Сам элемент ничего не рисует (ItemHasNoContents) и служит родителем
+ * элементов комнат, поэтому план показывается и скрывается одним
+ * setVisible(). Комнаты - отдельные элементы сцены: индекс BSP сцены
+ * отбирает для отрисовки и поиска под курсором только попавшие в область,
+ * а DeviceCoordinateCache сохраняет растровое изображение комнаты, так что
+ * прокрутка плана сводится к копированию готовых изображений.
+ *
+ * Этажи раскладываются сеткой, близкой к квадратной; внутри этажа зоны
+ * BuildingHierarchy идут рядами комнат. Геометрия строится только при
+ * изменении планировки (invalidateLayout()), а новые значения меняют лишь
+ * номер цвета комнаты в заранее рассчитанной палитре из PaletteSize цветов:
+ * перерисовка (и сброс кэша изображения) запрашивается только у комнат,
+ * у которых номер цвета действительно изменился.
+ */
+class FloorPlanItem : public QGraphicsItem {
+public:
+    static constexpr int PaletteSize = 256;
+    static constexpr qreal RoomSize = 40.0;  ///< Сторона ячейки комнаты в координатах сцены
+    static constexpr qreal RoomGap = 2.0;    ///< Зазор между комнатами
+    static constexpr qreal FloorGap = 40.0;  ///< Расстояние между этажами на плане
+
+    FloorPlanItem(const RoomStateStore *store, const BuildingHierarchy *hierarchy, QGraphicsItem *parent = nullptr);
+
+    void setMetric(Metric metric);                ///< Величина, по которой окрашиваются комнаты
+    Metric currentMetric() const { return metric; }
+    void setValueRange(Metric metric, double low, double high); ///< Значения, соответствующие краям палитры
+    void setRoomPolygon(int roomId, const QPolygonF &polygon);  ///< Заменить прямоугольник комнаты своей формой
+
+    void invalidateLayout();                      ///< Перестроить комнаты по планировке (сразу, если план виден)
+    void refreshRooms(int firstRoomId, int lastRoomId, int fields); ///< Пересчитать цвета диапазона комнат
+    void refreshColors();                         ///< Пересчитать цвета всех комнат
+
+    int roomCount() const { return int(rooms.size()); }
+    int roomAt(const QPointF &scenePos) const;    ///< Комната под точкой сцены, -1 если нет
+    int changedColors() const { return lastChanged; } ///< Сколько комнат перекрашено последним обновлением
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+protected:
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
+
+private:
+    void rebuild();
+    quint8 colorIndex(double value) const;
+
+    const RoomStateStore *store;
+    const BuildingHierarchy *hierarchy;
+    Metric metric = Metric::Temperature;
+    double lowValue[MetricCount];
+    double highValue[MetricCount];
+    QColor palette[PaletteSize];            ///< От холодного (синий) к тёплому (красный)
+    std::vector<RoomShapeItem *> rooms;     ///< Элементы комнат по номерам, дети плана
+    QRectF bounds;
+    bool layoutDirty = true;
+    int lastChanged = 0;
+};
+
+#endif // FLOORPLANITEM_H
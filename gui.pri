@@ -0,0 +1,24 @@
+# Окно приложения поверх ядра из engine.pri (QtWidgets).
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+        $$PWD/buildingtreemodel.cpp \
+        $$PWD/floorplanitem.cpp \
+        $$PWD/roomtablemodel.cpp \
+        $$PWD/source.cpp \
+        $$PWD/statsdialog.cpp \
+        $$PWD/thememanager.cpp \
+        $$PWD/trendchartitem.cpp \
+        $$PWD/uiupdatescheduler.cpp
+
+HEADERS += \
+    $$PWD/buildingtreemodel.h \
+    $$PWD/floorplanitem.h \
+    $$PWD/header.h \
+    $$PWD/roomtablemodel.h \
+    $$PWD/statsdialog.h \
+    $$PWD/thememanager.h \
+    $$PWD/trendchartitem.h \
+    $$PWD/uiupdatescheduler.h
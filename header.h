@@ -16,31 +16,48 @@
 #include <QLineEdit>
 #include <QFormLayout>
 #include <QSpinBox>
+#include <QTableView>
+#include <QTreeView>
+#include <QCheckBox>
+
+#include "climateengine.h"
+#include "roomtablemodel.h"
+#include "buildingtreemodel.h"
+#include "uiupdatescheduler.h"
+#include "trendchartitem.h"
+#include "floorplanitem.h"
+#include "thememanager.h"
+#include "statsdialog.h"
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
+    friend class GuiBenchmark; ///< Замеры вызывают закрытые слоты напрямую (benchmarks/gui)
 
 public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
-private:
-    ///< Виджеты для отображения информации
-    QLabel *room1TemperatureLabel;
-    QLabel *room1HumidityLabel;
-    QLabel *room1PressureLabel;
-    QLabel *room1AirflowDirectionLabel;
+    void setRoomCount(int roomCount);
+    bool startSensorIngestion(const QString &sourceSpec); ///< Запуск приёма измерений, см. SensorSource::create
+    void startSimulation(double speed);                   ///< Запуск имитации здания, см. ThermalSimulation
+    bool loadAlarmRules(const QString &path);             ///< Правила тревог, см. AlarmEngine::parseRules
+    bool startRecording(const QString &path);             ///< Запись потока измерений, см. SensorRecorder
+    bool startReplay(const QString &path, double speed, qint64 fromMs); ///< Воспроизведение записи, см. RecordingPlayer
+    bool startStateExport(const QString &name);          ///< Состояние комнат в разделяемой памяти, см. SharedStateExporter
+    bool startArchive(const QString &directory);         ///< Долговременный архив измерений, см. HistoryArchiver
+    bool startControlApi(const QString &address);        ///< Локальный API управления, см. ControlApiServer
 
-    QLabel *room2TemperatureLabel;
-    QLabel *room2HumidityLabel;
-    QLabel *room2PressureLabel;
-    QLabel *room2AirflowDirectionLabel;
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override; ///< Размер графика, масштаб и выбор комнаты на плане
 
-
-    QLabel *room3TemperatureLabel;
-    QLabel *room3HumidityLabel;
-    QLabel *room3PressureLabel;
-    QLabel *room3AirflowDirectionLabel;
+private:
+    ///< Виджеты для отображения информации
+    QTableView *roomView;          ///< Список комнат, рисуются только видимые строки
+    RoomTableModel *roomModel;     ///< Модель комнат поверх roomStore
+    QTreeView *buildingView;       ///< Здание - этажи - зоны - комнаты со сводными значениями
+    BuildingTreeModel *buildingModel;
+    QLabel *updateStatsLabel;      ///< Счётчик объединённых обновлений в строке состояния
+    QLabel *alarmsLabel;           ///< Число поднятых тревог в строке состояния
 
     // Ползунки и выпадающие списки для управления
    // QSlider *temperatureSlider;
@@ -55,12 +72,25 @@ private:
     // Комнаты для отображения значений
     QGraphicsView *graphicsView;
     QGraphicsScene *scene;
+    TrendChartItem *trendChart;   ///< График трендов в scene
+    QComboBox *trendMetricCombo;  ///< Величина, отображаемая на графике и плане
+    static constexpr qreal MinPlanScale = 0.01; ///< Пределы масштаба плана колесом мыши
+    static constexpr qreal MaxPlanScale = 8.0;
+    FloorPlanItem *floorPlan;     ///< План этажей в scene, показывается вместо графика
+    QCheckBox *floorPlanCheck;    ///< Переключение график / план
+
+    ClimateEngine *engine;     ///< Ядро без интерфейса: комнаты, история, датчики, снимок состояния
+    RoomStateStore *roomStore; ///< Состояние комнат (engine->store()), окно только отображает его
+    UiUpdateScheduler *updateScheduler; ///< Публикация изменений roomStore не чаще раза за кадр
+    ThemeManager *themeManager;         ///< Заранее подготовленные темы, смена палитрой
+    StatsDialog *statsDialog = nullptr; ///< Окно "Статистика", создаётся при первом открытии
 
     bool systemState = false;///< Управление кондиционером
 
-    // Сохранение настроек в XML
+    // Сохранение состояния: двоичный снимок и настройки в XML
     void loadSettings();
     void saveSettings();
+    SnapshotSettings currentSnapshotSettings() const;
 
     // Обработчики событий
 private slots:
@@ -71,7 +101,16 @@ private slots:
     void updateTemperature(int value);
     void updateTemperature(int value,int ind);
     void editRoom(int roomIndex);
-    void toggleDarkTheme(bool isDark);///< Файл style - настройки альтернативной темы
+    void toggleDarkTheme(bool isDark);///< Смена темы через themeManager
+    void showUpdateStats();
+    void showAlarmEvents();             ///< Пачка событий AlarmEngine
+    void refreshTrendChart();
+    void updateTrendUnit();
+    void updateTrendRooms();            ///< Первые комнаты и выбранная в списке
+    void selectBuildingNode(const QModelIndex &index); ///< Переход к первой комнате узла в списке
+    void selectRoom(int roomId);        ///< Выделение комнаты в списке с прокруткой к ней
+    void showFloorPlan(bool show);      ///< План этажей вместо графика в graphicsView
+    void showStatsDialog();             ///< Замеры горячих участков, см. Profiler
 
     void openPreferences(); ///< Слот для открытия окна настроек приложения
     void showAboutDialog(); ///< Слот для отображения справки к приложению
@@ -83,7 +122,7 @@ class RoomEditDialog : public QDialog {
 public:
     explicit RoomEditDialog(int roomIndex,double currentTemperature,double currentHumidity,
                             double currentPressure,const QString &currentAirflowDirection,
-                            QWidget *parent = nullptr): QDialog(parent), CurrentRoom_ind(CurrentRoom_ind) {
+                            QWidget *parent = nullptr): QDialog(parent), CurrentRoom_ind(roomIndex) {
         setWindowTitle("Редактирование комнаты");
 
         QFormLayout *formLayout = new QFormLayout(this);
@@ -104,10 +143,19 @@ public:
 
         // Выпадающий список типа ComboBox для направления подачи воздуха
         airflowDirectionComboBox = new QComboBox(this);
-        airflowDirectionComboBox->addItems({"Вверх-Право-Лево", "Вниз-Вниз-Вниз", "Право-Лево"});
+        airflowDirectionComboBox->addItems(airflowDirectionNames());
         airflowDirectionComboBox->setCurrentText(currentAirflowDirection);  // Установка текущего направления воздуха
         formLayout->addRow(new QLabel("Направление подачи воздуха:"), airflowDirectionComboBox);
 
+        // Уставка: при источнике "hvac:" уходит на установку комнаты
+        setpointLineEdit = new QLineEdit(this);
+        formLayout->addRow(new QLabel("Уставка:"), setpointLineEdit);
+
+        // Скользящая статистика комнаты, скрыта до первого измерения
+        statisticsLabel = new QLabel(this);
+        statisticsLabel->setVisible(false);
+        formLayout->addRow(statisticsLabel);
+
         // Кнопка сохранения
         saveButton = new QPushButton("Сохранить", this);
         connect(saveButton, &QPushButton::clicked, this, &RoomEditDialog::accept);
@@ -138,6 +186,21 @@ public:
         return airflowDirectionComboBox->currentText();
     }
 
+    // Установка и получение уставки температуры
+    void setSetpoint(double celsius) {
+        setpointLineEdit->setText(QString::number(celsius));
+    }
+
+    double getSetpoint() const {
+        return setpointLineEdit->text().toDouble();
+    }
+
+    // Сводка скользящей статистики: среднее, разброс, тренд и прогноз
+    void setStatistics(const QString &summary) {
+        statisticsLabel->setText(summary);
+        statisticsLabel->setVisible(!summary.isEmpty());
+    }
+
     int Slider_ind;
 
 private:
@@ -146,6 +209,8 @@ private:
     QLineEdit *humidityLineEdit;     ///< Поле для ввода влажности
     QLineEdit *pressureLineEdit;     ///< Поле для ввода давления
     QComboBox *airflowDirectionComboBox;  ///< Выпадающий список для направления подачи воздуха
+    QLineEdit *setpointLineEdit;     ///< Поле для ввода уставки температуры
+    QLabel *statisticsLabel;         ///< Сводка статистики комнаты
     QPushButton *saveButton;  ///< Кнопка сохранения
 };
 
@@ -0,0 +1,519 @@
+#include "historyarchive.h"
+#include "profiler.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QIODevice>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+HistoryArchiver::Series::Series() {
+    for (int metric = 0; metric < MetricCount; ++metric)
+        values[metric] = TimeSeriesCodec::ValueEncoder(HistoryArchiveFormat::Scales[metric]);
+    reset();
+}
+
+void HistoryArchiver::Series::reset() {
+    time.reset();
+    for (int metric = 0; metric < MetricCount; ++metric) {
+        values[metric].reset();
+        minimum[metric] = std::numeric_limits<double>::infinity();
+        maximum[metric] = -std::numeric_limits<double>::infinity();
+    }
+    for (TimeSeriesCodec::BitWriter &stream : streams)
+        stream.clear();
+    count = 0;
+    firstMs = std::numeric_limits<qint64>::max();
+    lastMs = std::numeric_limits<qint64>::min();
+}
+
+HistoryArchiver::HistoryArchiver(QObject *parent)
+    : QObject(parent)
+{
+    writerPool.setMaxThreadCount(1);
+}
+
+HistoryArchiver::~HistoryArchiver() {
+    close();
+}
+
+bool HistoryArchiver::open(const QString &directory) {
+    close();
+    if (!QDir().mkpath(directory)) {
+        qWarning() << "Не удалось создать каталог архива" << directory;
+        return false;
+    }
+    ///< Продолжаем нумерацию блоков, уже лежащих в каталоге
+    nextChunkSequence = 0;
+    const QStringList names = QDir(directory).entryList({QString("*") + HistoryArchiveFormat::Suffix}, QDir::Files);
+    for (const QString &name : names) {
+        bool ok = false;
+        const quint64 sequence = name.section('-', 0, 0).toULongLong(&ok);
+        if (ok)
+            nextChunkSequence = std::max(nextChunkSequence, sequence + 1);
+    }
+    archiveDirectory = directory;
+    return true;
+}
+
+void HistoryArchiver::close() {
+    seal();
+    writerPool.waitForDone();
+    archiveDirectory.clear();
+}
+
+void HistoryArchiver::resize(int roomCount) {
+    seal();
+    series.resize(size_t(std::max(roomCount, 0)));
+}
+
+/**
+ * @brief Кодирует измерения в текущий блок.
+ *
+ * Измерение из следующего отрезка PartitionMs закрывает блок; запоздавшие
+ * измерения из прошлых отрезков остаются в текущем блоке.
+ */
+void HistoryArchiver::appendSamples(const SensorSample *samples, int count) {
+    if (!isOpen())
+        return;
+    for (int i = 0; i < count; ++i) {
+        const SensorSample &sample = samples[i];
+        if (sample.roomId < 0 || size_t(sample.roomId) >= series.size())
+            continue;
+        const qint64 samplePartition = sample.timestampMs >= 0 ? sample.timestampMs / PartitionMs
+                                                               : (sample.timestampMs + 1) / PartitionMs - 1;
+        if (samplePartition > partition) {
+            seal();
+            partition = samplePartition;
+        }
+
+        Series &room = series[size_t(sample.roomId)];
+        if (room.count == 0)
+            activeRooms.push_back(sample.roomId);
+        ++room.count;
+        room.firstMs = std::min(room.firstMs, sample.timestampMs);
+        room.lastMs = std::max(room.lastMs, sample.timestampMs);
+        int bits = room.time.append(room.streams[0], sample.timestampMs);
+        const double values[MetricCount] = {sample.temperature, sample.humidity, sample.pressure};
+        for (int metric = 0; metric < MetricCount; ++metric) {
+            bits += room.values[metric].append(room.streams[1 + metric], values[metric]);
+            room.minimum[metric] = std::min(room.minimum[metric], values[metric]);
+            room.maximum[metric] = std::max(room.maximum[metric], values[metric]);
+        }
+        pendingBits += quint64(bits);
+        ++pointCount;
+        if (pendingBits / 8 >= MaxChunkBytes)
+            seal();
+    }
+}
+
+/**
+ * @brief Собирает файл блока из потоков активных рядов.
+ */
+QByteArray HistoryArchiver::serializeChunk() const {
+    std::vector<qint32> rooms = activeRooms;
+    std::sort(rooms.begin(), rooms.end());
+
+    ArchiveChunkHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, HistoryArchiveFormat::Magic, sizeof(header.magic));
+    header.version = HistoryArchiveFormat::FormatVersion;
+    header.seriesCount = quint32(rooms.size());
+    header.firstMs = std::numeric_limits<qint64>::max();
+    header.lastMs = std::numeric_limits<qint64>::min();
+    for (int metric = 0; metric < MetricCount; ++metric) {
+        header.minimum[metric] = std::numeric_limits<double>::infinity();
+        header.maximum[metric] = -std::numeric_limits<double>::infinity();
+        header.scales[metric] = HistoryArchiveFormat::Scales[metric];
+    }
+
+    std::vector<ArchiveSeriesEntry> entries(rooms.size());
+    quint64 offset = 0;
+    for (size_t i = 0; i < rooms.size(); ++i) {
+        const Series &room = series[size_t(rooms[i])];
+        ArchiveSeriesEntry &entry = entries[i];
+        std::memset(&entry, 0, sizeof(entry));
+        entry.roomId = rooms[i];
+        entry.pointCount = room.count;
+        entry.firstMs = room.firstMs;
+        entry.lastMs = room.lastMs;
+        entry.offset = offset;
+        for (int metric = 0; metric < MetricCount; ++metric) {
+            entry.minimum[metric] = room.minimum[metric];
+            entry.maximum[metric] = room.maximum[metric];
+            header.minimum[metric] = std::min(header.minimum[metric], room.minimum[metric]);
+            header.maximum[metric] = std::max(header.maximum[metric], room.maximum[metric]);
+        }
+        for (int stream = 0; stream < HistoryArchiveFormat::StreamCount; ++stream) {
+            entry.streamBits[stream] = room.streams[stream].size();
+            offset += room.streams[stream].data().size() * sizeof(quint64);
+        }
+        header.firstMs = std::min(header.firstMs, room.firstMs);
+        header.lastMs = std::max(header.lastMs, room.lastMs);
+        header.pointCount += room.count;
+    }
+    header.dataBytes = offset;
+
+    QByteArray data;
+    data.reserve(int(sizeof(header) + entries.size() * sizeof(ArchiveSeriesEntry) + offset));
+    data.append(reinterpret_cast<const char *>(&header), int(sizeof(header)));
+    data.append(reinterpret_cast<const char *>(entries.data()), int(entries.size() * sizeof(ArchiveSeriesEntry)));
+    for (qint32 roomId : rooms) {
+        for (const TimeSeriesCodec::BitWriter &stream : series[size_t(roomId)].streams)
+            data.append(reinterpret_cast<const char *>(stream.data().data()), int(stream.data().size() * sizeof(quint64)));
+    }
+    return data;
+}
+
+/**
+ * @brief Имя файла блока: номер, время первой и последней точки.
+ *
+ * Номер уникален в каталоге и не зависит от того, записаны ли на диск
+ * предыдущие блоки: у блоков с одинаковым временем, закрытых подряд,
+ * имена не совпадают, даже пока их запись ещё в очереди.
+ */
+QString HistoryArchiver::chunkPath(quint64 sequence, qint64 firstMs, qint64 lastMs) const {
+    return QString("%1/%2-%3-%4%5")
+        .arg(archiveDirectory)
+        .arg(sequence, 8, 10, QChar('0'))
+        .arg(firstMs, 13, 10, QChar('0'))
+        .arg(lastMs, 13, 10, QChar('0'))
+        .arg(HistoryArchiveFormat::Suffix);
+}
+
+/**
+ * @brief Закрывает текущий блок: сборка здесь, запись на диск в фоновом потоке.
+ */
+void HistoryArchiver::seal() {
+    if (activeRooms.empty())
+        return;
+
+    QByteArray data;
+    {
+        CLIMATE_PROFILE_SCOPE(ArchiveSeal);
+        data = serializeChunk();
+        for (qint32 roomId : activeRooms)
+            series[size_t(roomId)].reset();
+        activeRooms.clear();
+        pendingBits = 0;
+    }
+
+    const ArchiveChunkHeader *header = reinterpret_cast<const ArchiveChunkHeader *>(data.constData());
+    const QString path = chunkPath(nextChunkSequence++, header->firstMs, header->lastMs);
+    ++chunkCount;
+    writerPool.start([this, data, path]() {
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+            qWarning() << "Не удалось записать блок архива" << path << ":" << file.errorString();
+            return;
+        }
+        writtenBytes.fetch_add(quint64(data.size()), std::memory_order_relaxed);
+    });
+}
+
+/**
+ * @brief Читает заголовки всех блоков каталога.
+ *
+ * Файлы, которые не являются блоками архива этой версии, пропускаются с предупреждением.
+ */
+bool HistoryArchive::open(const QString &directory) {
+    close();
+    QDir dir(directory);
+    if (!dir.exists()) {
+        qWarning() << "Каталог архива не найден:" << directory;
+        return false;
+    }
+    const QStringList names = dir.entryList({QString("*") + HistoryArchiveFormat::Suffix}, QDir::Files);
+    for (const QString &name : names) {
+        Chunk chunk;
+        chunk.path = dir.filePath(name);
+        QFile file(chunk.path);
+        if (!file.open(QIODevice::ReadOnly)
+            || file.read(reinterpret_cast<char *>(&chunk.header), sizeof(chunk.header)) != qint64(sizeof(chunk.header))
+            || std::memcmp(chunk.header.magic, HistoryArchiveFormat::Magic, sizeof(chunk.header.magic)) != 0
+            || chunk.header.version != HistoryArchiveFormat::FormatVersion) {
+            qWarning() << "Пропущен файл, не являющийся блоком архива:" << chunk.path;
+            continue;
+        }
+        chunk.fileBytes = quint64(file.size());
+        chunks.push_back(chunk);
+    }
+    std::sort(chunks.begin(), chunks.end(), [](const Chunk &a, const Chunk &b) {
+        return a.header.firstMs < b.header.firstMs;
+    });
+    return true;
+}
+
+void HistoryArchive::close() {
+    chunks.clear();
+}
+
+qint64 HistoryArchive::firstTimestampMs() const {
+    qint64 first = -1;
+    for (const Chunk &chunk : chunks)
+        first = first < 0 ? chunk.header.firstMs : std::min(first, chunk.header.firstMs);
+    return first;
+}
+
+qint64 HistoryArchive::lastTimestampMs() const {
+    qint64 last = -1;
+    for (const Chunk &chunk : chunks)
+        last = std::max(last, chunk.header.lastMs);
+    return last;
+}
+
+quint64 HistoryArchive::pointCount() const {
+    quint64 count = 0;
+    for (const Chunk &chunk : chunks)
+        count += chunk.header.pointCount;
+    return count;
+}
+
+quint64 HistoryArchive::fileBytes() const {
+    quint64 bytes = 0;
+    for (const Chunk &chunk : chunks)
+        bytes += chunk.fileBytes;
+    return bytes;
+}
+
+bool HistoryArchive::chunkMatches(const ArchiveChunkHeader &header, const ArchiveQuery &query) const {
+    if (header.lastMs < query.fromMs || header.firstMs >= query.toMs)
+        return false;
+    const int metric = int(query.metric);
+    return !query.filterValues
+           || (header.maximum[metric] >= query.minValue && header.minimum[metric] <= query.maxValue);
+}
+
+bool HistoryArchive::seriesMatches(const ArchiveSeriesEntry &entry, const ArchiveQuery &query) const {
+    if (entry.lastMs < query.fromMs || entry.firstMs >= query.toMs)
+        return false;
+    const int metric = int(query.metric);
+    return !query.filterValues
+           || (entry.maximum[metric] >= query.minValue && entry.minimum[metric] <= query.maxValue);
+}
+
+bool HistoryArchive::scan(const ArchiveQuery &query, const Visitor &visitor, ArchiveScanStats *stats) const {
+    ArchiveScanStats local;
+    ArchiveScanStats &counters = stats ? *stats : local;
+    counters = ArchiveScanStats();
+    for (const Chunk &chunk : chunks) {
+        if (!chunkMatches(chunk.header, query)) {
+            ++counters.chunksSkipped;
+            continue;
+        }
+        ++counters.chunksScanned;
+        if (!scanChunk(chunk, query, visitor, counters))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Отображает блок и декодирует подходящие ряды пачками.
+ */
+bool HistoryArchive::scanChunk(const Chunk &chunk, const ArchiveQuery &query, const Visitor &visitor,
+                               ArchiveScanStats &stats) const {
+    QFile file(chunk.path);
+    const quint64 entriesBytes = quint64(chunk.header.seriesCount) * sizeof(ArchiveSeriesEntry);
+    const quint64 dataOffset = sizeof(ArchiveChunkHeader) + entriesBytes;
+    if (!file.open(QIODevice::ReadOnly) || quint64(file.size()) < dataOffset + chunk.header.dataBytes) {
+        qWarning() << "Блок архива повреждён или усечён:" << chunk.path;
+        return false;
+    }
+    const uchar *base = file.map(0, file.size());
+    if (!base) {
+        qWarning() << "Не удалось отобразить блок архива" << chunk.path << ":" << file.errorString();
+        return false;
+    }
+
+    const ArchiveSeriesEntry *entries = reinterpret_cast<const ArchiveSeriesEntry *>(base + sizeof(ArchiveChunkHeader));
+    const ArchiveSeriesEntry *first = entries;
+    const ArchiveSeriesEntry *last = entries + chunk.header.seriesCount;
+    if (query.roomId >= 0) {
+        first = std::lower_bound(first, last, query.roomId, [](const ArchiveSeriesEntry &entry, int roomId) {
+            return entry.roomId < roomId;
+        });
+        last = first != last && first->roomId == query.roomId ? first + 1 : first;
+    }
+
+    const bool wholeTime = chunk.header.firstMs >= query.fromMs && chunk.header.lastMs < query.toMs;
+    const int filterMetric = int(query.metric);
+    qint64 timestamps[BatchPoints];
+    double values[MetricCount][BatchPoints];
+    bool ok = true;
+    for (const ArchiveSeriesEntry *entry = first; entry != last && ok; ++entry) {
+        if (!seriesMatches(*entry, query)) {
+            ++stats.seriesSkipped;
+            continue;
+        }
+        quint64 streamBytes = 0;
+        for (quint64 bits : entry->streamBits)
+            streamBytes += (bits + 63) / 64 * sizeof(quint64);
+        if (entry->offset % sizeof(quint64) != 0 || entry->offset + streamBytes > chunk.header.dataBytes) {
+            ok = false;
+            break;
+        }
+        stats.bytesRead += streamBytes;
+
+        const quint64 *words = reinterpret_cast<const quint64 *>(base + dataOffset + entry->offset);
+        TimeSeriesCodec::TimestampDecoder time(TimeSeriesCodec::BitReader(words, entry->streamBits[0]));
+        words += (entry->streamBits[0] + 63) / 64;
+        TimeSeriesCodec::ValueDecoder decoders[MetricCount];
+        for (int metric = 0; metric < MetricCount; ++metric) {
+            decoders[metric] = TimeSeriesCodec::ValueDecoder(
+                TimeSeriesCodec::BitReader(words, entry->streamBits[1 + metric]), chunk.header.scales[metric]);
+            words += (entry->streamBits[1 + metric] + 63) / 64;
+        }
+
+        // Ряд целиком внутри запроса - точки отдаются без проверки каждой
+        const bool wholeSeries = (wholeTime || (entry->firstMs >= query.fromMs && entry->lastMs < query.toMs))
+                                 && (!query.filterValues
+                                     || (entry->minimum[filterMetric] >= query.minValue
+                                         && entry->maximum[filterMetric] <= query.maxValue));
+        for (quint32 done = 0; done < entry->pointCount;) {
+            const int count = int(std::min<quint32>(BatchPoints, entry->pointCount - done));
+            for (int i = 0; i < count; ++i)
+                timestamps[i] = time.next();
+            for (int metric = 0; metric < MetricCount; ++metric) {
+                for (int i = 0; i < count; ++i)
+                    values[metric][i] = decoders[metric].next();
+            }
+            // Точки из повреждённого потока не должны дойти до visitor
+            if (time.overrun() || decoders[0].overrun() || decoders[1].overrun() || decoders[2].overrun()) {
+                ok = false;
+                break;
+            }
+            done += quint32(count);
+            stats.pointsDecoded += quint64(count);
+
+            int matched = count;
+            if (!wholeSeries) {
+                matched = 0;
+                for (int i = 0; i < count; ++i) {
+                    const double value = values[filterMetric][i];
+                    if (timestamps[i] < query.fromMs || timestamps[i] >= query.toMs
+                        || (query.filterValues && (value < query.minValue || value > query.maxValue)))
+                        continue;
+                    timestamps[matched] = timestamps[i];
+                    for (int metric = 0; metric < MetricCount; ++metric)
+                        values[metric][matched] = values[metric][i];
+                    ++matched;
+                }
+            }
+            if (matched > 0) {
+                stats.pointsMatched += quint64(matched);
+                visitor(ArchiveBatch{entry->roomId, matched, timestamps, {values[0], values[1], values[2]}});
+            }
+        }
+    }
+
+    file.unmap(const_cast<uchar *>(base));
+    if (!ok)
+        qWarning() << "Блок архива повреждён:" << chunk.path;
+    return ok;
+}
+
+namespace {
+
+/// Буфер выгрузки: копит данные и отдаёт устройству кусками по FlushBytes
+class ExportBuffer {
+public:
+    static constexpr int FlushBytes = 1 << 20;
+
+    explicit ExportBuffer(QIODevice *out) : out(out) { data.reserve(FlushBytes + 4096); }
+
+    void append(const char *bytes, int size) {
+        data.append(bytes, size);
+        if (data.size() >= FlushBytes)
+            flush();
+    }
+
+    bool flush() {
+        if (!data.isEmpty() && out->write(data) != data.size())
+            failed = true;
+        data.clear();
+        return !failed;
+    }
+
+    bool ok() const { return !failed; }
+
+private:
+    QIODevice *out;
+    QByteArray data;
+    bool failed = false;
+};
+
+} // namespace
+
+bool HistoryArchive::exportCsv(QIODevice *out, const ArchiveQuery &query) const {
+    ExportBuffer buffer(out);
+    static const char header[] = "room,timestamp_ms,temperature_c,humidity_percent,pressure_pa\n";
+    buffer.append(header, int(sizeof(header) - 1));
+
+    const bool scanned = scan(query, [&buffer](const ArchiveBatch &batch) {
+        char line[160];
+        char *const end = line + sizeof(line);
+        for (int i = 0; i < batch.count; ++i) {
+            char *p = std::to_chars(line, end, batch.roomId).ptr;
+            *p++ = ',';
+            p = std::to_chars(p, end, batch.timestamps[i]).ptr;
+            // Кратчайшая запись double, которая читается обратно без потерь
+            for (int metric = 0; metric < MetricCount; ++metric) {
+                *p++ = ',';
+                p = std::to_chars(p, end, batch.values[metric][i]).ptr;
+            }
+            *p++ = '\n';
+            buffer.append(line, int(p - line));
+        }
+    });
+    return buffer.flush() && scanned;
+}
+
+bool HistoryArchive::exportColumnar(QIODevice *out, const ArchiveQuery &query) const {
+    ExportBuffer buffer(out);
+    buffer.append("CLIMCOL1", 8);
+
+    std::vector<qint64> timestamps;
+    std::vector<qint32> rooms;
+    std::vector<double> values[MetricCount];
+    timestamps.reserve(ExportBlockRows);
+    rooms.reserve(ExportBlockRows);
+    for (std::vector<double> &column : values)
+        column.reserve(ExportBlockRows);
+
+    auto writeBlock = [&]() {
+        const quint32 rows[2] = {quint32(timestamps.size()), 0};
+        buffer.append(reinterpret_cast<const char *>(rows), int(sizeof(rows)));
+        buffer.append(reinterpret_cast<const char *>(timestamps.data()), int(timestamps.size() * sizeof(qint64)));
+        if (rooms.size() % 2)
+            rooms.push_back(0);  // столбец комнат дополняется до 8 байт
+        buffer.append(reinterpret_cast<const char *>(rooms.data()), int(rooms.size() * sizeof(qint32)));
+        for (const std::vector<double> &column : values)
+            buffer.append(reinterpret_cast<const char *>(column.data()), int(column.size() * sizeof(double)));
+        timestamps.clear();
+        rooms.clear();
+        for (std::vector<double> &column : values)
+            column.clear();
+    };
+
+    const bool scanned = scan(query, [&](const ArchiveBatch &batch) {
+        for (int done = 0; done < batch.count;) {
+            const int count = std::min(batch.count - done, ExportBlockRows - int(timestamps.size()));
+            timestamps.insert(timestamps.end(), batch.timestamps + done, batch.timestamps + done + count);
+            rooms.insert(rooms.end(), size_t(count), batch.roomId);
+            for (int metric = 0; metric < MetricCount; ++metric)
+                values[metric].insert(values[metric].end(), batch.values[metric] + done, batch.values[metric] + done + count);
+            done += count;
+            if (int(timestamps.size()) == ExportBlockRows)
+                writeBlock();
+        }
+    });
+    if (!timestamps.empty())
+        writeBlock();
+    writeBlock();  // пустой блок - конец данных
+    return buffer.flush() && scanned;
+}
@@ -0,0 +1,224 @@
+#ifndef HISTORYARCHIVE_H
+#define HISTORYARCHIVE_H
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "roomhistory.h"
+#include "sensorsample.h"
+#include "timeseriescodec.h"
+
+class QIODevice;
+
+/**
+ * @brief Формат долговременного архива истории комнат.
+ *
+ * Архив - каталог неизменяемых блоков (файлов "<номер>-<начало>-<конец>.chunk"),
+ * каждый из которых покрывает отрезок времени не длиннее PartitionMs. Внутри блока у каждой
+ * комнаты свой ряд: четыре битовых потока TimeSeriesCodec (время и три
+ * величины), выровненные по 64 битам. Блок:
+ *
+ *     [ArchiveChunkHeader, 128 байт]
+ *     [ArchiveSeriesEntry x seriesCount, по 112 байт, по возрастанию roomId]
+ *     [потоки рядов]
+ *
+ * Заголовок блока и записи рядов хранят время первой и последней точки и
+ * min/max каждой величины, поэтому запрос по диапазону времени или значений
+ * пропускает блоки и ряды, не читая их потоки. Блок пишется целиком через
+ * QSaveFile и после этого не меняется. Порядок байтов - как у процессора
+ * записи.
+ */
+namespace HistoryArchiveFormat {
+constexpr char Magic[8] = {'C', 'L', 'I', 'M', 'A', 'R', 'C', '1'};
+constexpr quint32 FormatVersion = 1;
+constexpr int StreamCount = 1 + MetricCount;                ///< Время и величины
+constexpr double Scales[MetricCount] = {100.0, 100.0, 10.0}; ///< Фиксированная точка: 0.01 °C, 0.01 %, 0.1 Па
+constexpr const char *Suffix = ".chunk";
+}
+
+struct ArchiveChunkHeader {
+    char magic[8];
+    quint32 version;
+    quint32 seriesCount;
+    qint64 firstMs;
+    qint64 lastMs;
+    quint64 pointCount;
+    double minimum[MetricCount];
+    double maximum[MetricCount];
+    double scales[MetricCount];
+    quint64 dataBytes;          ///< Потоки всех рядов
+    quint64 reserved;
+};
+
+struct ArchiveSeriesEntry {
+    qint32 roomId;
+    quint32 pointCount;
+    qint64 firstMs;             ///< Наименьшее время точки ряда
+    qint64 lastMs;              ///< Наибольшее
+    double minimum[MetricCount];
+    double maximum[MetricCount];
+    quint64 offset;             ///< Начало потоков ряда от начала данных блока, байт
+    quint64 streamBits[HistoryArchiveFormat::StreamCount];
+};
+
+static_assert(sizeof(ArchiveChunkHeader) == 128, "ArchiveChunkHeader is part of the chunk layout");
+static_assert(sizeof(ArchiveSeriesEntry) == 112, "ArchiveSeriesEntry is part of the chunk layout");
+
+/**
+ * @brief Запись измерений в архив.
+ *
+ * Измерения кодируются сразу при поступлении в потоки текущего блока в
+ * памяти. Блок закрывается, когда измерение попадает в следующий отрезок
+ * PartitionMs или потоки превышают MaxChunkBytes: данные собираются в
+ * файл в потоке интерфейса, а запись на диск идёт в фоновом потоке.
+ * Незакрытый блок читателям не виден и при аварийном завершении
+ * теряется; для недавних данных есть RoomHistory и SensorRecorder.
+ */
+class HistoryArchiver : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr qint64 PartitionMs = 60 * 60 * 1000;
+    static constexpr quint64 MaxChunkBytes = 32 * 1024 * 1024;
+
+    explicit HistoryArchiver(QObject *parent = nullptr);
+    ~HistoryArchiver();
+
+    bool open(const QString &directory); ///< Создаёт каталог при необходимости
+    void close();                        ///< Закрывает текущий блок и ждёт записи на диск
+    bool isOpen() const { return !archiveDirectory.isEmpty(); }
+    QString directory() const { return archiveDirectory; }
+
+    void resize(int roomCount);          ///< Измерения комнат за пределами roomCount отбрасываются
+    void appendSamples(const SensorSample *samples, int count);
+
+    quint64 archivedPoints() const { return pointCount; }
+    quint64 chunksWritten() const { return chunkCount; }
+    quint64 bytesWritten() const { return writtenBytes; }
+    quint64 pendingBytes() const { return pendingBits / 8; } ///< Потоки текущего блока
+
+public slots:
+    void seal(); ///< Закрыть текущий блок сейчас
+
+private:
+    struct Series {
+        Series();
+        void reset();
+
+        TimeSeriesCodec::TimestampEncoder time;
+        TimeSeriesCodec::ValueEncoder values[MetricCount];
+        TimeSeriesCodec::BitWriter streams[HistoryArchiveFormat::StreamCount];
+        quint32 count = 0;
+        qint64 firstMs = 0;
+        qint64 lastMs = 0;
+        double minimum[MetricCount];
+        double maximum[MetricCount];
+    };
+
+    QByteArray serializeChunk() const;
+    QString chunkPath(quint64 sequence, qint64 firstMs, qint64 lastMs) const;
+
+    QString archiveDirectory;
+    std::vector<Series> series;          ///< По номеру комнаты
+    std::vector<qint32> activeRooms;     ///< Комнаты с точками в текущем блоке
+    qint64 partition = std::numeric_limits<qint64>::min(); ///< Номер отрезка текущего блока
+    quint64 pendingBits = 0;
+    quint64 pointCount = 0;
+    quint64 chunkCount = 0;
+    quint64 nextChunkSequence = 0;       ///< Номер следующего блока в имени файла; только растёт
+    std::atomic<quint64> writtenBytes{0};
+    QThreadPool writerPool;              ///< Один поток записи
+};
+
+/// Запрос к архиву: диапазон времени, комната и (необязательно) диапазон значений
+struct ArchiveQuery {
+    int roomId = -1;                                        ///< -1 - все комнаты
+    qint64 fromMs = std::numeric_limits<qint64>::min();     ///< Включительно
+    qint64 toMs = std::numeric_limits<qint64>::max();       ///< Не включительно
+    bool filterValues = false;                              ///< Только точки, где metric в [minValue, maxValue]
+    Metric metric = Metric::Temperature;
+    double minValue = 0.0;
+    double maxValue = 0.0;
+};
+
+/// Пачка точек одной комнаты, столбцами; указатели действительны только внутри вызова
+struct ArchiveBatch {
+    int roomId;
+    int count;
+    const qint64 *timestamps;
+    const double *values[MetricCount];
+};
+
+/// Счётчики одного прохода по архиву
+struct ArchiveScanStats {
+    int chunksScanned = 0;
+    int chunksSkipped = 0;      ///< Отброшены по заголовку
+    quint64 seriesSkipped = 0;  ///< Отброшены по записи ряда
+    quint64 pointsDecoded = 0;
+    quint64 pointsMatched = 0;
+    quint64 bytesRead = 0;      ///< Потоков прочитано
+};
+
+/**
+ * @brief Чтение архива: проход по диапазону и потоковая выгрузка.
+ *
+ * open() читает только заголовки блоков. scan() отображает подходящие
+ * блоки в память по одному и декодирует ряды пачками по BatchPoints
+ * точек, поэтому расход памяти не зависит от размера диапазона. Внутри
+ * блока точки идут по комнатам, внутри ряда - в порядке записи.
+ */
+class HistoryArchive {
+public:
+    static constexpr int BatchPoints = 1024;
+
+    using Visitor = std::function<void(const ArchiveBatch &batch)>;
+
+    bool open(const QString &directory); ///< Повторный вызов подхватывает новые блоки
+    void close();
+
+    int chunkCount() const { return int(chunks.size()); }
+    qint64 firstTimestampMs() const;     ///< -1, если архив пуст
+    qint64 lastTimestampMs() const;
+    quint64 pointCount() const;
+    quint64 fileBytes() const;
+
+    /**
+     * @brief Передаёт visitor все точки, подходящие под запрос.
+     * @return false, если блок повреждён (точки до него уже переданы).
+     */
+    bool scan(const ArchiveQuery &query, const Visitor &visitor, ArchiveScanStats *stats = nullptr) const;
+
+    /// CSV "room,timestamp_ms,temperature_c,humidity_percent,pressure_pa", номера комнат с 0
+    bool exportCsv(QIODevice *out, const ArchiveQuery &query = ArchiveQuery()) const;
+    /**
+     * @brief Столбцовая выгрузка для numpy и подобных.
+     *
+     * Заголовок "CLIMCOL1", затем блоки до ExportBlockRows строк:
+     * quint32 число строк, quint32 0, qint64 время[n], qint32 комната[n]
+     * (дополнено до 8 байт), double температура[n], влажность[n], давление[n].
+     * Последний блок - с нулём строк.
+     */
+    bool exportColumnar(QIODevice *out, const ArchiveQuery &query = ArchiveQuery()) const;
+
+private:
+    static constexpr int ExportBlockRows = 64 * 1024;
+
+    struct Chunk {
+        QString path;
+        ArchiveChunkHeader header;
+        quint64 fileBytes;
+    };
+
+    bool chunkMatches(const ArchiveChunkHeader &header, const ArchiveQuery &query) const;
+    bool seriesMatches(const ArchiveSeriesEntry &entry, const ArchiveQuery &query) const;
+    bool scanChunk(const Chunk &chunk, const ArchiveQuery &query, const Visitor &visitor, ArchiveScanStats &stats) const;
+
+    std::vector<Chunk> chunks;           ///< По возрастанию времени начала
+};
+
+#endif // HISTORYARCHIVE_H
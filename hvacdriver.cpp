@@ -0,0 +1,587 @@
+#include "hvacdriver.h"
+#include "profiler.h"
+
+#include <QDateTime>
+#include <QDebug>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+/// Монотонное время в миллисекундах: сроки запросов не зависят от перевода часов
+qint64 monotonicMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+constexpr size_t ReceiveChunk = 16 * 1024;
+
+} // namespace
+
+/**
+ * @brief Конструктор; подключение выполняет open().
+ * @param connectionCount Число параллельных TCP-соединений, 1..MaxConnections.
+ */
+HvacClient::HvacClient(const QString &host, quint16 port, int connectionCount)
+    : host(host), port(port), connections(size_t(std::clamp(connectionCount, 1, MaxConnections)))
+{
+    for (Connection &connection : connections)
+        connection.window.resize(MaxInFlight);
+}
+
+HvacClient::~HvacClient() {
+    close();
+}
+
+bool HvacClient::open() {
+    close();
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *result = nullptr;
+    const int error = ::getaddrinfo(host.toLocal8Bit().constData(), QByteArray::number(port).constData(), &hints, &result);
+    if (error != 0 || !result) {
+        qWarning() << "Не удалось найти адрес шлюза установок" << host << ":" << gai_strerror(error);
+        return false;
+    }
+    const quint8 *bytes = reinterpret_cast<const quint8 *>(result->ai_addr);
+    address.assign(bytes, bytes + result->ai_addrlen);
+    ::freeaddrinfo(result);
+
+    const qint64 now = monotonicMs();
+    for (Connection &connection : connections)
+        connectSocket(connection, now);
+    return true;
+}
+
+void HvacClient::close() {
+    const qint64 now = monotonicMs();
+    for (Connection &connection : connections)
+        dropConnection(connection, now, false);
+    for (std::deque<Request> *queue : {&writeQueue, &readQueue}) {
+        while (!queue->empty()) {
+            Request request = std::move(queue->front());
+            queue->pop_front();
+            finish(request, nullptr, false);
+        }
+    }
+    address.clear();
+}
+
+void HvacClient::readRegisters(quint16 start, quint16 count, ReadHandler handler) {
+    readQueue.push_back({HvacProtocol::ReadHoldingRegisters, start, count, monotonicMs(), std::move(handler), nullptr});
+}
+
+void HvacClient::writeRegister(quint16 address, quint16 value, WriteHandler handler) {
+    writeQueue.push_back({HvacProtocol::WriteSingleRegister, address, value, monotonicMs(), nullptr, std::move(handler)});
+}
+
+int HvacClient::pending() const {
+    int count = int(writeQueue.size() + readQueue.size());
+    for (const Connection &connection : connections)
+        count += connection.inFlight;
+    return count;
+}
+
+int HvacClient::connectedCount() const {
+    return int(std::count_if(connections.begin(), connections.end(), [](const Connection &connection) {
+        return connection.fd >= 0 && !connection.connecting;
+    }));
+}
+
+QString HvacClient::description() const {
+    return QString("%1:%2, соединений %3").arg(host).arg(port).arg(connections.size());
+}
+
+/**
+ * @brief Начинает неблокирующее подключение; завершение проверяется в process() по POLLOUT.
+ */
+void HvacClient::connectSocket(Connection &connection, qint64 nowMs) {
+    if (address.empty())
+        return;
+    const sockaddr *target = reinterpret_cast<const sockaddr *>(address.data());
+    connection.fd = ::socket(target->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (connection.fd < 0) {
+        connection.retryAtMs = nowMs + ReconnectIntervalMs;
+        return;
+    }
+    const int noDelay = 1;
+    ::setsockopt(connection.fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    if (::connect(connection.fd, target, socklen_t(address.size())) == 0) {
+        connection.connecting = false;
+    } else if (errno == EINPROGRESS) {
+        connection.connecting = true;
+    } else {
+        ::close(connection.fd);
+        connection.fd = -1;
+        connection.retryAtMs = nowMs + ReconnectIntervalMs;
+    }
+}
+
+/**
+ * @brief Закрывает соединение; отправленные по нему запросы завершаются ошибкой.
+ * @param lost Соединение потеряно, а не закрыто close(): сообщение в журнал.
+ */
+void HvacClient::dropConnection(Connection &connection, qint64 nowMs, bool lost) {
+    if (connection.fd < 0)
+        return;
+    if (lost && !connection.connecting)
+        qWarning() << "Соединение со шлюзом установок" << host << "разорвано";
+    ::close(connection.fd);
+    connection.fd = -1;
+    connection.connecting = false;
+    connection.retryAtMs = nowMs + ReconnectIntervalMs;
+    connection.output.clear();
+    connection.outputOffset = 0;
+    connection.input.clear();
+    for (Slot &slot : connection.window) {
+        if (!slot.used)
+            continue;
+        slot.used = false;
+        finish(slot.request, nullptr, false);
+    }
+    connection.inFlight = 0;
+}
+
+/**
+ * @brief Кодирует запросы из очередей в выходной буфер, пока в окне соединения есть место.
+ */
+void HvacClient::dispatch(Connection &connection) {
+    while (connection.inFlight < MaxInFlight && (!writeQueue.empty() || !readQueue.empty())) {
+        std::deque<Request> &queue = writeQueue.empty() ? readQueue : writeQueue;
+
+        // Ответы приходят не по порядку: пропускаем номера, слоты которых ещё заняты
+        while (connection.window[connection.nextTransaction % MaxInFlight].used)
+            ++connection.nextTransaction;
+        const quint16 transaction = connection.nextTransaction++;
+        Slot &slot = connection.window[transaction % MaxInFlight];
+        slot.request = std::move(queue.front());
+        queue.pop_front();
+        slot.transaction = transaction;
+        slot.used = true;
+        ++connection.inFlight;
+
+        quint8 frame[HvacProtocol::HeaderBytes + 5];
+        const size_t bytes = slot.request.function == HvacProtocol::ReadHoldingRegisters
+                ? HvacProtocol::encodeRead(frame, transaction, slot.request.address, slot.request.countOrValue)
+                : HvacProtocol::encodeWrite(frame, transaction, slot.request.address, slot.request.countOrValue);
+        connection.output.insert(connection.output.end(), frame, frame + bytes);
+    }
+}
+
+/**
+ * @brief Отправляет выходной буфер, пока сокет принимает данные.
+ * @return false при ошибке соединения.
+ */
+bool HvacClient::flush(Connection &connection) {
+    while (connection.outputOffset < connection.output.size()) {
+        const ssize_t sent = ::send(connection.fd, connection.output.data() + connection.outputOffset,
+                                    connection.output.size() - connection.outputOffset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            connection.outputOffset += size_t(sent);
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+    }
+    connection.output.clear();
+    connection.outputOffset = 0;
+    return true;
+}
+
+/**
+ * @brief Читает всё доступное и разбирает полные кадры.
+ *
+ * Неполный кадр остаётся в начале входного буфера до следующего вызова.
+ * @return false при закрытии соединения шлюзом, ошибке или недопустимом кадре.
+ */
+bool HvacClient::receive(Connection &connection) {
+    for (;;) {
+        const size_t used = connection.input.size();
+        connection.input.resize(used + ReceiveChunk);
+        const ssize_t received = ::recv(connection.fd, connection.input.data() + used, ReceiveChunk, 0);
+        connection.input.resize(used + size_t(std::max<ssize_t>(received, 0)));
+        if (received > 0)
+            continue;
+        if (received == 0)
+            return false;
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+        return false;
+    }
+
+    size_t offset = 0;
+    while (offset < connection.input.size()) {
+        const int bytes = HvacProtocol::frameBytes(connection.input.data() + offset, connection.input.size() - offset);
+        if (bytes < 0)
+            return false;
+        if (bytes == 0 || offset + size_t(bytes) > connection.input.size())
+            break;
+        if (!handleFrame(connection, connection.input.data() + offset, bytes))
+            return false;
+        offset += size_t(bytes);
+    }
+    connection.input.erase(connection.input.begin(), connection.input.begin() + std::ptrdiff_t(offset));
+    return true;
+}
+
+/**
+ * @brief Сопоставляет ответ с запросом по номеру транзакции и завершает запрос.
+ *
+ * Ответ на запрос, уже завершённый по таймауту, пропускается.
+ * @return false, если кадр нарушает протокол.
+ */
+bool HvacClient::handleFrame(Connection &connection, const quint8 *frame, int size) {
+    if (size < HvacProtocol::HeaderBytes + 2 || HvacProtocol::getU16(frame + 2) != 0)
+        return false;
+    const quint16 transaction = HvacProtocol::getU16(frame);
+    Slot &slot = connection.window[transaction % MaxInFlight];
+    if (!slot.used || slot.transaction != transaction)
+        return true;
+
+    const quint8 function = frame[HvacProtocol::HeaderBytes];
+    const quint8 *pdu = frame + HvacProtocol::HeaderBytes + 1;
+    const int pduBytes = size - HvacProtocol::HeaderBytes - 1;
+    bool ok = false;
+    quint16 registers[HvacProtocol::MaxReadRegisters];
+    if (function == (slot.request.function | HvacProtocol::ExceptionFlag)) {
+        ok = false;
+    } else if (function != slot.request.function) {
+        return false;
+    } else if (function == HvacProtocol::ReadHoldingRegisters) {
+        const int count = slot.request.countOrValue;
+        if (pduBytes < 1 + 2 * count || pdu[0] != 2 * count)
+            return false;
+        for (int i = 0; i < count; ++i)
+            registers[i] = HvacProtocol::getU16(pdu + 1 + 2 * i);
+        ok = true;
+    } else {
+        ok = pduBytes >= 4 && HvacProtocol::getU16(pdu) == slot.request.address
+             && HvacProtocol::getU16(pdu + 2) == slot.request.countOrValue;
+    }
+
+    slot.used = false;
+    --connection.inFlight;
+    finish(slot.request, ok ? registers : nullptr, ok);
+    return true;
+}
+
+/**
+ * @brief Вызывает обработчик запроса; registers для записи не используется.
+ */
+void HvacClient::finish(Request &request, const quint16 *registers, bool ok) {
+    ++completedInStep;
+    if (!ok)
+        ++failures;
+    if (request.function == HvacProtocol::ReadHoldingRegisters) {
+        ReadHandler handler = std::move(request.onRead);
+        if (handler)
+            handler(ok ? registers : nullptr, ok ? int(request.countOrValue) : 0);
+    } else {
+        WriteHandler handler = std::move(request.onWrite);
+        if (handler)
+            handler(ok);
+    }
+}
+
+/**
+ * @brief Завершает ошибкой отправленные запросы старше RequestTimeoutMs.
+ *
+ * Номер транзакции просроченного запроса освобождается; если шлюз всё же
+ * ответит позже, ответ не совпадёт с новым запросом в том же слоте и будет пропущен.
+ */
+void HvacClient::expire(Connection &connection, qint64 nowMs) {
+    if (connection.inFlight == 0)
+        return;
+    for (Slot &slot : connection.window) {
+        if (slot.used && nowMs - slot.request.queuedMs > RequestTimeoutMs) {
+            slot.used = false;
+            --connection.inFlight;
+            finish(slot.request, nullptr, false);
+        }
+    }
+}
+
+/**
+ * @brief Завершает ошибкой запросы, не отправленные за RequestTimeoutMs (например, шлюз недоступен).
+ */
+void HvacClient::expireQueue(std::deque<Request> &queue, qint64 nowMs) {
+    while (!queue.empty() && nowMs - queue.front().queuedMs > RequestTimeoutMs) {
+        Request request = std::move(queue.front());
+        queue.pop_front();
+        finish(request, nullptr, false);
+    }
+}
+
+/**
+ * @brief Один шаг: переподключение, отправка очередей, ожидание poll() до timeoutMs, приём.
+ */
+int HvacClient::process(int timeoutMs) {
+    completedInStep = 0;
+    qint64 now = monotonicMs();
+
+    pollfd waiters[MaxConnections];
+    const int count = int(connections.size());
+    for (int i = 0; i < count; ++i) {
+        Connection &connection = connections[size_t(i)];
+        if (connection.fd < 0 && now >= connection.retryAtMs)
+            connectSocket(connection, now);
+        if (connection.fd >= 0 && !connection.connecting) {
+            dispatch(connection);
+            if (!flush(connection))
+                dropConnection(connection, now);
+        }
+        waiters[i].fd = connection.fd;
+        waiters[i].events = connection.connecting ? POLLOUT
+                : short(POLLIN | (connection.output.empty() ? 0 : POLLOUT));
+        waiters[i].revents = 0;
+    }
+
+    if (::poll(waiters, nfds_t(count), std::max(timeoutMs, 0)) > 0) {
+        now = monotonicMs();
+        for (int i = 0; i < count; ++i) {
+            Connection &connection = connections[size_t(i)];
+            if (!waiters[i].revents || connection.fd != waiters[i].fd)
+                continue;
+            if (connection.connecting) {
+                int error = 0;
+                socklen_t length = sizeof(error);
+                ::getsockopt(connection.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+                if (error != 0) {
+                    dropConnection(connection, now);
+                    continue;
+                }
+                connection.connecting = false;
+            } else if ((waiters[i].revents & (POLLIN | POLLHUP | POLLERR)) && !receive(connection)) {
+                dropConnection(connection, now);
+                continue;
+            }
+            // Освободившиеся места окна сразу заполняются следующими запросами
+            dispatch(connection);
+            if (!flush(connection))
+                dropConnection(connection, now);
+        }
+    }
+
+    now = monotonicMs();
+    for (Connection &connection : connections)
+        expire(connection, now);
+    expireQueue(writeQueue, now);
+    expireQueue(readQueue, now);
+    return completedInStep;
+}
+
+/**
+ * @brief Конструктор источника.
+ * @param roomCount Число опрашиваемых установок (комнат), не больше HvacProtocol::MaxUnits.
+ * @param pollIntervalMs Период опроса; 0 - следующий цикл сразу после завершения предыдущего.
+ * @param maxIntervalTicks Наибольший период опроса установки в циклах; 1 - все установки каждый цикл.
+ */
+HvacDeviceSource::HvacDeviceSource(const QString &host, quint16 port, int roomCount, int connections, int pollIntervalMs,
+                                   int maxIntervalTicks)
+    : client(host, port, connections),
+      rooms(std::clamp(roomCount, 1, HvacProtocol::MaxUnits)),
+      pollMs(std::max(pollIntervalMs, 0)),
+      scheduler(rooms, maxIntervalTicks),
+      commands(CommandCapacity)
+{
+}
+
+/// Обработчики запросов ссылаются на источник: закрываем клиент, пока поля ещё живы
+HvacDeviceSource::~HvacDeviceSource() {
+    close();
+}
+
+bool HvacDeviceSource::open() {
+    ready.clear();
+    ready.reserve(size_t(rooms));
+    readyOffset = 0;
+    nextCycleMs = 0;
+    cycleOutstanding = 0;
+    scheduler.reset();
+    due.reserve(size_t(rooms));
+    return client.open();
+}
+
+void HvacDeviceSource::close() {
+    client.close();
+}
+
+QString HvacDeviceSource::description() const {
+    return QString("Установки: шлюз %1, %2 установок, опрос %3 мс, спокойных - до раза в %4 циклов")
+        .arg(client.description()).arg(rooms).arg(pollMs).arg(scheduler.maxIntervalTicks());
+}
+
+SensorSource::PollingStats HvacDeviceSource::pollingStats() const {
+    PollingStats stats;
+    stats.requests = requestCount.load(std::memory_order_relaxed);
+    stats.fixedRateRequests = fixedRateRequestCount.load(std::memory_order_relaxed);
+    stats.rooms = polledRoomCount.load(std::memory_order_relaxed);
+    stats.fixedRateRooms = fixedRateRoomCount.load(std::memory_order_relaxed);
+    return stats;
+}
+
+/**
+ * @brief Шаг потока приёма: команды записи, начало цикла опроса, ввод-вывод, выдача измерений.
+ */
+int HvacDeviceSource::read(SensorSample *buffer, int maxCount) {
+    commands.consume(CommandCapacity, [this](const Command *items, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            const Command &command = items[i];
+            if (command.reg == AlarmCommand) {
+                scheduler.setAlarmed(command.roomId, command.value != 0);
+                continue;
+            }
+            const HvacProtocol::Register reg = HvacProtocol::Register(command.reg);
+            client.writeRegister(HvacProtocol::unitRegister(command.roomId, reg), command.value, nullptr);
+            if (reg == HvacProtocol::Setpoint)
+                scheduler.expedite(command.roomId);
+        }
+    });
+
+    const qint64 now = monotonicMs();
+    if (now >= nextCycleMs) {
+        if (cycleOutstanding == 0) {
+            startCycle(now);
+        } else if (pollMs > 0) {
+            ++overrunCount;
+            nextCycleMs += pollMs;
+        }
+    }
+
+    if (readyOffset >= ready.size()) {
+        ready.clear();
+        readyOffset = 0;
+        // Ждём ответов, а между циклами - не дольше, чем до начала следующего
+        const int timeout = cycleOutstanding > 0 ? PollTimeoutMs
+                : int(std::clamp<qint64>(nextCycleMs - now, 0, PollTimeoutMs));
+        client.process(timeout);
+    }
+
+    const int count = int(std::min<size_t>(size_t(std::max(maxCount, 0)), ready.size() - readyOffset));
+    std::copy_n(ready.data() + readyOffset, count, buffer);
+    readyOffset += size_t(count);
+    return count;
+}
+
+/**
+ * @brief Ставит в очередь чтение установок, которым пора по расписанию.
+ *
+ * Установки идут по возрастанию номера; запрос начинается с первой ещё не
+ * прочитанной и захватывает все, что попадают в следующие UnitsPerRead
+ * номеров. Промежуточные установки, которым не пора, читаются заодно,
+ * но не выдаются и не меняют своего расписания.
+ */
+void HvacDeviceSource::startCycle(qint64 nowMs) {
+    cycleStartNs = Profiler::now();
+    nextCycleMs += pollMs;
+    if (nextCycleMs <= nowMs)
+        nextCycleMs = nowMs + pollMs;  // после долгой паузы не догоняем пропущенные циклы
+
+    scheduler.advance(due);
+    quint64 requests = 0;
+    for (size_t i = 0; i < due.size();) {
+        const int firstUnit = due[i];
+        size_t end = i + 1;
+        while (end < due.size() && due[end] - firstUnit < HvacProtocol::UnitsPerRead)
+            ++end;
+        const int units = due[end - 1] - firstUnit + 1;
+        i = end;
+
+        ++cycleOutstanding;
+        ++requests;
+        client.readRegisters(HvacProtocol::unitRegister(firstUnit, HvacProtocol::Temperature),
+                             quint16(units * HvacProtocol::RegistersPerUnit),
+                             [this, firstUnit, units](const quint16 *registers, int count) {
+            unitsRead(firstUnit, units, registers, count);
+        });
+    }
+
+    const quint64 fixedRateRequests = quint64((rooms + HvacProtocol::UnitsPerRead - 1) / HvacProtocol::UnitsPerRead);
+    requestCount.store(requestCount.load(std::memory_order_relaxed) + requests, std::memory_order_relaxed);
+    fixedRateRequestCount.store(fixedRateRequestCount.load(std::memory_order_relaxed) + fixedRateRequests,
+                                std::memory_order_relaxed);
+    polledRoomCount.store(scheduler.polledRooms(), std::memory_order_relaxed);
+    fixedRateRoomCount.store(scheduler.fixedRatePolls(), std::memory_order_relaxed);
+    if (cycleOutstanding == 0)
+        finishCycle();  // всем установкам ещё рано
+}
+
+void HvacDeviceSource::finishCycle() {
+    ++cycleCount;
+    CLIMATE_PROFILE_RECORD(DevicePollCycle, Profiler::now() - cycleStartNs);
+}
+
+/**
+ * @brief Разбирает ответ на чтение установок [firstUnit, firstUnit + units) и ставит их в расписание.
+ *
+ * Установки не на связи пропускаются с прежним периодом; при ошибке запроса
+ * (или неполном ответе) непрочитанные установки повторяются в следующем цикле.
+ */
+void HvacDeviceSource::unitsRead(int firstUnit, int units, const quint16 *registers, int count) {
+    --cycleOutstanding;
+    if (registers) {
+        const qint64 timestampMs = QDateTime::currentMSecsSinceEpoch();
+        for (int offset = 0; offset + HvacProtocol::RegistersPerUnit <= count; offset += HvacProtocol::RegistersPerUnit) {
+            const int roomId = firstUnit + offset / HvacProtocol::RegistersPerUnit;
+            if (roomId >= rooms || scheduler.isScheduled(roomId))
+                continue;  // прочитана заодно с соседями
+            const quint16 *unit = registers + offset;
+            if (!(unit[HvacProtocol::Status] & HvacProtocol::StatusOnline)) {
+                scheduler.postpone(roomId);
+                continue;
+            }
+            SensorSample sample;
+            sample.timestampMs = timestampMs;
+            sample.roomId = roomId;
+            sample.reserved = 0;
+            sample.temperature = qint16(unit[HvacProtocol::Temperature]) / HvacProtocol::TemperatureScale;
+            sample.humidity = unit[HvacProtocol::Humidity] / HvacProtocol::HumidityScale;
+            sample.pressure = double((quint32(unit[HvacProtocol::PressureHigh]) << 16) | unit[HvacProtocol::PressureLow])
+                              / HvacProtocol::PressureScale;
+            ready.push_back(sample);
+            scheduler.complete(roomId, sample.temperature, sample.humidity,
+                               qint16(unit[HvacProtocol::Setpoint]) / HvacProtocol::TemperatureScale);
+        }
+    }
+    for (int roomId = firstUnit; roomId < firstUnit + units; ++roomId)
+        scheduler.retry(roomId);  // ставит только установки, оставшиеся без ответа
+    if (cycleOutstanding == 0)
+        finishCycle();
+}
+
+bool HvacDeviceSource::pushCommand(int roomId, quint16 reg, quint16 value) {
+    if (roomId < 0 || roomId >= rooms)
+        return false;
+    const Command command{roomId, reg, value};
+    return commands.push(&command, 1) == 1;
+}
+
+bool HvacDeviceSource::writeSetpoint(int roomId, double celsius) {
+    const double scaled = std::clamp(std::round(celsius * HvacProtocol::TemperatureScale), -32768.0, 32767.0);
+    return pushCommand(roomId, HvacProtocol::Setpoint, quint16(qint16(scaled)));
+}
+
+bool HvacDeviceSource::writeAirflow(int roomId, AirflowDirection direction) {
+    return pushCommand(roomId, HvacProtocol::Airflow, quint16(direction));
+}
+
+bool HvacDeviceSource::setRoomAlarmed(int roomId, bool active) {
+    return pushCommand(roomId, AlarmCommand, active ? 1 : 0);
+}
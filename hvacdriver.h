@@ -0,0 +1,186 @@
+#ifndef HVACDRIVER_H
+#define HVACDRIVER_H
+
+#include <QString>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "hvacprotocol.h"
+#include "samplingscheduler.h"
+#include "sensoringestion.h"
+#include "spscringbuffer.h"
+
+/**
+ * @brief Неблокирующий клиент шлюза климатических установок (см. hvacprotocol.h).
+ *
+ * Держит несколько TCP-соединений к одному шлюзу и до MaxInFlight
+ * неотвеченных запросов в каждом: запросы не ждут ответа на предыдущий,
+ * а ответы сопоставляются по номеру транзакции. Запросы берутся из общей
+ * очереди тем соединением, у которого есть свободное место, поэтому
+ * нагрузка распределяется сама. Запись уставок идёт отдельной очередью
+ * впереди чтения, чтобы не стоять за циклом опроса.
+ *
+ * Весь ввод-вывод выполняет process() в вызывающем потоке: один poll()
+ * по всем соединениям, отправка, приём и вызов обработчиков завершения.
+ * Обработчик вызывается ровно один раз: с данными, либо с ошибкой при
+ * ответе-исключении, разрыве соединения или через RequestTimeoutMs после
+ * постановки в очередь.
+ * Разорванное соединение переподключается через ReconnectIntervalMs.
+ */
+class HvacClient {
+public:
+    using ReadHandler = std::function<void(const quint16 *registers, int count)>; ///< registers == nullptr - ошибка
+    using WriteHandler = std::function<void(bool ok)>;
+
+    static constexpr int MaxConnections = 16;
+    static constexpr int MaxInFlight = 64;    ///< На соединение; делит 65536, чтобы номера транзакций не сбивались при переполнении
+    static constexpr int RequestTimeoutMs = 2000;
+    static constexpr int ReconnectIntervalMs = 1000;
+
+    HvacClient(const QString &host, quint16 port, int connectionCount);
+    ~HvacClient();
+    HvacClient(const HvacClient &) = delete;
+    HvacClient &operator=(const HvacClient &) = delete;
+
+    bool open();                     ///< Разрешает адрес и начинает подключение всех соединений
+    void close();                    ///< Закрывает соединения, неотвеченные запросы завершаются ошибкой
+
+    void readRegisters(quint16 start, quint16 count, ReadHandler handler);
+    void writeRegister(quint16 address, quint16 value, WriteHandler handler);
+    int process(int timeoutMs);      ///< Один шаг ввода-вывода; возвращает число завершённых запросов
+
+    int pending() const;             ///< В очереди и без ответа
+    int connectedCount() const;
+    quint64 failedRequests() const { return failures; }
+    QString description() const;
+
+private:
+    struct Request {
+        quint8 function;
+        quint16 address;
+        quint16 countOrValue;
+        qint64 queuedMs;
+        ReadHandler onRead;
+        WriteHandler onWrite;
+    };
+
+    struct Slot {
+        Request request;
+        quint16 transaction = 0;
+        bool used = false;
+    };
+
+    struct Connection {
+        int fd = -1;
+        bool connecting = false;
+        qint64 retryAtMs = 0;
+        std::vector<quint8> output;      ///< Закодированные, но не отправленные запросы
+        size_t outputOffset = 0;
+        std::vector<quint8> input;       ///< Принятые байты, неполный кадр остаётся в начале
+        std::vector<Slot> window;        ///< Индекс - номер транзакции по модулю MaxInFlight
+        int inFlight = 0;
+        quint16 nextTransaction = 0;
+    };
+
+    void connectSocket(Connection &connection, qint64 nowMs);
+    void dropConnection(Connection &connection, qint64 nowMs, bool lost = true);
+    void dispatch(Connection &connection);
+    bool flush(Connection &connection);
+    bool receive(Connection &connection);
+    bool handleFrame(Connection &connection, const quint8 *frame, int size);
+    void finish(Request &request, const quint16 *registers, bool ok);
+    void expire(Connection &connection, qint64 nowMs);
+    void expireQueue(std::deque<Request> &queue, qint64 nowMs);
+
+    QString host;
+    quint16 port;
+    std::vector<Connection> connections;
+    std::vector<quint8> address;             ///< sockaddr разрешённого адреса
+    std::deque<Request> writeQueue;          ///< Запись, отправляется первой
+    std::deque<Request> readQueue;
+    int completedInStep = 0;
+    quint64 failures = 0;
+};
+
+/**
+ * @brief Источник измерений от климатических установок через HvacClient.
+ *
+ * Комната roomId - установка с тем же номером за шлюзом. Раз в
+ * pollIntervalMs начинается цикл опроса: SamplingScheduler выбирает
+ * установки, которым пора, и соседние из них читаются одним запросом
+ * длиной не больше HvacProtocol::UnitsPerRead установок. Спокойные
+ * установки опрашиваются реже, до раза в maxIntervalTicks циклов;
+ * maxIntervalTicks = 1 - опрос всех установок каждый цикл. Запросы цикла
+ * идут в соединения сразу, без ожидания ответов, поэтому опрос тысяч
+ * установок выполняется одним потоком приёма за время порядка нескольких
+ * сетевых задержек. Новый цикл не начинается, пока не завершён предыдущий:
+ * опоздавший цикл учитывается в cycleOverruns(), а не накапливает очередь.
+ * Экономия опроса против постоянной частоты - в pollingStats().
+ *
+ * Уставки и направление воздуха из интерфейса передаются в поток приёма
+ * через SpscRingBuffer и отправляются на установки на ближайшем шаге read();
+ * после записи уставки установка опрашивается в ближайшем цикле. Тем же
+ * путём приходит состояние тревог (setRoomAlarmed()).
+ */
+class HvacDeviceSource : public SensorSource {
+public:
+    static constexpr int DefaultConnections = 4;
+    static constexpr int DefaultPollIntervalMs = 1000;
+    static constexpr int PollTimeoutMs = 20;
+    static constexpr size_t CommandCapacity = 1 << 14;
+
+    HvacDeviceSource(const QString &host, quint16 port, int roomCount,
+                     int connections = DefaultConnections, int pollIntervalMs = DefaultPollIntervalMs,
+                     int maxIntervalTicks = SamplingScheduler::DefaultMaxIntervalTicks);
+    ~HvacDeviceSource() override;
+
+    bool open() override;
+    int read(SensorSample *buffer, int maxCount) override;
+    void close() override;
+    QString description() const override;
+    bool writeSetpoint(int roomId, double celsius) override;
+    bool writeAirflow(int roomId, AirflowDirection direction) override;
+    bool setRoomAlarmed(int roomId, bool active) override;
+    PollingStats pollingStats() const override;
+
+    quint64 cycles() const { return cycleCount; }
+    quint64 cycleOverruns() const { return overrunCount; }
+    quint64 failedRequests() const { return client.failedRequests(); }
+
+private:
+    /// Команда записи из потока интерфейса
+    struct Command {
+        qint32 roomId;
+        quint16 reg;        ///< Регистр установки или AlarmCommand
+        quint16 value;
+    };
+
+    static constexpr quint16 AlarmCommand = 0xffff; ///< Не регистр: состояние тревоги комнаты для расписания
+
+    void startCycle(qint64 nowMs);
+    void finishCycle();
+    void unitsRead(int firstUnit, int units, const quint16 *registers, int count);
+    bool pushCommand(int roomId, quint16 reg, quint16 value);
+
+    HvacClient client;
+    int rooms;
+    int pollMs;
+    qint64 nextCycleMs = 0;
+    qint64 cycleStartNs = 0;
+    int cycleOutstanding = 0;
+    quint64 cycleCount = 0;
+    quint64 overrunCount = 0;
+    SamplingScheduler scheduler;
+    std::vector<int> due;                ///< Установки текущего цикла
+    std::atomic<quint64> requestCount{0};  ///< Счётчики pollingStats(), пишет только поток приёма
+    std::atomic<quint64> fixedRateRequestCount{0};
+    std::atomic<quint64> polledRoomCount{0};
+    std::atomic<quint64> fixedRateRoomCount{0};
+    std::vector<SensorSample> ready;     ///< Разобранные измерения, ещё не отданные read()
+    size_t readyOffset = 0;
+    SpscRingBuffer<Command> commands;
+};
+
+#endif // HVACDRIVER_H
@@ -0,0 +1,113 @@
+#ifndef HVACPROTOCOL_H
+#define HVACPROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Протокол климатических установок в духе Modbus-TCP.
+ *
+ * Кадр - заголовок MBAP (номер транзакции, идентификатор протокола 0,
+ * длина остатка кадра, номер устройства) и PDU с кодом функции.
+ * Поддерживаются чтение регистров хранения (0x03) и запись одного
+ * регистра (0x06); ошибка возвращается кодом функции с битом 0x80.
+ * Номер транзакции позволяет держать в соединении много запросов
+ * сразу и сопоставлять ответы с запросами.
+ *
+ * Установки шлюза занимают подряд по RegistersPerUnit регистров, поэтому
+ * один запрос чтения до MaxReadRegisters регистров возвращает состояние
+ * UnitsPerRead установок. Заголовок не зависит от Qt и используется
+ * и ядром (HvacClient), и имитатором установок (tools/hvacsim).
+ */
+namespace HvacProtocol {
+constexpr std::uint16_t DefaultPort = 1502;
+constexpr int HeaderBytes = 7;             ///< MBAP: транзакция, протокол, длина, устройство
+constexpr int MaxFrameBytes = HeaderBytes + 253;
+constexpr int MaxReadRegisters = 125;
+constexpr int RegistersPerUnit = 8;
+constexpr int UnitsPerRead = MaxReadRegisters / RegistersPerUnit;
+constexpr int MaxUnits = 65536 / RegistersPerUnit;
+constexpr std::uint8_t GatewayUnit = 1;    ///< Номер устройства в MBAP: все установки за одним шлюзом
+
+/// Регистры установки, смещение от unit * RegistersPerUnit
+enum Register : std::uint16_t {
+    Temperature = 0,   ///< int16, 0.01 °C
+    Humidity,          ///< uint16, 0.01 %
+    PressureHigh,      ///< uint32 по двум регистрам, 0.1 Па
+    PressureLow,
+    Setpoint,          ///< int16, 0.01 °C, запись
+    Airflow,           ///< AirflowDirection, запись
+    Output,            ///< int16, 0.001 мощности установки
+    Status             ///< Бит StatusOnline - установка на связи
+};
+
+enum Function : std::uint8_t {
+    ReadHoldingRegisters = 0x03,
+    WriteSingleRegister = 0x06,
+    ExceptionFlag = 0x80
+};
+
+enum ExceptionCode : std::uint8_t {
+    IllegalFunction = 0x01,
+    IllegalAddress = 0x02,
+    IllegalValue = 0x03
+};
+
+constexpr std::uint16_t StatusOnline = 0x1;
+constexpr double TemperatureScale = 100.0;
+constexpr double HumidityScale = 100.0;
+constexpr double PressureScale = 10.0;
+constexpr double OutputScale = 1000.0;
+
+inline std::uint16_t getU16(const std::uint8_t *data) {
+    return std::uint16_t((data[0] << 8) | data[1]);
+}
+
+inline void putU16(std::uint8_t *data, std::uint16_t value) {
+    data[0] = std::uint8_t(value >> 8);
+    data[1] = std::uint8_t(value);
+}
+
+inline std::uint16_t unitRegister(int unit, Register reg) {
+    return std::uint16_t(unit * RegistersPerUnit + reg);
+}
+
+/**
+ * @brief Полная длина кадра в начале буфера.
+ * @return 0, если заголовок ещё не пришёл; -1, если длина в заголовке недопустима.
+ */
+inline int frameBytes(const std::uint8_t *data, std::size_t available) {
+    if (available < std::size_t(HeaderBytes))
+        return 0;
+    const int length = getU16(data + 4);
+    if (length < 2 || HeaderBytes - 1 + length > MaxFrameBytes)
+        return -1;
+    return HeaderBytes - 1 + length;
+}
+
+/// Заголовок MBAP для PDU длиной pduBytes
+inline void putHeader(std::uint8_t *out, std::uint16_t transaction, int pduBytes) {
+    putU16(out, transaction);
+    putU16(out + 2, 0);
+    putU16(out + 4, std::uint16_t(pduBytes + 1));
+    out[6] = GatewayUnit;
+}
+
+inline std::size_t encodeRead(std::uint8_t *out, std::uint16_t transaction, std::uint16_t start, std::uint16_t count) {
+    putHeader(out, transaction, 5);
+    out[7] = ReadHoldingRegisters;
+    putU16(out + 8, start);
+    putU16(out + 10, count);
+    return HeaderBytes + 5;
+}
+
+inline std::size_t encodeWrite(std::uint8_t *out, std::uint16_t transaction, std::uint16_t address, std::uint16_t value) {
+    putHeader(out, transaction, 5);
+    out[7] = WriteSingleRegister;
+    putU16(out + 8, address);
+    putU16(out + 10, value);
+    return HeaderBytes + 5;
+}
+}
+
+#endif // HVACPROTOCOL_H
@@ -1,15 +1,239 @@
+#include "climateengine.h"
+#include "historyarchive.h"
+#include "profiler.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QTimer>
+#include <QDebug>
+#include <atomic>
+#include <csignal>
+#include <cstring>
+
+#ifndef CLIMATE_HEADLESS
 #include "header.h"
 #include <QApplication>
+#endif
+
+namespace {
+
+std::atomic<bool> quitRequested{false};
+
+/// Обработчик SIGINT/SIGTERM: только выставляет флаг, выход выполняет цикл событий
+void requestQuit(int) {
+    quitRequested.store(true);
+}
+
+/**
+ * @brief Описывает параметры командной строки, общие для окна и режима без интерфейса.
+ */
+struct CommandLine {
+    QCommandLineParser parser;
+    QCommandLineOption roomsOption{"rooms", "Число комнат.", "count", "3"};
+    QCommandLineOption sensorsOption{"sensors", "Источник измерений: sim[:темп], hvac:<узел>[:<порт>] или путь к файлу, каналу, Unix-сокету.", "source"};
+    QCommandLineOption simulateOption{"simulate", "Имитация здания вместо датчиков с ускорением speed (секунд имитации в секунду).", "speed"};
+    QCommandLineOption headlessOption{"headless", "Работа без интерфейса (только ядро на QtCore)."};
+    QCommandLineOption controlOption{"control", "Включить регулятор температуры при запуске в режиме --headless."};
+    QCommandLineOption recordOption{"record", "Записывать измерения, уставки и включение установки в файл.", "file"};
+    QCommandLineOption replayOption{"replay", "Воспроизвести запись вместо датчиков.", "file"};
+    QCommandLineOption replaySpeedOption{"replay-speed", "Ускорение воспроизведения (1 - реальное время, 0 - без ограничения).", "speed", "1"};
+    QCommandLineOption replayFromOption{"replay-from", "Начать воспроизведение с этой секунды записи.", "seconds", "0"};
+    QCommandLineOption shmOption{"shm", "Публиковать состояние комнат в разделяемой памяти POSIX под этим именем (например, /climate-state).", "name"};
+    QCommandLineOption controlApiOption{"control-api", "Открыть API управления: unix:<путь> или tcp:[<узел>:]<порт> (узел по умолчанию 127.0.0.1).", "address"};
+    QCommandLineOption archiveOption{"archive", "Каталог долговременного архива измерений (создаётся при необходимости).", "directory"};
+    QCommandLineOption exportOption{"export", "Выгрузить архив --archive в файл и выйти (в режиме --headless).", "file"};
+    QCommandLineOption exportFormatOption{"export-format", "Формат выгрузки: csv или columnar.", "format", "csv"};
+    QCommandLineOption alarmsOption{"alarms", "Файл правил тревог, см. AlarmEngine::parseRules().", "file"};
+    QCommandLineOption profileOption{"profile", "Сохранить замеры горячих участков в файл при выходе из режима --headless.", "file"};
+    QCommandLineOption metricsOption{"metrics-interval", "Период вывода счётчиков в режиме --headless, с (0 - не выводить).", "seconds", "10"};
+
+    explicit CommandLine(const QCoreApplication &app) {
+        parser.addHelpOption();
+        parser.addOption(roomsOption);
+        parser.addOption(sensorsOption);
+        parser.addOption(simulateOption);
+        parser.addOption(headlessOption);
+        parser.addOption(controlOption);
+        parser.addOption(metricsOption);
+        parser.addOption(alarmsOption);
+        parser.addOption(recordOption);
+        parser.addOption(replayOption);
+        parser.addOption(replaySpeedOption);
+        parser.addOption(replayFromOption);
+        parser.addOption(shmOption);
+        parser.addOption(controlApiOption);
+        parser.addOption(archiveOption);
+        parser.addOption(exportOption);
+        parser.addOption(exportFormatOption);
+        parser.addOption(profileOption);
+        parser.process(app);
+    }
+};
+
+/// Ищет --headless до создания приложения: от него зависит, нужен ли QApplication
+bool headlessRequested(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--headless") == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Выгружает весь архив в файл без запуска ядра.
+ */
+int exportArchive(const CommandLine &commandLine) {
+    const QString format = commandLine.parser.value(commandLine.exportFormatOption);
+    if (format != QLatin1String("csv") && format != QLatin1String("columnar")) {
+        qWarning() << "Неизвестный формат выгрузки:" << format;
+        return 1;
+    }
+    HistoryArchive archive;
+    if (!archive.open(commandLine.parser.value(commandLine.archiveOption)))
+        return 1;
+    QFile file(commandLine.parser.value(commandLine.exportOption));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Не удалось создать файл выгрузки" << file.fileName() << ":" << file.errorString();
+        return 1;
+    }
+    const bool ok = format == QLatin1String("csv") ? archive.exportCsv(&file) : archive.exportColumnar(&file);
+    qInfo() << "Выгружено точек:" << archive.pointCount() << "блоков:" << archive.chunkCount()
+            << "архив:" << archive.fileBytes() << "байт, выгрузка:" << file.size() << "байт";
+    return ok ? 0 : 1;
+}
+
+/**
+ * @brief Запуск ядра без интерфейса.
+ *
+ * Состояние восстанавливается из снимка и сохраняется периодически и при
+ * завершении по SIGINT/SIGTERM. Если источник измерений закончился
+ * (например, прочитан файл), программа тоже завершается.
+ */
+int runHeadless(QCoreApplication &app) {
+    CommandLine commandLine(app);
+    if (commandLine.parser.isSet(commandLine.exportOption)) {
+        if (!commandLine.parser.isSet(commandLine.archiveOption)) {
+            qWarning() << "Для --export нужен каталог архива --archive";
+            return 1;
+        }
+        return exportArchive(commandLine);
+    }
+
+    ClimateEngine engine;
+    engine.loadSnapshot();
+    if (commandLine.parser.isSet(commandLine.roomsOption))
+        engine.setRoomCount(commandLine.parser.value(commandLine.roomsOption).toInt());
+    engine.setSystemEnabled(engine.settings().systemState || commandLine.parser.isSet(commandLine.controlOption));
+    engine.startAutosave();
+
+    if (commandLine.parser.isSet(commandLine.alarmsOption)
+        && !engine.alarms()->loadRules(commandLine.parser.value(commandLine.alarmsOption)))
+        return 1;
+    QObject::connect(engine.alarms(), &AlarmEngine::eventsReady, &engine, [&engine]() {
+        for (const AlarmEvent &event : engine.alarms()->lastEvents())
+            qInfo().noquote() << AlarmEngine::describe(event);
+    });
+
+    if (commandLine.parser.isSet(commandLine.sensorsOption)) {
+        QObject::connect(&engine, &ClimateEngine::sensorSourceFinished, &app, &QCoreApplication::quit);
+        if (!engine.startSensorIngestion(commandLine.parser.value(commandLine.sensorsOption)))
+            return 1;
+    }
+    if (commandLine.parser.isSet(commandLine.simulateOption))
+        engine.startSimulation(commandLine.parser.value(commandLine.simulateOption).toDouble());
+    if (commandLine.parser.isSet(commandLine.recordOption)
+        && !engine.startRecording(commandLine.parser.value(commandLine.recordOption)))
+        return 1;
+    if (commandLine.parser.isSet(commandLine.shmOption)
+        && !engine.startStateExport(commandLine.parser.value(commandLine.shmOption)))
+        return 1;
+    if (commandLine.parser.isSet(commandLine.archiveOption)
+        && !engine.startArchive(commandLine.parser.value(commandLine.archiveOption)))
+        return 1;
+    if (commandLine.parser.isSet(commandLine.controlApiOption)
+        && !engine.startControlApi(commandLine.parser.value(commandLine.controlApiOption)))
+        return 1;
+    if (commandLine.parser.isSet(commandLine.replayOption)) {
+        QObject::connect(&engine, &ClimateEngine::replayFinished, &app, &QCoreApplication::quit);
+        QObject::connect(&engine, &ClimateEngine::systemStateReplayed, &engine, &ClimateEngine::setSystemEnabled);
+        if (!engine.startReplay(commandLine.parser.value(commandLine.replayOption),
+                                commandLine.parser.value(commandLine.replaySpeedOption).toDouble(),
+                                qint64(commandLine.parser.value(commandLine.replayFromOption).toDouble() * 1000.0)))
+            return 1;
+    }
+
+    std::signal(SIGINT, requestQuit);
+    std::signal(SIGTERM, requestQuit);
+    QTimer quitPoll;
+    QObject::connect(&quitPoll, &QTimer::timeout, &app, [&app]() {
+        if (quitRequested.load())
+            app.quit();
+    });
+    quitPoll.start(100);
+
+    QTimer metricsTimer;
+    QObject::connect(&metricsTimer, &QTimer::timeout, &engine, [&engine]() {
+        qInfo().noquote() << engine.metricsSummary();
+    });
+    const int metricsSeconds = commandLine.parser.value(commandLine.metricsOption).toInt();
+    if (metricsSeconds > 0)
+        metricsTimer.start(metricsSeconds * 1000);
+
+    const int result = app.exec();
+    engine.stop();
+    qInfo().noquote() << engine.metricsSummary();
+    if (commandLine.parser.isSet(commandLine.profileOption)
+        && !Profiler::dumpToFile(commandLine.parser.value(commandLine.profileOption)))
+        qWarning() << "Не удалось сохранить замеры в" << commandLine.parser.value(commandLine.profileOption);
+    return result;
+}
+
+} // namespace
+
 int main(int argc, char *argv[]) {
+#ifdef CLIMATE_HEADLESS
+    // Сборка без QtGui: доступен только режим без интерфейса
+    QCoreApplication app(argc, argv);
+    return runHeadless(app);
+#else
+    if (headlessRequested(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        return runHeadless(app);
+    }
+
     // Создание приложения
     QApplication a(argc, argv);
 
+    // Параметры командной строки
+    CommandLine commandLine(a);
+
     // Создание основного окна
     MainWindow w;
+    if (commandLine.parser.isSet(commandLine.roomsOption))    // иначе остаётся число комнат из сохранённого снимка
+        w.setRoomCount(commandLine.parser.value(commandLine.roomsOption).toInt());
+    if (commandLine.parser.isSet(commandLine.alarmsOption))
+        w.loadAlarmRules(commandLine.parser.value(commandLine.alarmsOption));
+    if (commandLine.parser.isSet(commandLine.sensorsOption))
+        w.startSensorIngestion(commandLine.parser.value(commandLine.sensorsOption));
+    if (commandLine.parser.isSet(commandLine.simulateOption))
+        w.startSimulation(commandLine.parser.value(commandLine.simulateOption).toDouble());
+    if (commandLine.parser.isSet(commandLine.recordOption))
+        w.startRecording(commandLine.parser.value(commandLine.recordOption));
+    if (commandLine.parser.isSet(commandLine.shmOption))
+        w.startStateExport(commandLine.parser.value(commandLine.shmOption));
+    if (commandLine.parser.isSet(commandLine.archiveOption))
+        w.startArchive(commandLine.parser.value(commandLine.archiveOption));
+    if (commandLine.parser.isSet(commandLine.controlApiOption))
+        w.startControlApi(commandLine.parser.value(commandLine.controlApiOption));
+    if (commandLine.parser.isSet(commandLine.replayOption))
+        w.startReplay(commandLine.parser.value(commandLine.replayOption),
+                      commandLine.parser.value(commandLine.replaySpeedOption).toDouble(),
+                      qint64(commandLine.parser.value(commandLine.replayFromOption).toDouble() * 1000.0));
 
     // Отображение окна
     w.show();
 
     // Запуск основного цикла приложения
     return a.exec();
+#endif
 }
@@ -0,0 +1,54 @@
+#ifndef PARALLELFOR_H
+#define PARALLELFOR_H
+
+#include <QSemaphore>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+
+/**
+ * @brief Параллельный проход по диапазону [0, count) пачками по batchSize.
+ *
+ * Пачки раздаются через общий атомарный счётчик: каждый поток берёт
+ * следующую свободную пачку, как только закончил предыдущую, поэтому
+ * быстрые потоки забирают работу медленных без явного деления диапазона.
+ * Вызывающий поток работает наравне с помощниками из пула; помощники
+ * запускаются только на свободных потоках пула (tryStart), так что при
+ * занятом пуле проход выполняется целиком в вызывающем потоке.
+ * Возврат происходит после обработки всех пачек.
+ *
+ * @param body Вызывается как body(first, last) для полуинтервала [first, last).
+ */
+template <typename Body>
+void parallelFor(int count, int batchSize, const Body &body,
+                 QThreadPool *pool = QThreadPool::globalInstance()) {
+    if (count <= 0)
+        return;
+    batchSize = std::max(batchSize, 1);
+    const int batches = (count + batchSize - 1) / batchSize;
+
+    std::atomic<int> nextBatch{0};
+    auto run = [&]() {
+        for (int batch = nextBatch.fetch_add(1, std::memory_order_relaxed); batch < batches;
+             batch = nextBatch.fetch_add(1, std::memory_order_relaxed)) {
+            const int first = batch * batchSize;
+            body(first, std::min(first + batchSize, count));
+        }
+    };
+
+    QSemaphore finished;
+    int helpers = 0;
+    const int wanted = std::min(batches, pool->maxThreadCount()) - 1;
+    for (int i = 0; i < wanted; ++i) {
+        if (!pool->tryStart([&run, &finished]() {
+                run();
+                finished.release();
+            }))
+            break;
+        ++helpers;
+    }
+    run();
+    finished.acquire(helpers); ///< Также делает записи помощников видимыми вызывающему потоку
+}
+
+#endif // PARALLELFOR_H
@@ -0,0 +1,290 @@
+#include "profiler.h"
+
+#include <QDateTime>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Гистограммы одного потока.
+ *
+ * Пишет только поток-владелец, поэтому счётчики увеличиваются обычной парой
+ * загрузка/сохранение; атомарные типы нужны только для корректного чтения
+ * из collect().
+ */
+struct ThreadHistograms {
+    std::atomic<quint64> buckets[Profiler::ProbeCount][Profiler::BucketCount];
+    std::atomic<quint64> totalNs[Profiler::ProbeCount];
+    std::atomic<qint64> maxNs[Profiler::ProbeCount];
+};
+
+/// Гистограммы всех потоков; блоки не удаляются, чтобы замеры завершившихся потоков не терялись
+struct Registry {
+    QMutex mutex;
+    std::vector<std::unique_ptr<ThreadHistograms>> threads;
+    std::vector<quint64> baselineBuckets = std::vector<quint64>(size_t(Profiler::ProbeCount) * Profiler::BucketCount);
+    std::vector<quint64> baselineTotalNs = std::vector<quint64>(size_t(Profiler::ProbeCount));
+};
+
+Registry &registry() {
+    static Registry instance;
+    return instance;
+}
+
+thread_local ThreadHistograms *threadHistograms = nullptr;
+
+ThreadHistograms *registerThread() {
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    r.threads.emplace_back(new ThreadHistograms()); ///< Значения обнуляются инициализацией
+    return r.threads.back().get();
+}
+
+/// Суммы по всем потокам без учёта reset(); вызывается под r.mutex
+void sumThreads(const Registry &r, std::vector<quint64> &buckets, std::vector<quint64> &totalNs,
+                std::vector<qint64> &maxNs) {
+    buckets.assign(size_t(Profiler::ProbeCount) * Profiler::BucketCount, 0);
+    totalNs.assign(size_t(Profiler::ProbeCount), 0);
+    maxNs.assign(size_t(Profiler::ProbeCount), 0);
+    for (const std::unique_ptr<ThreadHistograms> &thread : r.threads) {
+        for (int probe = 0; probe < Profiler::ProbeCount; ++probe) {
+            quint64 *row = buckets.data() + size_t(probe) * Profiler::BucketCount;
+            for (int i = 0; i < Profiler::BucketCount; ++i)
+                row[i] += thread->buckets[probe][i].load(std::memory_order_relaxed);
+            totalNs[size_t(probe)] += thread->totalNs[probe].load(std::memory_order_relaxed);
+            maxNs[size_t(probe)] = std::max(maxNs[size_t(probe)], thread->maxNs[probe].load(std::memory_order_relaxed));
+        }
+    }
+}
+
+qint64 percentile(const quint64 *buckets, quint64 count, qint64 maxNs, double fraction) {
+    if (!count)
+        return 0;
+    const quint64 rank = std::max<quint64>(quint64(std::ceil(fraction * double(count))), 1);
+    quint64 seen = 0;
+    for (int i = 0; i < Profiler::BucketCount; ++i) {
+        seen += buckets[i];
+        if (seen >= rank)
+            return std::min(Profiler::bucketUpperBound(i), maxNs);
+    }
+    return maxNs;
+}
+
+QString microseconds(qint64 nanoseconds) {
+    return QString::number(double(nanoseconds) / 1000.0, 'f', 1);
+}
+
+} // namespace
+
+int Profiler::bucketIndex(qint64 nanoseconds) {
+    if (nanoseconds < SubBuckets)
+        return int(std::max<qint64>(nanoseconds, 0));
+    const int exponent = 63 - qCountLeadingZeroBits(quint64(nanoseconds));
+    if (exponent > MaxExponent)
+        return BucketCount - 1;
+    const int subBucket = int(nanoseconds >> (exponent - SubBucketBits)) & (SubBuckets - 1);
+    return (exponent - SubBucketBits + 1) * SubBuckets + subBucket;
+}
+
+qint64 Profiler::bucketUpperBound(int index) {
+    if (index < SubBuckets)
+        return index;
+    const int shift = index / SubBuckets - 1;
+    const qint64 lower = qint64(SubBuckets + index % SubBuckets) << shift;
+    return lower + (qint64(1) << shift) - 1;
+}
+
+/**
+ * @brief Записывает длительность участка в гистограмму текущего потока.
+ */
+void Profiler::record(Probe probe, qint64 nanoseconds) {
+    ThreadHistograms *local = threadHistograms;
+    if (Q_UNLIKELY(!local))
+        local = threadHistograms = registerThread();
+
+    std::atomic<quint64> &bucket = local->buckets[probe][bucketIndex(nanoseconds)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic<quint64> &total = local->totalNs[probe];
+    total.store(total.load(std::memory_order_relaxed) + quint64(std::max<qint64>(nanoseconds, 0)),
+                std::memory_order_relaxed);
+    if (nanoseconds > local->maxNs[probe].load(std::memory_order_relaxed))
+        local->maxNs[probe].store(nanoseconds, std::memory_order_relaxed);
+}
+
+QString Profiler::probeName(Probe probe) {
+    switch (probe) {
+    case UiFrame:           return QStringLiteral("Кадр интерфейса");
+    case ChangeToScreen:    return QStringLiteral("Изменение -> экран");
+    case EventLoopLag:      return QStringLiteral("Задержка цикла событий");
+    case StatusText:        return QStringLiteral("setText строки состояния");
+    case UnitConversion:    return QStringLiteral("Пересчёт единиц");
+    case SensorDrain:       return QStringLiteral("Пачка измерений");
+    case DevicePollCycle:   return QStringLiteral("Опрос установок: цикл");
+    case ControlApiDrain:   return QStringLiteral("API управления: пачка");
+    case AlarmCheck:        return QStringLiteral("Проверка тревог");
+    case DerivedMetricsUpdate: return QStringLiteral("Производные величины");
+    case ControlTick:       return QStringLiteral("Шаг регулятора");
+    case SimulationSteps:   return QStringLiteral("Шаги имитации");
+    case SnapshotSerialize: return QStringLiteral("Снимок: сборка");
+    case SnapshotWrite:     return QStringLiteral("Снимок: запись");
+    case SnapshotLoad:      return QStringLiteral("Снимок: загрузка");
+    case ArchiveSeal:       return QStringLiteral("Архив: сборка блока");
+    case XmlSave:           return QStringLiteral("settings.xml: запись");
+    case XmlLoad:           return QStringLiteral("settings.xml: чтение");
+    case TrendRefresh:      return QStringLiteral("График: обновление");
+    case TrendPaint:        return QStringLiteral("График: отрисовка");
+    case FloorPlanColors:   return QStringLiteral("План: цвета комнат");
+    case RowPaint:          return QStringLiteral("Отрисовка ячейки");
+    case ProbeCount:        break;
+    }
+    return QString();
+}
+
+QVector<Profiler::ProbeStats> Profiler::collect() {
+    std::vector<quint64> buckets;
+    std::vector<quint64> totalNs;
+    std::vector<qint64> maxNs;
+    std::vector<quint64> baselineBuckets;
+    std::vector<quint64> baselineTotalNs;
+    {
+        Registry &r = registry();
+        QMutexLocker locker(&r.mutex);
+        sumThreads(r, buckets, totalNs, maxNs);
+        baselineBuckets = r.baselineBuckets;
+        baselineTotalNs = r.baselineTotalNs;
+    }
+
+    QVector<ProbeStats> result;
+    result.reserve(ProbeCount);
+    for (int probe = 0; probe < ProbeCount; ++probe) {
+        quint64 *row = buckets.data() + size_t(probe) * BucketCount;
+        const quint64 *baseline = baselineBuckets.data() + size_t(probe) * BucketCount;
+        ProbeStats stats;
+        stats.probe = Probe(probe);
+        for (int i = 0; i < BucketCount; ++i) {
+            row[i] -= std::min(row[i], baseline[i]);
+            stats.count += row[i];
+        }
+        stats.totalNs = totalNs[size_t(probe)] - std::min(totalNs[size_t(probe)], baselineTotalNs[size_t(probe)]);
+        stats.maxNs = maxNs[size_t(probe)];
+        stats.p50Ns = percentile(row, stats.count, stats.maxNs, 0.5);
+        stats.p90Ns = percentile(row, stats.count, stats.maxNs, 0.9);
+        stats.p99Ns = percentile(row, stats.count, stats.maxNs, 0.99);
+        stats.p999Ns = percentile(row, stats.count, stats.maxNs, 0.999);
+        result.append(stats);
+    }
+    return result;
+}
+
+/**
+ * @brief Начинает замеры заново.
+ *
+ * Счётчики потоков не обнуляются (в них пишут владельцы), а запоминаются
+ * как точка отсчёта для collect(). Максимумы сбрасываются напрямую: запись,
+ * совпавшая со сбросом, может потеряться, на статистику это не влияет.
+ */
+void Profiler::reset() {
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    std::vector<qint64> maxNs;
+    sumThreads(r, r.baselineBuckets, r.baselineTotalNs, maxNs);
+    for (const std::unique_ptr<ThreadHistograms> &thread : r.threads) {
+        for (int probe = 0; probe < ProbeCount; ++probe)
+            thread->maxNs[probe].store(0, std::memory_order_relaxed);
+    }
+}
+
+QString Profiler::report() {
+    QString text = QString("%1 %2 %3 %4 %5 %6 %7 %8\n")
+                       .arg("Замер", -28)
+                       .arg("число", 10)
+                       .arg("средн., мкс", 12)
+                       .arg("p50", 10)
+                       .arg("p90", 10)
+                       .arg("p99", 10)
+                       .arg("p99.9", 10)
+                       .arg("макс.", 10);
+    for (const ProbeStats &stats : collect()) {
+        text += QString("%1 %2 %3 %4 %5 %6 %7 %8\n")
+                    .arg(probeName(stats.probe), -28)
+                    .arg(stats.count, 10)
+                    .arg(stats.averageNs() / 1000.0, 12, 'f', 1)
+                    .arg(microseconds(stats.p50Ns), 10)
+                    .arg(microseconds(stats.p90Ns), 10)
+                    .arg(microseconds(stats.p99Ns), 10)
+                    .arg(microseconds(stats.p999Ns), 10)
+                    .arg(microseconds(stats.maxNs), 10);
+    }
+    return text;
+}
+
+/**
+ * @brief Сохраняет таблицу замеров и ненулевые интервалы гистограмм в текстовый файл.
+ */
+bool Profiler::dumpToFile(const QString &path) {
+    QString text = QString("# Замеры на %1\n")
+                       .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss"));
+    text += report();
+
+    std::vector<quint64> buckets;
+    std::vector<quint64> totalNs;
+    std::vector<qint64> maxNs;
+    std::vector<quint64> baselineBuckets;
+    {
+        Registry &r = registry();
+        QMutexLocker locker(&r.mutex);
+        sumThreads(r, buckets, totalNs, maxNs);
+        baselineBuckets = r.baselineBuckets;
+    }
+    text += "\n# Гистограммы: замер;верхняя граница интервала, нс;число\n";
+    for (int probe = 0; probe < ProbeCount; ++probe) {
+        for (int i = 0; i < BucketCount; ++i) {
+            const size_t index = size_t(probe) * BucketCount + size_t(i);
+            const quint64 count = buckets[index] - std::min(buckets[index], baselineBuckets[index]);
+            if (count)
+                text += QString("%1;%2;%3\n").arg(probeName(Probe(probe))).arg(bucketUpperBound(i)).arg(count);
+        }
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    file.write(text.toUtf8());
+    return file.commit();
+}
+
+/**
+ * @brief Конструктор наблюдателя; замеры начинаются после start().
+ */
+EventLoopMonitor::EventLoopMonitor(QObject *parent)
+    : QObject(parent)
+{
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
+    connect(&timer, &QTimer::timeout, this, &EventLoopMonitor::onTimer);
+}
+
+void EventLoopMonitor::start(int intervalMs) {
+#ifndef CLIMATE_NO_PROFILING
+    timer.setInterval(std::max(intervalMs, 1));
+    clock.start();
+    expectedNs = qint64(timer.interval()) * 1000000;
+    timer.start();
+#else
+    Q_UNUSED(intervalMs);
+#endif
+}
+
+void EventLoopMonitor::onTimer() {
+    const qint64 nowNs = clock.nsecsElapsed();
+    CLIMATE_PROFILE_RECORD(EventLoopLag, std::max<qint64>(nowNs - expectedNs, 0));
+    expectedNs = nowNs + qint64(timer.interval()) * 1000000;
+    timer.start();
+}
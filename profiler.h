@@ -0,0 +1,150 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+#include <QElapsedTimer>
+#include <chrono>
+
+/**
+ * @brief Встроенные замеры времени горячих участков.
+ *
+ * Участок отмечается макросом CLIMATE_PROFILE_SCOPE(Замер) в начале блока:
+ * время от макроса до конца блока записывается в гистограмму замера.
+ * Гистограммы логарифмически-линейные (как HDR): значения группируются по
+ * степени двойки, каждая степень делится на SubBuckets равных частей, поэтому
+ * относительная погрешность не превышает 1/SubBuckets при любом масштабе
+ * от наносекунд до часа.
+ *
+ * У каждого потока свой набор гистограмм, в который пишет только он сам:
+ * запись - несколько обычных загрузок и сохранений без блокировок и
+ * атомарных read-modify-write операций. Чтение (collect()) суммирует
+ * гистограммы всех потоков и может идти параллельно с записью.
+ *
+ * При сборке с CLIMATE_NO_PROFILING макрос раскрывается в пустую инструкцию.
+ */
+class Profiler {
+public:
+    /// Замеряемые участки; названия см. probeName()
+    enum Probe {
+        UiFrame,            ///< Публикация кадра UiUpdateScheduler
+        ChangeToScreen,     ///< От первого изменения в кадре до его публикации
+        EventLoopLag,       ///< Опоздание таймера цикла событий
+        StatusText,         ///< setText строки состояния
+        UnitConversion,     ///< Пересчёт единиц в модели комнат
+        SensorDrain,        ///< Применение пачки измерений датчиков
+        DevicePollCycle,    ///< Цикл опроса всех климатических установок
+        ControlApiDrain,    ///< Выполнение пачки команд API управления
+        AlarmCheck,         ///< Проверка пачки измерений по правилам тревог
+        DerivedMetricsUpdate, ///< Пересчёт точки росы и других производных величин
+        ControlTick,        ///< Шаг регулятора
+        SimulationSteps,    ///< Шаги имитации здания за одну публикацию
+        SnapshotSerialize,
+        SnapshotWrite,
+        SnapshotLoad,
+        ArchiveSeal,        ///< Сборка блока архива истории
+        XmlSave,
+        XmlLoad,
+        TrendRefresh,       ///< Подтягивание новых данных графика
+        TrendPaint,
+        FloorPlanColors,    ///< Пересчёт цветов комнат плана этажей
+        RowPaint,           ///< Отрисовка ячейки списка комнат
+        ProbeCount
+    };
+
+    static constexpr int SubBucketBits = 3;
+    static constexpr int SubBuckets = 1 << SubBucketBits;
+    static constexpr int MaxExponent = 42;   ///< 2^42 нс - больше часа, большие значения попадают в последний интервал
+    static constexpr int BucketCount = (MaxExponent - 1) * SubBuckets;
+
+    /// Сводка замера по всем потокам, время в наносекундах
+    struct ProbeStats {
+        Probe probe;
+        quint64 count = 0;
+        quint64 totalNs = 0;
+        qint64 maxNs = 0;
+        qint64 p50Ns = 0;
+        qint64 p90Ns = 0;
+        qint64 p99Ns = 0;
+        qint64 p999Ns = 0;
+
+        double averageNs() const { return count ? double(totalNs) / double(count) : 0.0; }
+    };
+
+    static qint64 now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static void record(Probe probe, qint64 nanoseconds);
+    static QString probeName(Probe probe);
+
+    static QVector<ProbeStats> collect(); ///< Все замеры с момента последнего reset(), включая пустые
+    static void reset();
+    static QString report();              ///< Таблица замеров в текстовом виде
+    static bool dumpToFile(const QString &path);
+
+    static int bucketIndex(qint64 nanoseconds);
+    static qint64 bucketUpperBound(int index); ///< Наибольшее значение, попадающее в интервал
+};
+
+/**
+ * @brief Замер времени жизни объекта, см. CLIMATE_PROFILE_SCOPE.
+ */
+class ProfileScope {
+public:
+    explicit ProfileScope(Profiler::Probe probe)
+        : probe(probe), startNs(Profiler::now())
+    {
+    }
+    ~ProfileScope() { Profiler::record(probe, Profiler::now() - startNs); }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    Profiler::Probe probe;
+    qint64 startNs;
+};
+
+#define CLIMATE_PROFILE_CONCAT_(a, b) a##b
+#define CLIMATE_PROFILE_CONCAT(a, b) CLIMATE_PROFILE_CONCAT_(a, b)
+
+#ifdef CLIMATE_NO_PROFILING
+#define CLIMATE_PROFILE_SCOPE(probe) ((void)0)
+#define CLIMATE_PROFILE_RECORD(probe, nanoseconds) ((void)0)
+#else
+#define CLIMATE_PROFILE_SCOPE(probe) \
+    const ProfileScope CLIMATE_PROFILE_CONCAT(profileScope_, __LINE__)(Profiler::probe)
+#define CLIMATE_PROFILE_RECORD(probe, nanoseconds) Profiler::record(Profiler::probe, (nanoseconds))
+#endif
+
+/**
+ * @brief Следит за задержками цикла событий своего потока.
+ *
+ * Таймер с коротким периодом отмечает, насколько позже срока он сработал;
+ * опоздание пишется в замер EventLoopLag. Большие значения означают, что
+ * поток был занят обработкой чего-то другого.
+ */
+class EventLoopMonitor : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultIntervalMs = 10;
+
+    explicit EventLoopMonitor(QObject *parent = nullptr);
+    void start(int intervalMs = DefaultIntervalMs);
+    void stop() { timer.stop(); }
+
+private slots:
+    void onTimer();
+
+private:
+    QTimer timer;
+    QElapsedTimer clock;
+    qint64 expectedNs = 0;
+};
+
+#endif // PROFILER_H
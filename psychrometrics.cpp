@@ -0,0 +1,260 @@
+#include "psychrometrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define CLIMATE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+using namespace Psychrometrics;
+
+namespace {
+
+constexpr double Log2e = 1.4426950408889634;
+constexpr double Ln2Hi = 6.93147180369123816490e-01;   ///< Старшие биты ln 2, n * Ln2Hi точно для |n| < 2^11
+constexpr double Ln2Lo = 1.90821492927058770002e-10;
+constexpr double Sqrt2 = 1.4142135623730951;
+constexpr double ExpLimit = 708.0;
+constexpr double Two52 = 4503599627370496.0;
+constexpr double RoundMagic = 1.5 * Two52;                 ///< (v + RoundMagic) - RoundMagic - ближайшее целое к v при |v| < 2^51
+constexpr double ExponentMagic = Two52 + 1023.0;         ///< В младших битах суммы n + ExponentMagic - смещённый порядок
+
+constexpr std::uint64_t Two52Bits = 0x4330000000000000ULL;
+constexpr std::uint64_t MantissaMask = 0x000FFFFFFFFFFFFFULL;
+constexpr std::uint64_t OneBits = 0x3FF0000000000000ULL;
+
+/// Ряд Тейлора exp(r) при |r| <= ln2 / 2, коэффициенты 1/k! от k = 13; отброшенный член меньше 2e-17
+constexpr double ExpC[] = {
+    1.0 / 6227020800.0, 1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0, 1.0 / 362880.0, 1.0 / 40320.0, 1.0 / 5040.0, 1.0 / 720.0,
+    1.0 / 120.0, 1.0 / 24.0, 1.0 / 6.0, 0.5, 1.0, 1.0
+};
+
+/// log(m) = 2 atanh(s), s = (m - 1) / (m + 1), |s| <= 0.1716: коэффициенты 2/k при s^k от k = 19
+constexpr double LogC[] = {2.0 / 19.0, 2.0 / 17.0, 2.0 / 15.0, 2.0 / 13.0, 2.0 / 11.0, 2.0 / 9.0, 2.0 / 7.0, 2.0 / 5.0, 2.0 / 3.0};
+
+/// Регрессия Ротфуса (°F, %)
+constexpr double HeatC[] = {-42.379, 2.04901523, 10.14333127, -0.22475541, -6.83783e-3, -5.481717e-2,
+                            1.22874e-3, 8.5282e-4, -1.99e-6};
+
+inline std::uint64_t doubleBits(double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline double bitsDouble(std::uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Производные величины одной комнаты.
+ *
+ * Векторный путь повторяет эти операции в том же порядке, поэтому при
+ * -ffp-contract=off результаты совпадают бит в бит.
+ */
+inline void computeRoom(double temperature, double humidity, double pressure, size_t i, PsychrometricColumns out) {
+    const double t = std::min(std::max(temperature, MinTemperature), MaxTemperature);
+    const double rh = std::min(std::max(humidity, MinHumidity), 100.0);
+    const double a = MagnusB * t / (MagnusC + t);
+    const double vapor = MagnusA * fastExp(a) * (rh * 0.01);
+    const double gamma = fastLog(rh * 0.01) + a;
+    out.dewPoint[i] = MagnusC * gamma / (MagnusB - gamma);
+    out.absoluteHumidity[i] = vapor / (WaterVaporGasConstant * (t + 273.15)) * 1000.0;
+    const double ratio = MolarMassRatio * vapor / std::max(pressure - vapor, MinDryAirPressure);
+    out.enthalpy[i] = 1.006 * t + ratio * (2501.0 + 1.86 * t);
+
+    const double f = t * 1.8 + 32.0;
+    const double simple = 0.5 * (f + 61.0 + (f - 68.0) * 1.2 + rh * 0.094);
+    const double f2 = f * f;
+    const double rh2 = rh * rh;
+    double full = HeatC[0] + HeatC[1] * f + HeatC[2] * rh + HeatC[3] * f * rh + HeatC[4] * f2 + HeatC[5] * rh2
+                  + HeatC[6] * f2 * rh + HeatC[7] * f * rh2 + HeatC[8] * f2 * rh2;
+    if (rh < 13.0 && f >= 80.0 && f <= 112.0)
+        full = full - (13.0 - rh) * 0.25 * std::sqrt((17.0 - std::fabs(f - 95.0)) / 17.0);
+    if (rh > 85.0 && f >= 80.0 && f <= 87.0)
+        full = full + (rh - 85.0) * 0.1 * ((87.0 - f) * 0.2);
+    const double index = (simple + f) * 0.5 >= 80.0 ? full : simple;
+    out.heatIndex[i] = (index - 32.0) / 1.8;
+}
+
+} // namespace
+
+/**
+ * @brief exp(x) = 2^n * exp(r): n - ближайшее целое к x / ln 2, |r| <= ln2 / 2.
+ *
+ * 2^n собирается прямо в битах порядка, exp(r) - многочлен степени 13.
+ */
+double Psychrometrics::fastExp(double x) {
+    x = std::min(std::max(x, -ExpLimit), ExpLimit);
+    const double n = (x * Log2e + RoundMagic) - RoundMagic;
+    const double r = (x - n * Ln2Hi) - n * Ln2Lo;
+    double p = ExpC[0];
+    for (size_t k = 1; k < std::size(ExpC); ++k)
+        p = p * r + ExpC[k];
+    return p * bitsDouble(doubleBits(n + ExponentMagic) << 52);
+}
+
+/**
+ * @brief log(x) = e ln 2 + log(m), m в [sqrt(1/2), sqrt(2)) - мантисса x.
+ */
+double Psychrometrics::fastLog(double x) {
+    const std::uint64_t bits = doubleBits(x);
+    double e = bitsDouble((bits >> 52) | Two52Bits) - ExponentMagic;
+    double m = bitsDouble((bits & MantissaMask) | OneBits);
+    if (m > Sqrt2) {
+        m = m * 0.5;
+        e = e + 1.0;
+    }
+    const double s = (m - 1.0) / (m + 1.0);
+    const double s2 = s * s;
+    double p = LogC[0];
+    for (size_t k = 1; k < std::size(LogC); ++k)
+        p = p * s2 + LogC[k];
+    const double logM = 2.0 * s + s * s2 * p;
+    return e * Ln2Hi + (logM + e * Ln2Lo);
+}
+
+void computePsychrometricsScalar(const double *temperature, const double *humidity, const double *pressure,
+                                 size_t count, PsychrometricColumns out) {
+    for (size_t i = 0; i < count; ++i)
+        computeRoom(temperature[i], humidity[i], pressure[i], i, out);
+}
+
+#if defined(CLIMATE_X86_SIMD) && defined(__GNUC__)
+
+namespace {
+
+#define CLIMATE_AVX2 __attribute__((target("avx2")))
+
+CLIMATE_AVX2 inline __m256d splat(double value) {
+    return _mm256_set1_pd(value);
+}
+
+CLIMATE_AVX2 inline __m256d clamp(__m256d x, double low, double high) {
+    return _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(low)), _mm256_set1_pd(high));
+}
+
+CLIMATE_AVX2 inline __m256d fastExp4(__m256d x) {
+    x = clamp(x, -ExpLimit, ExpLimit);
+    const __m256d n = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(x, _mm256_set1_pd(Log2e)), _mm256_set1_pd(RoundMagic)),
+                                    _mm256_set1_pd(RoundMagic));
+    const __m256d r = _mm256_sub_pd(_mm256_sub_pd(x, _mm256_mul_pd(n, _mm256_set1_pd(Ln2Hi))),
+                                    _mm256_mul_pd(n, _mm256_set1_pd(Ln2Lo)));
+    __m256d p = _mm256_set1_pd(ExpC[0]);
+    for (size_t k = 1; k < std::size(ExpC); ++k)
+        p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(ExpC[k]));
+    const __m256i scale = _mm256_slli_epi64(_mm256_castpd_si256(_mm256_add_pd(n, _mm256_set1_pd(ExponentMagic))), 52);
+    return _mm256_mul_pd(p, _mm256_castsi256_pd(scale));
+}
+
+CLIMATE_AVX2 inline __m256d fastLog4(__m256d x) {
+    const __m256i bits = _mm256_castpd_si256(x);
+    __m256d e = _mm256_sub_pd(
+        _mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 52), _mm256_set1_epi64x(static_cast<long long>(Two52Bits)))),
+        _mm256_set1_pd(ExponentMagic));
+    __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(static_cast<long long>(MantissaMask))),
+                                                    _mm256_set1_epi64x(static_cast<long long>(OneBits))));
+    const __m256d upper = _mm256_cmp_pd(m, _mm256_set1_pd(Sqrt2), _CMP_GT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), upper);
+    e = _mm256_blendv_pd(e, _mm256_add_pd(e, _mm256_set1_pd(1.0)), upper);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d s = _mm256_div_pd(_mm256_sub_pd(m, one), _mm256_add_pd(m, one));
+    const __m256d s2 = _mm256_mul_pd(s, s);
+    __m256d p = _mm256_set1_pd(LogC[0]);
+    for (size_t k = 1; k < std::size(LogC); ++k)
+        p = _mm256_add_pd(_mm256_mul_pd(p, s2), _mm256_set1_pd(LogC[k]));
+    const __m256d logM = _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(2.0), s), _mm256_mul_pd(_mm256_mul_pd(s, s2), p));
+    return _mm256_add_pd(_mm256_mul_pd(e, _mm256_set1_pd(Ln2Hi)),
+                         _mm256_add_pd(logM, _mm256_mul_pd(e, _mm256_set1_pd(Ln2Lo))));
+}
+
+/// AVX2: по четыре комнаты, ветви скалярного пути заменены масками
+CLIMATE_AVX2
+void computePsychrometricsAvx2(const double *temperature, const double *humidity, const double *pressure,
+                               size_t count, PsychrometricColumns out) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d t = clamp(_mm256_loadu_pd(temperature + i), MinTemperature, MaxTemperature);
+        const __m256d rh = clamp(_mm256_loadu_pd(humidity + i), MinHumidity, 100.0);
+        const __m256d p = _mm256_loadu_pd(pressure + i);
+        const __m256d a = _mm256_div_pd(_mm256_mul_pd(splat(MagnusB), t), _mm256_add_pd(splat(MagnusC), t));
+        const __m256d fraction = _mm256_mul_pd(rh, splat(0.01));
+        const __m256d vapor = _mm256_mul_pd(_mm256_mul_pd(splat(MagnusA), fastExp4(a)), fraction);
+        const __m256d gamma = _mm256_add_pd(fastLog4(fraction), a);
+        _mm256_storeu_pd(out.dewPoint + i, _mm256_div_pd(_mm256_mul_pd(splat(MagnusC), gamma), _mm256_sub_pd(splat(MagnusB), gamma)));
+        _mm256_storeu_pd(out.absoluteHumidity + i,
+                         _mm256_mul_pd(_mm256_div_pd(vapor, _mm256_mul_pd(splat(WaterVaporGasConstant), _mm256_add_pd(t, splat(273.15)))),
+                                       splat(1000.0)));
+        const __m256d ratio = _mm256_div_pd(_mm256_mul_pd(splat(MolarMassRatio), vapor),
+                                            _mm256_max_pd(_mm256_sub_pd(p, vapor), splat(MinDryAirPressure)));
+        _mm256_storeu_pd(out.enthalpy + i,
+                         _mm256_add_pd(_mm256_mul_pd(splat(1.006), t),
+                                       _mm256_mul_pd(ratio, _mm256_add_pd(splat(2501.0), _mm256_mul_pd(splat(1.86), t)))));
+
+        const __m256d f = _mm256_add_pd(_mm256_mul_pd(t, splat(1.8)), splat(32.0));
+        const __m256d simple = _mm256_mul_pd(splat(0.5), _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(f, splat(61.0)),
+                                                                                   _mm256_mul_pd(_mm256_sub_pd(f, splat(68.0)), splat(1.2))),
+                                                                     _mm256_mul_pd(rh, splat(0.094))));
+        const __m256d f2 = _mm256_mul_pd(f, f);
+        const __m256d rh2 = _mm256_mul_pd(rh, rh);
+        __m256d full = _mm256_add_pd(splat(HeatC[0]), _mm256_mul_pd(splat(HeatC[1]), f));
+        full = _mm256_add_pd(full, _mm256_mul_pd(splat(HeatC[2]), rh));
+        full = _mm256_add_pd(full, _mm256_mul_pd(_mm256_mul_pd(splat(HeatC[3]), f), rh));
+        full = _mm256_add_pd(full, _mm256_mul_pd(splat(HeatC[4]), f2));
+        full = _mm256_add_pd(full, _mm256_mul_pd(splat(HeatC[5]), rh2));
+        full = _mm256_add_pd(full, _mm256_mul_pd(_mm256_mul_pd(splat(HeatC[6]), f2), rh));
+        full = _mm256_add_pd(full, _mm256_mul_pd(_mm256_mul_pd(splat(HeatC[7]), f), rh2));
+        full = _mm256_add_pd(full, _mm256_mul_pd(_mm256_mul_pd(splat(HeatC[8]), f2), rh2));
+
+        const __m256d hot = _mm256_and_pd(_mm256_cmp_pd(f, splat(80.0), _CMP_GE_OQ), _mm256_cmp_pd(f, splat(112.0), _CMP_LE_OQ));
+        const __m256d dryMask = _mm256_and_pd(hot, _mm256_cmp_pd(rh, splat(13.0), _CMP_LT_OQ));
+        const __m256d absDistance = _mm256_andnot_pd(splat(-0.0), _mm256_sub_pd(f, splat(95.0)));
+        const __m256d dry = _mm256_mul_pd(_mm256_mul_pd(_mm256_sub_pd(splat(13.0), rh), splat(0.25)),
+                                          _mm256_sqrt_pd(_mm256_div_pd(_mm256_sub_pd(splat(17.0), absDistance), splat(17.0))));
+        full = _mm256_blendv_pd(full, _mm256_sub_pd(full, dry), dryMask);
+        const __m256d humidMask = _mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(f, splat(80.0), _CMP_GE_OQ), _mm256_cmp_pd(f, splat(87.0), _CMP_LE_OQ)),
+                                                _mm256_cmp_pd(rh, splat(85.0), _CMP_GT_OQ));
+        const __m256d humid = _mm256_mul_pd(_mm256_mul_pd(_mm256_sub_pd(rh, splat(85.0)), splat(0.1)),
+                                            _mm256_mul_pd(_mm256_sub_pd(splat(87.0), f), splat(0.2)));
+        full = _mm256_blendv_pd(full, _mm256_add_pd(full, humid), humidMask);
+        const __m256d useFull = _mm256_cmp_pd(_mm256_mul_pd(_mm256_add_pd(simple, f), splat(0.5)), splat(80.0), _CMP_GE_OQ);
+        const __m256d index = _mm256_blendv_pd(simple, full, useFull);
+        _mm256_storeu_pd(out.heatIndex + i, _mm256_div_pd(_mm256_sub_pd(index, splat(32.0)), splat(1.8)));
+    }
+    computePsychrometricsScalar(temperature + i, humidity + i, pressure + i, count - i,
+                                {out.dewPoint + i, out.absoluteHumidity + i, out.enthalpy + i, out.heatIndex + i});
+}
+
+#undef CLIMATE_AVX2
+
+bool hasAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+} // namespace
+
+void computePsychrometrics(const double *temperature, const double *humidity, const double *pressure,
+                           size_t count, PsychrometricColumns out) {
+    if (hasAvx2()) {
+        computePsychrometricsAvx2(temperature, humidity, pressure, count, out);
+        return;
+    }
+    computePsychrometricsScalar(temperature, humidity, pressure, count, out);
+}
+
+#else
+
+void computePsychrometrics(const double *temperature, const double *humidity, const double *pressure,
+                           size_t count, PsychrometricColumns out) {
+    computePsychrometricsScalar(temperature, humidity, pressure, count, out);
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef PSYCHROMETRICS_H
+#define PSYCHROMETRICS_H
+
+#include <cstddef>
+
+/**
+ * @brief Производные величины влажного воздуха по температуре, влажности и давлению.
+ *
+ * Давление насыщенного пара - формула Магнуса с коэффициентами Алдучова и
+ * Эскриджа (над водой, погрешность менее 0.4 % в диапазоне -40..50 °C):
+ *
+ *     es(T) = 610.94 * exp(17.625 * T / (T + 243.04)), Па
+ *
+ * Точка росы - обращение той же формулы, абсолютная влажность - из уравнения
+ * состояния пара, энтальпия - на килограмм сухого воздуха (ASHRAE), индекс
+ * жары - регрессия Ротфуса с поправками NWS (для прохладного воздуха - её
+ * упрощённая форма).
+ *
+ * exp и log заменены приближениями из сложений и умножений (fastExp(),
+ * fastLog()), которые векторизуются без обращения к libm. Их погрешность
+ * относительно std::exp/std::log - одна-две единицы последнего разряда
+ * double; точка росы отличается от посчитанной через libm не больше чем
+ * на 1e-13 °C, что на много порядков меньше погрешности формулы Магнуса.
+ *
+ * Температура перед расчётом ограничивается [MinTemperature, MaxTemperature],
+ * влажность - [MinHumidity, 100], чтобы нулевая влажность или пустая комната
+ * не давали бесконечностей.
+ */
+namespace Psychrometrics {
+constexpr double MagnusA = 610.94;          ///< Па
+constexpr double MagnusB = 17.625;
+constexpr double MagnusC = 243.04;          ///< °C
+constexpr double WaterVaporGasConstant = 461.5; ///< Дж/(кг·К)
+constexpr double MolarMassRatio = 0.621945; ///< Вода / сухой воздух
+constexpr double MinTemperature = -80.0;    ///< °C
+constexpr double MaxTemperature = 100.0;
+constexpr double MinHumidity = 0.01;        ///< %
+constexpr double MinDryAirPressure = 1000.0; ///< Па, нижняя граница давления сухого воздуха
+
+/// exp(x) для |x| <= 708 (за пределами - значение на границе); относительная погрешность не больше 3e-16
+double fastExp(double x);
+/// log(x) для нормализованного x > 0; относительная погрешность не больше 5e-16 (около 2 ulp)
+double fastLog(double x);
+}
+
+/// Выходные столбцы производных величин, по элементу на комнату
+struct PsychrometricColumns {
+    double *dewPoint;           ///< Точка росы, °C
+    double *absoluteHumidity;   ///< г/м³
+    double *enthalpy;           ///< кДж/кг сухого воздуха
+    double *heatIndex;          ///< Ощущаемая температура, °C
+};
+
+/**
+ * @brief Считает производные величины для столбцов комнат за один проход.
+ *
+ * Выбирает при запуске AVX2, на прочих процессорах - скалярный цикл.
+ * Оба пути выполняют одни и те же операции в одном порядке и дают побитово
+ * одинаковый результат.
+ */
+void computePsychrometrics(const double *temperature, const double *humidity, const double *pressure,
+                           size_t count, PsychrometricColumns out);
+void computePsychrometricsScalar(const double *temperature, const double *humidity, const double *pressure,
+                                 size_t count, PsychrometricColumns out);
+
+#endif // PSYCHROMETRICS_H
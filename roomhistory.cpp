@@ -0,0 +1,303 @@
+#include "roomhistory.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+/// Деление с округлением вниз и для отрицательного времени
+qint64 floorDiv(qint64 value, qint64 divisor) {
+    qint64 quotient = value / divisor;
+    if ((value % divisor != 0) && ((value < 0) != (divisor < 0)))
+        --quotient;
+    return quotient;
+}
+
+/// Ячейка кольца уровня для интервала с номером bucketId
+size_t slotOf(qint64 bucketId, int bucketCount) {
+    const qint64 slot = bucketId % bucketCount;
+    return size_t(slot < 0 ? slot + bucketCount : slot);
+}
+
+/// Слияние агрегатов в одну точку
+struct PointAccumulator {
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+    double sum = 0.0;
+    quint64 count = 0;
+
+    void add(double minimum, double maximum, double mean, quint32 n) {
+        min = std::min(min, minimum);
+        max = std::max(max, maximum);
+        sum += mean * n;
+        count += n;
+    }
+
+    HistoryPoint point(qint64 timestampMs) const {
+        return {timestampMs, min, max, sum / double(count)};
+    }
+};
+
+} // namespace
+
+/**
+ * @brief Конструктор истории.
+ * @param config Глубина сырого кольца и уровни агрегации (сортируются по возрастанию шага).
+ */
+RoomHistory::RoomHistory(const HistoryConfig &config)
+    : settings(config)
+{
+    settings.rawCapacity = std::max(settings.rawCapacity, 1);
+    std::sort(settings.tiers.begin(), settings.tiers.end(),
+              [](const HistoryConfig::Tier &a, const HistoryConfig::Tier &b) {
+                  return a.resolutionMs < b.resolutionMs;
+              });
+    for (HistoryConfig::Tier &tier : settings.tiers) {
+        tier.resolutionMs = std::max<qint64>(tier.resolutionMs, 1);
+        tier.bucketCount = std::max(tier.bucketCount, 1);
+    }
+}
+
+/**
+ * @brief Задаёт число комнат. Вся накопленная история сбрасывается.
+ */
+void RoomHistory::resize(int roomCount) {
+    rooms = std::max(roomCount, 0);
+    allocate();
+}
+
+void RoomHistory::clear() {
+    allocate();
+}
+
+void RoomHistory::allocate() {
+    const size_t rawSize = size_t(rooms) * size_t(settings.rawCapacity);
+    rawTimestamps.assign(rawSize, 0);
+    for (std::vector<float> &column : rawValues)
+        column.assign(rawSize, 0.0f);
+    rawWritten.assign(size_t(rooms), 0);
+
+    tierStorage.clear();
+    tierStorage.reserve(size_t(settings.tiers.size()));
+    for (const HistoryConfig::Tier &tier : settings.tiers) {
+        TierStorage storage;
+        storage.resolutionMs = tier.resolutionMs;
+        storage.bucketCount = tier.bucketCount;
+        const size_t size = size_t(rooms) * size_t(tier.bucketCount);
+        storage.bucketIds.assign(size, -1);
+        storage.counts.assign(size, 0);
+        for (int metric = 0; metric < MetricCount; ++metric) {
+            storage.minimum[metric].assign(size, 0.0f);
+            storage.maximum[metric].assign(size, 0.0f);
+            storage.mean[metric].assign(size, 0.0f);
+        }
+        tierStorage.push_back(std::move(storage));
+    }
+}
+
+size_t RoomHistory::bytesPerRoom() const {
+    size_t bytes = size_t(settings.rawCapacity) * (sizeof(qint64) + MetricCount * sizeof(float)) + sizeof(quint64);
+    for (const HistoryConfig::Tier &tier : settings.tiers)
+        bytes += size_t(tier.bucketCount) * (sizeof(qint64) + sizeof(quint32) + 3 * MetricCount * sizeof(float));
+    return bytes;
+}
+
+/**
+ * @brief Добавляет измерение комнаты и обновляет агрегаты всех уровней.
+ *
+ * Измерение старше самого старого хранимого интервала уровня в этот уровень не попадает.
+ */
+void RoomHistory::append(int roomId, qint64 timestampMs, double temperature, double humidity, double pressure) {
+    if (roomId < 0 || roomId >= rooms)
+        return;
+
+    const float values[MetricCount] = {float(temperature), float(humidity), float(pressure)};
+
+    const size_t rawIndex = size_t(roomId) * size_t(settings.rawCapacity)
+                            + size_t(rawWritten[roomId] % quint64(settings.rawCapacity));
+    rawTimestamps[rawIndex] = timestampMs;
+    for (int metric = 0; metric < MetricCount; ++metric)
+        rawValues[metric][rawIndex] = values[metric];
+    ++rawWritten[roomId];
+
+    for (TierStorage &tier : tierStorage) {
+        const qint64 bucketId = floorDiv(timestampMs, tier.resolutionMs);
+        const size_t index = size_t(roomId) * size_t(tier.bucketCount) + slotOf(bucketId, tier.bucketCount);
+
+        if (tier.bucketIds[index] != bucketId) {
+            if (tier.bucketIds[index] > bucketId)
+                continue; // ячейка уже занята более новым интервалом
+            tier.bucketIds[index] = bucketId;
+            tier.counts[index] = 0;
+        }
+
+        const quint32 n = ++tier.counts[index];
+        for (int metric = 0; metric < MetricCount; ++metric) {
+            const float value = values[metric];
+            if (n == 1) {
+                tier.minimum[metric][index] = value;
+                tier.maximum[metric][index] = value;
+                tier.mean[metric][index] = value;
+            } else {
+                tier.minimum[metric][index] = std::min(tier.minimum[metric][index], value);
+                tier.maximum[metric][index] = std::max(tier.maximum[metric][index], value);
+                tier.mean[metric][index] += (value - tier.mean[metric][index]) / float(n);
+            }
+        }
+    }
+}
+
+void RoomHistory::appendSamples(const SensorSample *samples, int count) {
+    for (int i = 0; i < count; ++i) {
+        const SensorSample &sample = samples[i];
+        append(sample.roomId, sample.timestampMs, sample.temperature, sample.humidity, sample.pressure);
+    }
+}
+
+qint64 RoomHistory::latestTimestamp(int roomId) const {
+    if (roomId < 0 || roomId >= rooms || rawWritten[roomId] == 0)
+        return -1;
+    const quint64 last = (rawWritten[roomId] - 1) % quint64(settings.rawCapacity);
+    return rawTimestamps[size_t(roomId) * size_t(settings.rawCapacity) + size_t(last)];
+}
+
+int RoomHistory::copyRawTail(int roomId, int maxCount, qint64 *timestamps, float *const values[MetricCount]) const {
+    if (roomId < 0 || roomId >= rooms || maxCount <= 0)
+        return 0;
+
+    const quint64 capacity = quint64(settings.rawCapacity);
+    const quint64 written = rawWritten[roomId];
+    const quint64 count = std::min({written, capacity, quint64(maxCount)});
+    const size_t base = size_t(roomId) * size_t(capacity);
+    for (quint64 i = 0; i < count; ++i) {
+        const size_t index = base + size_t((written - count + i) % capacity);
+        timestamps[i] = rawTimestamps[index];
+        for (int metric = 0; metric < MetricCount; ++metric)
+            values[metric][i] = rawValues[metric][index];
+    }
+    return int(count);
+}
+
+/**
+ * @brief Выбирает источник данных для запроса.
+ * @return Номер уровня или -1 для сырого кольца.
+ */
+int RoomHistory::chooseTier(int roomId, qint64 fromMs, qint64 toMs, int maxPoints) const {
+    const qint64 newestMs = latestTimestamp(roomId);
+    const qint64 desiredResolution = std::max<qint64>((toMs - fromMs) / maxPoints, 1);
+
+    auto covers = [&](qint64 resolutionMs, int bucketCount) {
+        return newestMs - resolutionMs * bucketCount < fromMs;
+    };
+
+    int best = -1;
+    int finestCovering = -1;
+    for (int i = 0; i < int(tierStorage.size()); ++i) {
+        const TierStorage &tier = tierStorage[size_t(i)];
+        if (!covers(tier.resolutionMs, tier.bucketCount))
+            continue;
+        if (finestCovering < 0)
+            finestCovering = i;
+        if (tier.resolutionMs <= desiredResolution)
+            best = i;
+    }
+    if (best >= 0)
+        return best;
+
+    // Нужен шаг мельче любого уровня: сырые данные, если они покрывают диапазон
+    const quint64 capacity = quint64(settings.rawCapacity);
+    const quint64 written = rawWritten[roomId];
+    const quint64 oldest = written > capacity ? written % capacity : 0;
+    const bool rawCovers = rawTimestamps[size_t(roomId) * size_t(capacity) + size_t(oldest)] <= fromMs;
+    if (tierStorage.empty() || (rawCovers && desiredResolution < tierStorage.front().resolutionMs))
+        return -1;
+    if (finestCovering >= 0)
+        return finestCovering;
+    return int(tierStorage.size()) - 1;
+}
+
+QVector<HistoryPoint> RoomHistory::query(int roomId, Metric metric, qint64 fromMs, qint64 toMs, int maxPoints) const {
+    if (roomId < 0 || roomId >= rooms || toMs <= fromMs || maxPoints <= 0 || rawWritten[roomId] == 0)
+        return {};
+
+    const int tier = chooseTier(roomId, fromMs, toMs, maxPoints);
+    if (tier < 0)
+        return queryRaw(roomId, metric, fromMs, toMs, maxPoints);
+    return queryTier(tierStorage[size_t(tier)], roomId, metric, fromMs, toMs, maxPoints);
+}
+
+/**
+ * @brief Запрос по сырому кольцу: измерения из диапазона, при избытке слитые группами.
+ */
+QVector<HistoryPoint> RoomHistory::queryRaw(int roomId, Metric metric, qint64 fromMs, qint64 toMs, int maxPoints) const {
+    const quint64 capacity = quint64(settings.rawCapacity);
+    const quint64 written = rawWritten[roomId];
+    const quint64 stored = std::min(written, capacity);
+    const size_t base = size_t(roomId) * size_t(capacity);
+    const std::vector<float> &values = rawValues[int(metric)];
+
+    auto at = [&](quint64 i) { return base + size_t((written - stored + i) % capacity); };
+
+    quint64 matching = 0;
+    for (quint64 i = 0; i < stored; ++i) {
+        const qint64 timestamp = rawTimestamps[at(i)];
+        if (timestamp >= fromMs && timestamp < toMs)
+            ++matching;
+    }
+    const quint64 group = std::max<quint64>(1, (matching + quint64(maxPoints) - 1) / quint64(maxPoints));
+
+    QVector<HistoryPoint> result;
+    result.reserve(int(std::min<quint64>(matching, quint64(maxPoints))));
+    PointAccumulator accumulator;
+    qint64 groupStart = 0;
+    for (quint64 i = 0; i < stored; ++i) {
+        const size_t index = at(i);
+        const qint64 timestamp = rawTimestamps[index];
+        if (timestamp < fromMs || timestamp >= toMs)
+            continue;
+        if (accumulator.count == 0)
+            groupStart = timestamp;
+        const double value = values[index];
+        accumulator.add(value, value, value, 1);
+        if (accumulator.count == group) {
+            result.append(accumulator.point(groupStart));
+            accumulator = PointAccumulator();
+        }
+    }
+    if (accumulator.count > 0)
+        result.append(accumulator.point(groupStart));
+    return result;
+}
+
+/**
+ * @brief Запрос по уровню агрегации: подряд идущие интервалы сливаются до maxPoints точек.
+ */
+QVector<HistoryPoint> RoomHistory::queryTier(const TierStorage &tier, int roomId, Metric metric,
+                                             qint64 fromMs, qint64 toMs, int maxPoints) const {
+    const qint64 newestBucket = floorDiv(latestTimestamp(roomId), tier.resolutionMs);
+    const qint64 firstBucket = std::max(floorDiv(fromMs, tier.resolutionMs), newestBucket - tier.bucketCount + 1);
+    const qint64 lastBucket = std::min(floorDiv(toMs - 1, tier.resolutionMs), newestBucket);
+    if (lastBucket < firstBucket)
+        return {};
+
+    const qint64 bucketsInRange = lastBucket - firstBucket + 1;
+    const qint64 group = std::max<qint64>(1, (bucketsInRange + maxPoints - 1) / maxPoints);
+    const size_t base = size_t(roomId) * size_t(tier.bucketCount);
+    const int m = int(metric);
+
+    QVector<HistoryPoint> result;
+    result.reserve(int(std::min<qint64>(bucketsInRange, maxPoints)));
+    for (qint64 groupStart = firstBucket; groupStart <= lastBucket; groupStart += group) {
+        PointAccumulator accumulator;
+        const qint64 groupEnd = std::min(groupStart + group - 1, lastBucket);
+        for (qint64 bucket = groupStart; bucket <= groupEnd; ++bucket) {
+            const size_t index = base + slotOf(bucket, tier.bucketCount);
+            if (tier.bucketIds[index] != bucket || tier.counts[index] == 0)
+                continue;
+            accumulator.add(tier.minimum[m][index], tier.maximum[m][index], tier.mean[m][index], tier.counts[index]);
+        }
+        if (accumulator.count > 0)
+            result.append(accumulator.point(groupStart * tier.resolutionMs));
+    }
+    return result;
+}
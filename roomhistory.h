@@ -0,0 +1,122 @@
+#ifndef ROOMHISTORY_H
+#define ROOMHISTORY_H
+
+#include <QVector>
+#include <cstddef>
+#include <vector>
+
+#include "sensorsample.h"
+
+/**
+ * @brief Величина, для которой хранится история.
+ */
+enum class Metric : quint8 {
+    Temperature = 0,  ///< °C
+    Humidity,         ///< %
+    Pressure          ///< Па
+};
+
+constexpr int MetricCount = 3;
+
+/**
+ * @brief Точка истории: агрегат за интервал [timestampMs, timestampMs + длительность).
+ *
+ * Для сырых измерений min == max == avg.
+ */
+struct HistoryPoint {
+    qint64 timestampMs;
+    double min;
+    double max;
+    double avg;
+};
+
+/**
+ * @brief Параметры истории: глубина сырого кольца и уровни агрегации.
+ */
+struct HistoryConfig {
+    struct Tier {
+        qint64 resolutionMs;  ///< Длительность интервала агрегации
+        int bucketCount;      ///< Число хранимых интервалов
+    };
+
+    int rawCapacity = 256;                        ///< Сырых измерений на комнату
+    QVector<Tier> tiers = {{1000, 300},           ///< 1 с за 5 минут
+                           {60 * 1000, 1440},     ///< 1 мин за сутки
+                           {3600 * 1000, 168}};   ///< 1 ч за неделю
+};
+
+/**
+ * @brief Ограниченная по памяти история комнат с многоуровневой агрегацией.
+ *
+ * Для каждой комнаты хранится кольцо сырых измерений и несколько уровней
+ * агрегатов min/max/avg с разным шагом по времени. Каждый агрегат обновляется
+ * при вставке за O(число уровней). Интервал уровня с номером b лежит в ячейке
+ * b % bucketCount, поэтому пропуски во времени и запоздавшие измерения
+ * обрабатываются без сдвигов.
+ *
+ * Запрос выбирает самый грубый уровень, который ещё даёт не меньше maxPoints
+ * интервалов на заданном диапазоне и хранит его целиком, и сливает соседние
+ * интервалы до maxPoints точек. Работа пропорциональна числу точек, умноженному
+ * на отношение шагов соседних уровней, и не зависит от числа сырых измерений.
+ *
+ * Расход памяти на комнату постоянен и равен bytesPerRoom().
+ */
+class RoomHistory {
+public:
+    explicit RoomHistory(const HistoryConfig &config = HistoryConfig());
+
+    void resize(int roomCount);
+    int roomCount() const { return rooms; }
+    const HistoryConfig &config() const { return settings; }
+
+    void append(int roomId, qint64 timestampMs, double temperature, double humidity, double pressure);
+    void appendSamples(const SensorSample *samples, int count);
+
+    /**
+     * @brief Возвращает историю величины за диапазон времени.
+     * @param fromMs Начало диапазона (включительно).
+     * @param toMs Конец диапазона (не включительно).
+     * @param maxPoints Желаемое число точек, результат содержит не больше.
+     */
+    QVector<HistoryPoint> query(int roomId, Metric metric, qint64 fromMs, qint64 toMs, int maxPoints) const;
+
+    qint64 latestTimestamp(int roomId) const; ///< Время последнего измерения или -1
+
+    /**
+     * @brief Копирует последние сырые измерения комнаты от старых к новым.
+     * @return Число скопированных измерений (не больше maxCount).
+     */
+    int copyRawTail(int roomId, int maxCount, qint64 *timestamps, float *const values[MetricCount]) const;
+    size_t bytesPerRoom() const;
+    void clear();
+
+private:
+    /// Уровень агрегации: столбцы по всем комнатам, ячейка = комната * bucketCount + номер
+    struct TierStorage {
+        qint64 resolutionMs;
+        int bucketCount;
+        std::vector<qint64> bucketIds;  ///< Номер интервала (время / шаг), -1 - пусто
+        std::vector<quint32> counts;
+        std::vector<float> minimum[MetricCount];
+        std::vector<float> maximum[MetricCount];
+        std::vector<float> mean[MetricCount];
+    };
+
+    void allocate();
+    int chooseTier(int roomId, qint64 fromMs, qint64 toMs, int maxPoints) const;
+    QVector<HistoryPoint> queryRaw(int roomId, Metric metric, qint64 fromMs, qint64 toMs, int maxPoints) const;
+    QVector<HistoryPoint> queryTier(const TierStorage &tier, int roomId, Metric metric,
+                                    qint64 fromMs, qint64 toMs, int maxPoints) const;
+
+    HistoryConfig settings;
+    int rooms = 0;
+
+    ///< Сырое кольцо: ячейка = комната * rawCapacity + позиция
+    std::vector<qint64> rawTimestamps;
+    std::vector<float> rawValues[MetricCount];
+    std::vector<quint64> rawWritten; ///< Сколько измерений записано в кольцо комнаты всего
+
+    std::vector<TierStorage> tierStorage;
+};
+
+#endif // ROOMHISTORY_H
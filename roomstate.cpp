@@ -0,0 +1,207 @@
+#include "roomstate.h"
+
+#include <algorithm>
+
+/**
+ * @brief Возвращает отображаемое название направления подачи воздуха.
+ */
+QString airflowDirectionName(AirflowDirection direction) {
+    switch (direction) {
+    case AirflowDirection::UpRightLeft:  return QStringLiteral("Вверх-Право-Лево");
+    case AirflowDirection::DownDownDown: return QStringLiteral("Вниз-Вниз-Вниз");
+    case AirflowDirection::RightLeft:    return QStringLiteral("Право-Лево");
+    case AirflowDirection::None:         break;
+    }
+    return QStringLiteral("Направление подачи воздуха");
+}
+
+/**
+ * @brief Преобразует название направления из выпадающего списка в значение перечисления.
+ */
+AirflowDirection airflowDirectionFromName(const QString &name) {
+    for (AirflowDirection direction : {AirflowDirection::UpRightLeft,
+                                       AirflowDirection::DownDownDown,
+                                       AirflowDirection::RightLeft}) {
+        if (name == airflowDirectionName(direction))
+            return direction;
+    }
+    return AirflowDirection::None;
+}
+
+QStringList airflowDirectionNames() {
+    return {airflowDirectionName(AirflowDirection::UpRightLeft),
+            airflowDirectionName(AirflowDirection::DownDownDown),
+            airflowDirectionName(AirflowDirection::RightLeft)};
+}
+
+/**
+ * @brief Конструктор хранилища состояния комнат.
+ * @param roomCount Начальное число комнат.
+ */
+RoomStateStore::RoomStateStore(int roomCount, QObject *parent)
+    : QObject(parent)
+{
+    resize(roomCount);
+}
+
+/**
+ * @brief Изменяет число комнат.
+ *
+ * Новые комнаты получают нулевую температуру и влажность,
+ * нормальное атмосферное давление и незаданное направление воздуха.
+ */
+void RoomStateStore::resize(int roomCount) {
+    const size_t count = size_t(std::max(roomCount, 0));
+    temperatureColumn.resize(count, 0.0);
+    humidityColumn.resize(count, 0.0);
+    pressureColumn.resize(count, StandardPressure);
+    airflowColumn.resize(count, AirflowDirection::None);
+    setpointColumn.resize(count, 0.0);
+    outputColumn.resize(count, 0.0);
+    emit roomsReset();
+}
+
+void RoomStateStore::setTemperature(int roomId, double celsius) {
+    if (!isValidRoom(roomId) || temperatureColumn[roomId] == celsius)
+        return;
+    temperatureColumn[roomId] = celsius;
+    emit roomChanged(roomId, TemperatureField);
+}
+
+void RoomStateStore::setHumidity(int roomId, double percent) {
+    if (!isValidRoom(roomId) || humidityColumn[roomId] == percent)
+        return;
+    humidityColumn[roomId] = percent;
+    emit roomChanged(roomId, HumidityField);
+}
+
+void RoomStateStore::setPressure(int roomId, double pascal) {
+    if (!isValidRoom(roomId) || pressureColumn[roomId] == pascal)
+        return;
+    pressureColumn[roomId] = pascal;
+    emit roomChanged(roomId, PressureField);
+}
+
+void RoomStateStore::setAirflow(int roomId, AirflowDirection direction) {
+    if (!isValidRoom(roomId) || !isValidAirflow(direction) || airflowColumn[roomId] == direction)
+        return;
+    airflowColumn[roomId] = direction;
+    emit roomChanged(roomId, AirflowField);
+}
+
+void RoomStateStore::setSetpoint(int roomId, double celsius) {
+    if (!isValidRoom(roomId) || setpointColumn[roomId] == celsius)
+        return;
+    setpointColumn[roomId] = celsius;
+    emit roomChanged(roomId, SetpointField);
+}
+
+void RoomStateStore::restoreColumns(int roomCount, const double *temperatures, const double *humidities,
+                                    const double *pressures, const AirflowDirection *airflows,
+                                    const double *setpoints) {
+    const size_t count = size_t(std::max(roomCount, 0));
+    temperatureColumn.assign(temperatures, temperatures + count);
+    humidityColumn.assign(humidities, humidities + count);
+    pressureColumn.assign(pressures, pressures + count);
+    airflowColumn.assign(airflows, airflows + count);
+    setpointColumn.assign(setpoints, setpoints + count);
+    outputColumn.assign(count, 0.0);
+    emit roomsReset();
+}
+
+/**
+ * @brief Обновляет все величины комнаты и сообщает об изменении одним сигналом.
+ */
+void RoomStateStore::setRoom(int roomId, double celsius, double percent, double pascal,
+                             AirflowDirection direction) {
+    if (!isValidRoom(roomId))
+        return;
+
+    int fields = 0;
+    if (temperatureColumn[roomId] != celsius) {
+        temperatureColumn[roomId] = celsius;
+        fields |= TemperatureField;
+    }
+    if (humidityColumn[roomId] != percent) {
+        humidityColumn[roomId] = percent;
+        fields |= HumidityField;
+    }
+    if (pressureColumn[roomId] != pascal) {
+        pressureColumn[roomId] = pascal;
+        fields |= PressureField;
+    }
+    if (isValidAirflow(direction) && airflowColumn[roomId] != direction) {
+        airflowColumn[roomId] = direction;
+        fields |= AirflowField;
+    }
+    if (fields)
+        emit roomChanged(roomId, fields);
+}
+
+void RoomStateStore::fillTemperature(double celsius) {
+    std::fill(temperatureColumn.begin(), temperatureColumn.end(), celsius);
+    emit allRoomsChanged(TemperatureField);
+}
+
+void RoomStateStore::fillSetpoint(double celsius) {
+    std::fill(setpointColumn.begin(), setpointColumn.end(), celsius);
+    emit allRoomsChanged(SetpointField);
+}
+
+/**
+ * @brief Применяет пакет измерений датчиков.
+ * @param samples Измерения в порядке поступления.
+ * @param count Число измерений.
+ *
+ * Значения записываются прямо в столбцы, без сигнала на каждое измерение.
+ * Изменённые комнаты накапливаются в lastAppliedChanges(), после чего
+ * испускается один сигнал samplesApplied(). Измерения для несуществующих
+ * комнат отбрасываются.
+ */
+void RoomStateStore::applySamples(const SensorSample *samples, int count) {
+    appliedChanges.clear();
+    const int rooms = roomCount();
+    for (int i = 0; i < count; ++i) {
+        const SensorSample &sample = samples[i];
+        const int roomId = sample.roomId;
+        if (roomId < 0 || roomId >= rooms)
+            continue;
+
+        int fields = 0;
+        if (temperatureColumn[roomId] != sample.temperature) {
+            temperatureColumn[roomId] = sample.temperature;
+            fields |= TemperatureField;
+        }
+        if (humidityColumn[roomId] != sample.humidity) {
+            humidityColumn[roomId] = sample.humidity;
+            fields |= HumidityField;
+        }
+        if (pressureColumn[roomId] != sample.pressure) {
+            pressureColumn[roomId] = sample.pressure;
+            fields |= PressureField;
+        }
+        if (fields)
+            appliedChanges.push_back({roomId, fields});
+    }
+    if (!appliedChanges.empty())
+        emit samplesApplied();
+}
+
+/**
+ * @brief Применяет мощность, рассчитанную регулятором, ко всем комнатам разом.
+ *
+ * Как и applySamples(), записывает изменившиеся значения в столбец,
+ * накапливает их в lastAppliedChanges() и испускает один сигнал outputsApplied().
+ */
+void RoomStateStore::applyOutputs(const double *outputs, int count) {
+    appliedChanges.clear();
+    count = std::min(count, roomCount());
+    for (int roomId = 0; roomId < count; ++roomId) {
+        if (outputColumn[roomId] != outputs[roomId]) {
+            outputColumn[roomId] = outputs[roomId];
+            appliedChanges.push_back({roomId, OutputField});
+        }
+    }
+    if (!appliedChanges.empty())
+        emit outputsApplied();
+}
@@ -0,0 +1,129 @@
+#ifndef ROOMSTATE_H
+#define ROOMSTATE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+#include "sensorsample.h"
+
+/**
+ * @brief Направление подачи воздуха в комнате.
+ *
+ * Значения совпадают с порядком элементов выпадающего списка
+ * в RoomEditDialog (со сдвигом на единицу, ноль - "не задано").
+ */
+enum class AirflowDirection : quint8 {
+    None = 0,       ///< Направление не задано
+    UpRightLeft,    ///< "Вверх-Право-Лево"
+    DownDownDown,   ///< "Вниз-Вниз-Вниз"
+    RightLeft       ///< "Право-Лево"
+};
+
+QString airflowDirectionName(AirflowDirection direction);
+AirflowDirection airflowDirectionFromName(const QString &name);
+inline bool isValidAirflow(AirflowDirection direction) { return quint8(direction) <= quint8(AirflowDirection::RightLeft); }
+QStringList airflowDirectionNames(); ///< Названия направлений для выпадающих списков
+
+/**
+ * @brief Хранилище состояния комнат в виде набора столбцов (struct-of-arrays).
+ *
+ * Каждая величина хранится в отдельном непрерывном массиве, индексируемом
+ * идентификатором комнаты (0..roomCount()-1). Значения хранятся в базовых
+ * единицах: температура и уставка в °C, влажность в %, давление в Па, мощность
+ * климатической установки - доля от -1 (охлаждение) до 1 (нагрев). Перевод в
+ * единицы отображения выполняется интерфейсом при отрисовке.
+ *
+ * Хранилище является единственным источником данных о комнатах,
+ * интерфейс только наблюдает за ним через сигнал roomChanged().
+ * Потоковые измерения применяются пакетом через applySamples()
+ * с одним сигналом samplesApplied() на пакет.
+ */
+class RoomStateStore : public QObject {
+    Q_OBJECT
+
+public:
+    /// Битовые флаги изменённых полей комнаты
+    enum Field {
+        TemperatureField = 0x1,
+        HumidityField    = 0x2,
+        PressureField    = 0x4,
+        AirflowField     = 0x8,
+        SetpointField    = 0x10,
+        OutputField      = 0x20,
+        AllFields        = TemperatureField | HumidityField | PressureField | AirflowField | SetpointField
+                           | OutputField,
+        MeasurementFields = TemperatureField | HumidityField | PressureField ///< Поля, которые приходят с датчиков
+    };
+
+    static constexpr double StandardPressure = 101325.0; ///< Нормальное атмосферное давление, Па
+
+    explicit RoomStateStore(int roomCount = 0, QObject *parent = nullptr);
+
+    int roomCount() const { return int(temperatureColumn.size()); }
+    void resize(int roomCount);
+    bool isValidRoom(int roomId) const { return roomId >= 0 && roomId < roomCount(); }
+
+    double temperature(int roomId) const { return temperatureColumn[roomId]; }
+    double humidity(int roomId) const { return humidityColumn[roomId]; }
+    double pressure(int roomId) const { return pressureColumn[roomId]; }
+    AirflowDirection airflow(int roomId) const { return airflowColumn[roomId]; }
+    double setpoint(int roomId) const { return setpointColumn[roomId]; }
+    double output(int roomId) const { return outputColumn[roomId]; }
+
+    void setTemperature(int roomId, double celsius);
+    void setHumidity(int roomId, double percent);
+    void setPressure(int roomId, double pascal);
+    void setAirflow(int roomId, AirflowDirection direction);
+    void setSetpoint(int roomId, double celsius);
+    void setRoom(int roomId, double celsius, double percent, double pascal, AirflowDirection direction);
+    void fillTemperature(double celsius); ///< Установить одну температуру для всех комнат
+    void fillSetpoint(double celsius);    ///< Установить одну уставку для всех комнат
+
+    /// Изменение комнаты, внесённое пакетом измерений
+    struct RoomChange {
+        int roomId;
+        int fields;
+    };
+
+    void applySamples(const SensorSample *samples, int count);
+    void applyOutputs(const double *outputs, int count); ///< Мощность комнат 0..count-1 от регулятора
+    const std::vector<RoomChange> &lastAppliedChanges() const { return appliedChanges; }
+
+    ///< Непрерывные столбцы для пакетной обработки
+    const double *temperatures() const { return temperatureColumn.data(); }
+    const double *humidities() const { return humidityColumn.data(); }
+    const double *pressures() const { return pressureColumn.data(); }
+    const AirflowDirection *airflows() const { return airflowColumn.data(); }
+    const double *setpoints() const { return setpointColumn.data(); }
+    const double *outputs() const { return outputColumn.data(); }
+
+    /**
+     * @brief Заменяет все столбцы разом (восстановление из снимка).
+     *
+     * Данные копируются одним memcpy на столбец, испускается один сигнал roomsReset().
+     * Мощность не сохраняется и сбрасывается в ноль.
+     */
+    void restoreColumns(int roomCount, const double *temperatures, const double *humidities,
+                        const double *pressures, const AirflowDirection *airflows, const double *setpoints);
+
+signals:
+    void roomChanged(int roomId, int fields); ///< fields - комбинация флагов Field
+    void allRoomsChanged(int fields);         ///< Поля изменены у всех комнат сразу
+    void samplesApplied();                    ///< Применён пакет измерений, см. lastAppliedChanges()
+    void outputsApplied();                    ///< Применена мощность регулятора, см. lastAppliedChanges()
+    void roomsReset();                        ///< Изменилось число комнат
+
+private:
+    std::vector<double> temperatureColumn;        ///< Температура, °C
+    std::vector<double> humidityColumn;           ///< Относительная влажность, %
+    std::vector<double> pressureColumn;           ///< Давление, Па
+    std::vector<AirflowDirection> airflowColumn;  ///< Направление подачи воздуха
+    std::vector<double> setpointColumn;           ///< Уставка температуры, °C
+    std::vector<double> outputColumn;             ///< Мощность установки, -1..1
+
+    std::vector<RoomChange> appliedChanges;       ///< Переиспользуется между пакетами
+};
+
+#endif // ROOMSTATE_H
@@ -0,0 +1,89 @@
+#include "roomstatistics.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Конструктор статистики.
+ * @param config Постоянные времени; значения меньше миллисекунды поднимаются до неё.
+ */
+RoomStatistics::RoomStatistics(const StatisticsConfig &config)
+    : settings(config)
+{
+    settings.windowSeconds = std::max(settings.windowSeconds, 0.001);
+    settings.levelSeconds = std::max(settings.levelSeconds, 0.001);
+    settings.trendSeconds = std::max(settings.trendSeconds, 0.001);
+}
+
+void RoomStatistics::resize(int roomCount) {
+    accumulators.resize(size_t(std::max(roomCount, 0)), Accumulator{});
+}
+
+void RoomStatistics::clear() {
+    std::fill(accumulators.begin(), accumulators.end(), Accumulator{});
+}
+
+/**
+ * @brief Учитывает измерение комнаты.
+ *
+ * Первое измерение задаёт среднее и уровень, дисперсия и наклон начинаются с нуля.
+ */
+void RoomStatistics::append(int roomId, qint64 timestampMs, double temperature, double humidity, double pressure) {
+    if (roomId < 0 || size_t(roomId) >= accumulators.size())
+        return;
+    Accumulator &room = accumulators[size_t(roomId)];
+    const double values[MetricCount] = {temperature, humidity, pressure};
+
+    if (room.count == 0) {
+        for (int metric = 0; metric < MetricCount; ++metric)
+            room.channels[metric] = {values[metric], 0.0, values[metric], 0.0};
+        room.lastMs = timestampMs;
+        room.count = 1;
+        return;
+    }
+    if (timestampMs <= room.lastMs)
+        return;
+
+    const double dt = double(timestampMs - room.lastMs) / 1000.0;
+    const double a = dt / (settings.windowSeconds + dt);
+    const double b = dt / (settings.levelSeconds + dt);
+    const double g = dt / (settings.trendSeconds + dt);
+    for (int metric = 0; metric < MetricCount; ++metric) {
+        Channel &channel = room.channels[metric];
+        const double x = values[metric];
+
+        const double difference = x - channel.mean;
+        const double increment = a * difference;
+        channel.mean += increment;
+        channel.variance = (1.0 - a) * (channel.variance + difference * increment);
+
+        const double predicted = channel.level + channel.trend * dt;
+        const double level = predicted + b * (x - predicted);
+        channel.trend += g * ((level - channel.level) / dt - channel.trend);
+        channel.level = level;
+    }
+    room.lastMs = timestampMs;
+    ++room.count;
+}
+
+void RoomStatistics::appendSamples(const SensorSample *samples, int count) {
+    for (int i = 0; i < count; ++i) {
+        const SensorSample &sample = samples[i];
+        append(sample.roomId, sample.timestampMs, sample.temperature, sample.humidity, sample.pressure);
+    }
+}
+
+qint64 RoomStatistics::latestTimestamp(int roomId) const {
+    if (roomId < 0 || size_t(roomId) >= accumulators.size() || accumulators[size_t(roomId)].count == 0)
+        return -1;
+    return accumulators[size_t(roomId)].lastMs;
+}
+
+double RoomStatistics::standardDeviation(int roomId, Metric metric) const {
+    return std::sqrt(std::max(variance(roomId, metric), 0.0));
+}
+
+double RoomStatistics::forecast(int roomId, Metric metric, double horizonSeconds) const {
+    const Channel &value = channel(roomId, metric);
+    return value.level + value.trend * horizonSeconds;
+}
@@ -0,0 +1,94 @@
+#ifndef ROOMSTATISTICS_H
+#define ROOMSTATISTICS_H
+
+#include <cstddef>
+#include <vector>
+
+#include "roomhistory.h"
+#include "sensorsample.h"
+
+/**
+ * @brief Постоянные времени статистики комнат, с.
+ */
+struct StatisticsConfig {
+    double windowSeconds = 600.0;   ///< Скользящие среднее и дисперсия: около 10 минут
+    double levelSeconds = 60.0;     ///< Сглаживание уровня Холта
+    double trendSeconds = 300.0;    ///< Сглаживание наклона Холта
+};
+
+/**
+ * @brief Скользящие среднее, дисперсия, тренд и прогноз каждой величины комнаты.
+ *
+ * Каждое измерение обновляет аккумуляторы комнаты за O(1), история не
+ * пересматривается. Среднее и дисперсия - экспоненциально взвешенный
+ * вариант рекуррентной формулы Уэлфорда:
+ *
+ *     d = x - mean;  mean += a d;  variance = (1 - a)(variance + a d²)
+ *
+ * Уровень и наклон - метод Холта для неравномерного шага по времени:
+ *
+ *     level' = p + b (x - p),  p = level + trend dt
+ *     trend' = trend + g ((level' - level) / dt - trend)
+ *
+ * Веса a = dt / (T + dt) для каждой постоянной времени T из StatisticsConfig
+ * зависят от промежутка между измерениями, поэтому частота опроса не меняет
+ * длину окна в секундах. Прогноз - линейное продолжение уровня: level + trend h.
+ *
+ * Все аккумуляторы комнаты лежат в одной структуре на две строки кэша, расход
+ * памяти на комнату постоянен (bytesPerRoom()). Измерения не новее последнего
+ * учтённого для комнаты пропускаются.
+ */
+class RoomStatistics {
+public:
+    static constexpr double ForecastHorizonSeconds = 15 * 60;
+
+    explicit RoomStatistics(const StatisticsConfig &config = StatisticsConfig());
+
+    void resize(int roomCount);  ///< Новые комнаты без измерений
+    int roomCount() const { return int(accumulators.size()); }
+    const StatisticsConfig &config() const { return settings; }
+
+    void append(int roomId, qint64 timestampMs, double temperature, double humidity, double pressure);
+    void appendSamples(const SensorSample *samples, int count);
+
+    quint64 sampleCount(int roomId) const { return accumulators[size_t(roomId)].count; }
+    qint64 latestTimestamp(int roomId) const; ///< Время последнего учтённого измерения или -1
+
+    double mean(int roomId, Metric metric) const { return channel(roomId, metric).mean; }
+    double variance(int roomId, Metric metric) const { return channel(roomId, metric).variance; }
+    double standardDeviation(int roomId, Metric metric) const;
+    double trendPerMinute(int roomId, Metric metric) const { return channel(roomId, metric).trend * 60.0; }
+    /// Ожидаемое значение через horizonSeconds после последнего измерения
+    double forecast(int roomId, Metric metric, double horizonSeconds = ForecastHorizonSeconds) const;
+
+    static constexpr size_t bytesPerRoom();
+    void clear();
+
+private:
+    /// Аккумуляторы одной величины
+    struct Channel {
+        double mean;
+        double variance;
+        double level;
+        double trend;       ///< Единиц в секунду
+    };
+
+    struct alignas(64) Accumulator {
+        Channel channels[MetricCount];
+        qint64 lastMs;
+        quint64 count;
+    };
+
+    const Channel &channel(int roomId, Metric metric) const {
+        return accumulators[size_t(roomId)].channels[int(metric)];
+    }
+
+    StatisticsConfig settings;
+    std::vector<Accumulator> accumulators;  ///< По комнатам
+};
+
+constexpr size_t RoomStatistics::bytesPerRoom() {
+    return sizeof(Accumulator);
+}
+
+#endif // ROOMSTATISTICS_H
@@ -0,0 +1,333 @@
+#include "roomtablemodel.h"
+#include "profiler.h"
+
+#include <QPainter>
+
+#include <algorithm>
+
+/**
+ * @brief Конструктор модели комнат.
+ * @param store Хранилище состояния, за которым наблюдает модель.
+ */
+RoomTableModel::RoomTableModel(RoomStateStore *store, QObject *parent)
+    : QAbstractTableModel(parent), store(store)
+{
+    connect(store, &RoomStateStore::roomsReset, this, &RoomTableModel::roomsReset);
+    roomsReset();
+}
+
+int RoomTableModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : store->roomCount();
+}
+
+int RoomTableModel::columnCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QString RoomTableModel::roomName(int roomId) {
+    return QString("Комната %1").arg(roomId + 1);
+}
+
+/**
+ * @brief Пересчитывает столбцы отображения для диапазона комнат.
+ */
+void RoomTableModel::convertRooms(int firstRoomId, int lastRoomId, int fields) {
+    if (firstRoomId > lastRoomId)
+        return;
+    CLIMATE_PROFILE_SCOPE(UnitConversion);
+    const size_t count = size_t(lastRoomId - firstRoomId + 1);
+    if (fields & RoomStateStore::TemperatureField)
+        convertColumn(store->temperatures() + firstRoomId, displayTemperature.data() + firstRoomId, count,
+                      temperatureConversion(temperatureDisplayUnit));
+    if (fields & RoomStateStore::SetpointField)
+        convertColumn(store->setpoints() + firstRoomId, displaySetpoint.data() + firstRoomId, count,
+                      temperatureConversion(temperatureDisplayUnit));
+    if (fields & RoomStateStore::PressureField)
+        convertColumn(store->pressures() + firstRoomId, displayPressure.data() + firstRoomId, count,
+                      pressureConversion(pressureDisplayUnit));
+    if (derived && (fields & DerivedMetrics::InputFields)) {
+        derived->update();  ///< Производные величины - по текущим значениям, а не по прошлому тику
+        convertColumn(derived->dewPoints() + firstRoomId, displayDewPoint.data() + firstRoomId, count,
+                      temperatureConversion(temperatureDisplayUnit));
+        convertColumn(derived->heatIndices() + firstRoomId, displayHeatIndex.data() + firstRoomId, count,
+                      temperatureConversion(temperatureDisplayUnit));
+    }
+}
+
+QVariant RoomTableModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || !store->isValidRoom(index.row()))
+        return QVariant();
+
+    const int roomId = index.row();
+
+    if (role == Qt::DisplayRole) {
+        switch (index.column()) {
+        case NameColumn:        return roomName(roomId);
+        case TemperatureColumn:
+            return QString("%1 %2").arg(displayTemperature[size_t(roomId)])
+                                   .arg(QString::fromUtf8(temperatureUnitSymbol(temperatureDisplayUnit)));
+        case HumidityColumn:    return QString("%1%").arg(store->humidity(roomId));
+        case PressureColumn:
+            return QString("%1 %2").arg(displayPressure[size_t(roomId)])
+                                   .arg(QString::fromUtf8(pressureUnitSymbol(pressureDisplayUnit)));
+        case AirflowColumn:     return airflowDirectionName(store->airflow(roomId));
+        case SetpointColumn:
+            return QString("%1 %2").arg(displaySetpoint[size_t(roomId)])
+                                   .arg(QString::fromUtf8(temperatureUnitSymbol(temperatureDisplayUnit)));
+        case OutputColumn:      return QString("%1%").arg(store->output(roomId) * 100.0, 0, 'f', 0);
+        case TrendColumn:
+        case ForecastColumn:    return statisticsText(roomId, index.column());
+        }
+        if (!derived)
+            return QVariant();
+        switch (index.column()) {
+        case DewPointColumn:
+            return QString("%1 %2").arg(displayDewPoint[size_t(roomId)], 0, 'f', 1)
+                                   .arg(QString::fromUtf8(temperatureUnitSymbol(temperatureDisplayUnit)));
+        case HeatIndexColumn:
+            return QString("%1 %2").arg(displayHeatIndex[size_t(roomId)], 0, 'f', 1)
+                                   .arg(QString::fromUtf8(temperatureUnitSymbol(temperatureDisplayUnit)));
+        case AbsoluteHumidityColumn: return QString("%1 г/м³").arg(derived->absoluteHumidity(roomId), 0, 'f', 1);
+        case EnthalpyColumn:    return QString("%1 кДж/кг").arg(derived->enthalpy(roomId), 0, 'f', 1);
+        }
+    } else if (role == Qt::ToolTipRole) {
+        const QString text = statisticsText(roomId, index.column());
+        return text.isEmpty() ? QVariant() : QVariant(text);
+    } else if (role == RawValueRole) {
+        switch (index.column()) {
+        case NameColumn:        return roomId;
+        case TemperatureColumn: return store->temperature(roomId);
+        case HumidityColumn:    return store->humidity(roomId);
+        case PressureColumn:    return store->pressure(roomId);
+        case AirflowColumn:     return int(store->airflow(roomId));
+        case SetpointColumn:    return store->setpoint(roomId);
+        case OutputColumn:      return store->output(roomId);
+        }
+        if (statistics && statistics->sampleCount(roomId)) {
+            if (index.column() == TrendColumn)
+                return statistics->trendPerMinute(roomId, Metric::Temperature);
+            if (index.column() == ForecastColumn)
+                return statistics->forecast(roomId, Metric::Temperature);
+        }
+        if (!derived)
+            return QVariant();
+        switch (index.column()) {
+        case DewPointColumn:    return derived->dewPoint(roomId);
+        case HeatIndexColumn:   return derived->heatIndex(roomId);
+        case AbsoluteHumidityColumn: return derived->absoluteHumidity(roomId);
+        case EnthalpyColumn:    return derived->enthalpy(roomId);
+        }
+    }
+    return QVariant();
+}
+
+/**
+ * @brief Текст статистики для ячейки: тренд и прогноз температуры или подсказка к столбцу величины.
+ * @return Пустая строка, если статистики нет или для столбца она не показывается.
+ */
+QString RoomTableModel::statisticsText(int roomId, int column) const {
+    if (!statistics || !statistics->sampleCount(roomId))
+        return QString();
+    const QString temperatureSymbol = QString::fromUtf8(temperatureUnitSymbol(temperatureDisplayUnit));
+    if (column == TrendColumn) {
+        // Наклон - разность температур: переводится только масштабом, без смещения шкалы
+        const double trend = statistics->trendPerMinute(roomId, Metric::Temperature)
+                             * temperatureConversion(temperatureDisplayUnit).scale;
+        return QString("%1%2 %3/мин").arg(trend >= 0.0 ? "+" : "").arg(trend, 0, 'f', 2).arg(temperatureSymbol);
+    }
+    if (column == ForecastColumn)
+        return QString("%1 %2").arg(convertTemperature(statistics->forecast(roomId, Metric::Temperature),
+                                                       temperatureDisplayUnit), 0, 'f', 1)
+                               .arg(temperatureSymbol);
+
+    const int metric = column - TemperatureColumn;
+    if (metric < 0 || metric >= MetricCount)
+        return QString();
+    return QString("Среднее: %1, σ: %2, тренд: %3 в минуту")
+        .arg(statistics->mean(roomId, Metric(metric)), 0, 'f', 2)
+        .arg(statistics->standardDeviation(roomId, Metric(metric)), 0, 'f', 2)
+        .arg(statistics->trendPerMinute(roomId, Metric(metric)), 0, 'f', 3);
+}
+
+QVariant RoomTableModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    switch (section) {
+    case NameColumn:        return QString("Комната");
+    case TemperatureColumn: return QString("Температура");
+    case HumidityColumn:    return QString("Влажность");
+    case PressureColumn:    return QString("Давление");
+    case AirflowColumn:     return QString("Направление подачи воздуха");
+    case SetpointColumn:    return QString("Уставка");
+    case OutputColumn:      return QString("Мощность");
+    case DewPointColumn:    return QString("Точка росы");
+    case HeatIndexColumn:   return QString("Индекс жары");
+    case AbsoluteHumidityColumn: return QString("Абс. влажность");
+    case EnthalpyColumn:    return QString("Энтальпия");
+    case TrendColumn:       return QString("Тренд");
+    case ForecastColumn:    return QString("Прогноз 15 мин");
+    }
+    return QVariant();
+}
+
+/**
+ * @brief Меняет единицу отображения температуры: пересчёт столбца одним проходом.
+ */
+void RoomTableModel::setTemperatureUnit(TemperatureUnit unit) {
+    if (temperatureDisplayUnit == unit)
+        return;
+    temperatureDisplayUnit = unit;
+    convertRooms(0, store->roomCount() - 1, RoomStateStore::TemperatureField | RoomStateStore::SetpointField);
+    columnChanged(TemperatureColumn);
+    columnChanged(SetpointColumn);
+    columnChanged(DewPointColumn);
+    columnChanged(HeatIndexColumn);
+    columnChanged(TrendColumn);
+    columnChanged(ForecastColumn);
+}
+
+/**
+ * @brief Меняет единицу отображения давления: пересчёт столбца одним проходом.
+ */
+void RoomTableModel::setPressureUnit(PressureUnit unit) {
+    if (pressureDisplayUnit == unit)
+        return;
+    pressureDisplayUnit = unit;
+    convertRooms(0, store->roomCount() - 1, RoomStateStore::PressureField);
+    columnChanged(PressureColumn);
+}
+
+/**
+ * @brief Подключает источник производных величин и заполняет их столбцы.
+ */
+void RoomTableModel::setDerivedMetrics(DerivedMetrics *metrics) {
+    derived = metrics;
+    convertRooms(0, store->roomCount() - 1, DerivedMetrics::InputFields);
+    for (int column = DewPointColumn; column <= EnthalpyColumn; ++column)
+        columnChanged(column);
+}
+
+/**
+ * @brief Подключает скользящую статистику комнат: тренд, прогноз и подсказки.
+ */
+void RoomTableModel::setStatistics(const RoomStatistics *roomStatistics) {
+    statistics = roomStatistics;
+    columnChanged(TrendColumn);
+    columnChanged(ForecastColumn);
+}
+
+/**
+ * @brief Сообщает представлению об изменении столбца целиком.
+ *
+ * Представление перерисует только видимую часть столбца.
+ */
+void RoomTableModel::columnChanged(int column) {
+    if (store->roomCount() == 0)
+        return;
+    emit dataChanged(index(0, column), index(store->roomCount() - 1, column), {Qt::DisplayRole});
+}
+
+void RoomTableModel::roomChanged(int roomId, int fields) {
+    roomRangeChanged(roomId, roomId, fields);
+}
+
+/**
+ * @brief Преобразует флаги изменённых полей диапазона комнат в прямоугольник ячеек.
+ */
+void RoomTableModel::roomRangeChanged(int firstRoomId, int lastRoomId, int fields) {
+    int first = ColumnCount;
+    int last = -1;
+    auto include = [&](int flag, int column) {
+        if (fields & flag) {
+            first = std::min(first, column);
+            last = std::max(last, column);
+        }
+    };
+    include(RoomStateStore::TemperatureField, TemperatureColumn);
+    include(RoomStateStore::HumidityField, HumidityColumn);
+    include(RoomStateStore::PressureField, PressureColumn);
+    include(RoomStateStore::AirflowField, AirflowColumn);
+    include(RoomStateStore::SetpointField, SetpointColumn);
+    include(RoomStateStore::OutputField, OutputColumn);
+    if (derived)
+        include(DerivedMetrics::InputFields, EnthalpyColumn);  // все производные столбцы идут после OutputColumn
+    if (statistics)
+        include(DerivedMetrics::InputFields, ForecastColumn);  // статистика обновляется с каждым измерением
+
+    convertRooms(firstRoomId, lastRoomId, fields);
+    if (last >= 0)
+        emit dataChanged(index(firstRoomId, first), index(lastRoomId, last));
+}
+
+void RoomTableModel::roomsReset() {
+    beginResetModel();
+    displayTemperature.resize(size_t(store->roomCount()));
+    displayPressure.resize(size_t(store->roomCount()));
+    displaySetpoint.resize(size_t(store->roomCount()));
+    displayDewPoint.resize(size_t(store->roomCount()));
+    displayHeatIndex.resize(size_t(store->roomCount()));
+    convertRooms(0, store->roomCount() - 1, RoomStateStore::AllFields);
+    endResetModel();
+}
+
+/**
+ * @brief Конструктор делегата строки комнаты.
+ */
+RoomItemDelegate::RoomItemDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+{
+}
+
+/**
+ * @brief Рисует ячейку комнаты.
+ *
+ * Текст выводится одним вызовом drawText с обрезкой по ширине ячейки.
+ * Для температуры слева рисуется цветная метка от синего (холодно) до красного (жарко).
+ */
+void RoomItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
+                             const QModelIndex &index) const {
+    CLIMATE_PROFILE_SCOPE(RowPaint);
+    painter->save();
+
+    const bool selected = option.state & QStyle::State_Selected;
+    if (selected)
+        painter->fillRect(option.rect, option.palette.highlight());
+
+    QRect textRect = option.rect.adjusted(4, 0, -4, 0);
+
+    if (index.column() == RoomTableModel::TemperatureColumn) {
+        const double celsius = index.data(RoomTableModel::RawValueRole).toDouble();
+        // 10 °C и холоднее - синий, 30 °C и жарче - красный
+        const double t = std::clamp((celsius - 10.0) / 20.0, 0.0, 1.0);
+        const QRect chip(textRect.left(), textRect.center().y() - 5, 10, 10);
+        painter->fillRect(chip, QColor::fromHsvF(0.66 * (1.0 - t), 0.8, 0.9));
+        textRect.setLeft(chip.right() + 6);
+    } else if (index.column() == RoomTableModel::DewPointColumn) {
+        const QVariant dewPoint = index.data(RoomTableModel::RawValueRole);
+        const double celsius = index.sibling(index.row(), RoomTableModel::TemperatureColumn)
+                                   .data(RoomTableModel::RawValueRole).toDouble();
+        // Стены и воздуховоды холоднее воздуха: запас до точки росы меньше CondensationMargin - риск конденсации
+        if (dewPoint.isValid() && celsius - dewPoint.toDouble() < DerivedMetrics::CondensationMargin) {
+            const QRect chip(textRect.left(), textRect.center().y() - 5, 10, 10);
+            painter->fillRect(chip, QColor(40, 120, 230));
+            textRect.setLeft(chip.right() + 6);
+        }
+    }
+
+    painter->setPen(selected ? option.palette.highlightedText().color() : option.palette.text().color());
+    const QString text = index.data(Qt::DisplayRole).toString();
+    painter->drawText(textRect, Qt::AlignVCenter | Qt::AlignLeft,
+                      option.fontMetrics.elidedText(text, Qt::ElideRight, textRect.width()));
+
+    painter->restore();
+}
+
+/**
+ * @brief Возвращает фиксированный размер ячейки, не измеряя текст.
+ */
+QSize RoomItemDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const {
+    Q_UNUSED(option);
+    Q_UNUSED(index);
+    return QSize(ColumnWidth, RowHeight);
+}
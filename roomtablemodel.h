@@ -0,0 +1,118 @@
+#ifndef ROOMTABLEMODEL_H
+#define ROOMTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QStyledItemDelegate>
+
+#include "derivedmetrics.h"
+#include "roomstate.h"
+#include "roomstatistics.h"
+#include "unitconversion.h"
+
+#include <vector>
+
+/**
+ * @brief Табличная модель комнат поверх RoomStateStore.
+ *
+ * Модель не хранит данных: каждая ячейка вычисляется из столбцов хранилища
+ * при запросе представлением, поэтому рисуются и форматируются только
+ * видимые строки, а затраты памяти не зависят от числа комнат.
+ *
+ * Об изменениях отдельных комнат модель узнаёт не от хранилища напрямую,
+ * а через слоты roomChanged()/roomRangeChanged(), обычно от UiUpdateScheduler.
+ *
+ * Температура и давление в единицах отображения держатся в отдельных столбцах,
+ * которые пересчитываются векторным convertColumn(): при смене единицы - целиком,
+ * при изменении комнат - только изменённый диапазон.
+ *
+ * Точка росы, индекс жары, абсолютная влажность и энтальпия берутся из
+ * DerivedMetrics (см. setDerivedMetrics()); без него эти столбцы пусты.
+ * Тренд и прогноз температуры, а также подсказки со средним и разбросом
+ * величин берутся из RoomStatistics (см. setStatistics()).
+ */
+class RoomTableModel : public QAbstractTableModel {
+    Q_OBJECT
+
+public:
+    enum Column {
+        NameColumn = 0,
+        TemperatureColumn,
+        HumidityColumn,
+        PressureColumn,
+        AirflowColumn,
+        SetpointColumn,
+        OutputColumn,
+        DewPointColumn,
+        HeatIndexColumn,
+        AbsoluteHumidityColumn,
+        EnthalpyColumn,
+        TrendColumn,        ///< Наклон температуры, в минуту
+        ForecastColumn,     ///< Температура через RoomStatistics::ForecastHorizonSeconds
+        ColumnCount
+    };
+
+    enum Role {
+        RawValueRole = Qt::UserRole + 1  ///< Значение в базовых единицах (°C, %, Па, г/м³, кДж/кг)
+    };
+
+    explicit RoomTableModel(RoomStateStore *store, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    TemperatureUnit temperatureUnit() const { return temperatureDisplayUnit; }
+    PressureUnit pressureUnit() const { return pressureDisplayUnit; }
+    void setTemperatureUnit(TemperatureUnit unit);
+    void setPressureUnit(PressureUnit unit);
+    void setDerivedMetrics(DerivedMetrics *metrics);
+    void setStatistics(const RoomStatistics *statistics);
+
+    static QString roomName(int roomId);
+
+public slots:
+    void roomChanged(int roomId, int fields);
+    void roomRangeChanged(int firstRoomId, int lastRoomId, int fields);
+    void roomsReset();
+
+private:
+    void convertRooms(int firstRoomId, int lastRoomId, int fields);
+    QString statisticsText(int roomId, int column) const;
+    void columnChanged(int column);
+
+    RoomStateStore *store;
+    DerivedMetrics *derived = nullptr;
+    const RoomStatistics *statistics = nullptr;
+    TemperatureUnit temperatureDisplayUnit = TemperatureUnit::Celsius;
+    PressureUnit pressureDisplayUnit = PressureUnit::Pascal;
+
+    ///< Значения в единицах отображения, пересчитываются пакетно convertColumn()
+    std::vector<double> displayTemperature;
+    std::vector<double> displayPressure;
+    std::vector<double> displaySetpoint;
+    std::vector<double> displayDewPoint;
+    std::vector<double> displayHeatIndex;
+};
+
+/**
+ * @brief Делегат строки комнаты.
+ *
+ * Рисует текст ячейки напрямую, без расчёта размеров по содержимому,
+ * а в столбце температуры добавляет цветовой индикатор. В столбце точки росы
+ * индикатор появляется, если комнате грозит конденсация.
+ */
+class RoomItemDelegate : public QStyledItemDelegate {
+    Q_OBJECT
+
+public:
+    explicit RoomItemDelegate(QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+    static constexpr int RowHeight = 24;   ///< Фиксированная высота строки
+    static constexpr int ColumnWidth = 222;
+};
+
+#endif // ROOMTABLEMODEL_H
@@ -0,0 +1,168 @@
+#include "samplingscheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double VarianceWeight = 0.25;  ///< Вес нового измерения в скользящей дисперсии температуры
+
+int roundUpToPowerOfTwo(int value) {
+    int result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+} // namespace
+
+/**
+ * @brief Конструктор; все комнаты стоят на первом такте.
+ * @param maxIntervalTicks Наибольший период, 1 - опрос всех комнат каждый такт.
+ */
+SamplingScheduler::SamplingScheduler(int roomCount, int maxIntervalTicks, const SamplingPolicy &policy)
+    : policy(policy),
+      maxInterval(std::clamp(maxIntervalTicks, 1, 1 << 20)),
+      mask(std::uint64_t(roundUpToPowerOfTwo(maxInterval)) - 1),
+      rooms(size_t(std::max(roomCount, 0))),
+      heads(size_t(mask + 1), -1),
+      dueBits((rooms.size() + 63) / 64, 0)
+{
+    reset();
+}
+
+void SamplingScheduler::reset() {
+    std::fill(heads.begin(), heads.end(), -1);
+    for (int roomId = 0; roomId < roomCount(); ++roomId) {
+        rooms[size_t(roomId)] = Room{0.0, 0.0, 0.0, 0.0, 1, -1, -1, -1, false, false};
+        schedule(roomId, 1);
+    }
+}
+
+/**
+ * @brief Переходит к следующему такту и забирает его слот.
+ *
+ * Комнаты слота отмечаются в битовой карте и выдаются обходом её слов,
+ * поэтому порядок выдачи - по номеру комнаты, а стоимость - число выданных
+ * комнат плюс число комнат / 64.
+ */
+void SamplingScheduler::advance(std::vector<int> &due) {
+    due.clear();
+    ++currentTick;
+    fixedRateCount += rooms.size();
+
+    std::int32_t &head = heads[size_t(currentTick & mask)];
+    if (head < 0)
+        return;
+    for (std::int32_t roomId = head; roomId >= 0; roomId = rooms[size_t(roomId)].next) {
+        rooms[size_t(roomId)].slot = -1;
+        dueBits[size_t(roomId) / 64] |= std::uint64_t(1) << (roomId % 64);
+    }
+    head = -1;
+
+    for (size_t word = 0; word < dueBits.size(); ++word) {
+        std::uint64_t bits = dueBits[word];
+        dueBits[word] = 0;
+        while (bits) {
+            due.push_back(int(word * 64 + size_t(__builtin_ctzll(bits))));
+            bits &= bits - 1;
+        }
+    }
+    polledCount += due.size();
+}
+
+/**
+ * @brief Учитывает измерение и ставит комнату через новый период.
+ *
+ * Первое измерение комнаты только запоминается, период остаётся одним тактом.
+ */
+void SamplingScheduler::complete(int roomId, double temperature, double humidity, double setpoint) {
+    if (roomId < 0 || roomId >= roomCount() || isScheduled(roomId))
+        return;
+    Room &room = rooms[size_t(roomId)];
+
+    bool active = room.alarmed || !room.sampled;
+    if (room.sampled) {
+        const double difference = temperature - room.mean;
+        const double increment = VarianceWeight * difference;
+        room.mean += increment;
+        room.variance = (1.0 - VarianceWeight) * (room.variance + difference * increment);
+        active = active
+                 || std::abs(temperature - room.temperature) > policy.temperatureStep
+                 || std::abs(humidity - room.humidity) > policy.humidityStep
+                 || room.variance > policy.temperatureDeviation * policy.temperatureDeviation;
+    } else {
+        room.mean = temperature;
+        room.variance = 0.0;
+        room.sampled = true;
+    }
+    room.temperature = temperature;
+    room.humidity = humidity;
+
+    // Каждая полоса отклонения от уставки вдвое сокращает предел периода
+    const double bands = std::abs(temperature - setpoint) / policy.setpointBand;
+    const int shift = bands < 30.0 ? int(bands) : 30;
+    const int limit = std::max(maxInterval >> shift, 1);
+    room.interval = active ? 1 : std::min(room.interval * 2, limit);
+    schedule(roomId, room.interval);
+}
+
+void SamplingScheduler::postpone(int roomId) {
+    if (roomId >= 0 && roomId < roomCount() && !isScheduled(roomId))
+        schedule(roomId, rooms[size_t(roomId)].interval);
+}
+
+void SamplingScheduler::retry(int roomId) {
+    if (roomId >= 0 && roomId < roomCount() && !isScheduled(roomId))
+        schedule(roomId, 1);
+}
+
+/**
+ * @brief Отмечает тревогу комнаты; поднятая тревога переносит комнату на ближайший такт.
+ */
+void SamplingScheduler::setAlarmed(int roomId, bool active) {
+    if (roomId < 0 || roomId >= roomCount())
+        return;
+    rooms[size_t(roomId)].alarmed = active;
+    if (active)
+        expedite(roomId);
+}
+
+/**
+ * @brief Сбрасывает период комнаты и переносит её на ближайший такт; выданная комната просто ждёт ответа.
+ */
+void SamplingScheduler::expedite(int roomId) {
+    if (roomId < 0 || roomId >= roomCount())
+        return;
+    Room &room = rooms[size_t(roomId)];
+    room.interval = 1;
+    if (isScheduled(roomId) && std::uint64_t(room.slot) != ((currentTick + 1) & mask)) {
+        unlink(roomId);
+        schedule(roomId, 1);
+    }
+}
+
+/**
+ * @brief Вставляет комнату в начало слота через ticks тактов от текущего.
+ */
+void SamplingScheduler::schedule(int roomId, int ticks) {
+    const std::int32_t slot = std::int32_t((currentTick + std::uint64_t(ticks)) & mask);
+    Room &room = rooms[size_t(roomId)];
+    room.slot = slot;
+    room.prev = -1;
+    room.next = heads[size_t(slot)];
+    if (room.next >= 0)
+        rooms[size_t(room.next)].prev = roomId;
+    heads[size_t(slot)] = roomId;
+}
+
+void SamplingScheduler::unlink(int roomId) {
+    Room &room = rooms[size_t(roomId)];
+    if (room.prev >= 0)
+        rooms[size_t(room.prev)].next = room.next;
+    else
+        heads[size_t(room.slot)] = room.next;
+    if (room.next >= 0)
+        rooms[size_t(room.next)].prev = room.prev;
+    room.slot = -1;
+}
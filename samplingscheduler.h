@@ -0,0 +1,95 @@
+#ifndef SAMPLINGSCHEDULER_H
+#define SAMPLINGSCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Пороги, по которым комната считается неспокойной.
+ */
+struct SamplingPolicy {
+    double temperatureStep = 0.1;    ///< °C между соседними опросами
+    double humidityStep = 1.0;       ///< % между соседними опросами
+    double temperatureDeviation = 0.05; ///< °C, скользящее стандартное отклонение температуры
+    double setpointBand = 0.5;       ///< °C: каждая полоса отклонения от уставки вдвое сокращает наибольший период
+};
+
+/**
+ * @brief Расписание опроса комнат с периодом, подстраиваемым под каждую комнату.
+ *
+ * Время идёт тактами - циклами опроса источника. Период комнаты - от одного
+ * такта до maxIntervalTicks. Спокойная комната после каждого опроса удваивает
+ * период; скачок температуры или влажности, разброс температуры выше порога
+ * или поднятая тревога (setAlarmed()) возвращают период к одному такту.
+ * Отклонение от уставки ограничивает наибольший период: на каждую полосу
+ * SamplingPolicy::setpointBand предел уменьшается вдвое, поэтому комната,
+ * далёкая от уставки, опрашивается часто, даже если её температура стоит.
+ *
+ * Расписание - колесо таймеров на степень двойки слотов, не меньше наибольшего
+ * периода: слот - интрузивный двусвязный список комнат, поэтому постановка,
+ * перенос и снятие комнаты - O(1) без выделения памяти. advance() забирает
+ * слот очередного такта и выдаёт его комнаты по возрастанию номера (через
+ * битовую карту), чтобы источник мог читать соседние установки одним
+ * запросом. Выданная комната ждёт complete(), postpone() или retry() и до
+ * тех пор в колесе отсутствует.
+ *
+ * Не зависит от Qt; вызывается из одного потока.
+ */
+class SamplingScheduler {
+public:
+    static constexpr int DefaultMaxIntervalTicks = 32;
+
+    explicit SamplingScheduler(int roomCount, int maxIntervalTicks = DefaultMaxIntervalTicks,
+                               const SamplingPolicy &policy = SamplingPolicy());
+
+    void reset();   ///< Все комнаты - на ближайший такт, без накопленного состояния
+    int roomCount() const { return int(rooms.size()); }
+    int maxIntervalTicks() const { return maxInterval; }
+    std::uint64_t tick() const { return currentTick; }
+
+    /// Следующий такт: комнаты, которые пора опросить, по возрастанию номера
+    void advance(std::vector<int> &due);
+
+    /// Измерение выданной комнаты получено: новый период и постановка в расписание
+    void complete(int roomId, double temperature, double humidity, double setpoint);
+    void postpone(int roomId);  ///< Комната не ответила по существу (не на связи): прежний период
+    void retry(int roomId);     ///< Запрос не удался: повторить на следующем такте
+    void setAlarmed(int roomId, bool active); ///< Тревога: опрашивать каждый такт, пока не снята
+    void expedite(int roomId);  ///< Опросить на ближайшем такте (например, после записи уставки)
+
+    int interval(int roomId) const { return rooms[size_t(roomId)].interval; }
+    bool isScheduled(int roomId) const { return rooms[size_t(roomId)].slot >= 0; }
+
+    std::uint64_t polledRooms() const { return polledCount; }          ///< Всего выдано комнат
+    std::uint64_t fixedRatePolls() const { return fixedRateCount; }    ///< Столько же тактов при опросе всех комнат
+
+private:
+    struct Room {
+        double temperature;
+        double humidity;
+        double mean;        ///< Скользящие среднее и дисперсия температуры
+        double variance;
+        std::int32_t interval;
+        std::int32_t slot;  ///< -1 - выдана advance() и ждёт ответа
+        std::int32_t next;
+        std::int32_t prev;
+        bool sampled;
+        bool alarmed;
+    };
+
+    void schedule(int roomId, int ticks);
+    void unlink(int roomId);
+
+    SamplingPolicy policy;
+    int maxInterval;
+    std::uint64_t mask;
+    std::vector<Room> rooms;
+    std::vector<std::int32_t> heads;     ///< Первая комната слота или -1
+    std::vector<std::uint64_t> dueBits;  ///< Комнаты слота текущего такта
+    std::uint64_t currentTick = 0;
+    std::uint64_t polledCount = 0;
+    std::uint64_t fixedRateCount = 0;
+};
+
+#endif // SAMPLINGSCHEDULER_H
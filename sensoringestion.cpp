@@ -0,0 +1,419 @@
+#include "sensoringestion.h"
+#include "hvacdriver.h"
+#include "profiler.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QDebug>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <cmath>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+std::unique_ptr<SensorSource> SensorSource::create(const QString &spec, int roomCount) {
+    if (spec == QLatin1String("sim") || spec.startsWith(QLatin1String("sim:"))) {
+        const double rate = spec.size() > 4 ? spec.mid(4).toDouble() : 1000.0;
+        return std::unique_ptr<SensorSource>(new SimulatedSensorSource(roomCount, rate));
+    }
+    if (spec.startsWith(QLatin1String("hvac:"))) {
+        // Порт - после последнего двоеточия, если это число: "hvac:plant-gw" или "hvac:10.0.0.5:1502"
+        QString host = spec.mid(5);
+        quint16 port = HvacProtocol::DefaultPort;
+        const int colon = host.lastIndexOf(':');
+        bool portOk = false;
+        const uint parsedPort = colon > 0 ? host.mid(colon + 1).toUInt(&portOk) : 0;
+        if (portOk && parsedPort > 0 && parsedPort <= 0xffff) {
+            port = quint16(parsedPort);
+            host.truncate(colon);
+        }
+        return std::unique_ptr<SensorSource>(new HvacDeviceSource(host, port, roomCount));
+    }
+    return std::unique_ptr<SensorSource>(new StreamSensorSource(spec));
+}
+
+/**
+ * @brief Конструктор имитатора.
+ * @param roomCount Число комнат, измерения идут по кругу.
+ * @param samplesPerSecond Темп генерации, 0 - без ограничения.
+ */
+SimulatedSensorSource::SimulatedSensorSource(int roomCount, double samplesPerSecond)
+    : roomCount(std::max(roomCount, 1)), samplesPerSecond(std::max(samplesPerSecond, 0.0))
+{
+}
+
+bool SimulatedSensorSource::open() {
+    temperature.fill(21.0, roomCount);
+    humidity.fill(45.0, roomCount);
+    pressure.fill(RoomStateStore::StandardPressure, roomCount);
+    startMs = QDateTime::currentMSecsSinceEpoch();
+    generated = 0;
+    nextRoom = 0;
+    return true;
+}
+
+/**
+ * @brief Генерирует порцию измерений.
+ *
+ * При заданном темпе выдаёт ровно столько измерений, сколько должно было
+ * появиться к текущему моменту, поэтому средняя скорость не зависит от размера порции.
+ */
+int SimulatedSensorSource::read(SensorSample *buffer, int maxCount) {
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    int count = maxCount;
+    if (samplesPerSecond > 0) {
+        const quint64 due = quint64(double(now - startMs) * samplesPerSecond / 1000.0);
+        count = int(std::min<quint64>(quint64(maxCount), due > generated ? due - generated : 0));
+    }
+
+    for (int i = 0; i < count; ++i) {
+        // xorshift32: дешёвый генератор без состояния в куче
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 17;
+        randomState ^= randomState << 5;
+        const double step = (double(randomState & 0xffff) / 65535.0 - 0.5);
+
+        const int room = nextRoom;
+        temperature[room] = std::clamp(temperature[room] + step * 0.1, -40.0, 60.0);
+        humidity[room] = std::clamp(humidity[room] + step * 0.2, 0.0, 100.0);
+        pressure[room] = pressure[room] + step * 5.0;
+
+        SensorSample &sample = buffer[i];
+        sample.timestampMs = now;
+        sample.roomId = room;
+        sample.reserved = 0;
+        sample.temperature = std::round(temperature[room] * 100.0) / 100.0;
+        sample.humidity = std::round(humidity[room] * 10.0) / 10.0;
+        sample.pressure = std::round(pressure[room]);
+
+        nextRoom = (nextRoom + 1) % roomCount;
+    }
+    generated += quint64(count);
+    return count;
+}
+
+QString SimulatedSensorSource::description() const {
+    return QString("Имитатор: %1 комнат, %2 измерений/с").arg(roomCount).arg(samplesPerSecond);
+}
+
+StreamSensorSource::StreamSensorSource(const QString &path)
+    : path(path)
+{
+}
+
+StreamSensorSource::~StreamSensorSource() {
+    close();
+}
+
+/**
+ * @brief Открывает файл, именованный канал или подключается к Unix-сокету.
+ */
+bool StreamSensorSource::open() {
+#ifdef Q_OS_UNIX
+    const QByteArray localPath = QFile::encodeName(path);
+    struct stat info;
+    if (::stat(localPath.constData(), &info) != 0) {
+        qWarning() << "Источник измерений не найден:" << path;
+        return false;
+    }
+
+    if (S_ISSOCK(info.st_mode)) {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (size_t(localPath.size()) >= sizeof(address.sun_path)) {
+            qWarning() << "Слишком длинный путь к сокету:" << path;
+            return false;
+        }
+        std::memcpy(address.sun_path, localPath.constData(), size_t(localPath.size()));
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+            qWarning() << "Не удалось подключиться к сокету" << path << ":" << std::strerror(errno);
+            close();
+            return false;
+        }
+        endless = false;  // закрытие сокета отправителем - конец потока
+    } else {
+        fd = ::open(localPath.constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            qWarning() << "Не удалось открыть источник измерений" << path << ":" << std::strerror(errno);
+            return false;
+        }
+        endless = S_ISFIFO(info.st_mode);
+    }
+    buffered = 0;
+    return true;
+#else
+    qWarning() << "Потоковые источники измерений поддерживаются только в Unix:" << path;
+    return false;
+#endif
+}
+
+void StreamSensorSource::close() {
+#ifdef Q_OS_UNIX
+    if (fd >= 0)
+        ::close(fd);
+#endif
+    fd = -1;
+}
+
+QString StreamSensorSource::description() const {
+    return QString("Поток: %1").arg(path);
+}
+
+/**
+ * @brief Разбирает строку "<комната> <время> <температура> <влажность> <давление>".
+ *
+ * Используется std::from_chars: разбор не зависит от локали и не выделяет память.
+ */
+bool StreamSensorSource::parseLine(const char *begin, const char *end, SensorSample &sample) const {
+    auto skipSpaces = [end](const char *p) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            ++p;
+        return p;
+    };
+
+    const char *p = skipSpaces(begin);
+    qint32 roomId = 0;
+    auto room = std::from_chars(p, end, roomId);
+    if (room.ec != std::errc())
+        return false;
+
+    p = skipSpaces(room.ptr);
+    qint64 timestamp = 0;
+    auto time = std::from_chars(p, end, timestamp);
+    if (time.ec != std::errc())
+        return false;
+    p = time.ptr;
+
+    double values[3];
+    for (double &value : values) {
+        p = skipSpaces(p);
+        auto parsed = std::from_chars(p, end, value);
+        if (parsed.ec != std::errc())
+            return false;
+        p = parsed.ptr;
+    }
+
+    sample.timestampMs = timestamp;
+    sample.roomId = roomId;
+    sample.reserved = 0;
+    sample.temperature = values[0];
+    sample.humidity = values[1];
+    sample.pressure = values[2];
+    return true;
+}
+
+/**
+ * @brief Читает доступные данные и разбирает все полные строки.
+ *
+ * Незавершённая строка остаётся в начале буфера до следующего вызова; в
+ * конце файла она разбирается как последняя строка, следующий вызов
+ * возвращает -1.
+ */
+int StreamSensorSource::read(SensorSample *samples, int maxCount) {
+#ifdef Q_OS_UNIX
+    if (fd < 0)
+        return -1;
+
+    bool endOfInput = false;
+    if (buffered < BufferSize) {
+        pollfd waiter{fd, POLLIN, 0};
+        if (::poll(&waiter, 1, PollTimeoutMs) > 0) {
+            const ssize_t received = ::read(fd, buffer + buffered, size_t(BufferSize - buffered));
+            if (received > 0) {
+                buffered += int(received);
+            } else if (received == 0 && !endless) {
+                if (buffered == 0)
+                    return -1;
+                endOfInput = true;
+            } else if (received == 0 && buffered == 0) {
+                // У канала нет писателя: ждём следующего, не нагружая процессор
+                QThread::msleep(PollTimeoutMs);
+            } else if (received < 0 && errno != EAGAIN && errno != EINTR) {
+                return -1;
+            }
+        }
+    }
+
+    int count = 0;
+    const char *lineStart = buffer;
+    const char *bufferEnd = buffer + buffered;
+    while (count < maxCount) {
+        const char *lineEnd = static_cast<const char *>(std::memchr(lineStart, '\n', size_t(bufferEnd - lineStart)));
+        if (!lineEnd)
+            break;
+        if (parseLine(lineStart, lineEnd, samples[count]))
+            ++count;
+        lineStart = lineEnd + 1;
+    }
+    // Последняя строка файла без перевода строки: иначе буфер никогда не опустеет
+    if (endOfInput && count < maxCount && lineStart < bufferEnd) {
+        if (parseLine(lineStart, bufferEnd, samples[count]))
+            ++count;
+        lineStart = bufferEnd;
+    }
+
+    buffered = int(bufferEnd - lineStart);
+    if (buffered == BufferSize) {
+        qWarning() << "Слишком длинная строка в источнике измерений, данные отброшены";
+        buffered = 0;
+    } else if (buffered > 0 && lineStart != buffer) {
+        std::memmove(buffer, lineStart, size_t(buffered));
+    }
+    return count;
+#else
+    Q_UNUSED(samples);
+    Q_UNUSED(maxCount);
+    return -1;
+#endif
+}
+
+/**
+ * @brief Поток приёма: читает источник и пишет измерения в кольцевой буфер.
+ */
+class SensorIngestion::ReaderThread : public QThread {
+public:
+    ReaderThread(std::unique_ptr<SensorSource> source, SpscRingBuffer<SensorSample> &ring)
+        : source(std::move(source)), ring(ring)
+    {
+    }
+
+    void requestStop() { stopRequested.store(true, std::memory_order_relaxed); }
+    SensorSource *sensorSource() const { return source.get(); } ///< Живёт до удаления потока
+    quint64 stalls() const { return stallCount.load(std::memory_order_relaxed); }
+
+protected:
+    void run() override {
+        if (!source->open())
+            return;
+
+        SensorSample batch[BatchSize];
+        while (!stopRequested.load(std::memory_order_relaxed)) {
+            const int count = source->read(batch, BatchSize);
+            if (count < 0)
+                break;
+            if (count == 0) {
+                QThread::usleep(200);
+                continue;
+            }
+
+            // Буфер полон: ждём читателя, отдавая процессор, без потери измерений
+            size_t written = ring.push(batch, size_t(count));
+            while (written < size_t(count) && !stopRequested.load(std::memory_order_relaxed)) {
+                stallCount.fetch_add(1, std::memory_order_relaxed);
+                QThread::yieldCurrentThread();
+                written += ring.push(batch + written, size_t(count) - written);
+            }
+        }
+        source->close();
+    }
+
+private:
+    static constexpr int BatchSize = 1024;
+
+    std::unique_ptr<SensorSource> source;
+    SpscRingBuffer<SensorSample> &ring;
+    std::atomic<bool> stopRequested{false};
+    std::atomic<quint64> stallCount{0};
+};
+
+/**
+ * @brief Конструктор подсистемы приёма измерений.
+ * @param store Хранилище, в которое применяются измерения.
+ */
+SensorIngestion::SensorIngestion(RoomStateStore *store, QObject *parent)
+    : QObject(parent), store(store), ring(DefaultRingCapacity)
+{
+    drainTimer.setInterval(DrainIntervalMs);
+    connect(&drainTimer, &QTimer::timeout, this, &SensorIngestion::drain);
+}
+
+SensorIngestion::~SensorIngestion() {
+    stop();
+}
+
+/**
+ * @brief Запускает поток приёма для указанного источника.
+ * @return false, если приём уже идёт.
+ */
+bool SensorIngestion::start(std::unique_ptr<SensorSource> source) {
+    if (reader || !source)
+        return false;
+
+    qInfo() << "Приём измерений:" << source->description();
+    reader = new ReaderThread(std::move(source), ring);
+    connect(reader, &QThread::finished, this, [this]() {
+        // После stop() поток уже удалён, сообщать об исчерпании источника не нужно
+        if (!reader)
+            return;
+        drain();
+        emit sourceFinished();
+    });
+    reader->start();
+    drainTimer.start();
+    return true;
+}
+
+/**
+ * @brief Останавливает поток приёма и применяет оставшиеся измерения.
+ */
+void SensorIngestion::stop() {
+    if (!reader)
+        return;
+    reader->requestStop();
+    reader->wait();
+    drainTimer.stop();
+    drain();
+    delete reader;
+    reader = nullptr;
+}
+
+bool SensorIngestion::isRunning() const {
+    return reader && reader->isRunning();
+}
+
+quint64 SensorIngestion::producerStalls() const {
+    return reader ? reader->stalls() : 0;
+}
+
+bool SensorIngestion::writeSetpoint(int roomId, double celsius) {
+    return isRunning() && reader->sensorSource()->writeSetpoint(roomId, celsius);
+}
+
+bool SensorIngestion::writeAirflow(int roomId, AirflowDirection direction) {
+    return isRunning() && reader->sensorSource()->writeAirflow(roomId, direction);
+}
+
+bool SensorIngestion::setRoomAlarmed(int roomId, bool active) {
+    return isRunning() && reader->sensorSource()->setRoomAlarmed(roomId, active);
+}
+
+SensorSource::PollingStats SensorIngestion::pollingStats() const {
+    return reader ? reader->sensorSource()->pollingStats() : SensorSource::PollingStats();
+}
+
+/**
+ * @brief Забирает всё, что накопилось в буфере, и применяет к хранилищу.
+ *
+ * Данные передаются в RoomStateStore::applySamples() и получателям samplesApplied() прямо из памяти буфера.
+ */
+int SensorIngestion::drain() {
+    const size_t count = ring.consume(ring.capacity(), [this](const SensorSample *samples, size_t n) {
+        CLIMATE_PROFILE_SCOPE(SensorDrain);
+        store->applySamples(samples, int(n));
+        emit samplesApplied(samples, int(n));
+    });
+    appliedCount += count;
+    return int(count);
+}
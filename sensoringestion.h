@@ -0,0 +1,171 @@
+#ifndef SENSORINGESTION_H
+#define SENSORINGESTION_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+#include "sensorsample.h"
+#include "spscringbuffer.h"
+#include "roomstate.h"
+
+/**
+ * @brief Источник измерений датчиков.
+ *
+ * Методы вызываются только из потока приёма. read() не должен блокироваться
+ * надолго (не дольше нескольких десятков миллисекунд), чтобы поток мог
+ * вовремя завершиться.
+ */
+class SensorSource {
+public:
+    /// Счётчики опроса в сравнении с опросом всех комнат с постоянной частотой
+    struct PollingStats {
+        quint64 requests = 0;
+        quint64 fixedRateRequests = 0;
+        quint64 rooms = 0;            ///< Опрошено комнат (установок)
+        quint64 fixedRateRooms = 0;
+
+        double savedFraction() const { return fixedRateRooms ? 1.0 - double(rooms) / double(fixedRateRooms) : 0.0; }
+    };
+
+    virtual ~SensorSource() = default;
+
+    virtual bool open() = 0;
+    /**
+     * @brief Читает очередную порцию измерений.
+     * @return Число прочитанных измерений, 0 если данных пока нет, -1 если источник исчерпан.
+     */
+    virtual int read(SensorSample *buffer, int maxCount) = 0;
+    virtual void close() {}
+    virtual QString description() const = 0;
+
+    /**
+     * @brief Передаёт уставку на установку комнаты.
+     *
+     * В отличие от остальных методов вызывается из потока интерфейса (одного и
+     * того же), пока идёт приём; источник сам передаёт команду в поток приёма.
+     * @return false, если источник не управляет установками или очередь команд полна.
+     */
+    virtual bool writeSetpoint(int roomId, double celsius) { Q_UNUSED(roomId); Q_UNUSED(celsius); return false; }
+    /// Направление воздуха; вызывается так же, как writeSetpoint()
+    virtual bool writeAirflow(int roomId, AirflowDirection direction) { Q_UNUSED(roomId); Q_UNUSED(direction); return false; }
+    /// Тревога комнаты поднята или снята: источник с опросом может опрашивать её чаще; вызывается так же, как writeSetpoint()
+    virtual bool setRoomAlarmed(int roomId, bool active) { Q_UNUSED(roomId); Q_UNUSED(active); return false; }
+    /// Счётчики опроса; может вызываться из любого потока, пока идёт приём
+    virtual PollingStats pollingStats() const { return PollingStats(); }
+
+    /**
+     * @brief Создаёт источник по строке описания.
+     *
+     * "sim" или "sim:<измерений в секунду>" - встроенный имитатор (0 - без ограничения скорости),
+     * "hvac:<узел>[:<порт>]" - опрос климатических установок через шлюз (HvacDeviceSource),
+     * иначе - путь к файлу, именованному каналу или Unix-сокету с текстовыми строками
+     * "<комната> <время, мс> <температура> <влажность> <давление>".
+     */
+    static std::unique_ptr<SensorSource> create(const QString &spec, int roomCount);
+};
+
+/**
+ * @brief Имитатор датчиков: случайное блуждание значений по всем комнатам.
+ */
+class SimulatedSensorSource : public SensorSource {
+public:
+    SimulatedSensorSource(int roomCount, double samplesPerSecond);
+
+    bool open() override;
+    int read(SensorSample *buffer, int maxCount) override;
+    QString description() const override;
+
+private:
+    int roomCount;
+    double samplesPerSecond;      ///< 0 - генерировать с максимальной скоростью
+    qint64 startMs = 0;
+    quint64 generated = 0;
+    int nextRoom = 0;
+    quint32 randomState = 0x9e3779b9u;
+    QVector<double> temperature;  ///< Текущее состояние имитации по комнатам
+    QVector<double> humidity;
+    QVector<double> pressure;
+};
+
+/**
+ * @brief Текстовый поток измерений из файла, именованного канала или Unix-сокета.
+ *
+ * Чтение идёт через неблокирующий дескриптор с ожиданием poll(), разбор строк -
+ * в фиксированном буфере без выделения памяти.
+ */
+class StreamSensorSource : public SensorSource {
+public:
+    explicit StreamSensorSource(const QString &path);
+    ~StreamSensorSource() override;
+
+    bool open() override;
+    int read(SensorSample *buffer, int maxCount) override;
+    void close() override;
+    QString description() const override;
+
+private:
+    static constexpr int BufferSize = 64 * 1024;
+    static constexpr int PollTimeoutMs = 20;
+
+    bool parseLine(const char *begin, const char *end, SensorSample &sample) const;
+
+    QString path;
+    int fd = -1;
+    bool endless = false;   ///< Именованный канал: конец данных не означает конец источника
+    int buffered = 0;
+    char buffer[BufferSize];
+};
+
+/**
+ * @brief Подсистема приёма измерений датчиков.
+ *
+ * Источник читается в отдельном потоке, измерения передаются в поток
+ * интерфейса через SpscRingBuffer фиксированной ёмкости. Поток интерфейса
+ * забирает их пачками по таймеру и применяет к RoomStateStore одним вызовом
+ * applySamples(), без сигнала и выделения памяти на каждое измерение.
+ */
+class SensorIngestion : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr size_t DefaultRingCapacity = 1 << 18; ///< ~0.26 с при 1 млн измерений/с
+    static constexpr int DrainIntervalMs = 10;
+
+    explicit SensorIngestion(RoomStateStore *store, QObject *parent = nullptr);
+    ~SensorIngestion();
+
+    bool start(std::unique_ptr<SensorSource> source);
+    void stop();
+    bool isRunning() const;
+    quint64 samplesApplied() const { return appliedCount; }
+    quint64 producerStalls() const; ///< Сколько раз поток приёма ждал освобождения буфера
+
+    bool writeSetpoint(int roomId, double celsius);            ///< Уставка на установку через источник
+    bool writeAirflow(int roomId, AirflowDirection direction); ///< Направление воздуха через источник
+    bool setRoomAlarmed(int roomId, bool active);              ///< Состояние тревоги комнаты для расписания опроса
+    SensorSource::PollingStats pollingStats() const;
+
+public slots:
+    int drain(); ///< Применить накопленные измерения, возвращает их число
+
+signals:
+    void sourceFinished();
+    /// Пачка применена к хранилищу; samples действителен только на время вызова (соединение прямое)
+    void samplesApplied(const SensorSample *samples, int count);
+
+private:
+    class ReaderThread;
+
+    RoomStateStore *store;
+    SpscRingBuffer<SensorSample> ring;
+    QTimer drainTimer;
+    ReaderThread *reader = nullptr;
+    quint64 appliedCount = 0;
+};
+
+#endif // SENSORINGESTION_H
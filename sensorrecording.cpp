@@ -0,0 +1,620 @@
+#include "sensorrecording.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const char RecordingMagic[8] = {'C', 'L', 'I', 'M', 'R', 'E', 'C', '1'};
+const char IndexMagic[8] = {'C', 'L', 'I', 'M', 'I', 'D', 'X', '1'};
+const quint32 BlockMagic = 0x4b4c4231u;     ///< "1BLK"
+const quint32 ByteOrderMark = 0x01020304u;
+
+struct FileHeader {
+    char magic[8];
+    quint32 version;
+    quint32 byteOrderMark;
+    qint64 createdAtMs;
+};
+
+struct BlockHeader {
+    quint32 magic;
+    quint32 payloadBytes;
+    quint32 recordCount;
+    quint32 checksum;        ///< FNV-1a данных блока
+    qint64 firstTimestampMs;
+    qint64 lastTimestampMs;
+};
+
+struct IndexHeader {
+    char magic[8];
+    quint32 version;
+    quint32 reserved;
+};
+
+struct IndexEntry {
+    qint64 firstTimestampMs;
+    qint64 lastTimestampMs;
+    quint64 offset;          ///< Смещение заголовка блока
+    quint32 payloadBytes;
+    quint32 recordCount;
+};
+
+static_assert(sizeof(FileHeader) == 24, "Заголовок записи должен быть 24 байта");
+static_assert(sizeof(BlockHeader) == 32, "Заголовок блока должен быть 32 байта");
+static_assert(sizeof(IndexEntry) == 32, "Элемент индекса должен быть 32 байта");
+
+/// Младшие два бита метки - тип записи, для измерений биты 2..4 - величины, записанные целиком
+constexpr quint8 TypeMask = 0x3;
+constexpr int RawShift = 2;
+
+quint32 checksum(const uchar *data, quint64 size) {
+    quint32 hash = 2166136261u;
+    for (quint64 i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+quint64 zigzag(qint64 value) {
+    return (quint64(value) << 1) ^ quint64(value >> 63);
+}
+
+qint64 unzigzag(quint64 value) {
+    return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+/// Значение в фиксированной точке, если оно восстанавливается из неё без потерь
+bool toFixed(double value, qint64 &fixed) {
+    const double scaled = value * SensorRecording::ValueScale;
+    if (!(std::abs(scaled) < 1e15))
+        return false;
+    fixed = qint64(std::llround(scaled));
+    return double(fixed) / SensorRecording::ValueScale == value;
+}
+
+bool readVarint(const uchar *&p, const uchar *end, quint64 &value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        const uchar byte = *p++;
+        value |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+template <typename T>
+bool readRaw(const uchar *&p, const uchar *end, T &value) {
+    if (end - p < qint64(sizeof(T)))
+        return false;
+    std::memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+} // namespace
+
+QString SensorRecording::indexPath(const QString &recordingPath) {
+    return recordingPath + ".index";
+}
+
+/**
+ * @brief Конструктор; запись начинается после open().
+ */
+SensorRecorder::SensorRecorder(QObject *parent)
+    : QObject(parent)
+{
+    block.reserve(BlockBytes + 256);
+    flushTimer.setInterval(FlushIntervalMs);
+    connect(&flushTimer, &QTimer::timeout, this, &SensorRecorder::flush);
+}
+
+SensorRecorder::~SensorRecorder() {
+    close();
+}
+
+/**
+ * @brief Открывает файл записи для дописывания.
+ *
+ * У существующей записи отбрасывается недописанный хвост, а индекс
+ * пересобирается по найденным блокам.
+ */
+bool SensorRecorder::open(const QString &path) {
+    close();
+
+    QVector<IndexEntry> entries;
+    quint64 validEnd = 0;
+    if (QFileInfo(path).size() > 0) {
+        RecordingReader existing;
+        if (!existing.open(path)) {
+            qWarning() << "Файл" << path << "не является записью измерений, запись не начата.";
+            return false;
+        }
+        validEnd = sizeof(FileHeader);
+        if (!existing.blocks.empty())
+            validEnd = existing.blocks.back().offset + existing.blocks.back().payloadBytes;
+        for (const RecordingReader::Block &b : existing.blocks)
+            entries.append({b.firstTimestampMs, b.lastTimestampMs, b.offset - sizeof(BlockHeader),
+                            b.payloadBytes, b.recordCount});
+    }
+
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadWrite)) {
+        qWarning() << "Не удалось открыть файл записи" << path << ":" << file.errorString();
+        return false;
+    }
+    if (validEnd == 0) {
+        FileHeader header;
+        std::memcpy(header.magic, RecordingMagic, sizeof(header.magic));
+        header.version = SensorRecording::FormatVersion;
+        header.byteOrderMark = ByteOrderMark;
+        header.createdAtMs = QDateTime::currentMSecsSinceEpoch();
+        file.resize(0);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    } else {
+        file.resize(qint64(validEnd));
+        file.seek(qint64(validEnd));
+    }
+
+    indexFile.setFileName(SensorRecording::indexPath(path));
+    if (!indexFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Не удалось открыть индекс записи" << indexFile.fileName();
+        file.close();
+        return false;
+    }
+    IndexHeader indexHeader;
+    std::memcpy(indexHeader.magic, IndexMagic, sizeof(indexHeader.magic));
+    indexHeader.version = SensorRecording::FormatVersion;
+    indexHeader.reserved = 0;
+    indexFile.write(reinterpret_cast<const char *>(&indexHeader), sizeof(indexHeader));
+    indexFile.write(reinterpret_cast<const char *>(entries.constData()), entries.size() * int(sizeof(IndexEntry)));
+    indexFile.flush();
+
+    writtenBytes = quint64(file.pos());
+    flushTimer.start();
+    return true;
+}
+
+void SensorRecorder::close() {
+    if (!file.isOpen())
+        return;
+    flush();
+    flushTimer.stop();
+    file.close();
+    indexFile.close();
+}
+
+void SensorRecorder::beginRecord(quint8 tag, qint64 timestampMs) {
+    if (blockRecords == 0) {
+        blockFirstMs = timestampMs;
+        previousMs = timestampMs;
+    }
+    block.append(char(tag));
+    appendVarint(zigzag(timestampMs - previousMs));
+    previousMs = timestampMs;
+    ++blockRecords;
+    ++eventCount;
+}
+
+void SensorRecorder::appendVarint(quint64 value) {
+    while (value >= 0x80) {
+        block.append(char(value | 0x80));
+        value >>= 7;
+    }
+    block.append(char(value));
+}
+
+void SensorRecorder::appendRaw(const void *data, int size) {
+    block.append(static_cast<const char *>(data), size);
+}
+
+/**
+ * @brief Дописывает пачку измерений (вызывается рядом с RoomStateStore::applySamples()).
+ */
+void SensorRecorder::recordSamples(const SensorSample *samples, int count) {
+    if (!file.isOpen())
+        return;
+    for (int i = 0; i < count; ++i) {
+        const SensorSample &sample = samples[i];
+        if (sample.roomId < 0 || sample.roomId >= SensorRecording::MaxRooms)
+            continue;
+        const size_t room = size_t(sample.roomId);
+        if (room >= roomEpoch.size()) {
+            roomEpoch.resize(room + 1, 0);
+            previousValues.resize((room + 1) * MetricCount, 0);
+        }
+        qint64 *previous = previousValues.data() + room * MetricCount;
+        if (roomEpoch[room] != blockNumber) {
+            roomEpoch[room] = blockNumber;
+            std::fill(previous, previous + MetricCount, 0);
+        }
+
+        const double values[MetricCount] = {sample.temperature, sample.humidity, sample.pressure};
+        qint64 fixed[MetricCount];
+        quint8 tag = RecordedEvent::Sample;
+        for (int metric = 0; metric < MetricCount; ++metric) {
+            if (!toFixed(values[metric], fixed[metric]))
+                tag |= quint8(1 << (RawShift + metric));
+        }
+
+        beginRecord(tag, sample.timestampMs);
+        appendVarint(quint64(sample.roomId));
+        for (int metric = 0; metric < MetricCount; ++metric) {
+            if (tag & (1 << (RawShift + metric))) {
+                appendRaw(&values[metric], sizeof(double));
+            } else {
+                appendVarint(zigzag(fixed[metric] - previous[metric]));
+                previous[metric] = fixed[metric];
+            }
+        }
+        if (block.size() >= BlockBytes)
+            flush();
+    }
+}
+
+void SensorRecorder::recordSetpoint(qint64 timestampMs, int roomId, double celsius) {
+    if (!file.isOpen() || roomId < 0)
+        return;
+    beginRecord(RecordedEvent::Setpoint, timestampMs);
+    appendVarint(quint64(roomId));
+    appendRaw(&celsius, sizeof(celsius));
+    if (block.size() >= BlockBytes)
+        flush();
+}
+
+void SensorRecorder::recordSystemState(qint64 timestampMs, bool enabled) {
+    if (!file.isOpen())
+        return;
+    beginRecord(RecordedEvent::SystemState, timestampMs);
+    block.append(char(enabled ? 1 : 0));
+    if (block.size() >= BlockBytes)
+        flush();
+}
+
+/**
+ * @brief Дописывает блок и его элемент индекса; следующий блок кодируется с нуля.
+ */
+void SensorRecorder::flush() {
+    if (!file.isOpen() || blockRecords == 0)
+        return;
+
+    BlockHeader header;
+    header.magic = BlockMagic;
+    header.payloadBytes = quint32(block.size());
+    header.recordCount = blockRecords;
+    header.checksum = checksum(reinterpret_cast<const uchar *>(block.constData()), quint64(block.size()));
+    header.firstTimestampMs = blockFirstMs;
+    header.lastTimestampMs = previousMs;
+
+    const IndexEntry entry = {header.firstTimestampMs, header.lastTimestampMs, quint64(file.pos()),
+                              header.payloadBytes, header.recordCount};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(block);
+    file.flush();
+    indexFile.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+    indexFile.flush();
+
+    writtenBytes += sizeof(header) + quint64(block.size());
+    block.clear();
+    blockRecords = 0;
+    ++blockNumber;
+}
+
+RecordingReader::~RecordingReader() {
+    close();
+}
+
+/**
+ * @brief Отображает запись в память и читает индекс.
+ *
+ * Блоки после последнего проиндексированного находятся по заголовкам.
+ */
+bool RecordingReader::open(const QString &path) {
+    close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Не удалось открыть запись" << path;
+        return false;
+    }
+    size = quint64(file.size());
+    if (size < sizeof(FileHeader)) {
+        close();
+        return false;
+    }
+    base = file.map(0, qint64(size));
+    if (!base) {
+        qWarning() << "Не удалось отобразить запись в память:" << file.errorString();
+        close();
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, RecordingMagic, sizeof(header.magic)) != 0
+        || header.version != SensorRecording::FormatVersion
+        || header.byteOrderMark != ByteOrderMark) {
+        qWarning() << "Файл" << path << "не является записью измерений или имеет другую версию.";
+        close();
+        return false;
+    }
+
+    quint64 scanFrom = sizeof(FileHeader);
+    QFile index(SensorRecording::indexPath(path));
+    if (index.open(QIODevice::ReadOnly)) {
+        IndexHeader indexHeader;
+        if (index.read(reinterpret_cast<char *>(&indexHeader), sizeof(indexHeader)) == qint64(sizeof(indexHeader))
+            && std::memcmp(indexHeader.magic, IndexMagic, sizeof(indexHeader.magic)) == 0
+            && indexHeader.version == SensorRecording::FormatVersion) {
+            const QByteArray data = index.readAll();
+            const int count = data.size() / int(sizeof(IndexEntry));
+            blocks.reserve(size_t(count));
+            for (int i = 0; i < count; ++i) {
+                IndexEntry entry;
+                std::memcpy(&entry, data.constData() + size_t(i) * sizeof(IndexEntry), sizeof(entry));
+                const quint64 dataOffset = entry.offset + sizeof(BlockHeader);
+                if (entry.offset != scanFrom || dataOffset > size || entry.payloadBytes > size - dataOffset)
+                    break;
+                blocks.push_back({entry.firstTimestampMs, entry.lastTimestampMs, dataOffset,
+                                  entry.payloadBytes, entry.recordCount});
+                scanFrom = dataOffset + entry.payloadBytes;
+            }
+        }
+    }
+
+    Block block;
+    while (readBlockHeader(scanFrom, block)) {
+        blocks.push_back(block);
+        scanFrom = block.offset + block.payloadBytes;
+    }
+    return true;
+}
+
+void RecordingReader::close() {
+    if (base)
+        file.unmap(const_cast<uchar *>(base));
+    base = nullptr;
+    size = 0;
+    blocks.clear();
+    file.close();
+}
+
+/**
+ * @brief Читает и проверяет заголовок и контрольную сумму блока, начинающегося с offset.
+ */
+bool RecordingReader::readBlockHeader(quint64 offset, Block &block) const {
+    if (offset > size || size - offset < sizeof(BlockHeader))
+        return false;
+    BlockHeader header;
+    std::memcpy(&header, base + offset, sizeof(header));
+    const quint64 dataOffset = offset + sizeof(BlockHeader);
+    if (header.magic != BlockMagic || header.payloadBytes > size - dataOffset
+        || checksum(base + dataOffset, header.payloadBytes) != header.checksum)
+        return false;
+    block = {header.firstTimestampMs, header.lastTimestampMs, dataOffset, header.payloadBytes, header.recordCount};
+    return true;
+}
+
+qint64 RecordingReader::firstTimestampMs() const {
+    return blocks.empty() ? 0 : blocks.front().firstTimestampMs;
+}
+
+qint64 RecordingReader::lastTimestampMs() const {
+    return blocks.empty() ? 0 : blocks.back().lastTimestampMs;
+}
+
+int RecordingReader::findBlock(qint64 timestampMs) const {
+    const auto after = std::upper_bound(blocks.begin(), blocks.end(), timestampMs,
+                                        [](qint64 value, const Block &block) {
+                                            return value < block.firstTimestampMs;
+                                        });
+    return std::max(int(after - blocks.begin()) - 1, 0);
+}
+
+RecordingReader::Cursor::Cursor(const RecordingReader *reader, int block)
+    : reader(reader), blockIndex(block - 1)
+{
+    if (reader)
+        enterBlock(block);
+}
+
+/**
+ * @brief Переходит к блоку; блоки, найденные по индексу, проверяются по контрольной сумме здесь.
+ */
+bool RecordingReader::Cursor::enterBlock(int index) {
+    blockIndex = index;
+    remaining = 0;
+    if (!reader || index < 0 || index >= reader->blockCount())
+        return false;
+    const Block &block = reader->blocks[size_t(index)];
+    Block verified;
+    if (!reader->readBlockHeader(block.offset - sizeof(BlockHeader), verified)) {
+        qWarning() << "Повреждён блок записи" << index;
+        return false;
+    }
+    position = reader->base + block.offset;
+    end = position + block.payloadBytes;
+    remaining = block.recordCount;
+    previousMs = block.firstTimestampMs;
+    return true;
+}
+
+bool RecordingReader::Cursor::next(RecordedEvent &event) {
+    while (remaining == 0) {
+        if (!reader || blockIndex + 1 >= reader->blockCount() || !enterBlock(blockIndex + 1))
+            return false;
+    }
+    --remaining;
+
+    const uchar *p = position;
+    quint64 value = 0;
+    if (p >= end)
+        return false;
+    const quint8 tag = *p++;
+    if (!readVarint(p, end, value))
+        return false;
+    event.timestampMs = previousMs + unzigzag(value);
+    previousMs = event.timestampMs;
+    event.type = RecordedEvent::Type(tag & TypeMask);
+
+    switch (event.type) {
+    case RecordedEvent::Sample: {
+        if (!readVarint(p, end, value))
+            return false;
+        // Номер комнаты задаёт размер таблиц курсора: проверяем его и в блоке с верной контрольной суммой
+        if (value >= quint64(SensorRecording::MaxRooms))
+            return false;
+        const size_t room = size_t(value);
+        if (room >= roomEpoch.size()) {
+            roomEpoch.resize(room + 1, -1);
+            previousValues.resize((room + 1) * MetricCount, 0);
+        }
+        qint64 *previous = previousValues.data() + room * MetricCount;
+        if (roomEpoch[room] != blockIndex) {
+            roomEpoch[room] = blockIndex;
+            std::fill(previous, previous + MetricCount, 0);
+        }
+        double values[MetricCount];
+        for (int metric = 0; metric < MetricCount; ++metric) {
+            if (tag & (1 << (RawShift + metric))) {
+                if (!readRaw(p, end, values[metric]))
+                    return false;
+            } else {
+                if (!readVarint(p, end, value))
+                    return false;
+                previous[metric] += unzigzag(value);
+                values[metric] = double(previous[metric]) / SensorRecording::ValueScale;
+            }
+        }
+        event.sample = {event.timestampMs, qint32(room), 0, values[0], values[1], values[2]};
+        break;
+    }
+    case RecordedEvent::Setpoint:
+        if (!readVarint(p, end, value) || !readRaw(p, end, event.setpoint))
+            return false;
+        event.roomId = qint32(value);
+        break;
+    case RecordedEvent::SystemState:
+        if (p >= end)
+            return false;
+        event.systemState = *p++ != 0;
+        break;
+    default:
+        return false;
+    }
+    position = p;
+    return true;
+}
+
+/**
+ * @brief Конструктор проигрывателя.
+ * @param store Хранилище, к которому применяется запись.
+ */
+RecordingPlayer::RecordingPlayer(RoomStateStore *store, QObject *parent)
+    : QObject(parent), store(store)
+{
+    sampleBuffer.reserve(MaxBatch);
+    connect(&timer, &QTimer::timeout, this, &RecordingPlayer::tick);
+}
+
+bool RecordingPlayer::open(const QString &path) {
+    stop();
+    if (!reader.open(path))
+        return false;
+    cursor = reader.cursor(0);
+    hasPending = false;
+    positionMs = reader.firstTimestampMs();
+    qInfo().noquote() << QString("Запись %1: %2 блоков, %3 - %4")
+                             .arg(path)
+                             .arg(reader.blockCount())
+                             .arg(QDateTime::fromMSecsSinceEpoch(reader.firstTimestampMs()).toString(Qt::ISODate))
+                             .arg(QDateTime::fromMSecsSinceEpoch(reader.lastTimestampMs()).toString(Qt::ISODate));
+    return true;
+}
+
+void RecordingPlayer::start(double speed) {
+    playbackSpeed = std::max(speed, 0.0);
+    startPositionMs = positionMs;
+    clock.start();
+    timer.start(playbackSpeed > 0.0 ? TickIntervalMs : 0);
+}
+
+void RecordingPlayer::stop() {
+    timer.stop();
+}
+
+void RecordingPlayer::seek(qint64 timestampMs) {
+    cursor = reader.cursor(reader.findBlock(timestampMs));
+    hasPending = false;
+    sampleBuffer.clear();
+    RecordedEvent event;
+    while (cursor.next(event)) {
+        if (event.timestampMs >= timestampMs) {
+            pending = event;
+            hasPending = true;
+            break;
+        }
+        if (event.type != RecordedEvent::Sample)
+            applyEvent(event);
+    }
+    positionMs = timestampMs;
+    startPositionMs = timestampMs;
+    clock.restart();
+}
+
+/**
+ * @brief Применяет все записи, время которых наступило.
+ */
+void RecordingPlayer::tick() {
+    const qint64 dueMs = playbackSpeed > 0.0
+                             ? startPositionMs + qint64(double(clock.elapsed()) * playbackSpeed)
+                             : std::numeric_limits<qint64>::max();
+    RecordedEvent event;
+    while (sampleBuffer.size() < size_t(MaxBatch)) {
+        if (!hasPending) {
+            if (!cursor.next(event)) {
+                applyBatch();
+                timer.stop();
+                emit finished();
+                return;
+            }
+            pending = event;
+            hasPending = true;
+        }
+        if (pending.timestampMs > dueMs)
+            break;
+        hasPending = false;
+        positionMs = std::max(positionMs, pending.timestampMs);
+        if (pending.type == RecordedEvent::Sample) {
+            sampleBuffer.push_back(pending.sample);
+        } else {
+            applyBatch();
+            applyEvent(pending);
+        }
+    }
+    applyBatch();
+}
+
+void RecordingPlayer::applyBatch() {
+    if (sampleBuffer.empty())
+        return;
+    store->applySamples(sampleBuffer.data(), int(sampleBuffer.size()));
+    emit samplesApplied(sampleBuffer.data(), int(sampleBuffer.size()));
+    sampleBuffer.clear();
+}
+
+void RecordingPlayer::applyEvent(const RecordedEvent &event) {
+    if (event.type == RecordedEvent::Setpoint) {
+        if (store->isValidRoom(event.roomId))
+            store->setSetpoint(event.roomId, event.setpoint);
+    } else if (event.type == RecordedEvent::SystemState) {
+        emit systemStateChanged(event.systemState);
+    }
+}
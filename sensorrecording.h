@@ -0,0 +1,230 @@
+#ifndef SENSORRECORDING_H
+#define SENSORRECORDING_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include <QTimer>
+#include <vector>
+
+#include "sensorsample.h"
+#include "roomstate.h"
+
+/**
+ * @brief Запись из файла записи: измерение, уставка или включение установки.
+ */
+struct RecordedEvent {
+    enum Type : quint8 {
+        Sample = 0,
+        Setpoint,
+        SystemState
+    };
+
+    Type type;
+    bool systemState;     ///< Для SystemState
+    qint32 roomId;        ///< Для Setpoint (у Sample - sample.roomId)
+    double setpoint;      ///< Для Setpoint, °C
+    qint64 timestampMs;
+    SensorSample sample;  ///< Для Sample
+};
+
+/**
+ * @brief Формат записи потока измерений.
+ *
+ * Файл записи: заголовок и блоки, дописываемые в конец. Каждый блок
+ * начинается с заголовка (размер, число записей, время первой и последней
+ * записи, контрольная сумма) и декодируется независимо от остальных: время
+ * кодируется разностью с предыдущей записью блока, значения - разностью
+ * с предыдущим измерением той же комнаты в этом блоке, в фиксированной
+ * точке 1/ValueScale. Значение, которое не представимо в фиксированной
+ * точке без потерь, пишется целиком, так что воспроизведение точное.
+ *
+ * Рядом лежит индекс (путь + ".index"): время начала и смещение каждого
+ * блока. По нему переход к любому моменту записи - двоичный поиск и
+ * декодирование одного блока. Блоки, которых нет в индексе (например,
+ * после аварийного завершения), находятся просмотром заголовков от
+ * последнего проиндексированного блока; недописанный блок в конце
+ * отбрасывается по контрольной сумме.
+ */
+namespace SensorRecording {
+constexpr quint32 FormatVersion = 1;
+constexpr double ValueScale = 1000.0;
+constexpr int MaxRooms = 1 << 20;   ///< Номер комнаты в записи меньше; иначе запись не пишется, а при чтении блок считается повреждённым
+QString indexPath(const QString &recordingPath);
+}
+
+/**
+ * @brief Запись измерений, уставок и включения установки в файл.
+ *
+ * Записи копятся в блоке в памяти; блок дописывается в файл, когда
+ * достигает BlockBytes или по таймеру раз в FlushIntervalMs, поэтому
+ * при сбое теряется не больше последней секунды.
+ */
+class SensorRecorder : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int BlockBytes = 64 * 1024;
+    static constexpr int FlushIntervalMs = 1000;
+
+    explicit SensorRecorder(QObject *parent = nullptr);
+    ~SensorRecorder();
+
+    bool open(const QString &path); ///< Продолжает существующую запись или создаёт новую
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+    QString path() const { return file.fileName(); }
+
+    void recordSamples(const SensorSample *samples, int count);
+    void recordSetpoint(qint64 timestampMs, int roomId, double celsius);
+    void recordSystemState(qint64 timestampMs, bool enabled);
+
+    quint64 recordedEvents() const { return eventCount; }
+    quint64 bytesWritten() const { return writtenBytes; }
+
+public slots:
+    void flush(); ///< Дописать текущий блок в файл
+
+private:
+    void beginRecord(quint8 tag, qint64 timestampMs);
+    void appendVarint(quint64 value);
+    void appendRaw(const void *data, int size);
+
+    QFile file;
+    QFile indexFile;
+    QTimer flushTimer;
+    QByteArray block;              ///< Данные текущего блока без заголовка
+    quint32 blockRecords = 0;
+    qint64 blockFirstMs = 0;
+    qint64 previousMs = 0;         ///< Время предыдущей записи блока
+    quint32 blockNumber = 1;       ///< Метка блока в roomEpoch
+    std::vector<quint32> roomEpoch;        ///< Блок, в котором комната уже встречалась
+    std::vector<qint64> previousValues;    ///< [комната * MetricCount + величина], фиксированная точка
+    quint64 eventCount = 0;
+    quint64 writtenBytes = 0;
+};
+
+/**
+ * @brief Чтение записи через отображение файла в память.
+ */
+class RecordingReader {
+public:
+    RecordingReader() = default;
+    ~RecordingReader();
+    RecordingReader(const RecordingReader &) = delete;
+    RecordingReader &operator=(const RecordingReader &) = delete;
+
+    bool open(const QString &path);
+    void close();
+
+    int blockCount() const { return int(blocks.size()); }
+    qint64 firstTimestampMs() const;
+    qint64 lastTimestampMs() const;
+    int findBlock(qint64 timestampMs) const; ///< Последний блок, начинающийся не позже timestampMs
+
+    /**
+     * @brief Последовательное чтение записей начиная с блока.
+     */
+    class Cursor {
+    public:
+        explicit Cursor(const RecordingReader *reader = nullptr, int block = 0);
+        bool next(RecordedEvent &event); ///< false - записи закончились или данные повреждены
+        int block() const { return blockIndex; }
+
+    private:
+        bool enterBlock(int index);
+
+        const RecordingReader *reader;
+        int blockIndex;
+        const uchar *position = nullptr;
+        const uchar *end = nullptr;
+        quint32 remaining = 0;
+        qint64 previousMs = 0;
+        std::vector<int> roomEpoch;            ///< Блок, в котором комната уже встречалась (-1 - нет)
+        std::vector<qint64> previousValues;
+    };
+
+    Cursor cursor(int block = 0) const { return Cursor(this, block); }
+
+private:
+    friend class SensorRecorder; ///< Продолжение записи после последнего целого блока
+
+    struct Block {
+        qint64 firstTimestampMs;
+        qint64 lastTimestampMs;
+        quint64 offset;        ///< Смещение данных блока (после заголовка)
+        quint32 payloadBytes;
+        quint32 recordCount;
+    };
+
+    bool readBlockHeader(quint64 offset, Block &block) const;
+
+    QFile file;
+    const uchar *base = nullptr;
+    quint64 size = 0;
+    std::vector<Block> blocks;
+};
+
+/**
+ * @brief Воспроизведение записи в реальном времени, с ускорением или без ограничения скорости.
+ *
+ * Работает в потоке интерфейса: записи декодируются по таймеру прямо из
+ * отображённого файла, измерения применяются пачкой, как от датчиков
+ * (хранилище и samplesApplied()), уставки и включение установки - в том же
+ * порядке, в каком были записаны. Без ограничения скорости за один шаг
+ * таймера применяется не больше MaxBatch измерений, чтобы интерфейс
+ * оставался отзывчивым.
+ */
+class RecordingPlayer : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int TickIntervalMs = 10;
+    static constexpr int MaxBatch = 64 * 1024;
+
+    explicit RecordingPlayer(RoomStateStore *store, QObject *parent = nullptr);
+
+    bool open(const QString &path);
+    void start(double speed = 1.0); ///< speed - секунд записи в секунду, 0 - без ограничения
+    void stop();
+    bool isPlaying() const { return timer.isActive(); }
+
+    /**
+     * @brief Переходит к моменту записи.
+     *
+     * Декодируется только блок, содержащий timestampMs: измерения до этого
+     * момента пропускаются, уставки и включение установки применяются.
+     */
+    void seek(qint64 timestampMs);
+    qint64 position() const { return positionMs; } ///< Время последней применённой записи
+    const RecordingReader &recording() const { return reader; }
+
+signals:
+    void systemStateChanged(bool enabled); ///< Записанное включение установки
+    /// Пачка применена к хранилищу; samples действителен только на время вызова (соединение прямое)
+    void samplesApplied(const SensorSample *samples, int count);
+    void finished();
+
+private slots:
+    void tick();
+
+private:
+    void applyBatch();
+    void applyEvent(const RecordedEvent &event);
+
+    RoomStateStore *store;
+    RecordingReader reader;
+    RecordingReader::Cursor cursor;
+    RecordedEvent pending;          ///< Прочитанная, но ещё не наступившая запись
+    bool hasPending = false;
+    double playbackSpeed = 1.0;
+    qint64 positionMs = 0;          ///< Время записи, до которого всё применено
+    qint64 startPositionMs = 0;
+    QElapsedTimer clock;
+    QTimer timer;
+    std::vector<SensorSample> sampleBuffer;
+};
+
+#endif // SENSORRECORDING_H
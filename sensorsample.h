@@ -0,0 +1,23 @@
+#ifndef SENSORSAMPLE_H
+#define SENSORSAMPLE_H
+
+#include <QtGlobal>
+
+/**
+ * @brief Одно измерение датчика комнаты.
+ *
+ * Простая структура фиксированного размера: копируется в кольцевой буфер
+ * побайтно и не требует выделения памяти.
+ */
+struct SensorSample {
+    qint64 timestampMs;   ///< Время измерения, мс от начала эпохи
+    qint32 roomId;        ///< Идентификатор комнаты (начиная с 0)
+    qint32 reserved;      ///< Выравнивание
+    double temperature;   ///< °C
+    double humidity;      ///< %
+    double pressure;      ///< Па
+};
+
+Q_DECLARE_TYPEINFO(SensorSample, Q_PRIMITIVE_TYPE);
+
+#endif // SENSORSAMPLE_H
@@ -0,0 +1,134 @@
+#include "sharedstate.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SharedStateReader::~SharedStateReader() {
+    close();
+}
+
+/**
+ * @brief Отображает сегмент name только для чтения и проверяет раскладку.
+ */
+bool SharedStateReader::open(const std::string &name) {
+    close();
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        error = "shm_open " + name + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || std::size_t(info.st_size) < sizeof(SharedStateHeader)) {
+        error = "Сегмент " + name + " слишком мал";
+        ::close(fd);
+        return false;
+    }
+    void *mapping = mmap(nullptr, std::size_t(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        error = "mmap " + name + ": " + std::strerror(errno);
+        return false;
+    }
+    mappedBytes = std::size_t(info.st_size);
+    header = static_cast<const SharedStateHeader *>(mapping);
+
+    if (std::memcmp(header->magic, SharedState::Magic, sizeof(SharedState::Magic)) != 0
+        || header->version != SharedState::FormatVersion
+        || header->headerBytes != sizeof(SharedStateHeader)
+        || header->recordBytes != sizeof(SharedRoomRecord)
+        || header->blockRooms != SharedState::BlockRooms
+        // Смещения и число блоков однозначно следуют из roomCapacity: readBlock() не выйдет за отображение
+        || header->blockCount != (std::uint64_t(header->roomCapacity) + SharedState::BlockRooms - 1) / SharedState::BlockRooms
+        || header->blocksOffset != sizeof(SharedStateHeader)
+        || header->roomsOffset != header->blocksOffset + std::uint64_t(header->blockCount) * sizeof(SharedBlockSequence)
+        || SharedState::segmentBytes(header->roomCapacity) > mappedBytes) {
+        error = "Сегмент " + name + " имеет другую раскладку или версию";
+        close();
+        return false;
+    }
+    const char *base = static_cast<const char *>(mapping);
+    blocks = reinterpret_cast<const SharedBlockSequence *>(base + header->blocksOffset);
+    records = reinterpret_cast<const SharedRoomRecord *>(base + header->roomsOffset);
+    error.clear();
+    return true;
+}
+
+void SharedStateReader::close() {
+    if (header)
+        munmap(const_cast<SharedStateHeader *>(header), mappedBytes);
+    header = nullptr;
+    blocks = nullptr;
+    records = nullptr;
+    mappedBytes = 0;
+}
+
+bool SharedStateReader::isStale() const {
+    return header && header->closed.load(std::memory_order_acquire) != 0;
+}
+
+std::uint32_t SharedStateReader::roomCount() const {
+    return header ? std::min(header->roomCount.load(std::memory_order_acquire), header->roomCapacity) : 0;
+}
+
+std::uint64_t SharedStateReader::publishCount() const {
+    return header ? header->publishCount.load(std::memory_order_acquire) : 0;
+}
+
+std::int64_t SharedStateReader::publishTimeMs() const {
+    return header ? header->publishTimeMs.load(std::memory_order_acquire) : 0;
+}
+
+std::int64_t SharedStateReader::writerPid() const {
+    return header ? header->writerPid.load(std::memory_order_relaxed) : 0;
+}
+
+/**
+ * @brief Согласованная копия комнат [first, first + count) одного блока.
+ *
+ * Чтение по схеме seqlock: счётчик до копирования (acquire), копия,
+ * барьер acquire и повторное чтение счётчика. Копия, во время которой
+ * писатель менял блок, отбрасывается, поэтому разорванные значения
+ * наружу не попадают.
+ */
+bool SharedStateReader::readBlock(std::uint32_t block, std::uint32_t first, std::uint32_t count,
+                                  SharedRoomRecord *out) const {
+    const std::atomic<std::uint32_t> &sequence = blocks[block].sequence;
+    for (int attempt = 0; attempt < MaxRetries; ++attempt) {
+        const std::uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1u) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::memcpy(out, records + first, count * sizeof(SharedRoomRecord));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before)
+            return true;
+    }
+    return false;
+}
+
+bool SharedStateReader::readRoom(std::uint32_t roomId, SharedRoomRecord &record) const {
+    if (!header || roomId >= roomCount())
+        return false;
+    return readBlock(roomId / SharedState::BlockRooms, roomId, 1, &record);
+}
+
+bool SharedStateReader::snapshot(std::vector<SharedRoomRecord> &rooms) const {
+    if (!header)
+        return false;
+    const std::uint32_t count = roomCount();
+    rooms.resize(count);
+    for (std::uint32_t first = 0; first < count; first += SharedState::BlockRooms) {
+        if (!readBlock(first / SharedState::BlockRooms, first,
+                       std::min(SharedState::BlockRooms, count - first), rooms.data() + first))
+            return false;
+    }
+    return true;
+}
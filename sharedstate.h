@@ -0,0 +1,133 @@
+#ifndef SHAREDSTATE_H
+#define SHAREDSTATE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Раскладка сегмента разделяемой памяти с текущим состоянием комнат.
+ *
+ * Сегмент POSIX (shm_open) публикуется ядром (SharedStateExporter) и читается
+ * другими процессами через SharedStateReader. Заголовок файла не зависит от
+ * Qt, чтобы сторонние утилиты могли собирать его без остального ядра.
+ *
+ * Раскладка версии 1, все смещения от начала сегмента:
+ *
+ *     [SharedStateHeader, 128 байт]
+ *     [SharedBlockSequence x blockCount, по 64 байта]
+ *     [SharedRoomRecord x roomCapacity, по 48 байт]
+ *
+ * Комнаты разбиты на блоки по BlockRooms; у каждого блока свой счётчик
+ * последовательной блокировки (seqlock) в отдельной кэш-линии. Писатель
+ * делает счётчик нечётным, копирует записи блока и делает его снова чётным;
+ * читатель копирует блок, если счётчик чётный и не изменился за время
+ * копирования, и повторяет иначе. Писатель никогда не ждёт читателей,
+ * а читатели не пишут в сегмент и отображают его только для чтения.
+ *
+ * Число комнат больше roomCapacity писатель не расширяет на месте: старый
+ * сегмент помечается closed, и под тем же именем создаётся новый. Читатель,
+ * увидевший closed, должен открыть сегмент заново.
+ */
+namespace SharedState {
+constexpr char Magic[8] = {'C', 'L', 'I', 'M', 'S', 'H', 'M', '1'};
+constexpr std::uint32_t FormatVersion = 1;
+constexpr std::uint32_t BlockRooms = 64;
+constexpr const char *DefaultName = "/climate-state";
+}
+
+struct SharedStateHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t headerBytes;
+    std::uint32_t recordBytes;
+    std::uint32_t blockRooms;
+    std::uint32_t roomCapacity;
+    std::uint32_t blockCount;
+    std::uint64_t blocksOffset;
+    std::uint64_t roomsOffset;
+    std::atomic<std::uint32_t> roomCount;     ///< Текущее число комнат, не больше roomCapacity
+    std::atomic<std::uint32_t> closed;        ///< 1 - писатель завершился или заменил сегмент
+    std::atomic<std::uint64_t> publishCount;  ///< Число публикаций, растёт с каждой
+    std::atomic<std::int64_t> publishTimeMs;  ///< Время последней публикации, мс от эпохи
+    std::atomic<std::int64_t> writerPid;
+    char reserved[48];
+};
+
+struct alignas(64) SharedBlockSequence {
+    std::atomic<std::uint32_t> sequence;      ///< Нечётное - блок переписывается
+    char reserved[60];
+};
+
+/// Состояние комнаты в базовых единицах RoomStateStore
+struct SharedRoomRecord {
+    double temperature;   ///< °C
+    double humidity;      ///< %
+    double pressure;      ///< Па
+    double setpoint;      ///< °C
+    double output;        ///< Мощность установки, -1..1
+    std::uint32_t airflow; ///< Значение AirflowDirection
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(SharedStateHeader) == 128, "SharedStateHeader is part of the segment layout");
+static_assert(sizeof(SharedBlockSequence) == 64, "SharedBlockSequence is part of the segment layout");
+static_assert(sizeof(SharedRoomRecord) == 48, "SharedRoomRecord is part of the segment layout");
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free && std::atomic<std::uint64_t>::is_always_lock_free,
+              "Atomics shared between processes must be lock-free");
+
+namespace SharedState {
+/// Размер сегмента с местом под roomCapacity комнат
+constexpr std::size_t segmentBytes(std::uint32_t roomCapacity) {
+    return sizeof(SharedStateHeader) + (std::size_t(roomCapacity) + BlockRooms - 1) / BlockRooms * sizeof(SharedBlockSequence)
+           + std::size_t(roomCapacity) * sizeof(SharedRoomRecord);
+}
+}
+
+/**
+ * @brief Чтение состояния комнат из сегмента другого процесса.
+ *
+ * Сегмент отображается только для чтения, копирование идёт прямо из
+ * разделяемой памяти без системных вызовов. Снимок согласован внутри
+ * каждого блока комнат; блоки могут относиться к соседним публикациям.
+ */
+class SharedStateReader {
+public:
+    static constexpr int MaxRetries = 1000; ///< Попыток на блок, пока писатель его переписывает
+
+    SharedStateReader() = default;
+    ~SharedStateReader();
+    SharedStateReader(const SharedStateReader &) = delete;
+    SharedStateReader &operator=(const SharedStateReader &) = delete;
+
+    bool open(const std::string &name = SharedState::DefaultName);
+    void close();
+    bool isOpen() const { return header != nullptr; }
+    bool isStale() const;            ///< Писатель закрыл сегмент, нужен повторный open()
+    const std::string &errorString() const { return error; }
+
+    std::uint32_t roomCount() const;
+    std::uint64_t publishCount() const;
+    std::int64_t publishTimeMs() const;
+    std::int64_t writerPid() const;
+
+    bool readRoom(std::uint32_t roomId, SharedRoomRecord &record) const;
+    /**
+     * @brief Копирует все комнаты в rooms.
+     * @return false, если сегмент не открыт или блок не удалось прочитать за MaxRetries попыток.
+     */
+    bool snapshot(std::vector<SharedRoomRecord> &rooms) const;
+
+private:
+    bool readBlock(std::uint32_t block, std::uint32_t first, std::uint32_t count, SharedRoomRecord *out) const;
+
+    const SharedStateHeader *header = nullptr;
+    const SharedBlockSequence *blocks = nullptr;
+    const SharedRoomRecord *records = nullptr;
+    std::size_t mappedBytes = 0;
+    std::string error;
+};
+
+#endif // SHAREDSTATE_H
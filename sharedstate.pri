@@ -0,0 +1,14 @@
+# Чтение состояния комнат из разделяемой памяти (SharedStateReader).
+# Не зависит от Qt: подключается утилитами, которые читают состояние ядра
+# из другого процесса (см. tools/statedump).
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+        $$PWD/sharedstate.cpp
+
+HEADERS += \
+    $$PWD/sharedstate.h
+
+unix:!macx: LIBS += -lrt
@@ -0,0 +1,228 @@
+#include "sharedstateexporter.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * @brief Конструктор; сегмент создаётся только open().
+ * @param store Хранилище, состояние которого публикуется.
+ */
+SharedStateExporter::SharedStateExporter(RoomStateStore *store, QObject *parent)
+    : QObject(parent), store(store)
+{
+    timer.setSingleShot(true);
+    timer.setInterval(PublishIntervalMs);
+    connect(&timer, &QTimer::timeout, this, &SharedStateExporter::publish);
+    connect(store, &RoomStateStore::roomChanged, this, &SharedStateExporter::roomChanged);
+    connect(store, &RoomStateStore::allRoomsChanged, this, &SharedStateExporter::allRoomsChanged);
+    connect(store, &RoomStateStore::samplesApplied, this, &SharedStateExporter::samplesApplied);
+    connect(store, &RoomStateStore::outputsApplied, this, &SharedStateExporter::samplesApplied);
+    connect(store, &RoomStateStore::roomsReset, this, &SharedStateExporter::roomsReset);
+}
+
+SharedStateExporter::~SharedStateExporter() {
+    close();
+}
+
+bool SharedStateExporter::open(const QString &name) {
+    close();
+    segmentName = name.startsWith('/') ? name : '/' + name;
+    if (!createSegment(quint32(std::max(store->roomCount() * 2, MinCapacity)))) {
+        segmentName.clear();
+        return false;
+    }
+    publish();
+    return true;
+}
+
+void SharedStateExporter::close() {
+    timer.stop();
+    releaseSegment(true);
+    segmentName.clear();
+}
+
+/**
+ * @brief Создаёт (или пересоздаёт) сегмент с местом под capacity комнат.
+ *
+ * Имя сегмента видно читателям сразу после shm_open, поэтому магическая
+ * строка пишется последней: читатель, открывший сегмент раньше, отвергнет
+ * его как незаполненный и повторит попытку.
+ */
+bool SharedStateExporter::createSegment(quint32 capacity) {
+    const QByteArray nameBytes = segmentName.toLocal8Bit();
+    shm_unlink(nameBytes.constData());
+    const int fd = shm_open(nameBytes.constData(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        qWarning() << "Не удалось создать сегмент разделяемой памяти" << segmentName << ":" << std::strerror(errno);
+        return false;
+    }
+    const size_t bytes = SharedState::segmentBytes(capacity);
+    void *mapping = MAP_FAILED;
+    if (ftruncate(fd, off_t(bytes)) == 0)
+        mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        qWarning() << "Не удалось отобразить сегмент" << segmentName << ":" << std::strerror(errno);
+        shm_unlink(nameBytes.constData());
+        return false;
+    }
+    mappedBytes = bytes;
+
+    ///< ftruncate заполнил сегмент нулями: счётчики блоков чётные, magic пока пустой
+    const quint32 blockCount = (capacity + SharedState::BlockRooms - 1) / SharedState::BlockRooms;
+    header = new (mapping) SharedStateHeader;
+    header->version = SharedState::FormatVersion;
+    header->headerBytes = sizeof(SharedStateHeader);
+    header->recordBytes = sizeof(SharedRoomRecord);
+    header->blockRooms = SharedState::BlockRooms;
+    header->roomCapacity = capacity;
+    header->blockCount = blockCount;
+    header->blocksOffset = sizeof(SharedStateHeader);
+    header->roomsOffset = sizeof(SharedStateHeader) + size_t(blockCount) * sizeof(SharedBlockSequence);
+    header->roomCount.store(quint32(store->roomCount()), std::memory_order_relaxed);
+    header->closed.store(0, std::memory_order_relaxed);
+    header->publishCount.store(0, std::memory_order_relaxed);
+    header->publishTimeMs.store(0, std::memory_order_relaxed);
+    header->writerPid.store(QCoreApplication::applicationPid(), std::memory_order_relaxed);
+
+    char *base = static_cast<char *>(mapping);
+    blocks = reinterpret_cast<SharedBlockSequence *>(base + header->blocksOffset);
+    records = reinterpret_cast<SharedRoomRecord *>(base + header->roomsOffset);
+    for (quint32 block = 0; block < blockCount; ++block)
+        new (&blocks[block]) SharedBlockSequence{};
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, SharedState::Magic, sizeof(SharedState::Magic));
+
+    dirtyBlocks.assign(blockCount, 0);
+    dirtyList.clear();
+    markAllDirty();
+    return true;
+}
+
+/**
+ * @brief Отмечает сегмент closed и снимает отображение.
+ *
+ * Читатели, отобразившие сегмент, сохраняют доступ к памяти до своего
+ * close(); по флагу closed они понимают, что данные больше не обновятся.
+ */
+void SharedStateExporter::releaseSegment(bool unlink) {
+    if (!header)
+        return;
+    header->closed.store(1, std::memory_order_release);
+    munmap(header, mappedBytes);
+    if (unlink)
+        shm_unlink(segmentName.toLocal8Bit().constData());
+    header = nullptr;
+    blocks = nullptr;
+    records = nullptr;
+    mappedBytes = 0;
+}
+
+void SharedStateExporter::markDirty(int roomId) {
+    if (!header || roomId < 0)
+        return;
+    const quint32 block = quint32(roomId) / SharedState::BlockRooms;
+    if (block >= dirtyBlocks.size() || dirtyBlocks[block])
+        return;
+    dirtyBlocks[block] = 1;
+    dirtyList.push_back(block);
+    if (!timer.isActive())
+        timer.start();
+}
+
+void SharedStateExporter::markAllDirty() {
+    const int rooms = std::min(store->roomCount(), header ? int(header->roomCapacity) : 0);
+    for (int roomId = 0; roomId < rooms; roomId += int(SharedState::BlockRooms))
+        markDirty(roomId);
+}
+
+void SharedStateExporter::roomChanged(int roomId, int fields) {
+    Q_UNUSED(fields);
+    markDirty(roomId);
+}
+
+void SharedStateExporter::allRoomsChanged() {
+    markAllDirty();
+}
+
+void SharedStateExporter::samplesApplied() {
+    const std::vector<RoomStateStore::RoomChange> &changes = store->lastAppliedChanges();
+    if (changes.size() >= dirtyBlocks.size()) {
+        markAllDirty();
+        return;
+    }
+    for (const RoomStateStore::RoomChange &change : changes)
+        markDirty(change.roomId);
+}
+
+/**
+ * @brief Новое число комнат: в пределах ёмкости - обновление счётчика, иначе новый сегмент.
+ */
+void SharedStateExporter::roomsReset() {
+    if (!header)
+        return;
+    const quint32 rooms = quint32(store->roomCount());
+    if (rooms > header->roomCapacity) {
+        timer.stop();
+        releaseSegment(false);
+        if (!createSegment(rooms * 2)) {
+            segmentName.clear();
+            return;
+        }
+    }
+    header->roomCount.store(rooms, std::memory_order_release);
+    markAllDirty();
+}
+
+/**
+ * @brief Переписывает блок по схеме seqlock: нечётный счётчик, memcpy, чётный счётчик.
+ */
+void SharedStateExporter::writeBlock(quint32 block) {
+    const int first = int(block * SharedState::BlockRooms);
+    const int count = std::min(int(SharedState::BlockRooms), std::min(store->roomCount(), int(header->roomCapacity)) - first);
+    if (count <= 0)
+        return;
+
+    SharedRoomRecord staged[SharedState::BlockRooms];
+    const double *temperatures = store->temperatures();
+    const double *humidities = store->humidities();
+    const double *pressures = store->pressures();
+    const double *setpoints = store->setpoints();
+    const double *outputs = store->outputs();
+    const AirflowDirection *airflows = store->airflows();
+    for (int i = 0; i < count; ++i) {
+        const int roomId = first + i;
+        staged[i] = {temperatures[roomId], humidities[roomId], pressures[roomId], setpoints[roomId],
+                     outputs[roomId], quint32(airflows[roomId]), 0};
+    }
+
+    std::atomic<std::uint32_t> &sequence = blocks[block].sequence;
+    const std::uint32_t value = sequence.load(std::memory_order_relaxed);
+    sequence.store(value + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(records + first, staged, size_t(count) * sizeof(SharedRoomRecord));
+    sequence.store(value + 2, std::memory_order_release);
+    ++blocksWritten;
+}
+
+void SharedStateExporter::publish() {
+    if (!header || dirtyList.empty())
+        return;
+    for (quint32 block : dirtyList) {
+        dirtyBlocks[block] = 0;
+        writeBlock(block);
+    }
+    dirtyList.clear();
+    header->publishTimeMs.store(QDateTime::currentMSecsSinceEpoch(), std::memory_order_relaxed);
+    header->publishCount.fetch_add(1, std::memory_order_release);
+}
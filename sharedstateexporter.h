@@ -0,0 +1,70 @@
+#ifndef SHAREDSTATEEXPORTER_H
+#define SHAREDSTATEEXPORTER_H
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <vector>
+
+#include "roomstate.h"
+#include "sharedstate.h"
+
+/**
+ * @brief Публикация состояния комнат в разделяемую память для других процессов.
+ *
+ * Следит за RoomStateStore и отмечает изменённые блоки комнат (по
+ * SharedState::BlockRooms); отмеченные блоки переписываются в сегмент
+ * пачкой не чаще раза в PublishIntervalMs, как кадры UiUpdateScheduler.
+ * Записи блока собираются из столбцов хранилища заранее, под нечётным
+ * счётчиком seqlock выполняется только memcpy, поэтому окно, в котором
+ * читатели повторяют попытку, - доли микросекунды на блок. Писатель
+ * никогда не ждёт читателей.
+ *
+ * Сегмент создаётся с запасом ёмкости; при росте числа комнат сверх неё
+ * старый сегмент помечается closed и заменяется новым под тем же именем.
+ * Раскладка и чтение описаны в sharedstate.h.
+ */
+class SharedStateExporter : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int PublishIntervalMs = 20;
+    static constexpr int MinCapacity = 1024;
+
+    explicit SharedStateExporter(RoomStateStore *store, QObject *parent = nullptr);
+    ~SharedStateExporter();
+
+    bool open(const QString &name = SharedState::DefaultName); ///< Создаёт сегмент и публикует все комнаты
+    void close();                    ///< Помечает сегмент closed и удаляет имя
+    bool isOpen() const { return header != nullptr; }
+    QString name() const { return segmentName; }
+
+    void publish();                  ///< Немедленно переписать отмеченные блоки
+    quint64 publishedBlocks() const { return blocksWritten; }
+
+private slots:
+    void roomChanged(int roomId, int fields);
+    void allRoomsChanged();
+    void samplesApplied();
+    void roomsReset();
+
+private:
+    bool createSegment(quint32 capacity);
+    void releaseSegment(bool unlink);
+    void markDirty(int roomId);
+    void markAllDirty();
+    void writeBlock(quint32 block);
+
+    RoomStateStore *store;
+    QString segmentName;
+    QTimer timer;
+    SharedStateHeader *header = nullptr;
+    SharedBlockSequence *blocks = nullptr;
+    SharedRoomRecord *records = nullptr;
+    size_t mappedBytes = 0;
+    std::vector<quint8> dirtyBlocks;   ///< 1 - блок нужно переписать
+    std::vector<quint32> dirtyList;    ///< Номера отмеченных блоков в порядке отметки
+    quint64 blocksWritten = 0;
+};
+
+#endif // SHAREDSTATEEXPORTER_H
@@ -10,7 +10,16 @@
 #include <QApplication>
 #include <QDebug>
 #include <QSplitter>
+#include <QHeaderView>
+#include <QStatusBar>
+#include <QDateTime>
+#include <QTimer>
+#include <QPainter>
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include <cmath>
 #include "header.h"
+#include "profiler.h"
 
 /**
 * @brief Конструктор класса главного окна
@@ -24,16 +33,95 @@ MainWindow::MainWindow(QWidget *parent)
     QWidget *centralWidget = new QWidget(this);
     setCentralWidget(centralWidget);
 
+    engine = new ClimateEngine("state.snapshot", this);  ///< Ядро: комнаты, история, датчики, снимок
+    roomStore = engine->store();
+    updateScheduler = new UiUpdateScheduler(roomStore, this);
+    themeManager = new ThemeManager(this);   ///< Темы готовятся один раз при запуске
+    connect(themeManager, &ThemeManager::themeChanged, this, [this](int, qint64 switchNs) {
+        statusBar()->showMessage(QString("Тема переключена за %1 мс").arg(double(switchNs) / 1e6, 0, 'f', 2), 3000);
+    });
+
     setupUI();    ///< Вызов функции для настройки интерфейса
+
+    ///< Включение установки из воспроизводимой записи меняет и кнопку
+    connect(engine, &ClimateEngine::systemStateReplayed, this, [this](bool enabled) {
+        if (enabled != systemState)
+            toggleSystem();
+    });
+
+    engine->setSettingsProvider([this]() { return currentSnapshotSettings(); });
+    engine->startAutosave();
 }
 
 /**
 * @brief Деструктор класса главного окна
 */
 MainWindow::~MainWindow() {
+    engine->stop();    ///< Остановка приёма и итоговый снимок состояния
     saveSettings();    ///< Сохранение настроек перед выходом
 }
 
+/**
+ * @brief Задаёт число комнат здания.
+ */
+void MainWindow::setRoomCount(int roomCount) {
+    engine->setRoomCount(roomCount);
+}
+
+/**
+ * @brief Запускает приём измерений датчиков.
+ * @param sourceSpec Описание источника: "sim[:темп]", "hvac:<узел>[:<порт>]" или путь к файлу, каналу или сокету.
+ */
+bool MainWindow::startSensorIngestion(const QString &sourceSpec) {
+    return engine->startSensorIngestion(sourceSpec);
+}
+
+/**
+ * @brief Запускает имитацию здания вместо датчиков.
+ * @param speed Секунд имитации в секунду работы.
+ */
+void MainWindow::startSimulation(double speed) {
+    engine->startSimulation(speed);
+}
+
+/**
+ * @brief Начинает запись измерений, уставок и включения установки.
+ */
+bool MainWindow::startRecording(const QString &path) {
+    return engine->startRecording(path);
+}
+
+bool MainWindow::startStateExport(const QString &name) {
+    return engine->startStateExport(name);
+}
+
+bool MainWindow::startArchive(const QString &directory) {
+    return engine->startArchive(directory);
+}
+
+bool MainWindow::startControlApi(const QString &address) {
+    return engine->startControlApi(address);
+}
+
+/**
+ * @brief Воспроизводит запись вместо датчиков.
+ * @param speed Секунд записи в секунду, 0 - без ограничения скорости.
+ * @param fromMs Смещение от начала записи, мс.
+ */
+bool MainWindow::startReplay(const QString &path, double speed, qint64 fromMs) {
+    return engine->startReplay(path, speed, fromMs);
+}
+
+/**
+ * @brief Загружает правила тревог.
+ * @param path Текстовый файл правил, см. AlarmEngine::parseRules().
+ */
+bool MainWindow::loadAlarmRules(const QString &path) {
+    const bool loaded = engine->alarms()->loadRules(path);
+    showAlarmEvents();
+    return loaded;
+}
+
 /**
  * @brief Настраивает пользовательский интерфейс главного окна.
  *
@@ -63,6 +151,14 @@ void MainWindow::setupUI() {
     connect(darkThemeAction, &QAction::toggled, this, &MainWindow::toggleDarkTheme);
     settingsMenu->addAction(darkThemeAction);
 
+    QMenu *statsMenu = menuBar->addMenu("Статистика");
+    QAction *showStatsAction = new QAction("Замеры...", this);
+    connect(showStatsAction, &QAction::triggered, this, &MainWindow::showStatsDialog);
+    statsMenu->addAction(showStatsAction);
+    QAction *resetStatsAction = new QAction("Сбросить замеры", this);
+    connect(resetStatsAction, &QAction::triggered, this, []() { Profiler::reset(); });
+    statsMenu->addAction(resetStatsAction);
+
     QMenu *helpMenu = menuBar->addMenu("Помощь");
     QAction *aboutAction = new QAction("О программе", this);
     connect(aboutAction, &QAction::triggered, this, &MainWindow::showAboutDialog);
@@ -84,7 +180,7 @@ void MainWindow::setupUI() {
     QSplitter *splitter1 = new QSplitter(); ///< Разделитель для уравновешивания
     controlLayout->addWidget(splitter1);
 
-    controlLayout->addWidget(new QLabel("Температура 1:"));
+    controlLayout->addWidget(new QLabel("Уставка 1:"));
     temperature1_SpinBox = new QSpinBox(this);
     temperature1_SpinBox->setMinimum(-110);
     temperature1_SpinBox->setMaximum(110);
@@ -93,7 +189,7 @@ void MainWindow::setupUI() {
             this, [this](int value){ updateTemperature(value, 1); });
     controlLayout->addWidget(temperature1_SpinBox);
 
-    controlLayout->addWidget(new QLabel("Температура 2:"));
+    controlLayout->addWidget(new QLabel("Уставка 2:"));
     temperature2_SpinBox = new QSpinBox(this);
     temperature2_SpinBox->setMinimum(-110);
     temperature2_SpinBox->setMaximum(110);
@@ -102,7 +198,7 @@ void MainWindow::setupUI() {
             this, [this](int value){ updateTemperature(value, 2); });
     controlLayout->addWidget(temperature2_SpinBox);
 
-    controlLayout->addWidget(new QLabel("Температура 3:"));
+    controlLayout->addWidget(new QLabel("Уставка 3:"));
     temperature3_SpinBox = new QSpinBox(this);
     temperature3_SpinBox->setMinimum(-110);
     temperature3_SpinBox->setMaximum(110);
@@ -132,104 +228,153 @@ void MainWindow::setupUI() {
             &MainWindow::changePressureUnit);
     controlLayout->addWidget(pressureUnitCombo);
 
-    QWidget *roomsWidget = new QWidget(this);
-
-    roomsWidget->setStyleSheet(
-        "selection-color: yellow;"
-        "background-color: #f0f0f0; "
-        "border: 2px solid #808080; "
-        "border-radius: 2;"
-        );
-
-    QHBoxLayout *roomLayout = new QHBoxLayout(roomsWidget);
-
-    ///< Создание layout для каждой комнаты
-    ///< Комната 1
-    QVBoxLayout *room1Layout = new QVBoxLayout();
-    QPushButton *room1Button = new QPushButton("Комната 1", this);
-    connect(room1Button, &QPushButton::clicked, this, [this]() {editRoom(1); });
-
-    room1TemperatureLabel = new QLabel("Температура: 0", this);
-    room1HumidityLabel = new QLabel("Влажность: 0%", this);
-    room1PressureLabel = new QLabel("Давление: 0", this);
-    room1AirflowDirectionLabel = new QLabel("Направление подачи воздуха", this);
-    ///  Выставляем минимальную ширину QLabel для статичного отображения инфо-блоков
-    room1TemperatureLabel->setMinimumWidth(222);
-    room1HumidityLabel->setMinimumWidth(222);
-    room1PressureLabel->setMinimumWidth(222);
-    room1AirflowDirectionLabel->setMinimumWidth(222);
-
-    room1Layout->addWidget(room1Button);
-    room1Layout->addWidget(room1TemperatureLabel);
-    room1Layout->addWidget(room1HumidityLabel);
-    room1Layout->addWidget(room1PressureLabel);
-    room1Layout->addWidget(room1AirflowDirectionLabel);
-    roomLayout->addLayout(room1Layout);
-
-    ///< Комната 2
-    QVBoxLayout *room2Layout = new QVBoxLayout();
-    QPushButton *room2Button = new QPushButton("Комната 2", this);
-    connect(room2Button, &QPushButton::clicked, this, [this]() { editRoom(2); });
-    room2TemperatureLabel = new QLabel("Температура: 0", this);
-    room2TemperatureLabel->setObjectName("roomLabel");
-    room2HumidityLabel = new QLabel("Влажность: 0%", this);
-    room2PressureLabel = new QLabel("Давление: 0", this);
-    room2AirflowDirectionLabel = new QLabel("Направление подачи воздуха", this);
-
-    room2TemperatureLabel->setMinimumWidth(222);
-    room2HumidityLabel->setMinimumWidth(222);
-    room2PressureLabel->setMinimumWidth(222);
-    room2AirflowDirectionLabel->setMinimumWidth(222);
-
-    room2Layout->addWidget(room2Button);
-    room2Layout->addWidget(room2TemperatureLabel);
-    room2Layout->addWidget(room2HumidityLabel);
-    room2Layout->addWidget(room2PressureLabel);
-    room2Layout->addWidget(room2AirflowDirectionLabel);  ///<  Добавляем метку для направления воздуха
-    roomLayout->addLayout(room2Layout);
-
-    ///< Комната 3
-    QVBoxLayout *room3Layout = new QVBoxLayout();
-    QPushButton *room3Button = new QPushButton("Комната 3", this);
-    connect(room3Button, &QPushButton::clicked, this, [this]() { editRoom(3); });
-    room3TemperatureLabel = new QLabel("Температура: 0", this);
-    room3HumidityLabel = new QLabel("Влажность: 0%", this);
-    room3PressureLabel = new QLabel("Давление: 0", this);
-    room3AirflowDirectionLabel = new QLabel("Направление подачи воздуха", this);
-
-    room3TemperatureLabel->setMinimumWidth(222);
-    room3HumidityLabel->setMinimumWidth(222);
-    room3PressureLabel->setMinimumWidth(222);
-    room3AirflowDirectionLabel->setMinimumWidth(222);
-
-
-    room3Layout->addWidget(room3Button);
-    room3Layout->addWidget(room3TemperatureLabel);
-    room3Layout->addWidget(room3HumidityLabel);
-    room3Layout->addWidget(room3PressureLabel);
-    room3Layout->addWidget(room3AirflowDirectionLabel);  ///< Добавляем метку для направления воздуха
-    roomLayout->addLayout(room3Layout);
-
-    roomsWidget->setLayout(roomLayout);
+    ///< Список комнат: модель над roomStore и представление,
+    ///< которое создаёт только видимые строки вместо набора QLabel на каждую комнату
+    roomModel = new RoomTableModel(roomStore, this);
+    roomModel->setDerivedMetrics(engine->derived());
+    roomModel->setStatistics(engine->statistics());
+    roomView = new QTableView(this);
+    roomView->setModel(roomModel);
+    roomView->setItemDelegate(new RoomItemDelegate(roomView));
+    roomView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    roomView->setSelectionMode(QAbstractItemView::SingleSelection);
+    roomView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    roomView->setWordWrap(false);
+    roomView->verticalHeader()->hide();
+    ///  Фиксированные размеры строк и столбцов: представлению не нужно измерять содержимое
+    roomView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    roomView->verticalHeader()->setDefaultSectionSize(RoomItemDelegate::RowHeight);
+    roomView->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    roomView->horizontalHeader()->setDefaultSectionSize(RoomItemDelegate::ColumnWidth / 2);
+    roomView->horizontalHeader()->setStretchLastSection(true);
+    themeManager->addStyledView(roomView);  ///< Рамка и фон списка зависят от темы
+    connect(roomView, &QTableView::clicked, this, [this](const QModelIndex &index) {
+        editRoom(index.row() + 1);
+    });
+    ///  Изменения комнат доходят до представления только через планировщик кадров
+    connect(updateScheduler, &UiUpdateScheduler::roomRangeChanged,
+            roomModel, &RoomTableModel::roomRangeChanged);
+
+    ///< Дерево здания: сводки этажей и зон из BuildingHierarchy, раскрытие до отдельных комнат
+    buildingModel = new BuildingTreeModel(engine->building(), this);
+    buildingView = new QTreeView(this);
+    buildingView->setModel(buildingModel);
+    buildingView->setUniformRowHeights(true);
+    buildingView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    buildingView->header()->setSectionResizeMode(QHeaderView::Interactive);
+    buildingView->header()->setDefaultSectionSize(RoomItemDelegate::ColumnWidth / 2);
+    buildingView->expandToDepth(0);
+    themeManager->addStyledView(buildingView);
+    connect(buildingView, &QTreeView::clicked, this, &MainWindow::selectBuildingNode);
+    connect(updateScheduler, &UiUpdateScheduler::roomRangeChanged,
+            buildingModel, &BuildingTreeModel::roomRangeChanged);
+    connect(buildingModel, &QAbstractItemModel::modelReset, buildingView, [this]() {
+        buildingView->expandToDepth(0);
+    });
+
+    QSplitter *roomSplitter = new QSplitter(Qt::Vertical, this);
+    roomSplitter->addWidget(buildingView);
+    roomSplitter->addWidget(roomView);
+
+    updateStatsLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(updateStatsLabel);
+    connect(updateScheduler, &UiUpdateScheduler::flushed, this, &MainWindow::showUpdateStats);
+
+    alarmsLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(alarmsLabel);
+    connect(engine->alarms(), &AlarmEngine::eventsReady, this, &MainWindow::showAlarmEvents);
+    showAlarmEvents();
+
     //mainLayout->addLayout(controlLayout);
     mainLayout->addWidget(controlsRestrictorWidget);
-    mainLayout->addWidget(roomsWidget);
+    mainLayout->addWidget(roomSplitter, 1);
+
+    ///< График трендов на всю область просмотра или план этажей с прокруткой и масштабом
+    QWidget *chartPane = new QWidget(this);
+    QVBoxLayout *chartLayout = new QVBoxLayout(chartPane);
+    chartLayout->setContentsMargins(0, 0, 0, 0);
+    QHBoxLayout *chartControls = new QHBoxLayout();
+    trendMetricCombo = new QComboBox(this);
+    trendMetricCombo->addItems({"Температура", "Влажность", "Давление"});
+    chartControls->addWidget(trendMetricCombo, 1);
+    floorPlanCheck = new QCheckBox("План этажей", this);
+    chartControls->addWidget(floorPlanCheck);
+    chartLayout->addLayout(chartControls);
 
     graphicsView = new QGraphicsView(this);
     scene = new QGraphicsScene(this);
+    scene->setItemIndexMethod(QGraphicsScene::BspTreeIndex); ///< Тысячи комнат плана: отбор видимых по индексу
     graphicsView->setScene(scene);
-    mainLayout->addWidget(graphicsView);
+    graphicsView->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    graphicsView->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    graphicsView->setViewportUpdateMode(QGraphicsView::MinimalViewportUpdate);
+    graphicsView->setOptimizationFlags(QGraphicsView::DontSavePainterState | QGraphicsView::DontAdjustForAntialiasing);
+    graphicsView->setCacheMode(QGraphicsView::CacheNone);
+    graphicsView->setRenderHint(QPainter::Antialiasing, false);
+    graphicsView->setAlignment(Qt::AlignLeft | Qt::AlignTop);
+    graphicsView->viewport()->installEventFilter(this);
+    chartLayout->addWidget(graphicsView);
+    mainLayout->addWidget(chartPane, 1);
+
+    trendChart = new TrendChartItem(engine->history());
+    scene->addItem(trendChart);
+
+    floorPlan = new FloorPlanItem(roomStore, engine->building());
+    floorPlan->setVisible(false);  ///< Комнаты создаются при первом показе плана
+    scene->addItem(floorPlan);
+    connect(engine->building(), &BuildingHierarchy::layoutChanged, this, [this]() {
+        floorPlan->invalidateLayout();
+        if (floorPlanCheck->isChecked())
+            scene->setSceneRect(floorPlan->boundingRect());
+    });
+    connect(updateScheduler, &UiUpdateScheduler::roomRangeChanged, this, [this](int first, int last, int fields) {
+        floorPlan->refreshRooms(first, last, fields);
+    });
+    connect(floorPlanCheck, &QCheckBox::toggled, this, &MainWindow::showFloorPlan);
+    updateTrendRooms();
+    updateTrendUnit();
+    connect(trendMetricCombo, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, [this](int index) {
+                trendChart->setMetric(Metric(index));
+                floorPlan->setMetric(Metric(index));
+                updateTrendUnit();
+            });
+    connect(roomView->selectionModel(), &QItemSelectionModel::currentRowChanged,
+            this, &MainWindow::updateTrendRooms);
+    connect(roomStore, &RoomStateStore::roomsReset, this, &MainWindow::updateTrendRooms);
+
+    QTimer *chartTimer = new QTimer(this);
+    connect(chartTimer, &QTimer::timeout, this, &MainWindow::refreshTrendChart);
+    chartTimer->start(100);
 
     loadSettings();///< Загрузка настроек
 }
 
 /**
- * @brief Загружает настройки из XML файла.
+ * @brief Загружает сохранённое состояние.
  *
- * Этот метод открывает файл настроек, считывает данные о текущих единицах измерения температуры и давления,
- * и обновляет интерфейс в соответствии с сохранёнными настройками.
+ * Сначала читается двоичный снимок state.snapshot (комнаты, уставки, история
+ * и настройки). Если его нет или он повреждён, единицы измерения берутся
+ * из XML файла settings.xml, как в прежних версиях.
  */
 void MainWindow::loadSettings() {
+    if (engine->loadSnapshot()) {
+        const SnapshotSettings settings = engine->settings();
+        temperatureUnitCombo->setCurrentIndex(settings.temperatureUnit);
+        pressureUnitCombo->setCurrentIndex(settings.pressureUnit);
+        if (settings.systemState != systemState)
+            toggleSystem();
+        ///< Спинбоксы показывают восстановленные уставки первых комнат
+        QSpinBox *const setpointSpinBoxes[] = {temperature1_SpinBox, temperature2_SpinBox, temperature3_SpinBox};
+        for (int roomId = 0; roomId < std::min(roomStore->roomCount(), 3); ++roomId) {
+            const QSignalBlocker blocker(setpointSpinBoxes[roomId]);  ///< Без округления самой уставки
+            setpointSpinBoxes[roomId]->setValue(qRound(roomStore->setpoint(roomId)));
+        }
+        trendChart->invalidate();    ///< Сегменты графика строились до восстановления истории
+        return;
+    }
+
+    CLIMATE_PROFILE_SCOPE(XmlLoad);
     QFile file("settings.xml");
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
         qWarning() << "Не удалось открыть файл settings.xml для чтения.";
@@ -258,6 +403,17 @@ void MainWindow::loadSettings() {
     file.close();
 }
 
+/**
+ * @brief Собирает настройки для снимка состояния.
+ */
+SnapshotSettings MainWindow::currentSnapshotSettings() const {
+    SnapshotSettings settings;
+    settings.temperatureUnit = temperatureUnitCombo->currentIndex();
+    settings.pressureUnit = pressureUnitCombo->currentIndex();
+    settings.systemState = systemState;
+    return settings;
+}
+
 /**
  * @brief Сохраняет текущие настройки в XML файл.
  *
@@ -265,6 +421,7 @@ void MainWindow::loadSettings() {
  * в XML файл для последующего использования.
  */
 void MainWindow::saveSettings() {
+    CLIMATE_PROFILE_SCOPE(XmlSave);
     QFile file("settings.xml");
     if (!file.open(QIODevice::WriteOnly)) {
         qWarning() << "Не удалось открыть файл settings.xml для записи.";
@@ -290,205 +447,267 @@ void MainWindow::saveSettings() {
 /**
  * @brief Переключает тему интерфейса между темной и светлой.
  *
- * Этот метод изменяет стиль приложения в зависимости от состояния флага,
- * который указывает, активна ли темная тема.
+ * Тема меняется палитрой приложения через ThemeManager, без
+ * qApp->setStyleSheet() и перестилизации всех виджетов.
  *
  * @param isDark Флаг, определяющий, включена ли темная тема.
  */
 void MainWindow::toggleDarkTheme(bool isDark) {
-    if (isDark) {
-        qApp->setStyleSheet(R"(
-            QWidget {
-                background-color: #1e1e1e;
-                color: #ff69b4;
-            }
-            QMenuBar {
-                background-color: #2a2a2a;
-                color: #ff69b4;
-            }
-            QMenu {
-                background-color: #2a2a2a;
-                color: #ff69b4;
-            }
-            QMenuBar::item:selected, QMenu::item:selected {
-                background-color: #333;
-            }
-            QPushButton {
-                background-color: #333;
-                color: #ff69b4;
-                border: 1px solid #555;
-                border-radius: 6px;
-                padding: 4px 8px;
-            }
-            QPushButton:hover {
-                background-color: #444;
-            }
-            QComboBox {
-                background-color: #333;
-                color: #ff69b4;
-                border: 1px solid #555;
-                border-radius: 4px;
-                padding: 2px 4px;
-            }
-            QLabel {
-                color: #ff69b4;
-            }
-            QVBoxLayout {
-                background-color: #000000;
-                color: #ff69b4;
-            }
-            QHBoxLayout {
-                background-color: #000000;
-                color: #ff69b4;
-            }
-        )");
+    themeManager->apply(isDark ? ThemeManager::DarkTheme : ThemeManager::LightTheme);
+}
+
+/**
+ * @brief Подгоняет сцену и график под размер области просмотра graphicsView.
+ *
+ * На плане этажей колесо мыши меняет масштаб, а двойной щелчок выделяет
+ * комнату в списке.
+ */
+bool MainWindow::eventFilter(QObject *watched, QEvent *event) {
+    if (watched != graphicsView->viewport())
+        return QMainWindow::eventFilter(watched, event);
+
+    if (event->type() == QEvent::Resize) {
+        const QSize size = graphicsView->viewport()->size();
+        if (!floorPlanCheck->isChecked())
+            scene->setSceneRect(0, 0, size.width(), size.height());
+        trendChart->setSize(size);
+    } else if (floorPlanCheck->isChecked() && event->type() == QEvent::Wheel) {
+        ///< Масштаб плана колесом вокруг курсора, в пределах от всего здания до нескольких комнат
+        const qreal angle = static_cast<QWheelEvent *>(event)->angleDelta().y();
+        const qreal scale = graphicsView->transform().m11();
+        const qreal factor = std::min(std::max(std::pow(1.2, angle / 120.0), MinPlanScale / scale), MaxPlanScale / scale);
+        graphicsView->scale(factor, factor);
+        return true;
+    } else if (floorPlanCheck->isChecked() && event->type() == QEvent::MouseButtonDblClick) {
+        const QPoint position = static_cast<QMouseEvent *>(event)->pos();
+        const int roomId = floorPlan->roomAt(graphicsView->mapToScene(position));
+        if (roomId >= 0)
+            selectRoom(roomId);
+        return true;
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
+
+/**
+ * @brief Показывает в graphicsView план этажей вместо графика трендов или наоборот.
+ *
+ * График занимает ровно область просмотра без прокрутки; план получает сцену
+ * своего размера, прокрутку перетаскиванием и вначале помещается целиком.
+ */
+void MainWindow::showFloorPlan(bool show) {
+    trendChart->setVisible(!show);
+    floorPlan->setVisible(show);
+    graphicsView->resetTransform();
+    const Qt::ScrollBarPolicy scrollBars = show ? Qt::ScrollBarAsNeeded : Qt::ScrollBarAlwaysOff;
+    graphicsView->setHorizontalScrollBarPolicy(scrollBars);
+    graphicsView->setVerticalScrollBarPolicy(scrollBars);
+    graphicsView->setDragMode(show ? QGraphicsView::ScrollHandDrag : QGraphicsView::NoDrag);
+    graphicsView->setTransformationAnchor(show ? QGraphicsView::AnchorUnderMouse : QGraphicsView::AnchorViewCenter);
+    if (show) {
+        scene->setSceneRect(floorPlan->boundingRect());
+        graphicsView->fitInView(floorPlan->boundingRect(), Qt::KeepAspectRatio);
     } else {
-        qApp->setStyleSheet("");
+        const QSize size = graphicsView->viewport()->size();
+        scene->setSceneRect(0, 0, size.width(), size.height());
+    }
+}
+
+/**
+ * @brief Передаёт графику единицу измерения, выбранную для его величины.
+ */
+void MainWindow::updateTrendUnit() {
+    switch (Metric(trendMetricCombo->currentIndex())) {
+    case Metric::Temperature: {
+        const TemperatureUnit unit = TemperatureUnit(temperatureUnitCombo->currentIndex());
+        trendChart->setValueConversion(temperatureConversion(unit), QString::fromUtf8(temperatureUnitSymbol(unit)));
+        break;
     }
+    case Metric::Pressure: {
+        const PressureUnit unit = PressureUnit(pressureUnitCombo->currentIndex());
+        trendChart->setValueConversion(pressureConversion(unit), QString::fromUtf8(pressureUnitSymbol(unit)));
+        break;
+    }
+    case Metric::Humidity:
+        trendChart->setValueConversion({1.0, 0.0}, "%");
+        break;
+    }
+}
+
+void MainWindow::refreshTrendChart() {
+    trendChart->refresh(QDateTime::currentMSecsSinceEpoch());
+}
+
+/**
+ * @brief Выбирает комнаты для графика: первые три и текущую в списке комнат.
+ */
+void MainWindow::updateTrendRooms() {
+    QVector<int> rooms;
+    for (int roomId = 0; roomId < std::min(roomStore->roomCount(), 3); ++roomId)
+        rooms.append(roomId);
+    const QModelIndex current = roomView->currentIndex();
+    if (current.isValid() && !rooms.contains(current.row()))
+        rooms.append(current.row());
+    trendChart->setRooms(rooms);
+}
+
+/**
+ * @brief Показывает в строке состояния счётчики планировщика обновлений.
+ *
+ * Вызывается не чаще одного раза за кадр, после публикации изменений.
+ */
+void MainWindow::showUpdateStats() {
+    CLIMATE_PROFILE_SCOPE(StatusText);
+    updateStatsLabel->setText(QString("Обновлений: %1, объединено: %2, без изменений: %3")
+                                  .arg(updateScheduler->requestedUpdates())
+                                  .arg(updateScheduler->coalescedUpdates())
+                                  .arg(updateScheduler->skippedUpdates()));
+}
+
+/**
+ * @brief Выделяет в списке комнат первую комнату выбранного узла здания.
+ *
+ * Выделение в списке меняет и комнату на графике (см. updateTrendRooms()).
+ */
+void MainWindow::selectBuildingNode(const QModelIndex &index) {
+    const int roomId = buildingModel->firstRoom(index);
+    if (roomId >= 0)
+        selectRoom(roomId);
+}
+
+void MainWindow::selectRoom(int roomId) {
+    const QModelIndex roomIndex = roomModel->index(roomId, RoomTableModel::NameColumn);
+    roomView->setCurrentIndex(roomIndex);
+    roomView->scrollTo(roomIndex, QAbstractItemView::PositionAtTop);
+}
+
+/**
+ * @brief Показывает число поднятых тревог и последнее событие пачки.
+ *
+ * События приходят от AlarmEngine пачкой, поэтому надпись меняется не чаще
+ * раза в AlarmEngine::NotifyIntervalMs при любом потоке измерений.
+ */
+void MainWindow::showAlarmEvents() {
+    const AlarmEngine *alarms = engine->alarms();
+    alarmsLabel->setText(QString("Тревог: %1").arg(alarms->activeCount()));
+    if (!alarms->lastEvents().empty())
+        statusBar()->showMessage(AlarmEngine::describe(alarms->lastEvents().back()), 5000);
+}
+
+/**
+ * @brief Открывает окно "Статистика" (одно на окно приложения, без блокировки).
+ */
+void MainWindow::showStatsDialog() {
+    if (!statsDialog)
+        statsDialog = new StatsDialog(this);
+    statsDialog->show();
+    statsDialog->raise();
+    statsDialog->activateWindow();
 }
 
 /**
  * @brief Переключает состояние системы.
  *
- * Этот метод изменяет состояние системы (включено/выключено) и обновляет текст на кнопке
- * в зависимости от текущего состояния.
+ * Этот метод включает или выключает регулятор температуры всех комнат
+ * и обновляет текст на кнопке в зависимости от текущего состояния.
  */
 void MainWindow::toggleSystem() {
     systemState = !systemState;
     toggleSystemButton->setText(systemState ? "OFF" : "ON");
+    engine->setSystemEnabled(systemState);
 }
 
 
 /**
- * @brief Обновляет значение температуры в интерфейсе.
- * @param value Значение температуры, установленное слайдером.
- *
- * В зависимости от выбранной единицы измерения температуры (Цельсий, Фаренгейт, Кельвин),
- * преобразует значение и обновляет метки для всех комнат.
+ * @brief Устанавливает одинаковую уставку температуры во всех комнатах.
+ * @param value Значение температуры в °C.
  */
 void MainWindow::updateTemperature(int value) {
-    double temperature = value;
-    if (temperatureUnitCombo->currentIndex() == 1) {
-        // °F
-        temperature = temperature * 9.0 / 5.0 + 32;
-    } else if (temperatureUnitCombo->currentIndex() == 2) {
-        // K
-        temperature = temperature + 273.15;
-    }
-    // Обновление температуры в метках комнат
-    room1TemperatureLabel->setText(QString("Температура: %1").arg(temperature));
-    room2TemperatureLabel->setText(QString("Температура: %1").arg(temperature));
-    room3TemperatureLabel->setText(QString("Температура: %1").arg(temperature));
+    roomStore->fillSetpoint(value);
 }
 
+/**
+ * @brief Устанавливает уставку температуры отдельной комнаты.
+ *
+ * Температуру к уставке ведёт регулятор (ControlEngine), когда система включена.
+ *
+ * @param value Значение температуры в °C.
+ * @param ind Номер комнаты (1, 2 или 3).
+ */
 void MainWindow::updateTemperature(int value,int ind) {
-    double temperature = value;
-    if (temperatureUnitCombo->currentIndex() == 1) {
-        // °F
-        temperature = temperature * 9.0 / 5.0 + 32;
-    } else if (temperatureUnitCombo->currentIndex() == 2) {
-        // K
-        temperature = temperature + 273.15;
-    }
-    // Обновление температуры в метках комнат
-    if(ind==1)
-        room1TemperatureLabel->setText(QString("Температура: %1").arg(temperature));
-    else if(ind==2)
-        room2TemperatureLabel->setText(QString("Температура: %1").arg(temperature));
-    else if(ind==3)
-        room3TemperatureLabel->setText(QString("Температура: %1").arg(temperature));
+    roomStore->setSetpoint(ind - 1, value);
 }
 
 /**
  * @brief Изменяет единицу измерения температуры.
  * @param index Индекс выбранной единицы измерения в выпадающем списке.
  *
- * При изменении единицы измерения обновляет значение температуры
- * в соответствии с текущим положением слайдера.
+ * Значения в хранилище не меняются: модель пересчитывает столбец отображения
+ * одним векторным проходом, график меняет только преобразование оси.
  */
 void MainWindow::changeTemperatureUnit(int index) {
-    updateTemperature(temperature1_SpinBox->value());
+    roomModel->setTemperatureUnit(TemperatureUnit(index));
+    buildingModel->setTemperatureUnit(TemperatureUnit(index));
+    updateTrendUnit();
 }
 
 /**
  * @brief Изменяет единицу измерения давления.
  * @param index Индекс выбранной единицы измерения в выпадающем списке.
  *
- * Преобразует давление в выбранную единицу измерения и обновляет метки
- * для всех комнат.
+ * Значения в хранилище не меняются: модель пересчитывает столбец отображения
+ * одним векторным проходом, график меняет только преобразование оси.
  */
 void MainWindow::changePressureUnit(int index) {
-    double pressure = 101325; // Паскали
-    if (index == 1) {
-        // мм.рт.ст.
-        pressure = pressure / 133.322;
-    }
-    // Обновление давления в метках комнат
-    room1PressureLabel->setText(QString("Давление: %1").arg(pressure));
-    room2PressureLabel->setText(QString("Давление: %1").arg(pressure));
-    room3PressureLabel->setText(QString("Давление: %1").arg(pressure));
+    roomModel->setPressureUnit(PressureUnit(index));
+    buildingModel->setPressureUnit(PressureUnit(index));
+    updateTrendUnit();
 }
 
 /**
  * @brief Открывает окно редактирования параметров для указанной комнаты.
- * @param roomIndex Индекс комнаты (1, 2 или 3).
+ * @param roomIndex Номер комнаты (начиная с 1).
  *
- * Загружает текущие параметры температуры, влажности, давления и направления
- * подачи воздуха для выбранной комнаты, отображает окно редактирования и
- * обновляет метки при сохранении изменений.
+ * Берёт текущие параметры комнаты из roomStore, отображает окно редактирования
+ * и записывает принятые значения обратно в хранилище. Список комнат обновится
+ * по сигналу RoomStateStore::roomChanged.
  */
 void MainWindow::editRoom(int roomIndex) {
-    // Текущие параметры комнаты
-    double currentTemperature = 0.0;
-    double currentHumidity = 0.0;
-    double currentPressure = 0.0;
-    QString currentAirflowDirection;
-
-    // Получение текущих значений для выбранной комнаты
-    if (roomIndex == 1) {
-        currentTemperature = room1TemperatureLabel->text().remove("Температура: ").remove("°C").toDouble();
-        currentHumidity = room1HumidityLabel->text().remove("Влажность: ").remove("%").toDouble();
-        currentPressure = room1PressureLabel->text().remove("Давление: ").remove(" Па").toDouble();
-        currentAirflowDirection = room1AirflowDirectionLabel->text();
-    } else if (roomIndex == 2) {
-        currentTemperature = room2TemperatureLabel->text().remove("Температура: ").remove("°C").toDouble();
-        currentHumidity = room2HumidityLabel->text().remove("Влажность: ").remove("%").toDouble();
-        currentPressure = room2PressureLabel->text().remove("Давление: ").remove(" Па").toDouble();
-        currentAirflowDirection = room2AirflowDirectionLabel->text();
-    } else if (roomIndex == 3) {
-        currentTemperature = room3TemperatureLabel->text().remove("Температура: ").remove("°C").toDouble();
-        currentHumidity = room3HumidityLabel->text().remove("Влажность: ").remove("%").toDouble();
-        currentPressure = room3AirflowDirectionLabel->text().remove("Давление: ").remove(" Па").toDouble();
-        currentAirflowDirection = room3AirflowDirectionLabel->text();
-    }
+    const int roomId = roomIndex - 1;
+    if (!roomStore->isValidRoom(roomId))
+        return;
 
-    // Создание окна редактирования с текущими параметрами
-    RoomEditDialog *dialog = new RoomEditDialog(roomIndex, currentTemperature, currentHumidity, currentPressure, currentAirflowDirection, this);
+    // Создание окна редактирования с текущими параметрами (°C, %, Па)
+    RoomEditDialog *dialog = new RoomEditDialog(roomIndex,
+                                                roomStore->temperature(roomId),
+                                                roomStore->humidity(roomId),
+                                                roomStore->pressure(roomId),
+                                                airflowDirectionName(roomStore->airflow(roomId)),
+                                                this);
+    dialog->setSetpoint(roomStore->setpoint(roomId));
+
+    const RoomStatistics *statistics = engine->statistics();
+    if (statistics->sampleCount(roomId)) {
+        static const char *const metricNames[MetricCount] = {"Температура", "Влажность", "Давление"};
+        QStringList lines;
+        for (int metric = 0; metric < MetricCount; ++metric)
+            lines << QString("%1: среднее %2, σ %3, тренд %4 в минуту")
+                         .arg(metricNames[metric])
+                         .arg(statistics->mean(roomId, Metric(metric)), 0, 'f', 2)
+                         .arg(statistics->standardDeviation(roomId, Metric(metric)), 0, 'f', 2)
+                         .arg(statistics->trendPerMinute(roomId, Metric(metric)), 0, 'f', 3);
+        lines << QString("Прогноз через 15 мин: %1 °C")
+                     .arg(statistics->forecast(roomId, Metric::Temperature), 0, 'f', 1);
+        dialog->setStatistics(lines.join('\n'));
+    }
 
-    // Ожидаем подтверждения изменений
+    // Ожидаем подтверждения изменений; уставка и направление воздуха уходят на установку через ядро
     if (dialog->exec() == QDialog::Accepted) {
-        double newTemperature = dialog->getTemperature();
-        double newHumidity = dialog->getHumidity();
-        double newPressure = dialog->getPressure();
-        QString newAirflowDirection = dialog->getAirflowDirection();
-
-        // Обновляем метки для выбранной комнаты
-        if (roomIndex == 1) {
-            room1TemperatureLabel->setText(QString("Температура: %1°C").arg(newTemperature));
-            room1HumidityLabel->setText(QString("Влажность: %1%").arg(newHumidity));
-            room1PressureLabel->setText(QString("Давление: %1 Па").arg(newPressure));
-            room1AirflowDirectionLabel->setText(newAirflowDirection);
-        } else if (roomIndex == 2) {
-            room2TemperatureLabel->setText(QString("Температура: %1°C").arg(newTemperature));
-            room2HumidityLabel->setText(QString("Влажность: %1%").arg(newHumidity));
-            room2PressureLabel->setText(QString("Давление: %1 Па").arg(newPressure));
-            room2AirflowDirectionLabel->setText(newAirflowDirection);
-        } else if (roomIndex == 3) {
-            room3TemperatureLabel->setText(QString("Температура: %1°C").arg(newTemperature));
-            room3HumidityLabel->setText(QString("Влажность: %1%").arg(newHumidity));
-            room3PressureLabel->setText(QString("Давление: %1 Па").arg(newPressure));
-            room3AirflowDirectionLabel->setText(newAirflowDirection);
-        }
+        roomStore->setRoom(roomId,
+                           dialog->getTemperature(),
+                           dialog->getHumidity(),
+                           dialog->getPressure(),
+                           airflowDirectionFromName(dialog->getAirflowDirection()));
+        roomStore->setSetpoint(roomId, dialog->getSetpoint());
     }
 
     delete dialog;
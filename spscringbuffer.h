@@ -0,0 +1,117 @@
+#ifndef SPSCRINGBUFFER_H
+#define SPSCRINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+
+/**
+ * @brief Кольцевой буфер без блокировок для одного писателя и одного читателя.
+ *
+ * Ёмкость фиксируется при создании (округляется вверх до степени двойки),
+ * память выделяется один раз. Индексы писателя и читателя лежат в разных
+ * строках кэша, а каждая сторона хранит кэшированную копию чужого индекса,
+ * поэтому общая строка кэша читается только когда буфер кажется полным/пустым.
+ *
+ * push() вызывается только из потока писателя, consume() - только из потока читателя.
+ */
+template <typename T>
+class SpscRingBuffer {
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRingBuffer хранит только тривиально копируемые типы");
+
+public:
+    explicit SpscRingBuffer(size_t minimumCapacity)
+        : bufferCapacity(roundUpToPowerOfTwo(std::max<size_t>(minimumCapacity, 2))),
+          mask(bufferCapacity - 1),
+          storage(new T[bufferCapacity])
+    {
+    }
+
+    SpscRingBuffer(const SpscRingBuffer &) = delete;
+    SpscRingBuffer &operator=(const SpscRingBuffer &) = delete;
+
+    size_t capacity() const { return bufferCapacity; }
+
+    /// Приблизительное число элементов (точное только для одной из сторон)
+    size_t size() const {
+        return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Записывает до count элементов.
+     * @return Число записанных элементов (меньше count, если буфер заполнен).
+     */
+    size_t push(const T *items, size_t count) {
+        const size_t write = writeIndex.load(std::memory_order_relaxed);
+        size_t free = bufferCapacity - (write - cachedReadIndex);
+        if (free < count) {
+            cachedReadIndex = readIndex.load(std::memory_order_acquire);
+            free = bufferCapacity - (write - cachedReadIndex);
+        }
+        const size_t n = std::min(count, free);
+        if (n == 0)
+            return 0;
+
+        const size_t start = write & mask;
+        const size_t firstPart = std::min(n, bufferCapacity - start);
+        std::copy(items, items + firstPart, storage.get() + start);
+        std::copy(items + firstPart, items + n, storage.get());
+
+        writeIndex.store(write + n, std::memory_order_release);
+        return n;
+    }
+
+    bool push(const T &item) { return push(&item, 1) == 1; }
+
+    /**
+     * @brief Передаёт читателю до maxCount элементов без копирования.
+     * @param handler Вызывается как handler(const T *data, size_t count) для одного
+     *                или двух непрерывных участков буфера.
+     * @return Число прочитанных элементов.
+     */
+    template <typename Handler>
+    size_t consume(size_t maxCount, Handler &&handler) {
+        const size_t read = readIndex.load(std::memory_order_relaxed);
+        size_t available = cachedWriteIndex - read;
+        if (available == 0) {
+            cachedWriteIndex = writeIndex.load(std::memory_order_acquire);
+            available = cachedWriteIndex - read;
+        }
+        const size_t n = std::min(maxCount, available);
+        if (n == 0)
+            return 0;
+
+        const size_t start = read & mask;
+        const size_t firstPart = std::min(n, bufferCapacity - start);
+        handler(static_cast<const T *>(storage.get() + start), firstPart);
+        if (n > firstPart)
+            handler(static_cast<const T *>(storage.get()), n - firstPart);
+
+        readIndex.store(read + n, std::memory_order_release);
+        return n;
+    }
+
+private:
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value)
+            result <<= 1;
+        return result;
+    }
+
+    static constexpr size_t CacheLineSize = 64;
+
+    const size_t bufferCapacity;
+    const size_t mask;
+    std::unique_ptr<T[]> storage;
+
+    alignas(CacheLineSize) std::atomic<size_t> writeIndex{0}; ///< Пишется только писателем
+    size_t cachedReadIndex = 0;                                ///< Копия readIndex у писателя
+
+    alignas(CacheLineSize) std::atomic<size_t> readIndex{0};  ///< Пишется только читателем
+    size_t cachedWriteIndex = 0;                               ///< Копия writeIndex у читателя
+};
+
+#endif // SPSCRINGBUFFER_H
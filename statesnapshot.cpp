@@ -0,0 +1,263 @@
+#include "statesnapshot.h"
+#include "profiler.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QDebug>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char SnapshotMagic[8] = {'C', 'L', 'I', 'M', 'S', 'N', 'A', 'P'};
+const quint32 ByteOrderMark = 0x01020304u;
+
+/// Заголовок файла снимка; все смещения - от начала файла
+struct SnapshotHeader {
+    char magic[8];
+    quint32 version;
+    quint32 byteOrderMark;
+    quint64 fileSize;
+    qint64 savedAtMs;
+    qint32 roomCount;
+    qint32 temperatureUnit;
+    qint32 pressureUnit;
+    qint32 systemState;
+    qint32 historyTailLength;
+    qint32 reserved;
+    quint64 temperatureOffset;
+    quint64 humidityOffset;
+    quint64 pressureOffset;
+    quint64 setpointOffset;
+    quint64 airflowOffset;
+    quint64 historyCountOffset;      ///< qint32 на комнату
+    quint64 historyTimestampOffset;  ///< qint64 [комната][HistoryTailLength]
+    quint64 historyValueOffset[MetricCount]; ///< float [комната][HistoryTailLength]
+};
+
+static_assert(sizeof(SnapshotHeader) % 8 == 0, "Заголовок снимка должен быть выровнен на 8 байт");
+
+quint64 align8(quint64 value) {
+    return (value + 7) & ~quint64(7);
+}
+
+} // namespace
+
+/**
+ * @brief Собирает снимок в памяти.
+ *
+ * Столбцы копируются целиком; для истории сохраняется не больше
+ * HistoryTailLength последних сырых измерений каждой комнаты.
+ */
+QByteArray StateSnapshot::serialize(const RoomStateStore &store, const RoomHistory &history,
+                                    const SnapshotSettings &settings) {
+    CLIMATE_PROFILE_SCOPE(SnapshotSerialize);
+    const quint64 rooms = quint64(store.roomCount());
+    const quint64 tail = quint64(HistoryTailLength);
+
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SnapshotMagic, sizeof(header.magic));
+    header.version = FormatVersion;
+    header.byteOrderMark = ByteOrderMark;
+    header.savedAtMs = QDateTime::currentMSecsSinceEpoch();
+    header.roomCount = qint32(rooms);
+    header.temperatureUnit = settings.temperatureUnit;
+    header.pressureUnit = settings.pressureUnit;
+    header.systemState = settings.systemState ? 1 : 0;
+    header.historyTailLength = HistoryTailLength;
+
+    quint64 offset = sizeof(SnapshotHeader);
+    auto place = [&offset](quint64 bytes) {
+        const quint64 start = offset;
+        offset = align8(offset + bytes);
+        return start;
+    };
+    header.temperatureOffset = place(rooms * sizeof(double));
+    header.humidityOffset = place(rooms * sizeof(double));
+    header.pressureOffset = place(rooms * sizeof(double));
+    header.setpointOffset = place(rooms * sizeof(double));
+    header.airflowOffset = place(rooms * sizeof(AirflowDirection));
+    header.historyCountOffset = place(rooms * sizeof(qint32));
+    header.historyTimestampOffset = place(rooms * tail * sizeof(qint64));
+    for (quint64 &valueOffset : header.historyValueOffset)
+        valueOffset = place(rooms * tail * sizeof(float));
+    header.fileSize = offset;
+
+    QByteArray data(int(offset), '\0');
+    char *base = data.data();
+    std::memcpy(base, &header, sizeof(header));
+    std::memcpy(base + header.temperatureOffset, store.temperatures(), rooms * sizeof(double));
+    std::memcpy(base + header.humidityOffset, store.humidities(), rooms * sizeof(double));
+    std::memcpy(base + header.pressureOffset, store.pressures(), rooms * sizeof(double));
+    std::memcpy(base + header.setpointOffset, store.setpoints(), rooms * sizeof(double));
+    std::memcpy(base + header.airflowOffset, store.airflows(), rooms * sizeof(AirflowDirection));
+
+    qint32 *counts = reinterpret_cast<qint32 *>(base + header.historyCountOffset);
+    qint64 *timestamps = reinterpret_cast<qint64 *>(base + header.historyTimestampOffset);
+    float *values[MetricCount];
+    for (int metric = 0; metric < MetricCount; ++metric)
+        values[metric] = reinterpret_cast<float *>(base + header.historyValueOffset[metric]);
+
+    for (quint64 room = 0; room < rooms; ++room) {
+        float *roomValues[MetricCount];
+        for (int metric = 0; metric < MetricCount; ++metric)
+            roomValues[metric] = values[metric] + room * tail;
+        counts[room] = history.copyRawTail(int(room), HistoryTailLength, timestamps + room * tail, roomValues);
+    }
+    return data;
+}
+
+/**
+ * @brief Атомарно записывает снимок: во временный файл, затем переименование.
+ */
+bool StateSnapshot::writeFile(const QString &path, const QByteArray &data) {
+    CLIMATE_PROFILE_SCOPE(SnapshotWrite);
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Не удалось открыть файл" << path << "для записи снимка.";
+        return false;
+    }
+    if (file.write(data) != data.size()) {
+        qWarning() << "Ошибка записи снимка:" << file.errorString();
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+/**
+ * @brief Загружает снимок, отображая файл в память.
+ *
+ * Заголовок, все смещения и значения направления воздуха проверяются до
+ * изменения хранилища.
+ */
+bool StateSnapshot::load(const QString &path, RoomStateStore &store, RoomHistory &history,
+                         SnapshotSettings &settings) {
+    CLIMATE_PROFILE_SCOPE(SnapshotLoad);
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const qint64 size = file.size();
+    if (size < qint64(sizeof(SnapshotHeader)))
+        return false;
+
+    const uchar *base = file.map(0, size);
+    if (!base) {
+        qWarning() << "Не удалось отобразить снимок в память:" << file.errorString();
+        return false;
+    }
+
+    SnapshotHeader header;
+    std::memcpy(&header, base, sizeof(header));
+
+    const quint64 rooms = quint64(std::max(header.roomCount, 0));
+    const quint64 tail = quint64(std::max(header.historyTailLength, 0));
+    auto fits = [&](quint64 offset, quint64 bytes) {
+        return offset % 8 == 0 && offset <= quint64(size) && bytes <= quint64(size) - offset;
+    };
+
+    bool valid = std::memcmp(header.magic, SnapshotMagic, sizeof(header.magic)) == 0
+                 && header.version == FormatVersion
+                 && header.byteOrderMark == ByteOrderMark
+                 && header.fileSize == quint64(size)
+                 && header.roomCount >= 0
+                 // Размеры столбцов ниже считаются из этих чисел: ограничиваем их до умножения
+                 && tail <= quint64(HistoryTailLength)
+                 && rooms <= quint64(size) / sizeof(double)
+                 && fits(header.temperatureOffset, rooms * sizeof(double))
+                 && fits(header.humidityOffset, rooms * sizeof(double))
+                 && fits(header.pressureOffset, rooms * sizeof(double))
+                 && fits(header.setpointOffset, rooms * sizeof(double))
+                 && fits(header.airflowOffset, rooms * sizeof(AirflowDirection))
+                 && fits(header.historyCountOffset, rooms * sizeof(qint32))
+                 && fits(header.historyTimestampOffset, rooms * tail * sizeof(qint64));
+    for (quint64 valueOffset : header.historyValueOffset)
+        valid = valid && fits(valueOffset, rooms * tail * sizeof(float));
+    if (valid) {
+        const quint8 *airflows = base + header.airflowOffset;
+        valid = std::all_of(airflows, airflows + rooms, [](quint8 airflow) {
+            return isValidAirflow(AirflowDirection(airflow));
+        });
+    }
+
+    if (!valid) {
+        qWarning() << "Файл снимка" << path << "повреждён или имеет другую версию, он будет пропущен.";
+        file.unmap(const_cast<uchar *>(base));
+        return false;
+    }
+
+    settings.temperatureUnit = header.temperatureUnit;
+    settings.pressureUnit = header.pressureUnit;
+    settings.systemState = header.systemState != 0;
+
+    store.restoreColumns(int(rooms),
+                         reinterpret_cast<const double *>(base + header.temperatureOffset),
+                         reinterpret_cast<const double *>(base + header.humidityOffset),
+                         reinterpret_cast<const double *>(base + header.pressureOffset),
+                         reinterpret_cast<const AirflowDirection *>(base + header.airflowOffset),
+                         reinterpret_cast<const double *>(base + header.setpointOffset));
+
+    if (history.roomCount() != int(rooms))
+        history.resize(int(rooms));
+    const qint32 *counts = reinterpret_cast<const qint32 *>(base + header.historyCountOffset);
+    const qint64 *timestamps = reinterpret_cast<const qint64 *>(base + header.historyTimestampOffset);
+    const float *values[MetricCount];
+    for (int metric = 0; metric < MetricCount; ++metric)
+        values[metric] = reinterpret_cast<const float *>(base + header.historyValueOffset[metric]);
+
+    for (quint64 room = 0; room < rooms; ++room) {
+        const quint64 count = std::min<quint64>(quint64(std::max(counts[room], 0)), tail);
+        for (quint64 i = 0; i < count; ++i) {
+            const quint64 index = room * tail + i;
+            history.append(int(room), timestamps[index], values[0][index], values[1][index], values[2][index]);
+        }
+    }
+
+    file.unmap(const_cast<uchar *>(base));
+    return true;
+}
+
+/**
+ * @brief Конструктор фонового сохранения.
+ * @param settingsProvider Возвращает текущие настройки; вызывается в потоке интерфейса.
+ */
+SnapshotWriter::SnapshotWriter(const QString &path, const RoomStateStore *store, const RoomHistory *history,
+                               SettingsProvider settingsProvider, QObject *parent)
+    : QObject(parent), snapshotPath(path), store(store), history(history),
+      settingsProvider(std::move(settingsProvider))
+{
+    writerPool.setMaxThreadCount(1);
+    connect(&timer, &QTimer::timeout, this, &SnapshotWriter::saveInBackground);
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    writerPool.waitForDone();
+}
+
+void SnapshotWriter::start(int intervalMs) {
+    timer.start(intervalMs);
+}
+
+/**
+ * @brief Собирает снимок и отдаёт запись на диск фоновому потоку.
+ */
+void SnapshotWriter::saveInBackground() {
+    if (writing.exchange(true))
+        return;
+
+    const QByteArray data = StateSnapshot::serialize(*store, *history, settingsProvider());
+    const QString path = snapshotPath;
+    writerPool.start([this, data, path]() {
+        StateSnapshot::writeFile(path, data);
+        writing.store(false);
+    });
+}
+
+bool SnapshotWriter::saveNow() {
+    writerPool.waitForDone();
+    return StateSnapshot::writeFile(snapshotPath, StateSnapshot::serialize(*store, *history, settingsProvider()));
+}
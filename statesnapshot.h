@@ -0,0 +1,87 @@
+#ifndef STATESNAPSHOT_H
+#define STATESNAPSHOT_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QTimer>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+
+#include "roomstate.h"
+#include "roomhistory.h"
+
+/**
+ * @brief Настройки приложения, сохраняемые в снимке вместе с состоянием комнат.
+ */
+struct SnapshotSettings {
+    int temperatureUnit = 0;   ///< Индекс в temperatureUnitCombo
+    int pressureUnit = 0;      ///< Индекс в pressureUnitCombo
+    bool systemState = false;  ///< Кондиционер включён
+};
+
+/**
+ * @brief Двоичный снимок состояния: настройки, столбцы комнат, уставки и хвост истории.
+ *
+ * Файл состоит из заголовка фиксированного размера и столбцов, выровненных
+ * на 8 байт, в порядке байтов платформы. Заголовок хранит смещения столбцов,
+ * поэтому при загрузке файл отображается в память и столбцы копируются
+ * в хранилище напрямую, без разбора. Запись идёт через QSaveFile
+ * (временный файл и атомарное переименование), так что при сбое на диске
+ * остаётся либо старый, либо новый снимок целиком.
+ */
+class StateSnapshot {
+public:
+    static constexpr quint32 FormatVersion = 1;
+    static constexpr int HistoryTailLength = 64; ///< Последних сырых измерений на комнату
+
+    static QByteArray serialize(const RoomStateStore &store, const RoomHistory &history,
+                                const SnapshotSettings &settings);
+    static bool writeFile(const QString &path, const QByteArray &data);
+
+    /**
+     * @brief Загружает снимок в хранилище и историю.
+     * @return false, если файла нет или он повреждён; хранилище при этом не меняется.
+     */
+    static bool load(const QString &path, RoomStateStore &store, RoomHistory &history,
+                     SnapshotSettings &settings);
+};
+
+/**
+ * @brief Периодическое сохранение снимка в фоне.
+ *
+ * По таймеру снимок собирается в потоке интерфейса (копирование столбцов)
+ * и записывается на диск в отдельном потоке. Если предыдущая запись ещё
+ * не закончилась, очередной снимок пропускается.
+ */
+class SnapshotWriter : public QObject {
+    Q_OBJECT
+
+public:
+    using SettingsProvider = std::function<SnapshotSettings()>;
+
+    static constexpr int DefaultIntervalMs = 30 * 1000;
+
+    SnapshotWriter(const QString &path, const RoomStateStore *store, const RoomHistory *history,
+                   SettingsProvider settingsProvider, QObject *parent = nullptr);
+    ~SnapshotWriter();
+
+    void start(int intervalMs = DefaultIntervalMs);
+    bool saveNow(); ///< Синхронное сохранение (например, при выходе)
+    QString path() const { return snapshotPath; }
+
+public slots:
+    void saveInBackground();
+
+private:
+    QString snapshotPath;
+    const RoomStateStore *store;
+    const RoomHistory *history;
+    SettingsProvider settingsProvider;
+    QTimer timer;
+    QThreadPool writerPool;            ///< Один поток записи
+    std::atomic<bool> writing{false};
+};
+
+#endif // STATESNAPSHOT_H
@@ -0,0 +1,104 @@
+#include "statsdialog.h"
+#include "profiler.h"
+
+#include <QDialogButtonBox>
+#include <QFileDialog>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+namespace {
+
+QString microseconds(double nanoseconds) {
+    return QString::number(nanoseconds / 1000.0, 'f', 1);
+}
+
+} // namespace
+
+/**
+ * @brief Конструктор окна статистики.
+ */
+StatsDialog::StatsDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle("Статистика");
+    resize(760, 460);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    table = new QTableWidget(Profiler::ProbeCount, 8, this);
+    table->setHorizontalHeaderLabels({"Замер", "Число", "Средн., мкс", "p50, мкс", "p90, мкс",
+                                      "p99, мкс", "p99.9, мкс", "Макс., мкс"});
+    table->verticalHeader()->setVisible(false);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionMode(QAbstractItemView::NoSelection);
+    table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    for (int row = 0; row < Profiler::ProbeCount; ++row) {
+        table->setItem(row, 0, new QTableWidgetItem(Profiler::probeName(Profiler::Probe(row))));
+        for (int column = 1; column < table->columnCount(); ++column) {
+            QTableWidgetItem *item = new QTableWidgetItem;
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            table->setItem(row, column, item);
+        }
+    }
+    layout->addWidget(table);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    QPushButton *resetButton = buttons->addButton("Сбросить", QDialogButtonBox::ResetRole);
+    QPushButton *dumpButton = buttons->addButton("Сохранить в файл...", QDialogButtonBox::ActionRole);
+    connect(resetButton, &QPushButton::clicked, this, &StatsDialog::resetStats);
+    connect(dumpButton, &QPushButton::clicked, this, &StatsDialog::dumpToFile);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    layout->addWidget(buttons);
+
+    refreshTimer.setInterval(RefreshIntervalMs);
+    connect(&refreshTimer, &QTimer::timeout, this, &StatsDialog::refresh);
+}
+
+/**
+ * @brief Обновляет таблицу; тексты ячеек меняются только у изменившихся значений.
+ */
+void StatsDialog::refresh() {
+    const QVector<Profiler::ProbeStats> stats = Profiler::collect();
+    for (const Profiler::ProbeStats &probe : stats) {
+        const int row = int(probe.probe);
+        const QString values[] = {QString::number(probe.count),
+                                  microseconds(probe.averageNs()),
+                                  microseconds(double(probe.p50Ns)),
+                                  microseconds(double(probe.p90Ns)),
+                                  microseconds(double(probe.p99Ns)),
+                                  microseconds(double(probe.p999Ns)),
+                                  microseconds(double(probe.maxNs))};
+        for (int column = 1; column < table->columnCount(); ++column) {
+            QTableWidgetItem *item = table->item(row, column);
+            if (item->text() != values[column - 1])
+                item->setText(values[column - 1]);
+        }
+    }
+}
+
+void StatsDialog::resetStats() {
+    Profiler::reset();
+    refresh();
+}
+
+void StatsDialog::dumpToFile() {
+    const QString path = QFileDialog::getSaveFileName(this, "Сохранить статистику", "profile.txt",
+                                                      "Текстовые файлы (*.txt)");
+    if (path.isEmpty())
+        return;
+    if (!Profiler::dumpToFile(path))
+        QMessageBox::warning(this, "Статистика", QString("Не удалось сохранить файл %1.").arg(path));
+}
+
+void StatsDialog::showEvent(QShowEvent *event) {
+    refresh();
+    refreshTimer.start();
+    QDialog::showEvent(event);
+}
+
+void StatsDialog::hideEvent(QHideEvent *event) {
+    refreshTimer.stop();
+    QDialog::hideEvent(event);
+}
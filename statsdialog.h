@@ -0,0 +1,37 @@
+#ifndef STATSDIALOG_H
+#define STATSDIALOG_H
+
+#include <QDialog>
+#include <QTableWidget>
+#include <QTimer>
+
+/**
+ * @brief Окно "Статистика": замеры Profiler по всем участкам.
+ *
+ * Пока окно открыто, таблица обновляется раз в RefreshIntervalMs.
+ * Время показывается в микросекундах, перцентили - по верхней
+ * границе интервала гистограммы.
+ */
+class StatsDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    static constexpr int RefreshIntervalMs = 500;
+
+    explicit StatsDialog(QWidget *parent = nullptr);
+
+public slots:
+    void refresh();
+    void resetStats();
+    void dumpToFile(); ///< Сохранение замеров с выбором файла
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    QTableWidget *table;
+    QTimer refreshTimer;
+};
+
+#endif // STATSDIALOG_H
@@ -0,0 +1,99 @@
+#include "thememanager.h"
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QStyle>
+#include <QStyleFactory>
+
+namespace {
+
+/// Тёмная тема с розовым текстом, прежде заданная таблицей стилей приложения
+QPalette darkPalette() {
+    const QColor background(0x1e, 0x1e, 0x1e);
+    const QColor panel(0x2a, 0x2a, 0x2a);
+    const QColor button(0x33, 0x33, 0x33);
+    const QColor text(0xff, 0x69, 0xb4);
+    const QColor disabledText(0x80, 0x80, 0x80);
+
+    QPalette palette;
+    palette.setColor(QPalette::Window, background);
+    palette.setColor(QPalette::WindowText, text);
+    palette.setColor(QPalette::Base, background);
+    palette.setColor(QPalette::AlternateBase, panel);
+    palette.setColor(QPalette::ToolTipBase, panel);
+    palette.setColor(QPalette::ToolTipText, text);
+    palette.setColor(QPalette::Text, text);
+    palette.setColor(QPalette::Button, button);
+    palette.setColor(QPalette::ButtonText, text);
+    palette.setColor(QPalette::BrightText, Qt::white);
+    palette.setColor(QPalette::Light, QColor(0x55, 0x55, 0x55));
+    palette.setColor(QPalette::Midlight, QColor(0x44, 0x44, 0x44));
+    palette.setColor(QPalette::Mid, QColor(0x55, 0x55, 0x55));
+    palette.setColor(QPalette::Dark, QColor(0x15, 0x15, 0x15));
+    palette.setColor(QPalette::Shadow, Qt::black);
+    palette.setColor(QPalette::Highlight, QColor(0x44, 0x44, 0x44));
+    palette.setColor(QPalette::HighlightedText, text);
+    palette.setColor(QPalette::Link, text);
+    palette.setColor(QPalette::Disabled, QPalette::WindowText, disabledText);
+    palette.setColor(QPalette::Disabled, QPalette::Text, disabledText);
+    palette.setColor(QPalette::Disabled, QPalette::ButtonText, disabledText);
+    return palette;
+}
+
+} // namespace
+
+/**
+ * @brief Конструктор: задаёт стиль приложения и готовит все темы.
+ *
+ * Сразу применяется светлая тема.
+ */
+ThemeManager::ThemeManager(QObject *parent)
+    : QObject(parent)
+{
+    if (QApplication::style()->objectName().compare("fusion", Qt::CaseInsensitive) != 0) {
+        if (QStyle *fusion = QStyleFactory::create("Fusion"))
+            QApplication::setStyle(fusion);  ///< Приложение становится владельцем стиля
+    }
+
+    themes.resize(2);
+    themes[LightTheme] = {"Светлая", QApplication::style()->standardPalette(),
+                          "selection-color: yellow;"
+                          "background-color: #f0f0f0; "
+                          "border: 2px solid #808080; "
+                          "border-radius: 2;"};
+    themes[DarkTheme] = {"Тёмная", darkPalette(),
+                         "selection-color: yellow;"
+                         "background-color: #1e1e1e; "
+                         "border: 2px solid #555555; "
+                         "border-radius: 2;"};
+
+    apply(LightTheme);
+}
+
+void ThemeManager::addStyledView(QWidget *view) {
+    styledViews.append(view);
+    if (current >= 0)
+        view->setStyleSheet(themes[current].viewStyleSheet);
+}
+
+/**
+ * @brief Применяет тему и замеряет время переключения.
+ */
+void ThemeManager::apply(int themeId) {
+    if (themeId < 0 || themeId >= themes.size() || themeId == current)
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const Theme &theme = themes[themeId];
+    QApplication::setPalette(theme.palette);
+    for (const QPointer<QWidget> &view : styledViews) {
+        if (view)
+            view->setStyleSheet(theme.viewStyleSheet);
+    }
+
+    current = themeId;
+    lastSwitchDuration = timer.nsecsElapsed();
+    emit themeChanged(current, lastSwitchDuration);
+}
@@ -0,0 +1,55 @@
+#ifndef THEMEMANAGER_H
+#define THEMEMANAGER_H
+
+#include <QObject>
+#include <QPalette>
+#include <QPointer>
+#include <QString>
+#include <QVector>
+#include <QWidget>
+
+/**
+ * @brief Переключение тем интерфейса через палитру.
+ *
+ * Темы (палитра и короткая таблица стилей для отдельных представлений)
+ * строятся один раз при создании. Приложение один раз получает стиль Fusion,
+ * который целиком рисует по палитре, поэтому смена темы - это одна
+ * установка QApplication::setPalette() без разбора CSS и перестилизации
+ * каждого виджета, как при qApp->setStyleSheet(). Таблица стилей меняется
+ * только у зарегистрированных представлений.
+ */
+class ThemeManager : public QObject {
+    Q_OBJECT
+
+public:
+    enum ThemeId {
+        LightTheme,
+        DarkTheme
+    };
+
+    struct Theme {
+        QString name;
+        QPalette palette;
+        QString viewStyleSheet; ///< Для представлений из addStyledView()
+    };
+
+    explicit ThemeManager(QObject *parent = nullptr);
+
+    void addStyledView(QWidget *view); ///< Представление с собственной рамкой и фоном в каждой теме
+    void apply(int themeId);
+
+    int currentTheme() const { return current; }
+    const Theme &theme(int themeId) const { return themes[themeId]; }
+    qint64 lastSwitchNs() const { return lastSwitchDuration; } ///< Длительность последнего переключения
+
+signals:
+    void themeChanged(int themeId, qint64 switchNs);
+
+private:
+    QVector<Theme> themes;
+    QVector<QPointer<QWidget>> styledViews;
+    int current = -1;
+    qint64 lastSwitchDuration = 0;
+};
+
+#endif // THEMEMANAGER_H
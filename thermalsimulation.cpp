@@ -0,0 +1,445 @@
+#include "thermalsimulation.h"
+#include "parallelfor.h"
+#include "profiler.h"
+
+#include <QDateTime>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define CLIMATE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr double SecondsPerDay = 86400.0;
+constexpr double Pi = 3.14159265358979323846;
+
+/// Вид ребра графа соседства относительно комнаты-владельца
+enum EdgeKind {
+    SameFloor,
+    FloorAbove,
+    FloorBelow
+};
+
+/// Усиление обмена по направлению подачи воздуха: [направление][SameFloor, FloorAbove, FloorBelow]
+constexpr double AirflowGain[4][3] = {
+    {1.0, 1.0, 1.0},   // None
+    {2.0, 2.0, 1.0},   // UpRightLeft
+    {1.0, 1.0, 3.0},   // DownDownDown
+    {2.5, 1.0, 1.0}    // RightLeft
+};
+
+/// Строка AirflowGain; неизвестное направление (хранилище его не пропускает, см. isValidAirflow()) считается отсутствием подачи
+const double *airflowGain(AirflowDirection direction) {
+    const int row = int(direction);
+    Q_ASSERT(row >= 0 && row < 4);
+    return AirflowGain[row >= 0 && row < 4 ? row : 0];
+}
+
+/**
+ * @brief Столбцы и коэффициенты одного шага имитации.
+ *
+ * Сосед комнаты i на месте slot - neighbours[slot * rooms + i], его
+ * коэффициент - edgeCoefficients[slot * rooms + i] (см. ThermalSimulation::buildLayout()).
+ */
+struct StepColumns {
+    const double *temperature;
+    const double *humidity;
+    const double *pressure;
+    const double *heating;
+    const double *pressureTarget;
+    const int *neighbours;
+    const double *edgeCoefficients;
+    size_t rooms;
+    double *nextTemperature;
+    double *nextHumidity;
+    double *nextPressure;
+    double outdoorTemperature;
+    double outdoorHumidity;
+    double outdoorCoefficient;
+    double heaterCoefficient;
+    double humidityCoefficient;
+    double pressureCoefficient;
+    double exchangeRatio;
+    double moistureStep;
+    double humidityPerDegree;
+};
+
+/// Комнаты [first, last) по одной; ограничение влажности - min/max без ветвлений
+void stepRoomsScalar(const StepColumns &c, size_t first, size_t last) {
+    const double *t = c.temperature;
+    const double *h = c.humidity;
+    const double *p = c.pressure;
+    for (size_t i = first; i < last; ++i) {
+        double heatFlow = 0.0;
+        double moistureFlow = 0.0;
+        for (int slot = 0; slot < ThermalSimulation::MaxNeighbours; ++slot) {
+            const size_t edge = size_t(slot) * c.rooms + i;
+            const int j = c.neighbours[edge];
+            heatFlow += c.edgeCoefficients[edge] * (t[j] - t[i]);
+            moistureFlow += c.edgeCoefficients[edge] * (h[j] - h[i]);
+        }
+
+        const double newTemperature = t[i] + heatFlow + c.outdoorCoefficient * (c.outdoorTemperature - t[i])
+                                      + c.heaterCoefficient * c.heating[i];
+        const double newHumidity = h[i] + c.exchangeRatio * moistureFlow + c.humidityCoefficient * (c.outdoorHumidity - h[i])
+                                   + c.moistureStep - c.humidityPerDegree * h[i] * (newTemperature - t[i]);
+        c.nextTemperature[i] = newTemperature;
+        c.nextHumidity[i] = std::min(std::max(newHumidity, 0.0), 100.0);
+        c.nextPressure[i] = p[i] + c.pressureCoefficient * (c.pressureTarget[i] - p[i]);
+    }
+}
+
+#if defined(CLIMATE_X86_SIMD) && defined(__GNUC__)
+
+/**
+ * @brief AVX2: по четыре комнаты, соседи читаются выборкой по индексам.
+ *
+ * Операции те же и в том же порядке, что в stepRoomsScalar(), поэтому
+ * результат совпадает до бита.
+ */
+__attribute__((target("avx2")))
+void stepRoomsAvx2(const StepColumns &c, size_t first, size_t last) {
+    const __m256d outdoorTemperature = _mm256_set1_pd(c.outdoorTemperature);
+    const __m256d outdoorHumidity = _mm256_set1_pd(c.outdoorHumidity);
+    const __m256d outdoorCoefficient = _mm256_set1_pd(c.outdoorCoefficient);
+    const __m256d heaterCoefficient = _mm256_set1_pd(c.heaterCoefficient);
+    const __m256d humidityCoefficient = _mm256_set1_pd(c.humidityCoefficient);
+    const __m256d pressureCoefficient = _mm256_set1_pd(c.pressureCoefficient);
+    const __m256d exchangeRatio = _mm256_set1_pd(c.exchangeRatio);
+    const __m256d moistureStep = _mm256_set1_pd(c.moistureStep);
+    const __m256d humidityPerDegree = _mm256_set1_pd(c.humidityPerDegree);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d hundred = _mm256_set1_pd(100.0);
+    ///< Выборка с маской всех элементов: на _mm256_i32gather_pd() GCC 12 выдаёт ложное предупреждение
+    const __m256d allLanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+    size_t i = first;
+    for (; i + 4 <= last; i += 4) {
+        const __m256d t = _mm256_loadu_pd(c.temperature + i);
+        const __m256d h = _mm256_loadu_pd(c.humidity + i);
+        __m256d heatFlow = zero;
+        __m256d moistureFlow = zero;
+        for (int slot = 0; slot < ThermalSimulation::MaxNeighbours; ++slot) {
+            const size_t edge = size_t(slot) * c.rooms + i;
+            const __m128i j = _mm_loadu_si128(reinterpret_cast<const __m128i *>(c.neighbours + edge));
+            const __m256d coefficient = _mm256_loadu_pd(c.edgeCoefficients + edge);
+            const __m256d neighbourTemperature = _mm256_mask_i32gather_pd(zero, c.temperature, j, allLanes, 8);
+            const __m256d neighbourHumidity = _mm256_mask_i32gather_pd(zero, c.humidity, j, allLanes, 8);
+            heatFlow = _mm256_add_pd(heatFlow, _mm256_mul_pd(coefficient, _mm256_sub_pd(neighbourTemperature, t)));
+            moistureFlow = _mm256_add_pd(moistureFlow, _mm256_mul_pd(coefficient, _mm256_sub_pd(neighbourHumidity, h)));
+        }
+
+        __m256d newTemperature = _mm256_add_pd(t, heatFlow);
+        newTemperature = _mm256_add_pd(newTemperature, _mm256_mul_pd(outdoorCoefficient, _mm256_sub_pd(outdoorTemperature, t)));
+        newTemperature = _mm256_add_pd(newTemperature, _mm256_mul_pd(heaterCoefficient, _mm256_loadu_pd(c.heating + i)));
+        __m256d newHumidity = _mm256_add_pd(h, _mm256_mul_pd(exchangeRatio, moistureFlow));
+        newHumidity = _mm256_add_pd(newHumidity, _mm256_mul_pd(humidityCoefficient, _mm256_sub_pd(outdoorHumidity, h)));
+        newHumidity = _mm256_add_pd(newHumidity, moistureStep);
+        newHumidity = _mm256_sub_pd(newHumidity, _mm256_mul_pd(_mm256_mul_pd(humidityPerDegree, h),
+                                                               _mm256_sub_pd(newTemperature, t)));
+        const __m256d p = _mm256_loadu_pd(c.pressure + i);
+        const __m256d newPressure = _mm256_add_pd(p, _mm256_mul_pd(pressureCoefficient,
+                                                                   _mm256_sub_pd(_mm256_loadu_pd(c.pressureTarget + i), p)));
+        _mm256_storeu_pd(c.nextTemperature + i, newTemperature);
+        ///< Порядок операндов как у std::min/std::max: NaN проходит насквозь
+        _mm256_storeu_pd(c.nextHumidity + i, _mm256_min_pd(hundred, _mm256_max_pd(zero, newHumidity)));
+        _mm256_storeu_pd(c.nextPressure + i, newPressure);
+    }
+    stepRoomsScalar(c, i, last);
+}
+
+bool hasAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+void stepRooms(const StepColumns &c, size_t first, size_t last) {
+    if (hasAvx2()) {
+        stepRoomsAvx2(c, first, last);
+        return;
+    }
+    stepRoomsScalar(c, first, last);
+}
+
+#else
+
+void stepRooms(const StepColumns &c, size_t first, size_t last) {
+    stepRoomsScalar(c, first, last);
+}
+
+#endif
+
+} // namespace
+
+/**
+ * @brief Конструктор имитации.
+ * @param store Хранилище, из которого берутся начальное состояние и мощность установки
+ *              и в которое публикуется результат.
+ */
+ThermalSimulation::ThermalSimulation(RoomStateStore *store, QObject *parent)
+    : QObject(parent), store(store), startMs(QDateTime::currentMSecsSinceEpoch())
+{
+    connect(&timer, &QTimer::timeout, this, &ThermalSimulation::onTimer);
+    connect(store, &RoomStateStore::roomsReset, this, &ThermalSimulation::roomsReset);
+    connect(store, &RoomStateStore::roomChanged, this, &ThermalSimulation::roomChanged);
+    connect(store, &RoomStateStore::allRoomsChanged, this, &ThermalSimulation::allRoomsChanged);
+    roomsReset();
+}
+
+void ThermalSimulation::setParameters(const Parameters &parameters) {
+    model = parameters;
+    coefficientsDirty = true;
+}
+
+void ThermalSimulation::setAmbient(const Ambient &ambient) {
+    outdoor = ambient;
+    coefficientsDirty = true;
+}
+
+/**
+ * @brief Задаёт шаг имитации.
+ *
+ * Схема явная: шаг должен быть много меньше теплоёмкость / сумма теплопередач
+ * комнаты (при параметрах по умолчанию - около часа).
+ */
+void ThermalSimulation::setStepSeconds(double seconds) {
+    stepSec = std::max(seconds, 0.001);
+    coefficientsDirty = true;
+}
+
+void ThermalSimulation::setBuildingLayout(int roomsPerRow, int rowsPerFloor) {
+    rowLength = std::max(roomsPerRow, 1);
+    floorRows = std::max(rowsPerFloor, 1);
+    buildLayout();
+}
+
+/**
+ * @brief Строит граф соседства по планировке для текущего числа комнат.
+ *
+ * Место без соседа указывает на саму комнату: вклад c * (t[i] - t[i]) равен
+ * нулю, и шагу не нужна проверка наличия соседа.
+ */
+void ThermalSimulation::buildLayout() {
+    const int rooms = store->roomCount();
+    const int perFloor = rowLength * floorRows;
+
+    layoutRooms = rooms;
+    neighbours.resize(size_t(rooms) * MaxNeighbours);
+    auto setEdge = [this, rooms](NeighbourSlot slot, int roomId, int neighbour, bool exists) {
+        neighbours[size_t(slot) * size_t(rooms) + size_t(roomId)] =
+            exists && neighbour >= 0 && neighbour < rooms ? neighbour : roomId;
+    };
+
+    for (int roomId = 0; roomId < rooms; ++roomId) {
+        const int inFloor = roomId % perFloor;
+        const int row = inFloor / rowLength;
+        const int column = inFloor % rowLength;
+
+        setEdge(LeftSlot, roomId, roomId - 1, column > 0);
+        setEdge(RightSlot, roomId, roomId + 1, column + 1 < rowLength);
+        setEdge(RowBeforeSlot, roomId, roomId - rowLength, row > 0);
+        setEdge(RowAfterSlot, roomId, roomId + rowLength, row + 1 < floorRows);
+        setEdge(FloorAboveSlot, roomId, roomId + perFloor, true);
+        setEdge(FloorBelowSlot, roomId, roomId - perFloor, true);
+    }
+
+    edgeCoefficients.resize(neighbours.size());
+    coefficientsDirty = true;
+}
+
+/**
+ * @brief Пересчитывает коэффициенты шага после смены параметров, шага или направлений воздуха.
+ */
+void ThermalSimulation::updateCoefficients() {
+    const double perHeatCapacity = stepSec / model.heatCapacity;
+    outdoorCoefficient = model.outdoorConductance * perHeatCapacity;
+    heaterCoefficient = model.heaterPower * perHeatCapacity;
+    humidityCoefficient = 1.0 - std::exp(-model.humidityRelaxation * stepSec);
+    pressureCoefficient = 1.0 - std::exp(-model.pressureRelaxation * stepSec);
+
+    const AirflowDirection *airflows = store->airflows();
+    const int rooms = layoutRooms;
+    for (int roomId = 0; roomId < rooms; ++roomId) {
+        const double *ownGain = airflowGain(airflows[roomId]);
+        for (int slot = 0; slot < MaxNeighbours; ++slot) {
+            const size_t edge = size_t(slot) * size_t(rooms) + size_t(roomId);
+            const int neighbour = neighbours[edge];
+            const EdgeKind kind = slot == FloorAboveSlot ? FloorAbove : slot == FloorBelowSlot ? FloorBelow : SameFloor;
+            const EdgeKind reverse = kind == FloorAbove ? FloorBelow : kind == FloorBelow ? FloorAbove : SameFloor;
+            const double conductance = kind == SameFloor ? model.wallConductance : model.floorConductance;
+            const double *otherGain = airflowGain(airflows[neighbour]);
+            edgeCoefficients[edge] = neighbour == roomId
+                                     ? 0.0
+                                     : conductance * perHeatCapacity * 0.5 * (ownGain[kind] + otherGain[reverse]);
+        }
+        pressureTarget[size_t(roomId)] = outdoor.pressure
+                                         + (airflows[roomId] != AirflowDirection::None ? model.supplyPressure : 0.0);
+    }
+    coefficientsDirty = false;
+}
+
+/**
+ * @brief Берёт состояние всех комнат и мощность установки из хранилища.
+ */
+void ThermalSimulation::reset() {
+    const int rooms = store->roomCount();
+    temperature.assign(store->temperatures(), store->temperatures() + rooms);
+    humidity.assign(store->humidities(), store->humidities() + rooms);
+    pressure.assign(store->pressures(), store->pressures() + rooms);
+    heating.assign(store->outputs(), store->outputs() + rooms);
+    nextTemperature.resize(size_t(rooms));
+    nextHumidity.resize(size_t(rooms));
+    nextPressure.resize(size_t(rooms));
+    pressureTarget.resize(size_t(rooms));
+    pendingSeconds = 0.0;
+    coefficientsDirty = true;
+}
+
+void ThermalSimulation::roomsReset() {
+    buildLayout();
+    reset();
+}
+
+/**
+ * @brief Ручное изменение комнаты переносится в состояние имитации.
+ *
+ * Публикация самой имитации идёт через applySamples() и сюда не попадает.
+ */
+void ThermalSimulation::roomChanged(int roomId, int fields) {
+    if (roomId < 0 || roomId >= int(temperature.size()))
+        return;
+    if (fields & RoomStateStore::TemperatureField)
+        temperature[size_t(roomId)] = store->temperature(roomId);
+    if (fields & RoomStateStore::HumidityField)
+        humidity[size_t(roomId)] = store->humidity(roomId);
+    if (fields & RoomStateStore::PressureField)
+        pressure[size_t(roomId)] = store->pressure(roomId);
+    if (fields & RoomStateStore::AirflowField)
+        coefficientsDirty = true;
+}
+
+void ThermalSimulation::allRoomsChanged(int fields) {
+    if (fields & (RoomStateStore::TemperatureField | RoomStateStore::HumidityField | RoomStateStore::PressureField))
+        reset();
+    else if (fields & RoomStateStore::AirflowField)
+        coefficientsDirty = true;
+}
+
+void ThermalSimulation::start(double speed) {
+    this->speed = std::max(speed, 0.0);
+    reset();
+    wallClock.start();
+    timer.start(PublishIntervalMs);
+}
+
+void ThermalSimulation::stop() {
+    timer.stop();
+}
+
+/**
+ * @brief Срабатывание таймера: догоняет прошедшее время с учётом ускорения и публикует результат.
+ */
+void ThermalSimulation::onTimer() {
+    const qint64 elapsedMs = std::min<qint64>(wallClock.restart(), 1000); ///< После долгой паузы не догоняем
+    pendingSeconds += double(elapsedMs) / 1000.0 * speed;
+    const qint64 count = std::min<qint64>(qint64(pendingSeconds / stepSec), MaxStepsPerPublish);
+    if (count <= 0)
+        return;
+    ///< Не успеваем за ускорением: имитация отстаёт от заданного темпа, а не копит долг на следующие срабатывания
+    pendingSeconds = std::min(pendingSeconds - double(count) * stepSec, stepSec);
+
+    heating.assign(store->outputs(), store->outputs() + heating.size());
+    runSteps(count);
+    publish();
+}
+
+void ThermalSimulation::advance(double seconds) {
+    heating.assign(store->outputs(), store->outputs() + heating.size());
+    runSteps(std::llround(seconds / stepSec));
+    publish();
+}
+
+double ThermalSimulation::outdoorTemperatureAt(double seconds) const {
+    const double dayMs = std::fmod(double(startMs) + seconds * 1000.0, SecondsPerDay * 1000.0);
+    ///< Минимум в 3:00 и максимум в 15:00 по UTC
+    return outdoor.temperature + outdoor.dailyAmplitude * std::sin(2.0 * Pi * (dayMs / 1000.0 / SecondsPerDay - 0.375));
+}
+
+/**
+ * @brief Выполняет count шагов имитации.
+ */
+void ThermalSimulation::runSteps(qint64 count) {
+    CLIMATE_PROFILE_SCOPE(SimulationSteps);
+    if (coefficientsDirty)
+        updateCoefficients();
+
+    const int rooms = int(temperature.size());
+    for (qint64 i = 0; i < count; ++i) {
+        const double outdoorTemperature = outdoorTemperatureAt(simTime + 0.5 * stepSec);
+        parallelFor(rooms, BatchSize, [this, outdoorTemperature](int first, int last) {
+            stepRange(first, last, outdoorTemperature);
+        });
+        temperature.swap(nextTemperature);
+        humidity.swap(nextHumidity);
+        pressure.swap(nextPressure);
+        simTime += stepSec;
+        ++stepCount;
+    }
+}
+
+/**
+ * @brief Один шаг комнат [first, last).
+ *
+ * Читает только текущие столбцы и пишет только свои элементы следующих,
+ * поэтому пачки обрабатываются параллельно без синхронизации. На процессорах
+ * с AVX2 комнаты считаются по четыре (см. stepRoomsAvx2()).
+ */
+void ThermalSimulation::stepRange(int first, int last, double outdoorTemperature) {
+    StepColumns columns;
+    columns.temperature = temperature.data();
+    columns.humidity = humidity.data();
+    columns.pressure = pressure.data();
+    columns.heating = heating.data();
+    columns.pressureTarget = pressureTarget.data();
+    columns.neighbours = neighbours.data();
+    columns.edgeCoefficients = edgeCoefficients.data();
+    columns.rooms = size_t(layoutRooms);
+    columns.nextTemperature = nextTemperature.data();
+    columns.nextHumidity = nextHumidity.data();
+    columns.nextPressure = nextPressure.data();
+    columns.outdoorTemperature = outdoorTemperature;
+    columns.outdoorHumidity = outdoor.humidity;
+    columns.outdoorCoefficient = outdoorCoefficient;
+    columns.heaterCoefficient = heaterCoefficient;
+    columns.humidityCoefficient = humidityCoefficient;
+    columns.pressureCoefficient = pressureCoefficient;
+    columns.exchangeRatio = model.humidityExchangeRatio;
+    columns.moistureStep = model.moistureGain * stepSec;
+    columns.humidityPerDegree = model.humidityPerDegree / 100.0;
+    stepRooms(columns, size_t(first), size_t(last));
+}
+
+/**
+ * @brief Публикует состояние всех комнат в хранилище одним пакетом.
+ */
+void ThermalSimulation::publish() {
+    const int rooms = std::min(int(temperature.size()), store->roomCount());
+    const qint64 publishedMs = timestampMs();
+    sampleBuffer.resize(size_t(rooms));
+    for (int roomId = 0; roomId < rooms; ++roomId) {
+        SensorSample &sample = sampleBuffer[size_t(roomId)];
+        sample.timestampMs = publishedMs;
+        sample.roomId = roomId;
+        sample.reserved = 0;
+        sample.temperature = temperature[size_t(roomId)];
+        sample.humidity = humidity[size_t(roomId)];
+        sample.pressure = pressure[size_t(roomId)];
+    }
+
+    store->applySamples(sampleBuffer.data(), rooms);
+    emit samplesApplied(sampleBuffer.data(), rooms);
+    emit advanced(simTime);
+}
@@ -0,0 +1,173 @@
+#ifndef THERMALSIMULATION_H
+#define THERMALSIMULATION_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <vector>
+
+#include "roomstate.h"
+#include "sensorsample.h"
+
+/**
+ * @brief Имитация здания: теплообмен, влажность и давление по комнатам.
+ *
+ * Комнаты связаны графом соседства с постоянным числом мест MaxNeighbours
+ * на комнату: каждое место - непрерывный столбец номеров соседей и
+ * коэффициентов по всем комнатам, отсутствующий сосед - сама комната
+ * с нулевым коэффициентом. По умолчанию здание строится как набор этажей
+ * из рядов комнат: соседи по ряду и между рядами обмениваются теплом через
+ * стены, комнаты соседних этажей - через перекрытия.
+ * Каждая комната также теряет тепло наружу и получает мощность климатической
+ * установки из столбца RoomStateStore::outputs(), то есть замыкает контур
+ * с ControlEngine.
+ *
+ * Направление подачи воздуха комнаты усиливает обмен в своих направлениях:
+ * "Вверх-Право-Лево" - с соседями по этажу и верхним этажом, "Вниз-Вниз-Вниз" -
+ * с нижним этажом, "Право-Лево" - с соседями по этажу. Коэффициент ребра
+ * берётся средним по обеим комнатам, поэтому обмен остаётся симметричным
+ * и тепло не возникает из ниоткуда. Приток воздуха также задаёт избыточное
+ * давление комнаты относительно наружного.
+ *
+ * Шаг явный (схема Якоби): новое состояние рассчитывается из предыдущего
+ * в отдельные столбцы, поэтому комнаты обрабатываются параллельно пачками
+ * без синхронизации (см. parallelFor()). Проход по пачке не содержит
+ * ветвлений: на процессорах с AVX2 комнаты считаются по четыре. Результат
+ * публикуется в хранилище тем же пакетным applySamples(), что и измерения
+ * датчиков, и попадает в историю, таблицу и графики обычным путём.
+ */
+class ThermalSimulation : public QObject {
+    Q_OBJECT
+
+public:
+    /// Физические параметры комнаты (одинаковые для всех комнат)
+    struct Parameters {
+        double heatCapacity = 2.0e6;          ///< Теплоёмкость воздуха и обстановки, Дж/К
+        double wallConductance = 60.0;        ///< Теплопередача стены между соседями, Вт/К
+        double floorConductance = 40.0;       ///< Теплопередача перекрытия между этажами, Вт/К
+        double outdoorConductance = 80.0;     ///< Теплопотери наружу, Вт/К
+        double heaterPower = 3000.0;          ///< Мощность установки при выходе регулятора 1, Вт
+        double humidityExchangeRatio = 3.0;   ///< Во сколько раз влага переносится быстрее тепла
+        double humidityRelaxation = 1.0 / 3600.0; ///< Обмен влагой с улицей, 1/с
+        double moistureGain = 0.5 / 3600.0;   ///< Выделение влаги в комнате, %/с
+        double humidityPerDegree = 5.0;       ///< Снижение относительной влажности при нагреве, % (отн.) на °C
+        double pressureRelaxation = 0.5;      ///< Выравнивание давления с наружным, 1/с
+        double supplyPressure = 15.0;         ///< Избыточное давление при притоке воздуха, Па
+    };
+
+    /// Наружные условия; температура колеблется в течение суток
+    struct Ambient {
+        double temperature = -5.0;            ///< Среднесуточная, °C
+        double dailyAmplitude = 5.0;          ///< Амплитуда суточного колебания, °C
+        double humidity = 80.0;               ///< %
+        double pressure = RoomStateStore::StandardPressure; ///< Па
+    };
+
+    static constexpr double DefaultStepSeconds = 5.0;
+    static constexpr double DefaultSpeed = 60.0;      ///< Секунд имитации в секунду работы
+    static constexpr int PublishIntervalMs = 100;
+    static constexpr int BatchSize = 1024;            ///< Комнат в одной пачке параллельного прохода
+    static constexpr int MaxStepsPerPublish = 200;    ///< Шагов за срабатывание таймера; отставание сверх этого отбрасывается
+    static constexpr int MaxNeighbours = 6;           ///< Четыре соседа по этажу, верхний и нижний
+
+    explicit ThermalSimulation(RoomStateStore *store, QObject *parent = nullptr);
+
+    void setParameters(const Parameters &parameters);
+    Parameters parameters() const { return model; }
+    void setAmbient(const Ambient &ambient);
+    Ambient ambient() const { return outdoor; }
+    void setStepSeconds(double seconds);
+    double stepSeconds() const { return stepSec; }
+
+    /**
+     * @brief Задаёт планировку: этажи из rowsPerFloor рядов по roomsPerRow комнат.
+     *
+     * Комнаты нумеруются по рядам, затем по этажам; последний этаж может быть неполным.
+     */
+    void setBuildingLayout(int roomsPerRow, int rowsPerFloor);
+    int roomsPerRow() const { return rowLength; }
+    int rowsPerFloor() const { return floorRows; }
+
+    void reset();                        ///< Взять текущее состояние комнат из хранилища
+    void start(double speed = DefaultSpeed); ///< Имитация в реальном времени с ускорением speed
+    void stop();
+    bool isRunning() const { return timer.isActive(); }
+
+    /**
+     * @brief Имитирует seconds секунд без ожидания и публикует итоговое состояние.
+     *
+     * Мощность установки берётся из хранилища один раз в начале и на время
+     * вызова не меняется; для замкнутого контура с регулятором используйте start().
+     */
+    void advance(double seconds);
+
+    double simulatedSeconds() const { return simTime; }
+    qint64 timestampMs() const { return startMs + qint64(simTime * 1000.0); } ///< Время опубликованного состояния, мс от начала эпохи
+    quint64 steps() const { return stepCount; }
+
+signals:
+    void advanced(double simulatedSeconds); ///< Новое состояние опубликовано в хранилище
+    /// Пачка применена к хранилищу; samples действителен только на время вызова (соединение прямое)
+    void samplesApplied(const SensorSample *samples, int count);
+
+private slots:
+    void onTimer();
+    void roomsReset();
+    void roomChanged(int roomId, int fields);
+    void allRoomsChanged(int fields);
+
+private:
+    /// Место соседа в графе: столбцы neighbours и edgeCoefficients
+    enum NeighbourSlot {
+        LeftSlot,
+        RightSlot,
+        RowBeforeSlot,
+        RowAfterSlot,
+        FloorAboveSlot,
+        FloorBelowSlot
+    };
+
+    void buildLayout();
+    void updateCoefficients();
+    void runSteps(qint64 count);
+    void stepRange(int first, int last, double outdoorTemperature);
+    void publish();
+    double outdoorTemperatureAt(double seconds) const;
+
+    RoomStateStore *store;
+    QTimer timer;
+    QElapsedTimer wallClock;
+    double speed = DefaultSpeed;
+    double pendingSeconds = 0.0;     ///< Не отработанный остаток меньше шага
+    double simTime = 0.0;            ///< Секунды от начала имитации
+    qint64 startMs = 0;              ///< Время публикации, соответствующее simTime == 0
+    quint64 stepCount = 0;
+
+    Parameters model;
+    Ambient outdoor;
+    double stepSec = DefaultStepSeconds;
+    int rowLength = 10;
+    int floorRows = 2;
+
+    ///< Граф соседства: сосед комнаты i на месте slot - neighbours[slot * layoutRooms + i]
+    int layoutRooms = 0;
+    std::vector<int> neighbours;
+    std::vector<double> edgeCoefficients;  ///< Доля разности температур, переносимая за шаг; 0 - нет соседа
+    bool coefficientsDirty = true;
+
+    ///< Коэффициенты шага, не зависящие от комнаты
+    double outdoorCoefficient = 0.0;
+    double heaterCoefficient = 0.0;
+    double humidityCoefficient = 0.0;
+    double pressureCoefficient = 0.0;
+
+    ///< Состояние по комнатам: текущее и рассчитываемое
+    std::vector<double> temperature, nextTemperature;
+    std::vector<double> humidity, nextHumidity;
+    std::vector<double> pressure, nextPressure;
+    std::vector<double> pressureTarget;    ///< Установившееся давление с учётом притока
+    std::vector<double> heating;           ///< Мощность установки, -1..1
+    std::vector<SensorSample> sampleBuffer; ///< Переиспользуется между публикациями
+};
+
+#endif // THERMALSIMULATION_H
@@ -0,0 +1,283 @@
+#ifndef TIMESERIESCODEC_H
+#define TIMESERIESCODEC_H
+
+#include <QtGlobal>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief Сжатие временных рядов в духе Gorilla: время - разностью разностей,
+ * значения - XOR с предыдущим значением.
+ *
+ * Битовые потоки пишутся словами по 64 бита от старшего бита к младшему,
+ * поэтому поток можно читать прямо из отображённого файла без копирования.
+ *
+ * Время (мс): первое значение целиком, затем разность разностей d:
+ *
+ *     '0'                      d == 0
+ *     '10'   + 7 бит           d в [-63, 64]
+ *     '110'  + 9 бит           d в [-255, 256]
+ *     '1110' + 12 бит          d в [-2047, 2048]
+ *     '1111' + 64 бита         иначе
+ *
+ * Значение: бит режима ('0' - значение в фиксированной точке 1/scale,
+ * '1' - исходный double), затем XOR с предыдущим преобразованным значением:
+ *
+ *     '0'                                   XOR == 0
+ *     '10' + значащие биты                  окно ведущих и хвостовых нулей как у прошлого кода '11',
+ *                                           если оно шире нужного не больше чем на длину заголовка
+ *     '11' + 5 бит ведущих нулей + 6 бит длины + значащие биты
+ *
+ * Показания датчиков обычно кратны 0.01 °C, 0.1 % или 1 Па; в фиксированной
+ * точке это целые double, у которых мантисса заканчивается длинной серией
+ * нулей, и XOR соседних показаний укладывается в несколько бит. Значение,
+ * которое не восстанавливается из фиксированной точки бит в бит, пишется
+ * как есть, поэтому сжатие без потерь.
+ */
+namespace TimeSeriesCodec {
+
+class BitWriter {
+public:
+    /// Дописывает младшие bits бит value (1..64)
+    void write(quint64 value, int bits) {
+        if (bits < 64)
+            value &= (quint64(1) << bits) - 1;
+        const int used = int(bitCount & 63);
+        if (used == 0)
+            words.push_back(0);
+        const int free = 64 - used;
+        if (bits <= free) {
+            words.back() |= value << (free - bits);
+        } else {
+            words.back() |= value >> (bits - free);
+            words.push_back(value << (64 - (bits - free)));
+        }
+        bitCount += quint64(bits);
+    }
+
+    void clear() {
+        words.clear();
+        bitCount = 0;
+    }
+
+    const std::vector<quint64> &data() const { return words; }
+    quint64 size() const { return bitCount; }
+
+private:
+    std::vector<quint64> words;
+    quint64 bitCount = 0;
+};
+
+class BitReader {
+public:
+    BitReader() = default;
+    BitReader(const quint64 *words, quint64 bitCount) : words(words), limit(bitCount) {}
+
+    /// Читает bits бит (1..64); за концом потока возвращает 0 и выставляет overrun()
+    quint64 read(int bits) {
+        if (position + quint64(bits) > limit) {
+            failed = true;
+            position = limit;
+            return 0;
+        }
+        const quint64 word = position >> 6;
+        const int offset = int(position & 63);
+        quint64 value = words[word] << offset;
+        if (offset + bits > 64)
+            value |= words[word + 1] >> (64 - offset);
+        position += quint64(bits);
+        return value >> (64 - bits);
+    }
+
+    bool readBit() { return read(1) != 0; }
+    bool overrun() const { return failed; }
+
+private:
+    const quint64 *words = nullptr;
+    quint64 limit = 0;
+    quint64 position = 0;
+    bool failed = false;
+};
+
+inline quint64 doubleBits(double value) {
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline double bitsDouble(quint64 bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+class TimestampEncoder {
+public:
+    /// @return Число записанных бит
+    int append(BitWriter &out, qint64 timestampMs) {
+        if (count++ == 0) {
+            out.write(quint64(timestampMs), 64);
+            previous = timestampMs;
+            return 64;
+        }
+        const qint64 delta = timestampMs - previous;
+        const qint64 dod = delta - previousDelta;
+        previous = timestampMs;
+        previousDelta = delta;
+        if (dod == 0) {
+            out.write(0, 1);
+            return 1;
+        }
+        if (dod >= -63 && dod <= 64) {
+            out.write((quint64(0b10) << 7) | quint64(dod + 63), 9);
+            return 9;
+        }
+        if (dod >= -255 && dod <= 256) {
+            out.write((quint64(0b110) << 9) | quint64(dod + 255), 12);
+            return 12;
+        }
+        if (dod >= -2047 && dod <= 2048) {
+            out.write((quint64(0b1110) << 12) | quint64(dod + 2047), 16);
+            return 16;
+        }
+        out.write(0b1111, 4);
+        out.write(quint64(dod), 64);
+        return 68;
+    }
+
+    void reset() { *this = TimestampEncoder(); }
+
+private:
+    quint64 count = 0;
+    qint64 previous = 0;
+    qint64 previousDelta = 0;
+};
+
+class TimestampDecoder {
+public:
+    explicit TimestampDecoder(BitReader reader = BitReader()) : in(reader) {}
+
+    qint64 next() {
+        if (count++ == 0) {
+            previous = qint64(in.read(64));
+            return previous;
+        }
+        qint64 dod = 0;
+        if (in.readBit()) {
+            if (!in.readBit())
+                dod = qint64(in.read(7)) - 63;
+            else if (!in.readBit())
+                dod = qint64(in.read(9)) - 255;
+            else if (!in.readBit())
+                dod = qint64(in.read(12)) - 2047;
+            else
+                dod = qint64(in.read(64));
+        }
+        previousDelta += dod;
+        previous += previousDelta;
+        return previous;
+    }
+
+    bool overrun() const { return in.overrun(); }
+
+private:
+    BitReader in;
+    quint64 count = 0;
+    qint64 previous = 0;
+    qint64 previousDelta = 0;
+};
+
+class ValueEncoder {
+public:
+    explicit ValueEncoder(double scale = 1.0) : scale(scale) {}
+
+    /// @return Число записанных бит
+    int append(BitWriter &out, double value) {
+        // Фиксированная точка, только если деление восстанавливает исходное значение бит в бит
+        const double scaled = std::nearbyint(value * scale);
+        const bool fixed = std::fabs(scaled) < 9007199254740992.0 && doubleBits(scaled / scale) == doubleBits(value);
+        const quint64 bits = doubleBits(fixed ? scaled : value);
+        out.write(fixed ? 0 : 1, 1);
+
+        if (count++ == 0) {
+            out.write(bits, 64);
+            previous = bits;
+            return 65;
+        }
+        const quint64 difference = bits ^ previous;
+        previous = bits;
+        if (difference == 0) {
+            out.write(0, 1);
+            return 2;
+        }
+        int leading = __builtin_clzll(difference);
+        const int trailing = __builtin_ctzll(difference);
+        if (leading > 31)
+            leading = 31;
+        const int meaningful = 64 - leading - trailing;
+        // Старое окно - только если оно не дороже нового заголовка: иначе после одного
+        // широкого XOR все следующие значения писались бы в широкое окно
+        if (windowLength > 0 && leading >= windowLeading && trailing >= 64 - windowLeading - windowLength
+                && windowLength <= meaningful + 11) {
+            out.write(0b10, 2);
+            out.write(difference >> (64 - windowLeading - windowLength), windowLength);
+            return 3 + windowLength;
+        }
+        windowLeading = leading;
+        windowLength = meaningful;
+        out.write((quint64(0b11) << 11) | (quint64(windowLeading) << 6) | quint64(windowLength & 63), 13);
+        out.write(difference >> trailing, windowLength);
+        return 14 + windowLength;
+    }
+
+    void reset() { *this = ValueEncoder(scale); }
+
+private:
+    double scale;
+    quint64 count = 0;
+    quint64 previous = 0;
+    int windowLeading = 0;
+    int windowLength = 0;    ///< 0 - окна ещё нет
+};
+
+class ValueDecoder {
+public:
+    explicit ValueDecoder(BitReader reader = BitReader(), double scale = 1.0) : in(reader), scale(scale) {}
+
+    double next() {
+        const bool fixed = !in.readBit();
+        if (count++ == 0) {
+            previous = in.read(64);
+        } else if (in.readBit()) {
+            if (in.readBit()) {
+                windowLeading = int(in.read(5));
+                windowLength = int(in.read(6));
+                if (windowLength == 0)
+                    windowLength = 64;
+            }
+            // Кодировщик такого не пишет: старое окно до первого или окно шире значения
+            if (windowLength == 0 || windowLeading + windowLength > 64)
+                corrupt = true;
+            else
+                previous ^= in.read(windowLength) << (64 - windowLeading - windowLength);
+        }
+        const double value = bitsDouble(previous);
+        return fixed ? value / scale : value;
+    }
+
+    bool overrun() const { return in.overrun() || corrupt; } ///< Поток кончился раньше или повреждён
+
+private:
+    BitReader in;
+    double scale;
+    bool corrupt = false;
+    quint64 count = 0;
+    quint64 previous = 0;
+    int windowLeading = 0;
+    int windowLength = 0;
+};
+
+} // namespace TimeSeriesCodec
+
+#endif // TIMESERIESCODEC_H
@@ -0,0 +1,192 @@
+#include "controlapiclient.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::size_t ReceiveChunk = 64 * 1024;
+
+} // namespace
+
+ControlApiClient::~ControlApiClient() {
+    close();
+}
+
+/**
+ * @brief Подключается в блокирующем режиме, затем переводит сокет в неблокирующий.
+ */
+bool ControlApiClient::connect(const std::string &address) {
+    close();
+    if (address.compare(0, 5, "unix:") == 0) {
+        const std::string path = address.substr(5);
+        sockaddr_un target;
+        std::memset(&target, 0, sizeof(target));
+        target.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(target.sun_path))
+            return fail("Недопустимый путь сокета: " + path);
+        std::memcpy(target.sun_path, path.data(), path.size());
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr *>(&target), sizeof(target)) != 0)
+            return fail(address + ": " + std::strerror(errno));
+    } else if (address.compare(0, 4, "tcp:") == 0) {
+        std::string host = "127.0.0.1";
+        std::string port = address.substr(4);
+        const std::size_t colon = port.rfind(':');
+        if (colon != std::string::npos) {
+            host = port.substr(0, colon);
+            port = port.substr(colon + 1);
+            if (host.size() >= 2 && host.front() == '[' && host.back() == ']')
+                host = host.substr(1, host.size() - 2);
+        }
+        addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *result = nullptr;
+        const int status = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+        if (status != 0 || !result)
+            return fail(address + ": " + gai_strerror(status));
+        fd = ::socket(result->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const bool connected = fd >= 0 && ::connect(fd, result->ai_addr, result->ai_addrlen) == 0;
+        ::freeaddrinfo(result);
+        if (!connected)
+            return fail(address + ": " + std::strerror(errno));
+        const int noDelay = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    } else {
+        return fail("Адрес должен начинаться с unix: или tcp: - " + address);
+    }
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    error.clear();
+    return true;
+}
+
+void ControlApiClient::close() {
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+    input.clear();
+    output.clear();
+    outputOffset = 0;
+    pending = 0;
+}
+
+bool ControlApiClient::fail(const std::string &message) {
+    error = message;
+    close();
+    return false;
+}
+
+/**
+ * @brief Дописывает в очередь отправки заголовок кадра и возвращает место под элементы.
+ */
+std::uint8_t *ControlApiClient::appendFrame(std::uint8_t opcode, std::size_t count, std::size_t itemBytes) {
+    const std::size_t used = output.size();
+    output.resize(used + ControlApi::HeaderBytes + count * itemBytes);
+    ControlApi::encodeHeader(output.data() + used, opcode, ControlApi::Ok, nextRequestId, std::uint32_t(count),
+                             count * itemBytes);
+    ++pending;
+    return output.data() + used + ControlApi::HeaderBytes;
+}
+
+std::uint32_t ControlApiClient::setSetpoints(const std::int32_t *roomIds, const double *celsius, std::size_t count) {
+    count = std::min<std::size_t>(count, ControlApi::MaxItems);
+    std::uint8_t *item = appendFrame(ControlApi::SetSetpoints, count, ControlApi::SetpointItemBytes);
+    for (std::size_t i = 0; i < count; ++i, item += ControlApi::SetpointItemBytes)
+        ControlApi::encodeSetpoint(item, roomIds[i], celsius[i]);
+    return nextRequestId++;
+}
+
+std::uint32_t ControlApiClient::readRooms(const std::int32_t *roomIds, std::size_t count) {
+    count = std::min<std::size_t>(count, ControlApi::MaxItems);
+    std::uint8_t *item = appendFrame(ControlApi::ReadRooms, count, ControlApi::RoomIdItemBytes);
+    for (std::size_t i = 0; i < count; ++i, item += ControlApi::RoomIdItemBytes)
+        ControlApi::putU32(item, std::uint32_t(roomIds[i]));
+    return nextRequestId++;
+}
+
+int ControlApiClient::process(int timeoutMs, const Handler &handler) {
+    if (fd < 0) {
+        error = "Нет соединения";
+        return -1;
+    }
+    pollfd waiter{fd, short(POLLIN | (outputOffset < output.size() ? POLLOUT : 0)), 0};
+    if (::poll(&waiter, 1, timeoutMs) < 0 && errno != EINTR) {
+        fail(std::string("poll: ") + std::strerror(errno));
+        return -1;
+    }
+
+    while (outputOffset < output.size()) {
+        const ssize_t sent = ::send(fd, output.data() + outputOffset, output.size() - outputOffset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            outputOffset += std::size_t(sent);
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            fail(std::string("send: ") + std::strerror(errno));
+            return -1;
+        }
+    }
+    if (outputOffset == output.size()) {
+        output.clear();
+        outputOffset = 0;
+    }
+
+    for (;;) {
+        const std::size_t used = input.size();
+        input.resize(used + ReceiveChunk);
+        const ssize_t received = ::recv(fd, input.data() + used, ReceiveChunk, 0);
+        input.resize(used + std::size_t(std::max<ssize_t>(received, 0)));
+        if (received > 0 && std::size_t(received) == ReceiveChunk)
+            continue;
+        if (received > 0 || (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)))
+            break;
+        if (received < 0 && errno == EINTR)
+            continue;
+        fail(received == 0 ? std::string("Сервер закрыл соединение") : std::string("recv: ") + std::strerror(errno));
+        return -1;
+    }
+
+    // Ответы разбираются прямо в приёмном буфере
+    int handled = 0;
+    std::size_t offset = 0;
+    while (offset < input.size()) {
+        const long bytes = ControlApi::frameBytes(input.data() + offset, input.size() - offset,
+                                                  ControlApi::RoomStateBytes);
+        if (bytes < 0) {
+            fail("Недопустимая длина кадра ответа");
+            return -1;
+        }
+        if (bytes == 0)
+            break;
+        const std::uint8_t *frame = input.data() + offset;
+        const ControlApi::FrameHeader header = ControlApi::decodeHeader(frame);
+        const Response response{std::uint8_t(header.opcode & ~ControlApi::ResponseFlag), header.status,
+                                header.requestId, header.count, frame + ControlApi::HeaderBytes};
+        if (std::size_t(bytes) < ControlApi::HeaderBytes + header.count * ControlApi::responseItemBytes(header.opcode)) {
+            fail("Длина кадра ответа не совпадает с числом элементов");
+            return -1;
+        }
+        if (pending > 0)
+            --pending;
+        if (handler)
+            handler(response);
+        ++handled;
+        offset += std::size_t(bytes);
+    }
+    input.erase(input.begin(), input.begin() + long(offset));
+    return handled;
+}
@@ -0,0 +1,80 @@
+#ifndef CONTROLAPICLIENT_H
+#define CONTROLAPICLIENT_H
+
+#include "controlapiprotocol.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Эталонный клиент API управления (ControlApiServer).
+ *
+ * Запросы только ставятся в очередь отправки и получают номер; process()
+ * отправляет очередь, принимает ответы и отдаёт их обработчику в порядке
+ * запросов. Поэтому клиент может держать сколько угодно запросов в пути:
+ * нагрузочная утилита так измеряет пропускную способность, а не задержку.
+ *
+ * Не зависит от Qt; вызывается из одного потока.
+ */
+class ControlApiClient {
+public:
+    /// Ответ сервера; items указывает в приёмный буфер и действителен только в обработчике
+    struct Response {
+        std::uint8_t opcode;        ///< Код запроса, без ResponseFlag
+        std::uint8_t status;        ///< ControlApi::Status
+        std::uint32_t requestId;
+        std::uint32_t count;        ///< Принятых уставок или записей RoomState
+        const std::uint8_t *items;
+
+        ControlApi::RoomState room(std::uint32_t index) const {
+            return ControlApi::decodeRoomState(items + std::size_t(index) * ControlApi::RoomStateBytes);
+        }
+    };
+    using Handler = std::function<void(const Response &)>;
+
+    ControlApiClient() = default;
+    ~ControlApiClient();
+    ControlApiClient(const ControlApiClient &) = delete;
+    ControlApiClient &operator=(const ControlApiClient &) = delete;
+
+    /**
+     * @brief Подключается к серверу.
+     * @param address "unix:<путь>" или "tcp:[<узел>:]<порт>", как у ControlApiServer::start().
+     * @return false при ошибке (см. errorString()).
+     */
+    bool connect(const std::string &address);
+    void close();
+    bool isConnected() const { return fd >= 0; }
+
+    /// Ставит в очередь пакет уставок (не больше ControlApi::MaxItems) и возвращает номер запроса
+    std::uint32_t setSetpoints(const std::int32_t *roomIds, const double *celsius, std::size_t count);
+    /// Ставит в очередь чтение состояния комнат и возвращает номер запроса
+    std::uint32_t readRooms(const std::int32_t *roomIds, std::size_t count);
+
+    /**
+     * @brief Отправляет очередь и разбирает пришедшие ответы.
+     * @param timeoutMs Сколько ждать сокет; 0 - не ждать.
+     * @return Число разобранных ответов или -1 при ошибке соединения (см. errorString()).
+     */
+    int process(int timeoutMs, const Handler &handler);
+
+    std::size_t pendingRequests() const { return pending; }  ///< Отправлено или в очереди, без ответа
+    const std::string &errorString() const { return error; }
+
+private:
+    std::uint8_t *appendFrame(std::uint8_t opcode, std::size_t count, std::size_t itemBytes);
+    bool fail(const std::string &message);
+
+    int fd = -1;
+    std::vector<std::uint8_t> input;
+    std::vector<std::uint8_t> output;
+    std::size_t outputOffset = 0;
+    std::size_t pending = 0;
+    std::uint32_t nextRequestId = 1;
+    std::string error;
+};
+
+#endif // CONTROLAPICLIENT_H
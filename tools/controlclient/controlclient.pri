@@ -0,0 +1,11 @@
+# Эталонный клиент API управления (ControlApiClient).
+# Не зависит от Qt: подключается утилитой controlclient и замерами API управления.
+
+INCLUDEPATH += $$PWD $$PWD/../..
+DEPENDPATH += $$PWD
+
+SOURCES += \
+        $$PWD/controlapiclient.cpp
+
+HEADERS += \
+    $$PWD/controlapiclient.h
@@ -0,0 +1,15 @@
+# Клиент и нагрузочная утилита локального API управления.
+#
+#   ./untitled1 --rooms 5000 --control-api unix:/tmp/climate-control.sock
+#   ./controlclient --rooms 5000 --batch 512 --pipeline 16 --seconds 10
+
+TEMPLATE = app
+CONFIG += c++17 console
+CONFIG -= qt app_bundle
+
+TARGET = controlclient
+
+include(controlclient.pri)
+
+SOURCES += \
+        main.cpp
@@ -0,0 +1,121 @@
+#include "controlapiclient.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+std::atomic<bool> stopRequested{false};
+
+void requestStop(int) {
+    stopRequested.store(true, std::memory_order_relaxed);
+}
+
+void usage() {
+    std::fprintf(stderr, "Использование: controlclient [--address unix:путь|tcp:[узел:]порт] [--rooms N] "
+                         "[--batch N] [--pipeline N] [--seconds N] [--read]\n");
+}
+
+} // namespace
+
+/**
+ * @brief Нагрузочная утилита API управления: пакеты уставок по кругу комнат без ожидания ответов.
+ *
+ * --pipeline - сколько запросов держать в пути, --read чередует пакеты
+ * уставок с чтением тех же комнат. Печатает выполненные элементы в секунду.
+ */
+int main(int argc, char *argv[]) {
+    const char *address = ControlApi::DefaultAddress;
+    int rooms = 5000;
+    int batch = 512;
+    int pipeline = 16;
+    int seconds = 10;
+    bool reads = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--address") == 0 && i + 1 < argc) {
+            address = argv[++i];
+        } else if (std::strcmp(argv[i], "--rooms") == 0 && i + 1 < argc) {
+            rooms = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc) {
+            pipeline = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--read") == 0) {
+            reads = true;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (rooms < 1 || batch < 1 || batch > int(ControlApi::MaxItems) || pipeline < 1 || seconds < 1) {
+        usage();
+        return 2;
+    }
+
+    ControlApiClient client;
+    if (!client.connect(address)) {
+        std::fprintf(stderr, "%s\n", client.errorString().c_str());
+        return 1;
+    }
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+    std::printf("API управления %s: комнат %d, пакет %d, в пути %d запросов\n", address, rooms, batch, pipeline);
+    std::fflush(stdout);
+
+    std::vector<std::int32_t> roomIds(std::size_t(batch), 0);
+    std::vector<double> setpoints(std::size_t(batch), 0.0);
+    int nextRoom = 0;
+    std::uint64_t sent = 0;
+    std::uint64_t applied = 0;
+    std::uint64_t failed = 0;
+    const auto handler = [&](const ControlApiClient::Response &response) {
+        applied += response.count;
+        if (response.status != ControlApi::Ok)
+            ++failed;
+    };
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point started = Clock::now();
+    const Clock::time_point deadline = started + std::chrono::seconds(seconds);
+    while (!stopRequested.load(std::memory_order_relaxed) && Clock::now() < deadline) {
+        while (client.pendingRequests() < std::size_t(pipeline)) {
+            for (int i = 0; i < batch; ++i) {
+                roomIds[std::size_t(i)] = nextRoom;
+                setpoints[std::size_t(i)] = 20.0 + double((sent + std::uint64_t(i)) % 50) * 0.1;
+                nextRoom = (nextRoom + 1) % rooms;
+            }
+            if (reads && sent % 2 == 1)
+                client.readRooms(roomIds.data(), roomIds.size());
+            else
+                client.setSetpoints(roomIds.data(), setpoints.data(), roomIds.size());
+            ++sent;
+        }
+        if (client.process(10, handler) < 0) {
+            std::fprintf(stderr, "%s\n", client.errorString().c_str());
+            return 1;
+        }
+    }
+    // Дожидаемся ответов на отправленное, чтобы счёт был честным
+    const Clock::time_point drainDeadline = Clock::now() + std::chrono::seconds(5);
+    while (client.pendingRequests() > 0 && Clock::now() < drainDeadline) {
+        if (client.process(10, handler) < 0) {
+            std::fprintf(stderr, "%s\n", client.errorString().c_str());
+            return 1;
+        }
+    }
+
+    const double elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+    std::printf("Запросов: %llu, элементов выполнено: %llu (%.0f в секунду), пакетов с ошибкой: %llu\n",
+                static_cast<unsigned long long>(sent - client.pendingRequests()),
+                static_cast<unsigned long long>(applied), double(applied) / std::max(elapsed, 1e-9),
+                static_cast<unsigned long long>(failed));
+    return failed == 0 ? 0 : 1;
+}
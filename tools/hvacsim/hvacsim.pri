@@ -0,0 +1,11 @@
+# Имитатор шлюза климатических установок (HvacSimulator).
+# Не зависит от Qt: подключается утилитой hvacsim и замерами опроса установок.
+
+INCLUDEPATH += $$PWD $$PWD/../..
+DEPENDPATH += $$PWD
+
+SOURCES += \
+        $$PWD/hvacsimulator.cpp
+
+HEADERS += \
+    $$PWD/hvacsimulator.h
@@ -0,0 +1,15 @@
+# Имитатор шлюза климатических установок для источника "hvac:".
+#
+#   ./hvacsim --units 5000 --latency 2
+#   ./untitled1 --rooms 5000 --sensors hvac:127.0.0.1:1502
+
+TEMPLATE = app
+CONFIG += c++17 console
+CONFIG -= qt app_bundle
+
+TARGET = hvacsim
+
+include(hvacsim.pri)
+
+SOURCES += \
+        main.cpp
@@ -0,0 +1,293 @@
+#include "hvacsimulator.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+std::int64_t monotonicMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+constexpr double AmbientTemperature = 18.0;  ///< К ней остывает выключенная комната
+constexpr double HeatingRate = 0.2;          ///< °C/с при полной мощности
+constexpr double LossRate = 0.002;           ///< Доля разницы с улицей за секунду
+constexpr std::size_t ReceiveChunk = 16 * 1024;
+
+} // namespace
+
+HvacSimulator::HvacSimulator(int unitCount, int responseDelayMs)
+    : units(std::size_t(std::clamp(unitCount, 1, HvacProtocol::MaxUnits))),
+      delayMs(std::max(responseDelayMs, 0))
+{
+    for (std::size_t i = 0; i < units.size(); ++i)
+        units[i] = {20.0 + double(i % 7) * 0.5, 45.0, 101325.0, 21.0, 0.0, 0};
+}
+
+HvacSimulator::~HvacSimulator() {
+    for (const Client &client : clients)
+        ::close(client.fd);
+    if (listener >= 0)
+        ::close(listener);
+}
+
+int HvacSimulator::listen(std::uint16_t port, bool anyAddress) {
+    listener = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listener < 0) {
+        error = std::string("socket: ") + std::strerror(errno);
+        return -1;
+    }
+    const int reuse = 1;
+    ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(anyAddress ? INADDR_ANY : INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (::bind(listener, reinterpret_cast<sockaddr *>(&address), length) != 0
+            || ::listen(listener, 64) != 0
+            || ::getsockname(listener, reinterpret_cast<sockaddr *>(&address), &length) != 0) {
+        error = "Порт " + std::to_string(port) + ": " + std::strerror(errno);
+        ::close(listener);
+        listener = -1;
+        return -1;
+    }
+    return ntohs(address.sin_port);
+}
+
+void HvacSimulator::run(const std::atomic<bool> &stop) {
+    std::vector<pollfd> waiters;
+    lastStepMs = monotonicMs();
+    while (!stop.load(std::memory_order_relaxed)) {
+        std::int64_t now = monotonicMs();
+        advance(now);
+
+        waiters.clear();
+        waiters.push_back({listener, POLLIN, 0});
+        int timeoutMs = StepMs;
+        for (Client &client : clients) {
+            while (!client.delayed.empty() && client.delayed.front().dueMs <= now) {
+                const std::vector<std::uint8_t> &frame = client.delayed.front().frame;
+                client.output.insert(client.output.end(), frame.begin(), frame.end());
+                client.delayed.pop_front();
+            }
+            if (!client.delayed.empty())
+                timeoutMs = std::min<int>(timeoutMs, int(client.delayed.front().dueMs - now));
+            const bool hasOutput = client.outputOffset < client.output.size();
+            waiters.push_back({client.fd, short(POLLIN | (hasOutput ? POLLOUT : 0)), 0});
+        }
+
+        if (::poll(waiters.data(), nfds_t(waiters.size()), std::max(timeoutMs, 0)) < 0 && errno != EINTR) {
+            error = std::string("poll: ") + std::strerror(errno);
+            return;
+        }
+        now = monotonicMs();
+        // Новые клиенты добавляются после обхода: индексы waiters совпадают с clients
+        const std::size_t polledClients = waiters.size() - 1;
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < polledClients; ++i) {
+            Client &client = clients[i];
+            const short events = waiters[i + 1].revents;
+            bool alive = true;
+            if (events & (POLLIN | POLLHUP | POLLERR))
+                alive = receive(client, now);
+            if (alive)
+                alive = flush(client);
+            if (!alive) {
+                ::close(client.fd);
+                continue;
+            }
+            if (kept != i)
+                clients[kept] = std::move(client);
+            ++kept;
+        }
+        clients.erase(clients.begin() + std::ptrdiff_t(kept), clients.begin() + std::ptrdiff_t(polledClients));
+        if (waiters[0].revents & POLLIN)
+            acceptClients();
+    }
+}
+
+/**
+ * @brief Шаг имитации всех установок, не чаще StepMs.
+ */
+void HvacSimulator::advance(std::int64_t nowMs) {
+    if (nowMs - lastStepMs < StepMs)
+        return;
+    const double seconds = double(nowMs - lastStepMs) / 1000.0;
+    lastStepMs = nowMs;
+    for (Unit &unit : units) {
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 17;
+        randomState ^= randomState << 5;
+        const double noise = double(randomState & 0xffff) / 65535.0 - 0.5;
+
+        unit.output = std::clamp((unit.setpoint - unit.temperature) / 2.0, -1.0, 1.0);
+        unit.temperature += (unit.output * HeatingRate + (AmbientTemperature - unit.temperature) * LossRate) * seconds;
+        unit.humidity = std::clamp(unit.humidity + noise * 0.2, 20.0, 80.0);
+        unit.pressure = 101325.0 + noise * 4.0;
+    }
+}
+
+void HvacSimulator::acceptClients() {
+    for (;;) {
+        const int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        const int noDelay = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        Client client;
+        client.fd = fd;
+        clients.push_back(std::move(client));
+    }
+}
+
+/**
+ * @brief Читает доступные кадры и ставит ответы в очередь клиента.
+ * @return false, если клиент закрыл соединение или прислал недопустимый кадр.
+ */
+bool HvacSimulator::receive(Client &client, std::int64_t nowMs) {
+    for (;;) {
+        const std::size_t used = client.input.size();
+        client.input.resize(used + ReceiveChunk);
+        const ssize_t received = ::recv(client.fd, client.input.data() + used, ReceiveChunk, 0);
+        client.input.resize(used + std::size_t(std::max<ssize_t>(received, 0)));
+        if (received > 0)
+            continue;
+        if (received == 0)
+            return false;
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+        return false;
+    }
+
+    std::size_t offset = 0;
+    std::uint8_t response[HvacProtocol::MaxFrameBytes];
+    while (offset < client.input.size()) {
+        const int bytes = HvacProtocol::frameBytes(client.input.data() + offset, client.input.size() - offset);
+        if (bytes < 0)
+            return false;
+        if (bytes == 0 || offset + std::size_t(bytes) > client.input.size())
+            break;
+        const std::size_t responseBytes = handleFrame(client.input.data() + offset, bytes, response);
+        if (delayMs > 0)
+            client.delayed.push_back({nowMs + delayMs, std::vector<std::uint8_t>(response, response + responseBytes)});
+        else
+            client.output.insert(client.output.end(), response, response + responseBytes);
+        offset += std::size_t(bytes);
+    }
+    client.input.erase(client.input.begin(), client.input.begin() + std::ptrdiff_t(offset));
+    return true;
+}
+
+bool HvacSimulator::flush(Client &client) {
+    while (client.outputOffset < client.output.size()) {
+        const ssize_t sent = ::send(client.fd, client.output.data() + client.outputOffset,
+                                    client.output.size() - client.outputOffset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            client.outputOffset += std::size_t(sent);
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+    }
+    client.output.clear();
+    client.outputOffset = 0;
+    return true;
+}
+
+/**
+ * @brief Формирует ответ на кадр запроса.
+ * @return Длина ответа в response.
+ */
+std::size_t HvacSimulator::handleFrame(const std::uint8_t *frame, int size, std::uint8_t *response) {
+    ++frames;
+    const std::uint16_t transaction = HvacProtocol::getU16(frame);
+    const std::uint8_t function = size > HvacProtocol::HeaderBytes ? frame[HvacProtocol::HeaderBytes] : 0;
+    const std::uint8_t *pdu = frame + HvacProtocol::HeaderBytes + 1;
+    const int pduBytes = size - HvacProtocol::HeaderBytes - 1;
+
+    auto exception = [&](std::uint8_t code) {
+        HvacProtocol::putHeader(response, transaction, 2);
+        response[HvacProtocol::HeaderBytes] = std::uint8_t(function | HvacProtocol::ExceptionFlag);
+        response[HvacProtocol::HeaderBytes + 1] = code;
+        return std::size_t(HvacProtocol::HeaderBytes + 2);
+    };
+
+    if (function == HvacProtocol::ReadHoldingRegisters && pduBytes >= 4) {
+        const int start = HvacProtocol::getU16(pdu);
+        const int count = HvacProtocol::getU16(pdu + 2);
+        if (count < 1 || count > HvacProtocol::MaxReadRegisters
+                || start + count > int(units.size()) * HvacProtocol::RegistersPerUnit)
+            return exception(HvacProtocol::IllegalAddress);
+        HvacProtocol::putHeader(response, transaction, 2 + 2 * count);
+        response[HvacProtocol::HeaderBytes] = function;
+        response[HvacProtocol::HeaderBytes + 1] = std::uint8_t(2 * count);
+        for (int i = 0; i < count; ++i)
+            HvacProtocol::putU16(response + HvacProtocol::HeaderBytes + 2 + 2 * i, readRegister(start + i));
+        return std::size_t(HvacProtocol::HeaderBytes + 2 + 2 * count);
+    }
+    if (function == HvacProtocol::WriteSingleRegister && pduBytes >= 4) {
+        const std::uint8_t code = writeRegister(HvacProtocol::getU16(pdu), HvacProtocol::getU16(pdu + 2));
+        if (code)
+            return exception(code);
+        // Ответ на запись повторяет запрос
+        HvacProtocol::putHeader(response, transaction, 5);
+        std::memcpy(response + HvacProtocol::HeaderBytes, frame + HvacProtocol::HeaderBytes, 5);
+        return std::size_t(HvacProtocol::HeaderBytes + 5);
+    }
+    return exception(HvacProtocol::IllegalFunction);
+}
+
+std::uint16_t HvacSimulator::readRegister(int address) const {
+    const Unit &unit = units[std::size_t(address / HvacProtocol::RegistersPerUnit)];
+    const std::uint32_t pressure = std::uint32_t(std::lround(unit.pressure * HvacProtocol::PressureScale));
+    switch (address % HvacProtocol::RegistersPerUnit) {
+    case HvacProtocol::Temperature:  return std::uint16_t(std::int16_t(std::lround(unit.temperature * HvacProtocol::TemperatureScale)));
+    case HvacProtocol::Humidity:     return std::uint16_t(std::lround(unit.humidity * HvacProtocol::HumidityScale));
+    case HvacProtocol::PressureHigh: return std::uint16_t(pressure >> 16);
+    case HvacProtocol::PressureLow:  return std::uint16_t(pressure);
+    case HvacProtocol::Setpoint:     return std::uint16_t(std::int16_t(std::lround(unit.setpoint * HvacProtocol::TemperatureScale)));
+    case HvacProtocol::Airflow:      return unit.airflow;
+    case HvacProtocol::Output:       return std::uint16_t(std::int16_t(std::lround(unit.output * HvacProtocol::OutputScale)));
+    case HvacProtocol::Status:       return HvacProtocol::StatusOnline;
+    }
+    return 0;
+}
+
+std::uint8_t HvacSimulator::writeRegister(int address, std::uint16_t value) {
+    const std::size_t index = std::size_t(address / HvacProtocol::RegistersPerUnit);
+    if (index >= units.size())
+        return HvacProtocol::IllegalAddress;
+    Unit &unit = units[index];
+    switch (address % HvacProtocol::RegistersPerUnit) {
+    case HvacProtocol::Setpoint: {
+        const double celsius = std::int16_t(value) / HvacProtocol::TemperatureScale;
+        if (celsius < 5.0 || celsius > 35.0)
+            return HvacProtocol::IllegalValue;
+        unit.setpoint = celsius;
+        return 0;
+    }
+    case HvacProtocol::Airflow:
+        if (value > 3)
+            return HvacProtocol::IllegalValue;
+        unit.airflow = value;
+        return 0;
+    default:
+        return HvacProtocol::IllegalAddress;
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef HVACSIMULATOR_H
+#define HVACSIMULATOR_H
+
+#include "hvacprotocol.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Имитатор шлюза климатических установок для проверки HvacClient.
+ *
+ * Принимает TCP-соединения и отвечает на кадры hvacprotocol.h в одном
+ * потоке через poll(). Каждая установка ведёт температуру к уставке с
+ * мощностью, пропорциональной отклонению, влажность и давление медленно
+ * блуждают. Ответы могут задерживаться на responseDelayMs, чтобы было
+ * видно, как конвейер запросов скрывает сетевую задержку.
+ */
+class HvacSimulator {
+public:
+    static constexpr int StepMs = 100;      ///< Шаг имитации установок
+
+    explicit HvacSimulator(int units, int responseDelayMs = 0);
+    ~HvacSimulator();
+    HvacSimulator(const HvacSimulator &) = delete;
+    HvacSimulator &operator=(const HvacSimulator &) = delete;
+
+    /**
+     * @brief Открывает порт на 127.0.0.1 (или на всех адресах при anyAddress).
+     * @param port 0 - свободный порт, выбранный системой.
+     * @return Занятый порт или -1 (см. errorString()).
+     */
+    int listen(std::uint16_t port, bool anyAddress = false);
+    void run(const std::atomic<bool> &stop); ///< Обслуживает соединения, пока stop == false
+    const std::string &errorString() const { return error; }
+
+    int unitCount() const { return int(units.size()); }
+    std::uint64_t framesHandled() const { return frames; }
+
+private:
+    struct Unit {
+        double temperature;
+        double humidity;
+        double pressure;
+        double setpoint;
+        double output;
+        std::uint16_t airflow;
+    };
+
+    struct Delayed {
+        std::int64_t dueMs;
+        std::vector<std::uint8_t> frame;
+    };
+
+    struct Client {
+        int fd;
+        std::vector<std::uint8_t> input;
+        std::vector<std::uint8_t> output;
+        std::size_t outputOffset = 0;
+        std::deque<Delayed> delayed;         ///< Ответы, ждущие responseDelayMs
+    };
+
+    void advance(std::int64_t nowMs);
+    void acceptClients();
+    bool receive(Client &client, std::int64_t nowMs);
+    bool flush(Client &client);
+    std::size_t handleFrame(const std::uint8_t *frame, int size, std::uint8_t *response);
+    std::uint16_t readRegister(int address) const;
+    std::uint8_t writeRegister(int address, std::uint16_t value); ///< 0 или код исключения
+
+    std::vector<Unit> units;
+    std::vector<Client> clients;
+    int listener = -1;
+    int delayMs;
+    std::int64_t lastStepMs = 0;
+    std::uint32_t randomState = 0x2545f491u;
+    std::uint64_t frames = 0;
+    std::string error;
+};
+
+#endif // HVACSIMULATOR_H
@@ -0,0 +1,71 @@
+#include "hvacsimulator.h"
+
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+std::atomic<bool> stopRequested{false};
+
+void requestStop(int) {
+    stopRequested.store(true, std::memory_order_relaxed);
+}
+
+void usage() {
+    std::fprintf(stderr, "Использование: hvacsim [--port N] [--units N] [--latency мс] [--any]\n");
+}
+
+} // namespace
+
+/**
+ * @brief Имитатор шлюза установок: отвечает на опрос и запись уставок до SIGINT/SIGTERM.
+ *
+ * --latency задерживает каждый ответ, --any открывает порт на всех адресах вместо 127.0.0.1.
+ */
+int main(int argc, char *argv[]) {
+    int port = HvacProtocol::DefaultPort;
+    int units = 5000;
+    int latencyMs = 0;
+    bool anyAddress = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--units") == 0 && i + 1 < argc) {
+            units = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            latencyMs = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--any") == 0) {
+            anyAddress = true;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (port < 0 || port > 0xffff) {
+        usage();
+        return 2;
+    }
+
+    HvacSimulator simulator(units, latencyMs);
+    const int boundPort = simulator.listen(std::uint16_t(port), anyAddress);
+    if (boundPort < 0) {
+        std::fprintf(stderr, "%s\n", simulator.errorString().c_str());
+        return 1;
+    }
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+    std::printf("Шлюз установок: порт %d, установок %d, задержка ответа %d мс\n",
+                boundPort, simulator.unitCount(), latencyMs);
+    std::fflush(stdout);
+
+    simulator.run(stopRequested);
+    if (!simulator.errorString().empty()) {
+        std::fprintf(stderr, "%s\n", simulator.errorString().c_str());
+        return 1;
+    }
+    std::printf("Обработано кадров: %llu\n", static_cast<unsigned long long>(simulator.framesHandled()));
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "sharedstate.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char *airflowNames[] = {"-", "Вверх-Право-Лево", "Вниз-Вниз-Вниз", "Право-Лево"};
+
+std::int64_t nowMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Печатает сводку сегмента и первые shownRooms комнат одного снимка.
+ */
+bool printSnapshot(const SharedStateReader &reader, std::vector<SharedRoomRecord> &rooms, int shownRooms) {
+    if (!reader.snapshot(rooms)) {
+        std::fprintf(stderr, "Снимок не получен: писатель слишком часто переписывает блоки\n");
+        return false;
+    }
+    double sum = 0.0;
+    for (const SharedRoomRecord &room : rooms)
+        sum += room.temperature;
+    std::printf("pid %lld, комнат %zu, публикаций %llu, возраст %lld мс, средняя температура %.2f °C\n",
+                static_cast<long long>(reader.writerPid()), rooms.size(),
+                static_cast<unsigned long long>(reader.publishCount()),
+                static_cast<long long>(nowMs() - reader.publishTimeMs()),
+                rooms.empty() ? 0.0 : sum / double(rooms.size()));
+
+    const int count = std::min(shownRooms, int(rooms.size()));
+    for (int roomId = 0; roomId < count; ++roomId) {
+        const SharedRoomRecord &room = rooms[size_t(roomId)];
+        std::printf("  %6d  %7.2f °C  %6.1f %%  %9.1f Па  уставка %6.2f  мощность %+5.2f  %s\n",
+                    roomId + 1, room.temperature, room.humidity, room.pressure, room.setpoint, room.output,
+                    room.airflow < 4 ? airflowNames[room.airflow] : "?");
+    }
+    return true;
+}
+
+void usage() {
+    std::fprintf(stderr, "Использование: statedump [имя сегмента] [--watch мс] [--rooms N]\n");
+}
+
+} // namespace
+
+/**
+ * @brief Пример чтения состояния комнат из разделяемой памяти ядра.
+ *
+ * Без --watch печатает один снимок. С --watch печатает снимок с заданным
+ * периодом и открывает сегмент заново, если писатель его закрыл или
+ * заменил (например, при росте числа комнат).
+ */
+int main(int argc, char *argv[]) {
+    std::string name = SharedState::DefaultName;
+    int watchMs = 0;
+    int shownRooms = 10;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--watch") == 0 && i + 1 < argc) {
+            watchMs = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--rooms") == 0 && i + 1 < argc) {
+            shownRooms = std::atoi(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 2;
+        } else {
+            name = argv[i];
+        }
+    }
+
+    SharedStateReader reader;
+    std::vector<SharedRoomRecord> rooms;
+    for (;;) {
+        if (!reader.isOpen() || reader.isStale()) {
+            if (!reader.open(name)) {
+                std::fprintf(stderr, "%s\n", reader.errorString().c_str());
+                if (watchMs <= 0)
+                    return 1;
+            }
+        }
+        if (reader.isOpen() && !printSnapshot(reader, rooms, shownRooms) && watchMs <= 0)
+            return 1;
+        if (watchMs <= 0)
+            return 0;
+        std::this_thread::sleep_for(std::chrono::milliseconds(watchMs));
+    }
+}
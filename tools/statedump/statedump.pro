@@ -0,0 +1,15 @@
+# Пример потребителя разделяемой памяти ядра: печатает состояние комнат.
+#
+#   ./untitled1 --headless --simulate 60 --shm /climate-state
+#   ./statedump /climate-state --watch 1000
+
+TEMPLATE = app
+CONFIG += c++17 console
+CONFIG -= qt app_bundle
+
+TARGET = statedump
+
+include(../../sharedstate.pri)
+
+SOURCES += \
+        main.cpp
@@ -0,0 +1,363 @@
+#include "trendchartitem.h"
+#include "profiler.h"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QGraphicsSceneWheelEvent>
+#include <QGraphicsSceneMouseEvent>
+#include <QDateTime>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+qint64 floorDiv(qint64 value, qint64 divisor) {
+    qint64 quotient = value / divisor;
+    if ((value % divisor != 0) && ((value < 0) != (divisor < 0)))
+        --quotient;
+    return quotient;
+}
+
+const QColor seriesColors[] = {QColor(220, 50, 47), QColor(38, 139, 210), QColor(133, 153, 0),
+                               QColor(211, 54, 130), QColor(181, 137, 0), QColor(42, 161, 152)};
+
+} // namespace
+
+/**
+ * @brief Конструктор графика.
+ * @param history История, из которой берутся данные; должна жить дольше графика.
+ */
+TrendChartItem::TrendChartItem(const RoomHistory *history, QGraphicsItem *parent)
+    : QGraphicsItem(parent), history(history)
+{
+    setFlag(ItemUsesExtendedStyleOption);  ///< Нужен exposedRect для отрисовки только видимой части
+    setCacheMode(NoCache);                 ///< Кэшируются пути сегментов, а не растровое изображение
+}
+
+QRectF TrendChartItem::boundingRect() const {
+    return QRectF(QPointF(0, 0), itemSize);
+}
+
+QRectF TrendChartItem::plotRect() const {
+    return QRectF(AxisWidth, 8, std::max<qreal>(itemSize.width() - AxisWidth - 8, 1),
+                  std::max<qreal>(itemSize.height() - 28, 1));
+}
+
+int TrendChartItem::plotColumns() const {
+    return std::max(int(plotRect().width()), 1);
+}
+
+void TrendChartItem::setSize(const QSizeF &size) {
+    if (itemSize == size)
+        return;
+    prepareGeometryChange();
+    itemSize = size;
+    updateSegments();
+    updateValueRange();
+}
+
+void TrendChartItem::setRooms(const QVector<int> &roomIds) {
+    QVector<Series> updated;
+    for (int i = 0; i < roomIds.size(); ++i) {
+        const int roomId = roomIds[i];
+        auto existing = std::find_if(series.begin(), series.end(),
+                                     [roomId](const Series &s) { return s.roomId == roomId; });
+        Series item = existing != series.end() ? *existing : Series{roomId, QColor(), {}};
+        item.color = seriesColors[i % int(sizeof(seriesColors) / sizeof(seriesColors[0]))];
+        updated.append(item);
+    }
+    series = updated;
+    updateSegments();
+    updateValueRange();
+    update();
+}
+
+void TrendChartItem::setMetric(Metric newMetric) {
+    if (metric == newMetric)
+        return;
+    metric = newMetric;
+    invalidate();
+}
+
+/**
+ * @brief Меняет единицу оси значений.
+ *
+ * Пути сегментов хранятся в базовых единицах, перевод выполняется
+ * преобразованием при отрисовке, поэтому кэш не сбрасывается.
+ */
+void TrendChartItem::setValueConversion(AffineConversion conversion, const QString &unitSymbol) {
+    valueConversion = conversion;
+    valueUnit = unitSymbol;
+    updateValueRange();
+    update();
+}
+
+/**
+ * @brief Меняет масштаб оси времени, сохраняя время у правого края.
+ */
+void TrendChartItem::setMsPerColumn(qint64 milliseconds) {
+    milliseconds = std::clamp<qint64>(milliseconds, 10, 3600 * 1000);
+    if (milliseconds == msPerColumn)
+        return;
+    const qint64 endMs = endColumn * msPerColumn;
+    msPerColumn = milliseconds;
+    endColumn = floorDiv(endMs, msPerColumn);
+    invalidate();
+}
+
+void TrendChartItem::setFollowLive(bool follow) {
+    followLive = follow;
+    if (followLive)
+        refresh(nowMs);
+}
+
+void TrendChartItem::invalidate() {
+    for (Series &s : series)
+        s.segments.clear();
+    updateSegments();
+    updateValueRange();
+    update();
+}
+
+/**
+ * @brief Строит сегмент графика по агрегатам истории.
+ *
+ * Диапазон запроса начинается на один столбец раньше сегмента,
+ * чтобы линия соседних сегментов была непрерывной.
+ */
+TrendChartItem::Segment TrendChartItem::buildSegment(int roomId, qint64 segmentIndex) const {
+    Segment segment;
+    const qint64 firstColumn = segmentIndex * SegmentColumns;
+    const qint64 fromMs = (firstColumn - 1) * msPerColumn;
+    const qint64 toMs = (firstColumn + SegmentColumns) * msPerColumn;
+    segment.complete = toMs <= nowMs;
+
+    const QVector<HistoryPoint> points = history->query(roomId, metric, fromMs, toMs, SegmentColumns + 1);
+    if (points.isEmpty())
+        return segment;
+
+    segment.empty = false;
+    segment.minValue = std::numeric_limits<double>::max();
+    segment.maxValue = std::numeric_limits<double>::lowest();
+
+    QPolygonF upper;
+    QPolygonF lower;
+    upper.reserve(points.size());
+    lower.reserve(points.size());
+    for (const HistoryPoint &point : points) {
+        const qreal x = qreal(floorDiv(point.timestampMs, msPerColumn) - firstColumn);
+        upper.append(QPointF(x, point.max));
+        lower.append(QPointF(x, point.min));
+        if (segment.line.elementCount() == 0)
+            segment.line.moveTo(x, point.avg);
+        else
+            segment.line.lineTo(x, point.avg);
+        segment.minValue = std::min(segment.minValue, point.min);
+        segment.maxValue = std::max(segment.maxValue, point.max);
+    }
+
+    std::reverse(lower.begin(), lower.end());
+    upper += lower;
+    segment.band.addPolygon(upper);
+    segment.band.closeSubpath();
+    return segment;
+}
+
+/**
+ * @brief Приводит кэш сегментов в соответствие с видимым диапазоном.
+ *
+ * Отсутствующие и незавершённые видимые сегменты строятся заново,
+ * сегменты далеко за пределами экрана удаляются.
+ */
+void TrendChartItem::updateSegments() {
+    const qint64 firstSegment = floorDiv(firstVisibleColumn(), SegmentColumns);
+    const qint64 lastSegment = floorDiv(endColumn, SegmentColumns);
+
+    for (Series &s : series) {
+        for (auto it = s.segments.begin(); it != s.segments.end();) {
+            if (it.key() < firstSegment - 1 || it.key() > lastSegment + 1)
+                it = s.segments.erase(it);
+            else
+                ++it;
+        }
+        for (qint64 index = firstSegment; index <= lastSegment; ++index) {
+            auto it = s.segments.find(index);
+            if (it == s.segments.end() || !it->complete)
+                s.segments.insert(index, buildSegment(s.roomId, index));
+        }
+    }
+}
+
+/**
+ * @brief Пересчитывает диапазон оси значений по границам видимых сегментов.
+ *
+ * Пути строятся в единицах величины, поэтому смена диапазона их не затрагивает.
+ */
+void TrendChartItem::updateValueRange() {
+    const qint64 firstSegment = floorDiv(firstVisibleColumn(), SegmentColumns);
+    const qint64 lastSegment = floorDiv(endColumn, SegmentColumns);
+
+    double low = std::numeric_limits<double>::max();
+    double high = std::numeric_limits<double>::lowest();
+    for (const Series &s : series) {
+        for (auto it = s.segments.constBegin(); it != s.segments.constEnd(); ++it) {
+            if (it.key() < firstSegment || it.key() > lastSegment || it->empty)
+                continue;
+            low = std::min(low, it->minValue);
+            high = std::max(high, it->maxValue);
+        }
+    }
+    if (low > high) {
+        low = 0.0;
+        high = 1.0;
+    }
+    low = valueConversion.apply(low);
+    high = valueConversion.apply(high);
+    const double padding = std::max((high - low) * 0.05, 0.5);
+    valueMin = low - padding;
+    valueMax = high + padding;
+}
+
+/**
+ * @brief Обновляет график по новым данным истории.
+ *
+ * В режиме слежения график сдвигается целиком (пути не перестраиваются),
+ * иначе перерисовывается только область последнего сегмента.
+ */
+void TrendChartItem::refresh(qint64 currentMs) {
+    CLIMATE_PROFILE_SCOPE(TrendRefresh);
+    nowMs = currentMs;
+    const double previousMin = valueMin;
+    const double previousMax = valueMax;
+
+    if (followLive)
+        endColumn = floorDiv(nowMs, msPerColumn);
+    updateSegments();
+    updateValueRange();
+
+    if (followLive || previousMin != valueMin || previousMax != valueMax) {
+        update();
+        return;
+    }
+
+    const QRectF plot = plotRect();
+    const qint64 tailColumn = floorDiv(nowMs, msPerColumn) / SegmentColumns * SegmentColumns;
+    const qreal tailX = plot.left() + qreal(tailColumn - firstVisibleColumn());
+    if (tailX <= plot.right())
+        update(QRectF(QPointF(std::max(tailX, plot.left()), plot.top()), plot.bottomRight()).adjusted(-1, -1, 1, 1));
+}
+
+void TrendChartItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) {
+    Q_UNUSED(widget);
+    CLIMATE_PROFILE_SCOPE(TrendPaint);
+
+    const QRectF exposed = option->exposedRect;
+    const QRectF plot = plotRect();
+    const QPalette &palette = option->palette;
+
+    painter->fillRect(exposed, palette.base());
+
+    // Подписи оси значений и масштаба времени
+    if (exposed.left() < plot.left() || exposed.bottom() > plot.bottom()) {
+        painter->setPen(palette.text().color());
+        painter->drawText(QRectF(0, plot.top() - 6, AxisWidth - 4, 14), Qt::AlignRight | Qt::AlignVCenter,
+                          QString("%1 %2").arg(valueMax, 0, 'f', 1).arg(valueUnit));
+        painter->drawText(QRectF(0, plot.bottom() - 8, AxisWidth - 4, 14), Qt::AlignRight | Qt::AlignVCenter,
+                          QString("%1 %2").arg(valueMin, 0, 'f', 1).arg(valueUnit));
+        painter->drawText(QRectF(plot.left(), plot.bottom() + 2, plot.width(), 16), Qt::AlignLeft | Qt::AlignVCenter,
+                          QString("%1 с/пиксель").arg(double(msPerColumn) / 1000.0));
+        painter->drawText(QRectF(plot.left(), plot.bottom() + 2, plot.width(), 16), Qt::AlignRight | Qt::AlignVCenter,
+                          QDateTime::fromMSecsSinceEpoch(endColumn * msPerColumn).toString("dd.MM HH:mm:ss"));
+    }
+
+    painter->setPen(QPen(palette.mid().color(), 0));
+    painter->drawRect(plot);
+
+    const QRectF area = exposed.intersected(plot);
+    if (area.isEmpty() || series.isEmpty())
+        return;
+
+    painter->save();
+    painter->setClipRect(area);
+
+    const double yScale = plot.height() / (valueMax - valueMin);
+    const qint64 firstColumn = firstVisibleColumn();
+    // Рисуются только сегменты, пересекающие открытую область
+    const qint64 firstSegment = floorDiv(firstColumn + qint64(area.left() - plot.left()), SegmentColumns);
+    const qint64 lastSegment = floorDiv(firstColumn + qint64(std::ceil(area.right() - plot.left())), SegmentColumns);
+    const QTransform base = painter->transform();
+
+    for (const Series &s : series) {
+        QColor bandColor = s.color;
+        bandColor.setAlpha(60);
+        QPen linePen(s.color, 0);
+        linePen.setCosmetic(true);
+
+        for (qint64 index = firstSegment; index <= lastSegment; ++index) {
+            auto it = s.segments.constFind(index);
+            if (it == s.segments.constEnd() || it->empty)
+                continue;
+
+            // Столбец -> пиксель по x; значение -> единица оси -> пиксель по y (ось направлена вверх)
+            QTransform transform;
+            transform.translate(plot.left() + qreal(index * SegmentColumns - firstColumn),
+                                plot.bottom() - (valueConversion.offset - valueMin) * yScale);
+            transform.scale(1.0, -yScale * valueConversion.scale);
+            painter->setTransform(transform * base);
+
+            painter->setPen(Qt::NoPen);
+            painter->setBrush(bandColor);
+            painter->drawPath(it->band);
+            painter->setBrush(Qt::NoBrush);
+            painter->setPen(linePen);
+            painter->drawPath(it->line);
+        }
+    }
+
+    painter->setTransform(base);
+    int legendX = int(plot.left()) + 6;
+    for (const Series &s : series) {
+        const QString name = QString("Комната %1").arg(s.roomId + 1);
+        painter->setPen(s.color);
+        painter->drawText(QPointF(legendX, plot.top() + 14), name);
+        legendX += painter->fontMetrics().horizontalAdvance(name) + 12;
+    }
+    painter->restore();
+}
+
+/**
+ * @brief Колесо мыши меняет масштаб оси времени вдвое.
+ */
+void TrendChartItem::wheelEvent(QGraphicsSceneWheelEvent *event) {
+    setMsPerColumn(event->delta() > 0 ? msPerColumn / 2 : msPerColumn * 2);
+    event->accept();
+}
+
+void TrendChartItem::mousePressEvent(QGraphicsSceneMouseEvent *event) {
+    dragStartX = event->pos().x();
+    dragStartColumn = endColumn;
+    event->accept();
+}
+
+/**
+ * @brief Перетаскивание прокручивает график по времени и отключает слежение.
+ *
+ * Готовые сегменты только сдвигаются, строятся лишь появившиеся на экране.
+ */
+void TrendChartItem::mouseMoveEvent(QGraphicsSceneMouseEvent *event) {
+    followLive = false;
+    endColumn = dragStartColumn - qint64(event->pos().x() - dragStartX);
+    updateSegments();
+    updateValueRange();
+    update();
+}
+
+/**
+ * @brief Двойной щелчок возвращает график к текущему времени.
+ */
+void TrendChartItem::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) {
+    setFollowLive(true);
+    event->accept();
+}
@@ -0,0 +1,96 @@
+#ifndef TRENDCHARTITEM_H
+#define TRENDCHARTITEM_H
+
+#include <QGraphicsItem>
+#include <QPainterPath>
+#include <QColor>
+#include <QHash>
+#include <QVector>
+
+#include "roomhistory.h"
+#include "unitconversion.h"
+
+/**
+ * @brief График трендов величины по нескольким комнатам для QGraphicsScene.
+ *
+ * Ось времени разбита на столбцы по одному пикселю (msPerColumn мс на столбец),
+ * данные для столбца берутся из RoomHistory как агрегат min/max/avg, поэтому
+ * объём отрисовки не зависит от числа измерений. Столбцы сгруппированы в сегменты
+ * по SegmentColumns, для каждого сегмента путь QPainterPath строится один раз
+ * в координатах "столбец/значение" и рисуется через преобразование: прокрутка,
+ * изменение масштаба и единицы измерения оси значений (аффинный перевод из
+ * unitconversion.h) не требуют перестроения. При поступлении
+ * новых данных перестраивается только последний (незавершённый) сегмент.
+ *
+ * Рисуются только сегменты, попадающие в перерисовываемую область.
+ */
+class TrendChartItem : public QGraphicsItem {
+public:
+    static constexpr int SegmentColumns = 64;
+    static constexpr int AxisWidth = 56;  ///< Место под подписи оси значений
+
+    explicit TrendChartItem(const RoomHistory *history, QGraphicsItem *parent = nullptr);
+
+    void setSize(const QSizeF &size);
+    void setRooms(const QVector<int> &roomIds);
+    void setMetric(Metric metric);
+    void setValueConversion(AffineConversion conversion, const QString &unitSymbol); ///< Единица оси значений
+    void setMsPerColumn(qint64 milliseconds); ///< Масштаб оси времени
+    void setFollowLive(bool follow);          ///< Правый край графика следует за текущим временем
+    void refresh(qint64 nowMs);               ///< Подтянуть новые данные и перерисовать изменившееся
+    void invalidate();                        ///< Сбросить все кэшированные сегменты
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+protected:
+    void wheelEvent(QGraphicsSceneWheelEvent *event) override;
+    void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
+    void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
+    void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) override;
+
+private:
+    /// Кэшированный фрагмент графика одной комнаты
+    struct Segment {
+        QPainterPath band;   ///< Огибающая min/max
+        QPainterPath line;   ///< Средние значения
+        double minValue = 0.0;
+        double maxValue = 0.0;
+        bool empty = true;
+        bool complete = false; ///< Сегмент целиком в прошлом и больше не перестраивается
+    };
+
+    struct Series {
+        int roomId;
+        QColor color;
+        QHash<qint64, Segment> segments; ///< Ключ - номер сегмента (столбец / SegmentColumns)
+    };
+
+    Segment buildSegment(int roomId, qint64 segmentIndex) const;
+    void updateSegments();
+    void updateValueRange();
+    QRectF plotRect() const;
+    int plotColumns() const;
+    qint64 firstVisibleColumn() const { return endColumn - plotColumns() + 1; }
+
+    const RoomHistory *history;
+    QSizeF itemSize = QSizeF(400, 300);
+    Metric metric = Metric::Temperature;
+    QVector<Series> series;
+
+    qint64 msPerColumn = 1000;
+    qint64 endColumn = 0;       ///< Абсолютный номер самого правого видимого столбца
+    qint64 nowMs = 0;
+    bool followLive = true;
+
+    AffineConversion valueConversion{1.0, 0.0}; ///< Из базовой единицы истории в единицу оси
+    QString valueUnit;
+
+    double valueMin = 0.0;      ///< Текущий диапазон оси значений (в единице оси)
+    double valueMax = 1.0;
+
+    qreal dragStartX = 0.0;
+    qint64 dragStartColumn = 0;
+};
+
+#endif // TRENDCHARTITEM_H
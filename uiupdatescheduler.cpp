@@ -0,0 +1,183 @@
+#include "uiupdatescheduler.h"
+#include "profiler.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+/**
+ * @brief Конструктор планировщика.
+ * @param store Хранилище, изменения которого публикуются в интерфейс.
+ */
+UiUpdateScheduler::UiUpdateScheduler(RoomStateStore *store, QObject *parent)
+    : QObject(parent), store(store)
+{
+    frameTimer.setSingleShot(true);
+    frameTimer.setTimerType(Qt::PreciseTimer);
+    frameTimer.setInterval(DefaultFrameIntervalMs);
+    connect(&frameTimer, &QTimer::timeout, this, &UiUpdateScheduler::flush);
+
+    connect(store, &RoomStateStore::roomChanged, this, &UiUpdateScheduler::markDirty);
+    connect(store, &RoomStateStore::allRoomsChanged, this, &UiUpdateScheduler::markAllDirty);
+    connect(store, &RoomStateStore::samplesApplied, this, &UiUpdateScheduler::markAppliedSamples);
+    connect(store, &RoomStateStore::outputsApplied, this, &UiUpdateScheduler::markAppliedSamples);
+    connect(store, &RoomStateStore::roomsReset, this, &UiUpdateScheduler::resetSnapshot);
+
+    resetSnapshot();
+}
+
+void UiUpdateScheduler::setFrameInterval(int milliseconds) {
+    frameTimer.setInterval(std::max(milliseconds, 0));
+}
+
+/**
+ * @brief Отмечает поля комнаты как изменённые.
+ *
+ * Повторная отметка уже отмеченного поля до ближайшего кадра
+ * учитывается как объединённое обновление.
+ */
+void UiUpdateScheduler::markDirty(int roomId, int fields) {
+    if (roomId < 0 || roomId >= int(dirtyMask.size()) || !fields)
+        return;
+
+    quint8 &mask = dirtyMask[roomId];
+    requestedCount += quint64(qPopulationCount(quint32(fields)));
+    coalescedCount += quint64(qPopulationCount(quint32(mask & fields)));
+    if (dirtyRooms.empty())
+        firstDirtyNs = Profiler::now();
+    if (!mask)
+        dirtyRooms.push_back(roomId);
+    mask |= quint8(fields);
+
+    if (!frameTimer.isActive())
+        frameTimer.start();
+}
+
+/**
+ * @brief Отмечает поля всех комнат как изменённые (например, при смене единиц или заливке значения).
+ */
+void UiUpdateScheduler::markAllDirty(int fields) {
+    for (int roomId = 0; roomId < int(dirtyMask.size()); ++roomId)
+        markDirty(roomId, fields);
+}
+
+/**
+ * @brief Отмечает комнаты, изменённые последним пакетом измерений или мощности регулятора.
+ */
+void UiUpdateScheduler::markAppliedSamples() {
+    for (const RoomStateStore::RoomChange &change : store->lastAppliedChanges())
+        markDirty(change.roomId, change.fields);
+}
+
+/**
+ * @brief Сравнивает поля комнаты с опубликованными значениями и обновляет снимок.
+ * @return Маска полей, значения которых действительно изменились.
+ */
+int UiUpdateScheduler::changedFields(int roomId, int fields) {
+    int changed = 0;
+    if (fields & RoomStateStore::TemperatureField) {
+        const double value = store->temperature(roomId);
+        if (publishedTemperature[roomId] != value) {
+            publishedTemperature[roomId] = value;
+            changed |= RoomStateStore::TemperatureField;
+        }
+    }
+    if (fields & RoomStateStore::HumidityField) {
+        const double value = store->humidity(roomId);
+        if (publishedHumidity[roomId] != value) {
+            publishedHumidity[roomId] = value;
+            changed |= RoomStateStore::HumidityField;
+        }
+    }
+    if (fields & RoomStateStore::PressureField) {
+        const double value = store->pressure(roomId);
+        if (publishedPressure[roomId] != value) {
+            publishedPressure[roomId] = value;
+            changed |= RoomStateStore::PressureField;
+        }
+    }
+    if (fields & RoomStateStore::AirflowField) {
+        const AirflowDirection value = store->airflow(roomId);
+        if (publishedAirflow[roomId] != value) {
+            publishedAirflow[roomId] = value;
+            changed |= RoomStateStore::AirflowField;
+        }
+    }
+    if (fields & RoomStateStore::SetpointField) {
+        const double value = store->setpoint(roomId);
+        if (publishedSetpoint[roomId] != value) {
+            publishedSetpoint[roomId] = value;
+            changed |= RoomStateStore::SetpointField;
+        }
+    }
+    if (fields & RoomStateStore::OutputField) {
+        const double value = store->output(roomId);
+        if (publishedOutput[roomId] != value) {
+            publishedOutput[roomId] = value;
+            changed |= RoomStateStore::OutputField;
+        }
+    }
+
+    const int published = qPopulationCount(quint32(changed));
+    publishedCount += quint64(published);
+    skippedCount += quint64(qPopulationCount(quint32(fields)) - published);
+    return changed;
+}
+
+/**
+ * @brief Публикует накопленные изменения одним проходом.
+ *
+ * Комнаты обходятся по возрастанию идентификатора, подряд идущие
+ * изменённые комнаты объединяются в один сигнал roomRangeChanged.
+ */
+void UiUpdateScheduler::flush() {
+    frameTimer.stop();
+    if (dirtyRooms.empty())
+        return;
+    CLIMATE_PROFILE_SCOPE(UiFrame);
+
+    std::sort(dirtyRooms.begin(), dirtyRooms.end());
+
+    int runFirst = -1;
+    int runLast = -1;
+    int runFields = 0;
+    for (int roomId : dirtyRooms) {
+        const int fields = changedFields(roomId, dirtyMask[roomId]);
+        dirtyMask[roomId] = 0;
+        if (!fields)
+            continue;
+
+        if (runFirst >= 0 && roomId == runLast + 1) {
+            runLast = roomId;
+            runFields |= fields;
+            continue;
+        }
+        if (runFirst >= 0)
+            emit roomRangeChanged(runFirst, runLast, runFields);
+        runFirst = runLast = roomId;
+        runFields = fields;
+    }
+    if (runFirst >= 0)
+        emit roomRangeChanged(runFirst, runLast, runFields);
+
+    dirtyRooms.clear();
+    ++frameCount;
+    emit flushed();
+    CLIMATE_PROFILE_RECORD(ChangeToScreen, Profiler::now() - firstDirtyNs);
+}
+
+/**
+ * @brief Пересоздаёт снимок опубликованных значений после смены числа комнат.
+ */
+void UiUpdateScheduler::resetSnapshot() {
+    frameTimer.stop();
+    const int count = store->roomCount();
+    dirtyMask.assign(size_t(count), 0);
+    dirtyRooms.clear();
+    publishedTemperature.assign(store->temperatures(), store->temperatures() + count);
+    publishedHumidity.assign(store->humidities(), store->humidities() + count);
+    publishedPressure.assign(store->pressures(), store->pressures() + count);
+    publishedAirflow.assign(store->airflows(), store->airflows() + count);
+    publishedSetpoint.assign(store->setpoints(), store->setpoints() + count);
+    publishedOutput.assign(store->outputs(), store->outputs() + count);
+}
@@ -0,0 +1,74 @@
+#ifndef UIUPDATESCHEDULER_H
+#define UIUPDATESCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <vector>
+
+#include "roomstate.h"
+
+/**
+ * @brief Планировщик обновлений интерфейса с объединением по кадрам.
+ *
+ * Собирает изменения комнат в множество "грязных" комнат с маской полей
+ * и публикует их не чаще одного раза за кадр (по умолчанию ~60 Гц).
+ * При публикации значения сравниваются с последними опубликованными,
+ * неизменившиеся поля отбрасываются, а соседние комнаты объединяются
+ * в один диапазон, чтобы представление получало минимум сигналов.
+ */
+class UiUpdateScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultFrameIntervalMs = 16; ///< ~60 кадров в секунду
+
+    explicit UiUpdateScheduler(RoomStateStore *store, QObject *parent = nullptr);
+
+    void setFrameInterval(int milliseconds);
+    int frameInterval() const { return frameTimer.interval(); }
+
+    quint64 requestedUpdates() const { return requestedCount; } ///< Всего отмеченных изменений
+    quint64 coalescedUpdates() const { return coalescedCount; } ///< Изменения, поглощённые более поздними в том же кадре
+    quint64 skippedUpdates() const { return skippedCount; }     ///< Изменения, не поменявшие значение
+    quint64 publishedUpdates() const { return publishedCount; } ///< Реально опубликованные поля
+    quint64 frames() const { return frameCount; }
+
+public slots:
+    void markDirty(int roomId, int fields);
+    void markAllDirty(int fields);
+    void flush(); ///< Немедленная публикация накопленных изменений
+
+signals:
+    void roomRangeChanged(int firstRoomId, int lastRoomId, int fields); ///< fields - флаги RoomStateStore::Field
+    void flushed(); ///< Кадр опубликован, счётчики обновлены
+
+private slots:
+    void resetSnapshot();
+    void markAppliedSamples();
+
+private:
+    int changedFields(int roomId, int fields);
+
+    RoomStateStore *store;
+    QTimer frameTimer;
+
+    std::vector<quint8> dirtyMask;  ///< Маска изменённых полей по комнатам
+    std::vector<int> dirtyRooms;    ///< Комнаты с ненулевой маской
+    qint64 firstDirtyNs = 0;        ///< Время первого изменения текущего кадра, см. Profiler::now()
+
+    ///< Последние опубликованные значения
+    std::vector<double> publishedTemperature;
+    std::vector<double> publishedHumidity;
+    std::vector<double> publishedPressure;
+    std::vector<AirflowDirection> publishedAirflow;
+    std::vector<double> publishedSetpoint;
+    std::vector<double> publishedOutput;
+
+    quint64 requestedCount = 0;
+    quint64 coalescedCount = 0;
+    quint64 skippedCount = 0;
+    quint64 publishedCount = 0;
+    quint64 frameCount = 0;
+};
+
+#endif // UIUPDATESCHEDULER_H
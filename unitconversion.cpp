@@ -0,0 +1,84 @@
+#include "unitconversion.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define CLIMATE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+const char *temperatureUnitSymbol(TemperatureUnit unit) {
+    switch (unit) {
+    case TemperatureUnit::Fahrenheit: return "°F";
+    case TemperatureUnit::Kelvin:     return "K";
+    case TemperatureUnit::Celsius:    break;
+    }
+    return "°C";
+}
+
+const char *pressureUnitSymbol(PressureUnit unit) {
+    return unit == PressureUnit::MmHg ? "мм.рт.ст." : "Па";
+}
+
+void convertColumnScalar(const double *in, double *out, size_t count, AffineConversion conversion) {
+    for (size_t i = 0; i < count; ++i)
+        out[i] = conversion.apply(in[i]);
+}
+
+#ifdef CLIMATE_X86_SIMD
+
+namespace {
+
+/// SSE2: по два значения, умножение и сложение раздельно (без FMA)
+void convertColumnSse2(const double *in, double *out, size_t count, AffineConversion conversion) {
+    const __m128d scale = _mm_set1_pd(conversion.scale);
+    const __m128d offset = _mm_set1_pd(conversion.offset);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128d a = _mm_loadu_pd(in + i);
+        const __m128d b = _mm_loadu_pd(in + i + 2);
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_mul_pd(a, scale), offset));
+        _mm_storeu_pd(out + i + 2, _mm_add_pd(_mm_mul_pd(b, scale), offset));
+    }
+    convertColumnScalar(in + i, out + i, count - i, conversion);
+}
+
+#if defined(__GNUC__)
+/// AVX2: по восемь значений за итерацию, код собирается для AVX2 независимо от флагов проекта
+__attribute__((target("avx2")))
+void convertColumnAvx2(const double *in, double *out, size_t count, AffineConversion conversion) {
+    const __m256d scale = _mm256_set1_pd(conversion.scale);
+    const __m256d offset = _mm256_set1_pd(conversion.offset);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256d a = _mm256_loadu_pd(in + i);
+        const __m256d b = _mm256_loadu_pd(in + i + 4);
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_mul_pd(a, scale), offset));
+        _mm256_storeu_pd(out + i + 4, _mm256_add_pd(_mm256_mul_pd(b, scale), offset));
+    }
+    convertColumnScalar(in + i, out + i, count - i, conversion);
+}
+
+bool hasAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#endif
+
+} // namespace
+
+void convertColumn(const double *in, double *out, size_t count, AffineConversion conversion) {
+#if defined(__GNUC__)
+    if (hasAvx2()) {
+        convertColumnAvx2(in, out, count, conversion);
+        return;
+    }
+#endif
+    convertColumnSse2(in, out, count, conversion);
+}
+
+#else
+
+void convertColumn(const double *in, double *out, size_t count, AffineConversion conversion) {
+    convertColumnScalar(in, out, count, conversion);
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef UNITCONVERSION_H
+#define UNITCONVERSION_H
+
+#include <cstddef>
+
+/// Единицы температуры в порядке элементов temperatureUnitCombo
+enum class TemperatureUnit : int {
+    Celsius = 0,   ///< °C (базовая единица хранения)
+    Fahrenheit,    ///< °F
+    Kelvin         ///< K
+};
+
+/// Единицы давления в порядке элементов pressureUnitCombo
+enum class PressureUnit : int {
+    Pascal = 0,    ///< Па (базовая единица хранения)
+    MmHg           ///< мм.рт.ст.
+};
+
+/**
+ * @brief Аффинное преобразование y = x * scale + offset.
+ *
+ * Все поддерживаемые пары единиц сводятся к нему, поэтому скалярный
+ * и векторный пути выполняют одни и те же две операции (умножение, затем
+ * сложение) и дают побитово одинаковый результат. Сборка идёт с
+ * -ffp-contract=off, чтобы компилятор не сливал их в FMA в скалярном коде.
+ */
+struct AffineConversion {
+    double scale;
+    double offset;
+
+    constexpr double apply(double value) const { return value * scale + offset; }
+};
+
+/// Коэффициенты перевода из базовой единицы в заданную, вычисляются при компиляции
+template <TemperatureUnit To> struct TemperatureConversion;
+template <> struct TemperatureConversion<TemperatureUnit::Celsius>    { static constexpr AffineConversion value{1.0, 0.0}; };
+template <> struct TemperatureConversion<TemperatureUnit::Fahrenheit> { static constexpr AffineConversion value{9.0 / 5.0, 32.0}; };
+template <> struct TemperatureConversion<TemperatureUnit::Kelvin>     { static constexpr AffineConversion value{1.0, 273.15}; };
+
+template <PressureUnit To> struct PressureConversion;
+template <> struct PressureConversion<PressureUnit::Pascal> { static constexpr AffineConversion value{1.0, 0.0}; };
+template <> struct PressureConversion<PressureUnit::MmHg>   { static constexpr AffineConversion value{1.0 / 133.322, 0.0}; };
+
+constexpr AffineConversion temperatureConversion(TemperatureUnit unit) {
+    return unit == TemperatureUnit::Fahrenheit ? TemperatureConversion<TemperatureUnit::Fahrenheit>::value
+         : unit == TemperatureUnit::Kelvin     ? TemperatureConversion<TemperatureUnit::Kelvin>::value
+                                               : TemperatureConversion<TemperatureUnit::Celsius>::value;
+}
+
+constexpr AffineConversion pressureConversion(PressureUnit unit) {
+    return unit == PressureUnit::MmHg ? PressureConversion<PressureUnit::MmHg>::value
+                                      : PressureConversion<PressureUnit::Pascal>::value;
+}
+
+constexpr double convertTemperature(double celsius, TemperatureUnit unit) {
+    return temperatureConversion(unit).apply(celsius);
+}
+
+constexpr double convertPressure(double pascal, PressureUnit unit) {
+    return pressureConversion(unit).apply(pascal);
+}
+
+const char *temperatureUnitSymbol(TemperatureUnit unit);
+const char *pressureUnitSymbol(PressureUnit unit);
+
+/**
+ * @brief Переводит столбец значений за один проход.
+ *
+ * Выбирает при запуске AVX2 или SSE2, на прочих платформах - скалярный цикл.
+ * Результат совпадает с AffineConversion::apply() для каждого элемента.
+ * Допускается in == out.
+ */
+void convertColumn(const double *in, double *out, size_t count, AffineConversion conversion);
+void convertColumnScalar(const double *in, double *out, size_t count, AffineConversion conversion);
+
+template <TemperatureUnit To>
+inline void convertTemperatureColumn(const double *celsius, double *out, size_t count) {
+    convertColumn(celsius, out, count, TemperatureConversion<To>::value);
+}
+
+template <PressureUnit To>
+inline void convertPressureColumn(const double *pascal, double *out, size_t count) {
+    convertColumn(pascal, out, count, PressureConversion<To>::value);
+}
+
+#endif // UNITCONVERSION_H
@@ -1,5 +1,12 @@
-QT    += core gui
-QT    += widgets
+QT    += core
+
+# qmake CONFIG+=headless - сборка без QtGui и виджетов, только ядро
+headless {
+    QT -= gui
+    DEFINES += CLIMATE_HEADLESS
+} else {
+    QT += gui widgets
+}
 
 CONFIG += c++17 cmdline
 
@@ -7,17 +14,17 @@ CONFIG += c++17 cmdline
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+include(engine.pri)
+
 SOURCES += \
-        main.cpp \
-        source.cpp
+        main.cpp
+
+!headless: include(gui.pri)
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
-HEADERS += \
-    header.h
-
 DISTFILES += \
     user_manual.docx